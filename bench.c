@@ -0,0 +1,432 @@
+/**
+ * @file bench.c
+ * @brief Implements `devcli bench` and `devcli verify`: cJSON versus the tape DOM.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "bench.h"
+#include "cJSON.h"
+#include "devcli.h"
+#include "tape.h"
+#include "log.h"
+
+/** @addtogroup bench
+ *  @{
+ */
+
+/**
+ * @def BENCH_MIN_SECONDS
+ * @brief Each parser is run repeatedly for at least this long.
+ */
+#define BENCH_MIN_SECONDS 0.25
+
+/**
+ * @def BENCH_SYNTHETIC_BYTES
+ * @brief Approximate size of the generated catalog used for large-input numbers.
+ */
+#define BENCH_SYNTHETIC_BYTES (8u<<20)
+
+/**
+ * @def BENCH_VERIFY_THREADS
+ * @brief Thread count forced by `verifyParsers()` so the parallel path runs
+ *        even on single-core machines.
+ */
+#define BENCH_VERIFY_THREADS 4
+
+/**
+ * @def BENCH_MALLOC_HEADER
+ * @brief Bytes prepended to every counted allocation to remember its size.
+ */
+#define BENCH_MALLOC_HEADER 16
+
+/**
+ * @def BENCH_ALLOCATOR_OVERHEAD
+ * @brief Typical per-allocation bookkeeping of a general-purpose malloc, used
+ *        to estimate the real heap footprint of many small allocations.
+ */
+#define BENCH_ALLOCATOR_OVERHEAD 16
+
+/**
+ * @brief Allocation statistics gathered through cJSON hooks.
+ */
+static struct {
+    size_t live;
+    size_t peak;
+    size_t count;
+} heapStats;
+
+static void *countingMalloc(size_t size){
+    unsigned char *block=malloc(size+BENCH_MALLOC_HEADER);
+    if(!block) return NULL;
+    memcpy(block, &size, sizeof(size));
+    heapStats.live+=size;
+    heapStats.count++;
+    if(heapStats.live>heapStats.peak) heapStats.peak=heapStats.live;
+    return block+BENCH_MALLOC_HEADER;
+}
+
+static void countingFree(void *ptr){
+    if(!ptr) return;
+    unsigned char *block=(unsigned char*)ptr-BENCH_MALLOC_HEADER;
+    size_t size;
+    memcpy(&size, block, sizeof(size));
+    heapStats.live-=size;
+    free(block);
+}
+
+/**
+ * @brief Returns a monotonic timestamp in seconds.
+ */
+static double nowSeconds(void){
+    #ifdef _WIN32
+        LARGE_INTEGER frequency, counter;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&counter);
+        return (double)counter.QuadPart/(double)frequency.QuadPart;
+    #else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (double)ts.tv_sec+(double)ts.tv_nsec/1e9;
+    #endif
+}
+
+static size_t countNodes(const cJSON *item){
+    size_t count=0;
+    for(; item; item=item->next){
+        count+=1+countNodes(item->child);
+    }
+    return count;
+}
+
+/**
+ * @brief Sums the bytes of the separate key and value copies cJSON holds.
+ */
+static size_t countStringBytes(const cJSON *item, size_t *copies){
+    size_t bytes=0;
+    for(; item; item=item->next){
+        if(item->string){
+            bytes+=strlen(item->string)+1;
+            (*copies)++;
+        }
+        if(cJSON_IsString(item) && item->valuestring){
+            bytes+=strlen(item->valuestring)+1;
+            (*copies)++;
+        }
+        bytes+=countStringBytes(item->child, copies);
+    }
+    return bytes;
+}
+
+/**
+ * @brief Which parser a timing loop exercises.
+ */
+typedef enum {
+    BENCH_CJSON,
+    BENCH_TAPE,
+    BENCH_TAPE_INDEXED,
+    BENCH_TAPE_PARALLEL
+} BenchParser;
+
+/**
+ * @brief Returns the mean seconds per parse of `json` with `parser`.
+ */
+static double timeParser(BenchParser parser, const char *json, size_t len){
+    size_t iterations=0;
+    double start=nowSeconds(), elapsed;
+    do{
+        JsonTape doc;
+        switch(parser){
+            case BENCH_CJSON: cJSON_Delete(cJSON_ParseWithLength(json, len)); break;
+            case BENCH_TAPE: tapeParse(json, len, &doc); tapeFree(&doc); break;
+            case BENCH_TAPE_INDEXED: tapeParseIndexed(json, len, &doc, 1); tapeFree(&doc); break;
+            case BENCH_TAPE_PARALLEL: tapeParseIndexed(json, len, &doc, 0); tapeFree(&doc); break;
+        }
+        iterations++;
+        elapsed=nowSeconds()-start;
+    }while(elapsed<BENCH_MIN_SECONDS);
+    return elapsed/(double)iterations;
+}
+
+/**
+ * @brief Prints one comparison table for `json`.
+ *
+ * @return int `0` on success, `1` if a parser rejected the input.
+ */
+static int benchReport(const char *label, const char *json, size_t len){
+    cJSON_Hooks hooks={countingMalloc, countingFree};
+    cJSON_InitHooks(&hooks);
+    memset(&heapStats, 0, sizeof(heapStats));
+    cJSON *root=cJSON_ParseWithLength(json, len);
+    if(!root){
+        cJSON_InitHooks(NULL);
+        LOG_ERROR("cJSON rejected the input near: %.20s", cJSON_GetErrorPtr());
+        return 1;
+    }
+    size_t nodes=countNodes(root);
+    size_t stringCopies=0;
+    size_t stringBytes=countStringBytes(root, &stringCopies);
+    size_t treeBytes=heapStats.live;
+    size_t treeAllocations=heapStats.count;
+    cJSON_Delete(root);
+    double treeTime=timeParser(BENCH_CJSON, json, len);
+    cJSON_InitHooks(NULL);
+
+    JsonTape doc;
+    if(tapeParse(json, len, &doc)!=0){
+        LOG_ERROR("Tape parser rejected the input at byte %zu.", doc.errorOffset);
+        return 1;
+    }
+    size_t words=doc.length;
+    size_t tapeBytes=tapeMemoryUsage(&doc);
+    size_t distinct=doc.internCount, arenaBytes=doc.stringsSize;
+    size_t repeats=doc.internHits, savedBytes=doc.internSaved;
+    tapeFree(&doc);
+    double tapeTime=timeParser(BENCH_TAPE, json, len);
+    double indexedTime=timeParser(BENCH_TAPE_INDEXED, json, len);
+    double parallelTime=timeParser(BENCH_TAPE_PARALLEL, json, len);
+
+    printf("%s: %zu bytes\n", label, len);
+    size_t treeHeap=treeBytes+treeAllocations*BENCH_ALLOCATOR_OVERHEAD;
+    size_t tapeHeap=tapeBytes+3*BENCH_ALLOCATOR_OVERHEAD;
+    char parallelLabel[32];
+    snprintf(parallelLabel, sizeof(parallelLabel), "indexed x%d", tapeHardwareThreads());
+    printf("%-14s %-12s %-10s %-12s %-13s %-12s\n", "Parser", "Parse (us)", "MB/s", "Memory (B)", "Allocations", "Heap est. (B)");
+    printf("-------------------------------------------------------------------------------\n");
+    printf("%-14s %-12.1f %-10.1f %-12zu %-13zu %-12zu\n", "cJSON", treeTime*1e6, (double)len/treeTime/1e6, treeBytes, treeAllocations, treeHeap);
+    printf("%-14s %-12.1f %-10.1f %-12zu %-13d %-12zu\n", "tape", tapeTime*1e6, (double)len/tapeTime/1e6, tapeBytes, 3, tapeHeap);
+    printf("%-14s %-12.1f %-10.1f\n", "indexed", indexedTime*1e6, (double)len/indexedTime/1e6);
+    printf("%-14s %-12.1f %-10.1f\n", parallelLabel, parallelTime*1e6, (double)len/parallelTime/1e6);
+    printf("cJSON nodes: %zu (%zu B each), tape words: %zu (8 B each)\n", nodes, sizeof(cJSON), words);
+    printf("Strings: cJSON keeps %zu copies in %zu B; the tape interns %zu distinct strings in %zu B (%zu repeats, %zu B saved).\n",
+           stringCopies, stringBytes, distinct, arenaBytes, repeats, savedBytes);
+    printf("Tape uses %.1fx less heap and parses %.1fx faster.\n\n", (double)treeHeap/(double)tapeHeap, treeTime/tapeTime);
+    return 0;
+}
+
+/**
+ * @brief Builds a large catalog by repeating the categories of `json` under new names.
+ *
+ * @details Copy `k` of category `build` is named `build_k`. The result is
+ *          printed formatted, like a hand-maintained `tasks.json`.
+ *
+ * @return char* Heap string of at least `targetBytes` bytes, or `NULL`.
+ */
+char *benchSyntheticCatalog(const char *json, size_t len, size_t targetBytes){
+    cJSON *source=cJSON_ParseWithLength(json, len);
+    if(!cJSON_IsObject(source) || !source->child){
+        cJSON_Delete(source);
+        return NULL;
+    }
+    cJSON *catalog=cJSON_CreateObject();
+    size_t sourceBytes=len ? len : 1;
+    size_t copies=targetBytes/sourceBytes+1;
+    char name[256];
+    for(size_t k=0; k<copies; k++){
+        cJSON *category=NULL;
+        cJSON_ArrayForEach(category, source){
+            snprintf(name, sizeof(name), "%s_%zu", category->string, k);
+            cJSON_AddItemToObject(catalog, name, cJSON_Duplicate(category, 1));
+        }
+    }
+    char *text=cJSON_Print(catalog);
+    cJSON_Delete(catalog);
+    cJSON_Delete(source);
+    return text;
+}
+
+/**
+ * @brief Compares cJSON with the tape parsers on `json` and on a generated large catalog.
+ *
+ * @details Each parser runs in a loop for at least `BENCH_MIN_SECONDS` and the
+ *          mean time per parse is reported. cJSON memory is measured through
+ *          counting allocation hooks and includes the key and value strings;
+ *          the allocation count is printed as well because every allocation
+ *          also costs allocator overhead; the "Heap est." column adds
+ *          `BENCH_ALLOCATOR_OVERHEAD` bytes per allocation to both parsers.
+ *          Tape memory is the size of the tape, the string arena and its intern
+ *          set; a separate line compares the string bytes of both parsers.
+ *
+ *          The second table uses `benchSyntheticCatalog()` to build a
+ *          multi-megabyte catalog, where the indexed and parallel modes of
+ *          `tapeParseIndexed()` matter.
+ *
+ * @ingroup bench
+ *
+ * @param json Contents of the configuration file.
+ * @param len Length of `json` in bytes.
+ *
+ * @return int `0` on success, `1` if any parser rejected the input.
+ *
+ * Example usage:
+ * @code
+ * devcli bench
+ * @endcode
+ */
+int benchParsers(const char *json, size_t len){
+    if(benchReport("Input", json, len)!=0) return 1;
+    char *catalog=benchSyntheticCatalog(json, len, BENCH_SYNTHETIC_BYTES);
+    if(!catalog){
+        LOG_ERROR("Could not generate a synthetic catalog.");
+        return 1;
+    }
+    int status=benchReport("Synthetic catalog", catalog, strlen(catalog));
+    free(catalog);
+    return status;
+}
+
+/**
+ * @brief Converts the value at tape index `i` back into a cJSON tree.
+ *
+ * @details Arrays are also probed with `tapeArrayAt()`; if it disagrees with
+ *          iteration, a marker string is returned so the comparison fails.
+ */
+static cJSON *tapeToJSON(const JsonTape *doc, size_t i){
+    switch(tapeType(doc, i)){
+        case '{': {
+            cJSON *object=cJSON_CreateObject();
+            TAPE_FOR_EACH_MEMBER(doc, i, member){
+                cJSON_AddItemToObject(object, tapeString(doc, member, NULL), tapeToJSON(doc, member+1));
+            }
+            return object;
+        }
+        case '[': {
+            cJSON *array=cJSON_CreateArray();
+            size_t count=0, last=TAPE_NONE;
+            TAPE_FOR_EACH_ELEMENT(doc, i, item){
+                cJSON_AddItemToArray(array, tapeToJSON(doc, item));
+                last=item;
+                count++;
+            }
+            if(count>0 && (tapeArrayAt(doc, i, 0)!=i+1 || tapeArrayAt(doc, i, count-1)!=last || tapeArrayAt(doc, i, count)!=TAPE_NONE)){
+                cJSON_Delete(array);
+                return cJSON_CreateString("tapeArrayAt() disagrees with iteration");
+            }
+            return array;
+        }
+        case '"': return cJSON_CreateString(tapeString(doc, i, NULL));
+        case 'd': return cJSON_CreateNumber(tapeNumber(doc, i));
+        case 't': return cJSON_CreateTrue();
+        case 'f': return cJSON_CreateFalse();
+        default: return cJSON_CreateNull();
+    }
+}
+
+/**
+ * @brief Parses one input with every parser and checks that they agree with cJSON.
+ *
+ * @return int `0` if all parsers agree, `1` otherwise.
+ */
+static int verifyOne(const char *label, const char *json, size_t len){
+    const char *end=NULL;
+    cJSON *expected=cJSON_ParseWithLengthOpts(json, len, &end, 0);
+    if(expected){
+        while(end<json+len && (*end==' ' || *end=='\t' || *end=='\r' || *end=='\n')) end++;
+        if(end<json+len && *end!='\0'){
+            cJSON_Delete(expected);
+            expected=NULL;
+        }
+    }
+    static const char *const modes[]={"tape", "indexed", "parallel"};
+    int failed=0;
+    for(int mode=0; mode<3; mode++){
+        JsonTape doc;
+        int status=mode==0 ? tapeParse(json, len, &doc) : tapeParseIndexed(json, len, &doc, mode==1 ? 1 : BENCH_VERIFY_THREADS);
+        if((status==0)!=(expected!=NULL)){
+            LOG_ERROR("%s: %s %s the input but cJSON %s it.", label, modes[mode], status==0 ? "accepted" : "rejected", expected ? "accepted" : "rejected");
+            failed=1;
+        }
+        else if(status==0){
+            cJSON *actual=tapeToJSON(&doc, 0);
+            if(!cJSON_Compare(expected, actual, 1)){
+                LOG_ERROR("%s: %s result differs from cJSON.", label, modes[mode]);
+                failed=1;
+            }
+            cJSON_Delete(actual);
+        }
+        tapeFree(&doc);
+    }
+    cJSON_Delete(expected);
+    return failed;
+}
+
+/**
+ * @brief Validates the tape parsers against `cJSON_Parse` on a corpus of configs.
+ *
+ * @details The corpus is every file named on the command line, the resolved
+ *          `tasks.json`, a generated multi-megabyte catalog (which takes the
+ *          parallel path) and a set of generated edge cases: escaped quotes and
+ *          backslash runs shifted across every position of a 64-byte block,
+ *          unicode escapes, numbers, literals and malformed documents. Every
+ *          input is parsed with `tapeParse()`, `tapeParseIndexed()` on one
+ *          thread and on `BENCH_VERIFY_THREADS` threads; each result must be
+ *          accepted or rejected exactly when cJSON does, and accepted results
+ *          must compare equal to cJSON's tree.
+ *
+ * @ingroup bench
+ *
+ * @param paths Extra files to check.
+ * @param pathCount Number of entries in `paths`.
+ * @param json Contents of the resolved `tasks.json`.
+ * @param len Length of `json` in bytes.
+ *
+ * @return int `0` if every input agrees, `1` otherwise.
+ *
+ * Example usage:
+ * @code
+ * devcli verify generated/catalog.json
+ * @endcode
+ */
+int verifyParsers(char *const *paths, size_t pathCount, const char *json, size_t len){
+    size_t checked=0, failures=0;
+    for(size_t i=0; i<pathCount; i++){
+        char *contents=readFileToBuffer(paths[i]);
+        if(!contents){
+            failures++;
+            continue;
+        }
+        failures+=verifyOne(paths[i], contents, strlen(contents));
+        checked++;
+        free(contents);
+    }
+    failures+=verifyOne("tasks.json", json, len);
+    checked++;
+    char *catalog=benchSyntheticCatalog(json, len, BENCH_SYNTHETIC_BYTES);
+    if(catalog){
+        failures+=verifyOne("synthetic catalog", catalog, strlen(catalog));
+        checked++;
+        free(catalog);
+    }
+    static const char *const escapes[]={"\\\\", "\\\"", "\\\\\\\"", "\\\\\\\\", "\\u00e9\\ud83d\\ude00", "\\/\\b\\f\\n\\r\\t"};
+    char edge[512];
+    for(size_t e=0; e<sizeof(escapes)/sizeof(escapes[0]); e++){
+        for(int pad=0; pad<130; pad++){
+            snprintf(edge, sizeof(edge), "{\"%.*s\":\"x%sy\",\"n\":[-1.5e3,0,true,false,null,{}],\"k\":\"%s\"}",
+                     pad, "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+                     escapes[e], escapes[e]);
+            failures+=verifyOne("edge case", edge, strlen(edge));
+            checked++;
+        }
+    }
+    static const char *const malformed[]={
+        "", "{", "}", "{,}", "[1,]", "{\"a\" 1}", "\"x", "{\"a\":tru}", "{\"a\":truex}", "[1 2]",
+        "{\"a\":1}x", "{\"a\":\"\\q\"}", "{\"a\":+1}", "[\"\\ud800\"]", "{\"a\":[}]", " [ ] ", "{}", "[[[]]]"
+    };
+    for(size_t m=0; m<sizeof(malformed)/sizeof(malformed[0]); m++){
+        failures+=verifyOne(malformed[m], malformed[m], strlen(malformed[m]));
+        checked++;
+    }
+    if(failures){
+        LOG_ERROR("%zu of %zu inputs disagree with cJSON.", failures, checked);
+        return 1;
+    }
+    LOG("All %zu inputs parse identically with cJSON, tape, indexed and parallel parsers.", checked);
+    return 0;
+}
+
+/** @} */ // end of bench group
@@ -0,0 +1,22 @@
+/**
+ * @file bench.h
+ * @brief Side-by-side measurements and cross-checks of the cJSON tree and the tape DOM.
+ */
+
+#ifndef DEVCLI_BENCH_H
+#define DEVCLI_BENCH_H
+
+#include <stddef.h>
+
+/** @defgroup bench Benchmarks
+ *  @brief Maintenance commands that compare config representations.
+ *  @{
+ */
+
+int benchParsers(const char *json, size_t len);
+char *benchSyntheticCatalog(const char *json, size_t len, size_t targetBytes);
+int verifyParsers(char *const *paths, size_t pathCount, const char *json, size_t len);
+
+/** @} */ // end of bench group
+
+#endif /* DEVCLI_BENCH_H */
@@ -0,0 +1,469 @@
+/**
+ * @file cmakebuild.c
+ * @brief Fingerprints the inputs of a CMake configuration and builds incrementally.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+#include "cmakebuild.h"
+#include "devcli.h"
+#include "jobserver.h"
+#include "spawn.h"
+#include "tape.h"
+#include "log.h"
+
+/** @addtogroup cmakebuild
+ *  @{
+ */
+
+/**
+ * @def CMAKE_FINGERPRINT_VERSION
+ * @brief First input of every fingerprint; changing it makes every build
+ *        directory configure once more.
+ */
+#define CMAKE_FINGERPRINT_VERSION "devcli-cmake-1"
+
+/**
+ * @def CMAKE_TREE_DEPTH
+ * @brief Deepest directory below the source directory searched for
+ *        `CMakeLists.txt` and `.cmake` files.
+ */
+#define CMAKE_TREE_DEPTH 24
+
+/**
+ * @brief A `cmake` configure command split into words.
+ */
+typedef struct {
+    char *copy;                         /**< The command, cut into words in place. */
+    char *words[CMAKE_MAX_WORDS];       /**< `cmake` first, quotes removed. */
+    int count;
+    const char *source;                 /**< Source directory (`..` or `-S`). */
+    const char *build;                  /**< Build directory (`-B`, or the working directory). */
+    const char *generator;              /**< `-G` value, or `NULL`. */
+    const char *toolchain;              /**< `--toolchain` or `CMAKE_TOOLCHAIN_FILE` value, or `NULL`. */
+    const char *initialCache;           /**< `-C` file, or `NULL`. */
+} CmakeCommand;
+
+/**
+ * @brief Environment variables CMake reads when it configures; a change to
+ *        any of them configures again.
+ */
+static const char *const cmakeEnvironment[]={"CC", "CXX", "FC", "CUDACXX", "CFLAGS", "CXXFLAGS", "CPPFLAGS",
+    "LDFLAGS", "CMAKE_GENERATOR", "CMAKE_BUILD_TYPE", "CMAKE_TOOLCHAIN_FILE", "CMAKE_PREFIX_PATH",
+    "CMAKE_INSTALL_PREFIX", "CMAKE_EXPORT_COMPILE_COMMANDS", "PKG_CONFIG_PATH", "VCPKG_ROOT"};
+
+/**
+ * @brief Returns `1` if `word` is the name or path of the `cmake` program.
+ */
+static int isCmake(const char *word){
+    const char *base=word;
+    for(const char *p=word; *p; p++){
+        if(*p=='/' || *p=='\\') base=p+1;
+    }
+    return strcmp(base, "cmake")==0 || strcmp(base, "cmake.exe")==0 || strcmp(base, "CMAKE.EXE")==0;
+}
+
+/**
+ * @brief Splits `command` into words, removing double quotes.
+ *
+ * @details Shell syntax that could do more than pass words to `cmake`
+ *          (`;`, `&&`, pipes, redirections, variables, command
+ *          substitution, single quotes and backslashes outside Windows) is
+ *          refused.
+ *
+ * @return int `0` on success, `-1` if the command has such syntax or too
+ *         many words.
+ */
+static int splitWords(const char *command, CmakeCommand *parsed){
+    #ifdef _WIN32
+        const char *special=";&|<>$`%^";
+    #else
+        const char *special=";&|<>$`'\\";
+    #endif
+    if(command[strcspn(command, special)] || strchr(command, '\n')) return -1;
+    parsed->copy=strdup(command);
+    if(!parsed->copy) return -1;
+    int count=splitCommandWords(parsed->copy, parsed->words, CMAKE_MAX_WORDS);
+    if(count<0) return -1;
+    parsed->count=count;
+    return 0;
+}
+
+/**
+ * @brief Returns the value of an option written `-X value` or `-Xvalue`,
+ *        advancing `*i` past a separate value, or `NULL` if `word` is not
+ *        option `name`.
+ */
+static const char *optionValue(const CmakeCommand *parsed, int *i, const char *name){
+    const char *word=parsed->words[*i];
+    size_t len=strlen(name);
+    if(strncmp(word, name, len)!=0) return NULL;
+    if(word[len]) return word[len]=='=' ? word+len+1 : word+len;
+    if(*i+1>=parsed->count) return NULL;
+    return parsed->words[++*i];
+}
+
+/**
+ * @brief Splits a `cmake` configure command and finds its directories and
+ *        the files it reads.
+ *
+ * @details Only plain configure runs are taken: `--build`, `--install`,
+ *          script and tool modes, presets (whose build directory lives in a
+ *          JSON file) and `--fresh` are left to `cmake` itself, and so is a
+ *          path argument that names an existing build directory.
+ *
+ * @return int `0` if `command` is such a configure run, `-1` otherwise.
+ */
+static int parseCmake(const char *command, CmakeCommand *parsed){
+    memset(parsed, 0, sizeof(*parsed));
+    if(splitWords(command, parsed)!=0 || parsed->count==0 || !isCmake(parsed->words[0])) return -1;
+    static const char *const refused[]={"--build", "--install", "--open", "-E", "-P", "-N", "-L", "-LA", "-LH",
+        "-LAH", "--version", "--help", "--workflow", "--fresh", "--system-information", "--find-package"};
+    parsed->build=".";
+    for(int i=1; i<parsed->count; i++){
+        const char *word=parsed->words[i];
+        for(size_t r=0; r<sizeof(refused)/sizeof(refused[0]); r++){
+            if(strcmp(word, refused[r])==0) return -1;
+        }
+        const char *value;
+        if(strncmp(word, "--preset", 8)==0 || strncmp(word, "--help", 6)==0) return -1;
+        if(strcmp(word, "--toolchain")==0){
+            if(i+1>=parsed->count) return -1;
+            parsed->toolchain=parsed->words[++i];
+        }
+        else if(strncmp(word, "-D", 2)==0){
+            value=word[2] ? word+2 : (i+1<parsed->count ? parsed->words[++i] : NULL);
+            if(!value) return -1;
+            if(strncmp(value, "CMAKE_TOOLCHAIN_FILE", 20)==0 && (value[20]=='=' || value[20]==':')) parsed->toolchain=strchr(value, '=') ? strchr(value, '=')+1 : NULL;
+        }
+        else if((value=optionValue(parsed, &i, "-S"))) parsed->source=value;
+        else if((value=optionValue(parsed, &i, "-B"))) parsed->build=value;
+        else if((value=optionValue(parsed, &i, "-G"))) parsed->generator=value;
+        else if((value=optionValue(parsed, &i, "-C"))) parsed->initialCache=value;
+        else if(strcmp(word, "-T")==0 || strcmp(word, "-A")==0 || strcmp(word, "-U")==0) i++;
+        else if(word[0]=='-') continue;
+        else if(parsed->source) return -1;
+        else{
+            char probe[4096];
+            struct stat info;
+            snprintf(probe, sizeof(probe), "%s/CMakeLists.txt", word);
+            if(stat(probe, &info)!=0) return -1;
+            parsed->source=word;
+        }
+    }
+    return parsed->source ? 0 : -1;
+}
+
+/**
+ * @brief Finds `name` (or `name.exe` on Windows) on `PATH`.
+ *
+ * @return int `0` with its path in `out` and its `stat` in `info`, or `-1`.
+ */
+static int findProgram(const char *name, char *out, size_t size, struct stat *info){
+    if(strchr(name, '/') || strchr(name, '\\')){
+        snprintf(out, size, "%s", name);
+        return stat(out, info)==0 ? 0 : -1;
+    }
+    #ifdef _WIN32
+        const char separator=';';
+        const char *suffixes[]={".exe", ""};
+    #else
+        const char separator=':';
+        const char *suffixes[]={""};
+    #endif
+    const char *dirs=getenv("PATH");
+    while(dirs && *dirs){
+        size_t len=strcspn(dirs, (char[]){separator, '\0'});
+        for(size_t i=0; i<sizeof(suffixes)/sizeof(suffixes[0]); i++){
+            int n=snprintf(out, size, "%.*s/%s%s", (int)len, dirs, name, suffixes[i]);
+            if(n>0 && (size_t)n<size && stat(out, info)==0 && !(info->st_mode&S_IFDIR)) return 0;
+        }
+        dirs+=len;
+        if(*dirs==separator) dirs++;
+    }
+    return -1;
+}
+
+/**
+ * @brief Returns `1` if `name` is an input of a CMake configuration.
+ */
+static int isCmakeInput(const char *name){
+    size_t len=strlen(name);
+    return strcmp(name, "CMakeLists.txt")==0 || strcmp(name, "CMakePresets.json")==0
+        || strcmp(name, "CMakeUserPresets.json")==0 || (len>6 && strcmp(name+len-6, ".cmake")==0);
+}
+
+/**
+ * @brief Adds the fingerprint of every CMake input below `dir` to `*sum`.
+ *
+ * @details Hidden directories such as `.git` and build trees (directories
+ *          with a `CMakeCache.txt`) are skipped. Fingerprints are added up,
+ *          so the order the directory lists them in does not matter.
+ */
+static void hashTree(const char *dir, int depth, uint64_t *sum, uint64_t *count){
+    char path[4096];
+    struct stat info;
+    snprintf(path, sizeof(path), "%s/CMakeCache.txt", dir);
+    if(depth>CMAKE_TREE_DEPTH || (depth>0 && stat(path, &info)==0)) return;
+    #ifdef _WIN32
+        char pattern[4096];
+        snprintf(pattern, sizeof(pattern), "%s\\*", dir);
+        WIN32_FIND_DATAA found;
+        HANDLE find=FindFirstFileA(pattern, &found);
+        if(find==INVALID_HANDLE_VALUE) return;
+        do{
+            const char *name=found.cFileName;
+    #else
+        DIR *listing=opendir(dir);
+        if(!listing) return;
+        const struct dirent *entry;
+        while((entry=readdir(listing))){
+            const char *name=entry->d_name;
+    #endif
+            if(name[0]=='.') continue;
+            int n=snprintf(path, sizeof(path), "%s/%s", dir, name);
+            if(n<0 || (size_t)n>=sizeof(path) || stat(path, &info)!=0) continue;
+            if(info.st_mode&S_IFDIR) hashTree(path, depth+1, sum, count);
+            else if(isCmakeInput(name)){
+                *sum+=fingerprintFile(FINGERPRINT_SEED, path, &info);
+                (*count)++;
+            }
+    #ifdef _WIN32
+        }while(FindNextFileA(find, &found));
+        FindClose(find);
+    #else
+        }
+        closedir(listing);
+    #endif
+}
+
+/**
+ * @brief Folds the file at `path`, or its absence, into `hash`.
+ */
+static uint64_t hashInputFile(uint64_t hash, const char *path){
+    struct stat info;
+    if(!path) return hash;
+    if(stat(path, &info)!=0) return fingerprintText(hash, path);
+    return fingerprintFile(hash, path, &info);
+}
+
+/**
+ * @brief Computes the fingerprint of everything a configuration depends on.
+ *
+ * @details The words of the command, the environment variables in
+ *          `cmakeEnvironment`, the `cmake` program, the toolchain and
+ *          initial cache files, and the path, size and modification time of
+ *          every `CMakeLists.txt`, `*.cmake` and preset file of the source
+ *          tree.
+ */
+static uint64_t cmakeFingerprint(const CmakeCommand *parsed){
+    uint64_t hash=fingerprintText(FINGERPRINT_SEED, CMAKE_FINGERPRINT_VERSION);
+    for(int i=0; i<parsed->count; i++) hash=fingerprintText(hash, parsed->words[i]);
+    for(size_t i=0; i<sizeof(cmakeEnvironment)/sizeof(cmakeEnvironment[0]); i++){
+        const char *value=getenv(cmakeEnvironment[i]);
+        hash=fingerprintText(hash, cmakeEnvironment[i]);
+        hash=fingerprintText(hash, value ? value : "\x01");
+    }
+    char program[4096];
+    struct stat info;
+    if(findProgram(parsed->words[0], program, sizeof(program), &info)==0) hash=fingerprintFile(hash, program, &info);
+    hash=hashInputFile(hash, parsed->toolchain);
+    hash=hashInputFile(hash, parsed->initialCache);
+    uint64_t sum=0, count=0;
+    hashTree(parsed->source, 0, &sum, &count);
+    uint64_t fields[2]={sum, count};
+    return fingerprintBytes(hash, fields, sizeof(fields));
+}
+
+/**
+ * @brief Reads the generator recorded in the build directory's
+ *        `CMakeCache.txt` into `out`.
+ *
+ * @return int `0` if the cache exists and names one.
+ */
+static int cachedGenerator(const char *build, char *out, size_t size){
+    char path[4096], line[1024];
+    snprintf(path, sizeof(path), "%s/CMakeCache.txt", build);
+    FILE *file=fopen(path, "r");
+    if(!file) return -1;
+    int found=-1;
+    while(found!=0 && fgets(line, sizeof(line), file)){
+        if(strncmp(line, "CMAKE_GENERATOR:INTERNAL=", 25)!=0) continue;
+        line[strcspn(line, "\r\n")]='\0';
+        snprintf(out, size, "%.*s", (int)(size-1), line+25);
+        found=0;
+    }
+    fclose(file);
+    return found;
+}
+
+/**
+ * @brief Returns `1` if the build directory is configured: it has a
+ *        `CMakeCache.txt`, and the build file of its generator when that is
+ *        Ninja or Makefiles.
+ */
+static int isConfigured(const char *build){
+    char generator[256], path[4096];
+    struct stat info;
+    if(cachedGenerator(build, generator, sizeof(generator))!=0) return 0;
+    if(strncmp(generator, "Ninja", 5)==0) snprintf(path, sizeof(path), "%s/build.ninja", build);
+    else if(strstr(generator, "Makefiles")) snprintf(path, sizeof(path), "%s/Makefile", build);
+    else return 1;
+    return stat(path, &info)==0;
+}
+
+/**
+ * @brief Returns `1` if the stamp in the build directory holds `fingerprint`.
+ */
+static int stampMatches(const char *build, uint64_t fingerprint){
+    char path[4096];
+    unsigned long long stored=0;
+    snprintf(path, sizeof(path), "%s/%s", build, CMAKE_STAMP_NAME);
+    FILE *file=fopen(path, "r");
+    if(!file) return 0;
+    int matches=fscanf(file, "%llx", &stored)==1 && stored==(unsigned long long)fingerprint;
+    fclose(file);
+    return matches;
+}
+
+/**
+ * @brief Writes `fingerprint` to the stamp in the build directory, or
+ *        removes the stamp for `0`.
+ */
+static void stampWrite(const char *build, uint64_t fingerprint){
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", build, CMAKE_STAMP_NAME);
+    if(fingerprint==0){
+        remove(path);
+        return;
+    }
+    FILE *file=fopen(path, "w");
+    if(!file) return;
+    fprintf(file, "%016llx\n", (unsigned long long)fingerprint);
+    fclose(file);
+}
+
+/**
+ * @brief Appends `word` to `out`, in double quotes if it has a space.
+ */
+static char *appendWord(char *out, const char *word){
+    return out+sprintf(out, strchr(word, ' ') ? "\"%s\" " : "%s ", word);
+}
+
+/**
+ * @brief Chooses a generator for a build directory that has none yet:
+ *        Ninja when `ninja` is on `PATH`, otherwise MinGW Makefiles on
+ *        Windows when `mingw32-make` is, otherwise CMake's default.
+ *
+ * @return const char* The generator to pass with `-G`, or `NULL` to leave
+ *         the choice to CMake.
+ */
+static const char *chooseGenerator(const CmakeCommand *parsed){
+    char path[4096], cached[256];
+    struct stat info;
+    if(parsed->generator || getenv("CMAKE_GENERATOR") || cachedGenerator(parsed->build, cached, sizeof(cached))==0) return NULL;
+    if(findProgram("ninja", path, sizeof(path), &info)==0 || findProgram("ninja-build", path, sizeof(path), &info)==0) return "Ninja";
+    #ifdef _WIN32
+        if(findProgram("mingw32-make", path, sizeof(path), &info)==0) return "MinGW Makefiles";
+    #endif
+    return NULL;
+}
+
+/**
+ * @brief Runs a `cmake` configure command as a configure-if-needed and an
+ *        incremental build.
+ *
+ * @details For a plain configure such as `cmake ..` from
+ *          `build.filesByCmake` (see `parseCmake()`), the inputs of the
+ *          configuration are fingerprinted (`cmakeFingerprint()`). When the
+ *          fingerprint matches the one stored in `.devcli_cmake` by the last
+ *          successful configure and the build directory still has its cache
+ *          and build file, configuring is skipped. Otherwise the command
+ *          runs, with `-G Ninja` added when the build directory has no
+ *          generator yet and `ninja` is installed (`chooseGenerator()`).
+ *          Inputs the fingerprint misses, such as files read by
+ *          `configure_file()`, are still caught: the build system CMake
+ *          generates configures again by itself when they change.
+ *
+ *          Then `cmake --build` runs in the build directory. Makefile
+ *          generators take their parallel jobs from devcli's jobserver in
+ *          `MAKEFLAGS`; other generators get `--parallel` with devcli's
+ *          `-j`, or one job per processor.
+ *
+ * @ingroup cmakebuild
+ *
+ * @param command Command line after placeholder substitution.
+ * @param cpus CPU list for `spawnShell()`, or `NULL`.
+ * @param peakMemory Receives the larger peak of the two steps in MiB.
+ * @param status Receives the status of the failing step, or `0`.
+ *
+ * @return int `0` if the command was run here, `-1` if it is not a plain
+ *         configure and the caller must run it.
+ *
+ * Example usage:
+ * @code
+ * int status;
+ * if (cmakeBuildRun("cmake ..", NULL, NULL, &status) != 0)
+ *     status = spawnShell("cmake ..", NULL, NULL);
+ * @endcode
+ */
+int cmakeBuildRun(const char *command, const char *cpus, uint32_t *peakMemory, int *status){
+    CmakeCommand parsed;
+    if(parseCmake(command, &parsed)!=0){
+        free(parsed.copy);
+        return -1;
+    }
+    size_t len=strlen(command)+64;
+    for(int i=0; i<parsed.count; i++) len+=strlen(parsed.words[i])+3;
+    char *line=malloc(len+strlen(parsed.build));
+    if(!line){
+        LOG_ERROR("Dynamic Memory allocation failed.");
+        free(parsed.copy);
+        return -1;
+    }
+    uint32_t peak=0, buildPeak=0;
+    uint64_t fingerprint=cmakeFingerprint(&parsed);
+    *status=0;
+    if(stampMatches(parsed.build, fingerprint) && isConfigured(parsed.build)){
+        LOG("CMake inputs of %s are unchanged; skipping configuration.", parsed.build);
+    }
+    else{
+        char *p=line;
+        for(int i=0; i<parsed.count; i++) p=appendWord(p, parsed.words[i]);
+        const char *generator=chooseGenerator(&parsed);
+        if(generator){
+            LOG("Configuring %s with the %s generator.", parsed.build, generator);
+            sprintf(p, "-G \"%s\"", generator);
+        }
+        stampWrite(parsed.build, 0);
+        *status=spawnShell(line, cpus, &peak);
+        if(*status==0) stampWrite(parsed.build, fingerprint);
+    }
+    if(*status==0){
+        char generator[256]="";
+        cachedGenerator(parsed.build, generator, sizeof(generator));
+        int jobs=jobserverJobs();
+        const char *makeflags=getenv("MAKEFLAGS");
+        int jobserver=makeflags && strstr(makeflags, "--jobserver-auth=");
+        char *p=appendWord(line, parsed.words[0]);
+        p+=sprintf(p, "--build ");
+        p=appendWord(p, parsed.build);
+        if(!(strstr(generator, "Makefiles") && jobserver)) sprintf(p, "--parallel %d", jobs>0 ? jobs : tapeHardwareThreads());
+        else p[-1]='\0';
+        LOG("Building: %s", line);
+        *status=spawnShell(line, cpus, &buildPeak);
+    }
+    if(peakMemory) *peakMemory=peak>buildPeak ? peak : buildPeak;
+    free(line);
+    free(parsed.copy);
+    return 0;
+}
+
+/** @} */ // end of cmakebuild group
@@ -0,0 +1,33 @@
+/**
+ * @file cmakebuild.h
+ * @brief Skips CMake configuration when its inputs are unchanged and builds incrementally.
+ */
+
+#ifndef DEVCLI_CMAKEBUILD_H
+#define DEVCLI_CMAKEBUILD_H
+
+#include <stdint.h>
+
+/** @defgroup cmakebuild CMake Builds
+ *  @brief Turns `cmake ..` tasks into a fingerprinted configure and a `cmake --build`.
+ *  @{
+ */
+
+/**
+ * @def CMAKE_STAMP_NAME
+ * @brief File, in the build directory, holding the fingerprint of the inputs
+ *        of the last successful configuration.
+ */
+#define CMAKE_STAMP_NAME ".devcli_cmake"
+
+/**
+ * @def CMAKE_MAX_WORDS
+ * @brief Most words a `cmake` command may have to be handled.
+ */
+#define CMAKE_MAX_WORDS 64
+
+int cmakeBuildRun(const char *command, const char *cpus, uint32_t *peakMemory, int *status);
+
+/** @} */ // end of cmakebuild group
+
+#endif /* DEVCLI_CMAKEBUILD_H */
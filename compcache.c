@@ -0,0 +1,689 @@
+/**
+ * @file compcache.c
+ * @brief Local compile cache keyed by the preprocessed source, the compiler and its flags.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#include <process.h>
+#define MKDIR(path) _mkdir(path)
+#define GETPID() _getpid()
+#else
+#include <unistd.h>
+#define MKDIR(path) mkdir(path, 0755)
+#define GETPID() getpid()
+#endif
+#include "compcache.h"
+#include "spawn.h"
+#include "log.h"
+
+/** @addtogroup compcache
+ *  @{
+ */
+
+/**
+ * @def COMPILE_CACHE_VERSION
+ * @brief First input of every key; changing it retires all stored entries.
+ */
+#define COMPILE_CACHE_VERSION "devcli-compile-cache-1"
+
+/**
+ * @brief 128-bit FNV-1a state; wide enough that two different inputs never
+ *        share an entry in practice.
+ */
+typedef struct {
+    uint64_t lo;
+    uint64_t hi;
+} CacheHash;
+
+/** @brief Compiles served from the store during this run. */
+static atomic_int cacheHits;
+/** @brief Compiles that ran and were stored. */
+static atomic_int cacheMisses;
+/** @brief Compiler commands that could not be cached, such as `gcc a.c && ./a.out`. */
+static atomic_int cacheSkipped;
+/** @brief Makes the names of temporary files unique between threads. */
+static atomic_uint cacheTemp;
+
+/**
+ * @brief Folds `len` bytes into a 128-bit FNV-1a hash.
+ *
+ * @details The FNV prime is `2^88 + 0x13b`, so the product is the state
+ *          times `0x13b` plus the low word shifted into the high one.
+ */
+static void hashUpdate(CacheHash *hash, const void *data, size_t len){
+    const unsigned char *bytes=data;
+    uint64_t lo=hash->lo, hi=hash->hi;
+    for(size_t i=0; i<len; i++){
+        lo^=bytes[i];
+        uint64_t p0=(lo&0xffffffffu)*0x13b, p1=(lo>>32)*0x13b;
+        uint64_t mid=(p0>>32)+(p1&0xffffffffu);
+        uint64_t carry=(p1>>32)+(mid>>32);
+        hi=hi*0x13b+carry+(lo<<24);
+        lo=(p0&0xffffffffu)|(mid<<32);
+    }
+    hash->lo=lo;
+    hash->hi=hi;
+}
+
+/**
+ * @brief Folds a string and its terminator into `hash`, so that adjacent
+ *        strings cannot run into each other.
+ */
+static void hashString(CacheHash *hash, const char *s){
+    hashUpdate(hash, s, strlen(s)+1);
+}
+
+/**
+ * @brief Folds the contents of the file at `path` into `hash`.
+ *
+ * @return int `0` on success, `-1` if it could not be read.
+ */
+static int hashFile(CacheHash *hash, const char *path){
+    FILE *file=fopen(path, "rb");
+    if(!file) return -1;
+    char buffer[65536];
+    size_t n;
+    while((n=fread(buffer, 1, sizeof(buffer), file))>0) hashUpdate(hash, buffer, n);
+    int error=ferror(file);
+    fclose(file);
+    return error ? -1 : 0;
+}
+
+/**
+ * @brief Fills `out` with the store directory and creates it.
+ *
+ * @details `DEVCLI_CACHE_DIR` if set, otherwise `.devcli/cache` in the home
+ *          directory, next to the user's `tasks.json`.
+ *
+ * @return int `0` if the directory exists.
+ */
+static int cacheDirectory(char *out, size_t size){
+    const char *dir=getenv("DEVCLI_CACHE_DIR");
+    if(dir && *dir){
+        if(strlen(dir)>=size) return -1;
+        strcpy(out, dir);
+    }
+    else{
+        #ifdef _WIN32
+            const char *home=getenv("USERPROFILE");
+            const char *sep="\\";
+        #else
+            const char *home=getenv("HOME");
+            const char *sep="/";
+        #endif
+        if(!home) return -1;
+        int n=snprintf(out, size, "%s%s.devcli", home, sep);
+        if(n<0 || (size_t)n>=size) return -1;
+        MKDIR(out);
+        n=snprintf(out, size, "%s%s.devcli%scache", home, sep, sep);
+        if(n<0 || (size_t)n>=size) return -1;
+    }
+    MKDIR(out);
+    struct stat info;
+    return stat(out, &info)==0 && (info.st_mode&S_IFDIR) ? 0 : -1;
+}
+
+/**
+ * @brief Returns `1` if `word` names gcc, g++, cc, c++, clang or clang++,
+ *        also with a directory, a cross prefix such as
+ *        `x86_64-w64-mingw32-gcc`, a version suffix such as `gcc-13`, or `.exe`.
+ *
+ * @ingroup compcache
+ */
+int compileWordIsCompiler(const char *word){
+    const char *base=word;
+    for(const char *p=word; *p; p++){
+        if(*p=='/' || *p=='\\') base=p+1;
+    }
+    size_t len=strlen(base);
+    if(len>4 && (strcmp(base+len-4, ".exe")==0 || strcmp(base+len-4, ".EXE")==0)) len-=4;
+    static const char *const names[]={"gcc", "g++", "cc", "c++", "clang", "clang++"};
+    for(size_t i=0; i<sizeof(names)/sizeof(names[0]); i++){
+        size_t n=strlen(names[i]);
+        if(len<n) continue;
+        if(len==n && strncmp(base, names[i], n)==0) return 1;
+        if(len>n && base[len-n-1]=='-' && strncmp(base+len-n, names[i], n)==0) return 1;
+        if(base[n]=='-' && strncmp(base, names[i], n)==0) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Returns `1` if `word` has one of the `extensions`.
+ */
+static int hasExtension(const char *word, const char *const *extensions, size_t count){
+    const char *dot=strrchr(word, '.');
+    if(!dot || dot==word) return 0;
+    for(size_t i=0; i<count; i++){
+        if(strcmp(dot, extensions[i])==0) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Returns `1` if `word` is a C or C++ source file by its extension.
+ */
+static int isSource(const char *word){
+    static const char *const extensions[]={".c", ".cc", ".cp", ".cpp", ".cxx", ".c++", ".C", ".CPP"};
+    return hasExtension(word, extensions, sizeof(extensions)/sizeof(extensions[0]));
+}
+
+/**
+ * @brief Returns `1` if `word` is an object file or library to link.
+ */
+static int isLinkInput(const char *word){
+    static const char *const extensions[]={".o", ".obj", ".a", ".so", ".lib", ".dll", ".dylib"};
+    return hasExtension(word, extensions, sizeof(extensions)/sizeof(extensions[0]));
+}
+
+/**
+ * @brief Returns `1` if `word` starts with one of `prefixes`.
+ */
+static int hasPrefix(const char *word, const char *const *prefixes, size_t count){
+    for(size_t i=0; i<count; i++){
+        if(strncmp(word, prefixes[i], strlen(prefixes[i]))==0) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Returns `1` if `word` is one of `options`.
+ */
+static int isOneOf(const char *word, const char *const *options, size_t count){
+    for(size_t i=0; i<count; i++){
+        if(strcmp(word, options[i])==0) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Returns `1` for options that read or write files the cache cannot
+ *        see, such as dependency files, coverage data or `-save-temps`.
+ */
+static int isUncacheable(const char *word){
+    static const char *const prefixes[]={"-M", "-E", "-x", "-save-temps", "-fprofile", "--coverage",
+        "-ftest-coverage", "-specs", "--specs", "-wrapper", "-fplugin", "-B"};
+    // `-Wp,-MD,deps.d` hands a dependency option to the preprocessor directly.
+    if(strncmp(word, "-Wp,", 4)==0 && strstr(word, "-M")) return 1;
+    return strcmp(word, "-")==0 || word[0]=='@' || hasPrefix(word, prefixes, sizeof(prefixes)/sizeof(prefixes[0]));
+}
+
+/**
+ * @brief Returns `1` if `word` may appear in a command the cache or a compile
+ *        worker runs: it has no shell syntax (`;`, `&&`, pipes, redirections,
+ *        quotes, variables, globs) and is not an option that reads or writes
+ *        files on the side.
+ *
+ * @ingroup compcache
+ */
+int compileWordSafe(const char *word){
+    #ifdef _WIN32
+        const char *special=";&|<>$`'\"()*?[]{}!%^\n\r";
+    #else
+        const char *special=";&|<>$`'\"()*?[]{}!\\~#\n\r";
+    #endif
+    return !word[strcspn(word, special)] && !isUncacheable(word);
+}
+
+/**
+ * @brief Classifies the word after `-I`, `-l` and the other options that
+ *        take their value as the next word, or returns `-1` for other words.
+ */
+static int valueKind(const char *word){
+    static const char *const preprocessor[]={"-I", "-D", "-U", "-include", "-imacros", "-isystem",
+        "-iquote", "-idirafter", "-Xpreprocessor"};
+    static const char *const linker[]={"-L", "-l", "-Xlinker"};
+    static const char *const flag[]={"-isysroot", "-target", "-arch"};
+    if(isOneOf(word, preprocessor, sizeof(preprocessor)/sizeof(preprocessor[0]))) return COMPILE_WORD_PREPROCESSOR;
+    if(isOneOf(word, linker, sizeof(linker)/sizeof(linker[0]))) return COMPILE_WORD_LINKER;
+    if(isOneOf(word, flag, sizeof(flag)/sizeof(flag[0]))) return COMPILE_WORD_FLAG;
+    return -1;
+}
+
+/**
+ * @brief Classifies an option with its value, if any, joined to it.
+ */
+static CompileWord optionKind(const char *word){
+    static const char *const preprocessor[]={"-I", "-D", "-U", "-Wp,", "-nostdinc"};
+    static const char *const linker[]={"-L", "-l", "-Wl,"};
+    if(hasPrefix(word, preprocessor, sizeof(preprocessor)/sizeof(preprocessor[0]))) return COMPILE_WORD_PREPROCESSOR;
+    if(hasPrefix(word, linker, sizeof(linker)/sizeof(linker[0]))) return COMPILE_WORD_LINKER;
+    return COMPILE_WORD_FLAG;
+}
+
+/**
+ * @brief Returns the first source file of `parsed`.
+ */
+static const char *firstSource(const CompileCommand *parsed){
+    for(int i=1; i<parsed->count; i++){
+        if(parsed->kinds[i]==COMPILE_WORD_SOURCE) return parsed->words[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Splits `command` into words if it is a single compiler run that
+ *        devcli can take apart.
+ *
+ * @details Only one plain command is accepted, with no word that fails
+ *          `compileWordSafe()`: shell syntax or side files could run or read
+ *          something devcli does not see. Every other word must be an
+ *          option, a C or C++ source file, or an object file or library to
+ *          link, and at least one source file is needed. With `-c` or `-S`
+ *          and one source, `output` is the `-o` name or the one the compiler
+ *          would choose; several sources cannot have an `-o` then.
+ *
+ * @ingroup compcache
+ *
+ * @param command Command line after placeholder substitution.
+ * @param parsed Receives the words; release with `compileCommandFree()`.
+ *
+ * @return int `1` if it was split, `0` if it is a compiler run that cannot
+ *         be, `-1` if it is not a compiler run at all.
+ */
+int compileCommandParse(const char *command, CompileCommand *parsed){
+    memset(parsed, 0, sizeof(*parsed));
+    while(*command==' ' || *command=='\t') command++;
+    size_t first=strcspn(command, " \t");
+    char compiler[512];
+    if(first==0 || first>=sizeof(compiler)) return -1;
+    memcpy(compiler, command, first);
+    compiler[first]='\0';
+    if(!compileWordIsCompiler(compiler)) return -1;
+    parsed->copy=strdup(command);
+    if(!parsed->copy) return 0;
+    for(char *word=strtok(parsed->copy, " \t"); word; word=strtok(NULL, " \t")){
+        if(parsed->count==COMPILE_CACHE_MAX_ARGS || !compileWordSafe(word)) goto refuse;
+        parsed->words[parsed->count++]=word;
+    }
+    parsed->kinds[0]=COMPILE_WORD_FLAG;
+    for(int i=1; i<parsed->count; i++){
+        char *word=parsed->words[i];
+        int kind=valueKind(word);
+        if(kind>=0){
+            if(i+1>=parsed->count) goto refuse;
+            parsed->kinds[i]=parsed->kinds[i+1]=(CompileWord)kind;
+            i++;
+        }
+        else if(strncmp(word, "-o", 2)==0){
+            if(parsed->output || (!word[2] && i+1>=parsed->count)) goto refuse;
+            parsed->kinds[i]=COMPILE_WORD_OUTPUT;
+            if(!word[2]) parsed->kinds[++i]=COMPILE_WORD_OUTPUT;
+            parsed->output=word[2] ? word+2 : parsed->words[i];
+        }
+        else if(strcmp(word, "-c")==0 || strcmp(word, "-S")==0){
+            parsed->kinds[i]=COMPILE_WORD_MODE;
+            parsed->mode=word[1];
+        }
+        else if(word[0]=='-'){
+            parsed->kinds[i]=optionKind(word);
+            if(strncmp(word, "-g", 2)==0) parsed->debug=1;
+        }
+        else if(isSource(word)){
+            parsed->kinds[i]=COMPILE_WORD_SOURCE;
+            parsed->sources++;
+        }
+        else if(isLinkInput(word)){
+            parsed->kinds[i]=COMPILE_WORD_INPUT;
+            parsed->inputs++;
+        }
+        else goto refuse;
+    }
+    if(parsed->sources==0 || (parsed->mode && parsed->sources>1 && parsed->output)) goto refuse;
+    if(!parsed->output && parsed->mode && parsed->sources==1){
+        const char *base=firstSource(parsed);
+        for(const char *p=base; *p; p++){
+            if(*p=='/' || *p=='\\') base=p+1;
+        }
+        int n=(int)(strrchr(base, '.')-base);
+        snprintf(parsed->defaultOutput, sizeof(parsed->defaultOutput), "%.*s.%c", n, base, parsed->mode=='c' ? 'o' : 's');
+        parsed->output=parsed->defaultOutput;
+    }
+    else if(!parsed->output && !parsed->mode){
+        #ifdef _WIN32
+            strcpy(parsed->defaultOutput, "a.exe");
+        #else
+            strcpy(parsed->defaultOutput, "a.out");
+        #endif
+        parsed->output=parsed->defaultOutput;
+    }
+    return 1;
+refuse:
+    compileCommandFree(parsed);
+    return 0;
+}
+
+/**
+ * @brief Releases the words of `compileCommandParse()`.
+ *
+ * @ingroup compcache
+ */
+void compileCommandFree(CompileCommand *parsed){
+    free(parsed->copy);
+    parsed->copy=NULL;
+    parsed->count=0;
+}
+
+/**
+ * @brief Returns `1` if `source` is compiled as C++: by a C++ driver such as
+ *        g++ or clang++, or because of its extension.
+ *
+ * @ingroup compcache
+ */
+int compileCommandIsCxx(const CompileCommand *parsed, const char *source){
+    const char *compiler=parsed->words[0];
+    const char *dot=strrchr(source, '.');
+    return strstr(compiler, "++")!=NULL || !dot || strcmp(dot, ".c")!=0;
+}
+
+/**
+ * @brief Preprocesses one `source` of `parsed` into the file `out`.
+ *
+ * @details Runs the compiler with the options of `parsed`, minus the mode,
+ *          output and link arguments, and `-E`. Its messages are discarded;
+ *          a source that does not preprocess is left for the real compile
+ *          to report.
+ *
+ * @ingroup compcache
+ *
+ * @return int Status of the preprocessor, `0` on success.
+ */
+int compileCommandPreprocess(const CompileCommand *parsed, const char *source, const char *out){
+    size_t len=strlen(source)+strlen(out)+40;
+    for(int i=0; i<parsed->count; i++) len+=strlen(parsed->words[i])+1;
+    char *command=malloc(len);
+    if(!command) return -1;
+    char *p=command;
+    for(int i=0; i<parsed->count; i++){
+        if(parsed->kinds[i]==COMPILE_WORD_FLAG || parsed->kinds[i]==COMPILE_WORD_PREPROCESSOR) p+=sprintf(p, "%s ", parsed->words[i]);
+    }
+    #ifdef _WIN32
+        sprintf(p, "-E %s -o \"%s\" 2>NUL", source, out);
+    #else
+        sprintf(p, "-E %s -o \"%s\" 2>/dev/null", source, out);
+    #endif
+    int status=spawnShell(command, NULL, NULL);
+    free(command);
+    return status;
+}
+
+/**
+ * @brief Folds where `compiler` is installed, its size and modification
+ *        time into `hash`, so that an upgraded compiler misses.
+ *
+ * @return int `0` on success, `-1` if the compiler is not on `PATH`.
+ */
+static int hashCompiler(CacheHash *hash, const char *compiler){
+    char path[1024];
+    struct stat info;
+    int found=0;
+    if(strchr(compiler, '/') || strchr(compiler, '\\')){
+        found=stat(compiler, &info)==0 && snprintf(path, sizeof(path), "%s", compiler)<(int)sizeof(path);
+    }
+    else{
+        #ifdef _WIN32
+            const char separator=';';
+            const char *suffixes[]={"", ".exe"};
+        #else
+            const char separator=':';
+            const char *suffixes[]={""};
+        #endif
+        const char *dirs=getenv("PATH");
+        while(dirs && *dirs && !found){
+            size_t len=strcspn(dirs, (char[]){separator, '\0'});
+            for(size_t i=0; i<sizeof(suffixes)/sizeof(suffixes[0]) && !found; i++){
+                int n=snprintf(path, sizeof(path), "%.*s/%s%s", (int)len, dirs, compiler, suffixes[i]);
+                found=n>0 && (size_t)n<sizeof(path) && stat(path, &info)==0 && !(info.st_mode&S_IFDIR);
+            }
+            dirs+=len;
+            if(*dirs==separator) dirs++;
+        }
+    }
+    if(!found) return -1;
+    uint64_t fields[2]={(uint64_t)info.st_size, (uint64_t)info.st_mtime};
+    hashString(hash, path);
+    hashUpdate(hash, fields, sizeof(fields));
+    return 0;
+}
+
+/**
+ * @brief Copies the file `from` to `to`.
+ *
+ * @return int `0` on success.
+ */
+static int copyFile(const char *from, const char *to){
+    FILE *in=fopen(from, "rb");
+    if(!in) return -1;
+    FILE *out=fopen(to, "wb");
+    if(!out){
+        fclose(in);
+        return -1;
+    }
+    char buffer[65536];
+    size_t n;
+    int error=0;
+    while(!error && (n=fread(buffer, 1, sizeof(buffer), in))>0) error=fwrite(buffer, 1, n, out)!=n;
+    error|=ferror(in);
+    fclose(in);
+    error|=fclose(out)!=0;
+    if(error) remove(to);
+    return error ? -1 : 0;
+}
+
+/**
+ * @brief Moves `from` over `to`, replacing it in one step, so nobody sees a
+ *        half-written file and a running executable can be replaced.
+ *
+ * @return int `0` on success.
+ */
+static int replaceFile(const char *from, const char *to){
+    #ifdef _WIN32
+        int ok=MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING);
+    #else
+        int ok=rename(from, to)==0;
+    #endif
+    if(!ok) remove(from);
+    return ok ? 0 : -1;
+}
+
+/**
+ * @brief Copies `from` to `to` through a temporary file next to `to`, with
+ *        the permissions of `from`.
+ *
+ * @return int `0` on success.
+ */
+static int installFile(const char *from, const char *to){
+    size_t len=strlen(to)+48;
+    char *temp=malloc(len);
+    if(!temp) return -1;
+    snprintf(temp, len, "%s.devcli-%ld-%u", to, (long)GETPID(), atomic_fetch_add(&cacheTemp, 1));
+    int result=copyFile(from, temp);
+    #ifndef _WIN32
+        struct stat info;
+        if(result==0 && stat(from, &info)==0) chmod(temp, info.st_mode&07777);
+    #endif
+    if(result==0) result=replaceFile(temp, to);
+    free(temp);
+    return result;
+}
+
+/**
+ * @brief Writes the compiler messages stored in `path` to stderr, so a hit
+ *        shows the same warnings as the compile it replaces.
+ */
+static void replayMessages(const char *path){
+    FILE *file=fopen(path, "rb");
+    if(!file) return;
+    char buffer[4096];
+    size_t n;
+    while((n=fread(buffer, 1, sizeof(buffer), file))>0) fwrite(buffer, 1, n, stderr);
+    fclose(file);
+    fflush(stderr);
+}
+
+/**
+ * @brief Returns `1` if the file at `path` exists and is not empty.
+ */
+static int hasContent(const char *path){
+    struct stat info;
+    return stat(path, &info)==0 && info.st_size>0;
+}
+
+/**
+ * @brief Computes the key of a parsed compile: the compiler's identity,
+ *        every word but the output name, and the preprocessed source.
+ *
+ * @details The preprocessor runs with the same flags and `-E`, so every
+ *          header the source includes, every macro from the command line
+ *          and `__DATE__` or `__TIME__`, which expand to the time of the run,
+ *          are in the text that is hashed. With `-g` the output also names
+ *          the working directory, which is added to the key too. For links,
+ *          `LIBRARY_PATH` is part of the key, but the libraries themselves
+ *          are not: a library rebuilt under the same name is not noticed.
+ *
+ * @return int `0` on success, `-1` if the preprocessor failed.
+ */
+static int hashCompile(const CompileCommand *parsed, const char *dir, CacheHash *key){
+    key->lo=0x62b821756295c58dull;
+    key->hi=0x6c62272e07bb0142ull;
+    hashString(key, COMPILE_CACHE_VERSION);
+    if(hashCompiler(key, parsed->words[0])!=0) return -1;
+    for(int i=1; i<parsed->count; i++){
+        if(parsed->kinds[i]!=COMPILE_WORD_OUTPUT) hashString(key, parsed->words[i]);
+    }
+    const char *libraryPath=getenv("LIBRARY_PATH");
+    hashString(key, libraryPath ? libraryPath : "");
+    if(parsed->debug){
+        char cwd[1024];
+        #ifdef _WIN32
+            if(!GetCurrentDirectoryA(sizeof(cwd), cwd)) return -1;
+        #else
+            if(!getcwd(cwd, sizeof(cwd))) return -1;
+        #endif
+        hashString(key, cwd);
+    }
+    char preprocessed[1200];
+    snprintf(preprocessed, sizeof(preprocessed), "%s/tmp-%ld-%u.i", dir, (long)GETPID(), atomic_fetch_add(&cacheTemp, 1));
+    int status=compileCommandPreprocess(parsed, firstSource(parsed), preprocessed);
+    int result=status==0 ? hashFile(key, preprocessed) : -1;
+    remove(preprocessed);
+    return result;
+}
+
+/**
+ * @brief Runs a compile command through the cache.
+ *
+ * @details Recognises a single gcc, g++, cc, c++ or clang run (see
+ *          `compileCommandParse()`) that compiles one source file and links
+ *          no other object file, such as `gcc hello.c -o hello` from
+ *          `build.gcc`, and computes a key from the compiler, its flags and
+ *          the preprocessed source (see `hashCompile()`). If the store holds an
+ *          output for the key, that object file or executable is copied into
+ *          place and the compiler's messages from the first run are shown
+ *          again; otherwise the command runs and its output is stored when it
+ *          succeeds. Entries live in `DEVCLI_CACHE_DIR`, by default
+ *          `~/.devcli/cache`, one file per key in directories named by its
+ *          first two hex digits; writes go through temporary files and a
+ *          rename, so concurrent tasks and devcli processes can share it.
+ *          Nothing is ever evicted; delete the directory to reclaim space.
+ *
+ *          `DEVCLI_CACHE=0` turns the cache off. Hits, misses and compiler
+ *          runs that cannot be cached are counted for `compileCacheReport()`.
+ *          Safe to call from several threads at once.
+ *
+ * @ingroup compcache
+ *
+ * @param command Command line after placeholder substitution.
+ * @param cpus CPU list for `spawnShell()`, or `NULL`.
+ * @param peakMemory Receives the compile's peak memory in MiB, `0` on a hit.
+ * @param status Receives the command's status, `0` on a hit.
+ *
+ * @return int `0` if the command was served or run here, `-1` if it is not
+ *         a cacheable compile and the caller must run it.
+ *
+ * Example usage:
+ * @code
+ * int status;
+ * if (compileCacheRun("gcc hello.c -o hello", NULL, NULL, &status) != 0)
+ *     status = spawnShell("gcc hello.c -o hello", NULL, NULL);
+ * compileCacheReport();
+ * @endcode
+ */
+int compileCacheRun(const char *command, const char *cpus, uint32_t *peakMemory, int *status){
+    const char *enabled=getenv("DEVCLI_CACHE");
+    if(enabled && strcmp(enabled, "0")==0) return -1;
+    CompileCommand parsed;
+    int kind=compileCommandParse(command, &parsed);
+    if(kind<0) return -1;
+    char dir[1024];
+    CacheHash key;
+    if(kind==0 || parsed.sources!=1 || parsed.inputs>0 || cacheDirectory(dir, sizeof(dir))!=0 || hashCompile(&parsed, dir, &key)!=0){
+        compileCommandFree(&parsed);
+        atomic_fetch_add(&cacheSkipped, 1);
+        return -1;
+    }
+    char entry[1200], messages[1300], temp[1300];
+    snprintf(entry, sizeof(entry), "%s/%02x", dir, (unsigned)(key.hi>>56));
+    MKDIR(entry);
+    snprintf(entry, sizeof(entry), "%s/%02x/%016llx%016llx", dir, (unsigned)(key.hi>>56), (unsigned long long)key.hi, (unsigned long long)key.lo);
+    snprintf(messages, sizeof(messages), "%s.stderr", entry);
+    const char *source=firstSource(&parsed);
+    if(installFile(entry, parsed.output)==0){
+        LOG("Compile cache hit for %s; copied %s from %s.", source, parsed.output, entry);
+        replayMessages(messages);
+        atomic_fetch_add(&cacheHits, 1);
+        if(peakMemory) *peakMemory=0;
+        *status=0;
+        compileCommandFree(&parsed);
+        return 0;
+    }
+    snprintf(temp, sizeof(temp), "%s/tmp-%ld-%u.stderr", dir, (long)GETPID(), atomic_fetch_add(&cacheTemp, 1));
+    size_t len=strlen(command)+strlen(temp)+8;
+    char *redirected=malloc(len);
+    if(!redirected){
+        LOG_ERROR("Dynamic Memory allocation failed.");
+        compileCommandFree(&parsed);
+        return -1;
+    }
+    snprintf(redirected, len, "%s 2>\"%s\"", command, temp);
+    *status=spawnShell(redirected, cpus, peakMemory);
+    free(redirected);
+    replayMessages(temp);
+    atomic_fetch_add(&cacheMisses, 1);
+    if(*status==0){
+        if(hasContent(temp)) installFile(temp, messages);
+        else remove(messages);
+        if(installFile(parsed.output, entry)==0) LOG("Compile cache miss for %s; stored %s.", source, parsed.output);
+        else LOG_ERROR("Could not store %s in the compile cache at %s.", parsed.output, entry);
+    }
+    remove(temp);
+    compileCommandFree(&parsed);
+    return 0;
+}
+
+/**
+ * @brief Logs the hit rate of the compiles of this run and resets the counts.
+ *
+ * @details Logs nothing if the run started no compiler.
+ *
+ * @ingroup compcache
+ */
+void compileCacheReport(void){
+    int hits=atomic_exchange(&cacheHits, 0);
+    int misses=atomic_exchange(&cacheMisses, 0);
+    int skipped=atomic_exchange(&cacheSkipped, 0);
+    if(hits+misses>0){
+        LOG("Compile cache: %d hit(s), %d miss(es), %d not cacheable; %.0f%% hit rate.",
+            hits, misses, skipped, 100.0*hits/(hits+misses));
+    }
+    else if(skipped>0) LOG("Compile cache: %d compiler run(s), none of them cacheable.", skipped);
+}
+
+/** @} */ // end of compcache group
@@ -0,0 +1,63 @@
+/**
+ * @file compcache.h
+ * @brief Serves gcc and g++ outputs from a local store when nothing that affects them changed.
+ */
+
+#ifndef DEVCLI_COMPCACHE_H
+#define DEVCLI_COMPCACHE_H
+
+#include <stdint.h>
+
+/** @defgroup compcache Compile Cache
+ *  @brief ccache-style cache in front of the compile commands of tasks such as `build.gcc`.
+ *  @{
+ */
+
+/**
+ * @def COMPILE_CACHE_MAX_ARGS
+ * @brief Most words a compile command may have to be cached or distributed.
+ */
+#define COMPILE_CACHE_MAX_ARGS 128
+
+/**
+ * @brief What a word of a compile command is, as `compileCommandParse()`
+ *        classifies it.
+ */
+typedef enum {
+    COMPILE_WORD_FLAG,          /**< Compiler option, or the value of one such as `-isysroot`'s. */
+    COMPILE_WORD_PREPROCESSOR,  /**< `-I`, `-D`, `-include` and the like, and their values. */
+    COMPILE_WORD_LINKER,        /**< `-L`, `-l`, `-Wl,` and `-Xlinker`, and their values. */
+    COMPILE_WORD_OUTPUT,        /**< `-o` and the output name. */
+    COMPILE_WORD_MODE,          /**< `-c` or `-S`. */
+    COMPILE_WORD_SOURCE,        /**< C or C++ source file. */
+    COMPILE_WORD_INPUT          /**< Object file or library to link. */
+} CompileWord;
+
+/**
+ * @brief A single compiler run split into words; see `compileCommandParse()`.
+ */
+typedef struct {
+    char *copy;                             /**< The command, cut into words in place. */
+    char *words[COMPILE_CACHE_MAX_ARGS];    /**< Compiler first. */
+    CompileWord kinds[COMPILE_CACHE_MAX_ARGS];
+    int count;
+    int sources;                            /**< Number of `COMPILE_WORD_SOURCE` words. */
+    int inputs;                             /**< Number of `COMPILE_WORD_INPUT` words. */
+    char mode;                              /**< `'c'`, `'S'`, or `'\0'` for a link. */
+    const char *output;                     /**< `-o` name, or the compiler's default for one source. */
+    char defaultOutput[512];                /**< `output` when there is no `-o`. */
+    int debug;                              /**< Some `-g` flag; the output names the directory. */
+} CompileCommand;
+
+int compileCommandParse(const char *command, CompileCommand *parsed);
+void compileCommandFree(CompileCommand *parsed);
+int compileCommandPreprocess(const CompileCommand *parsed, const char *source, const char *out);
+int compileCommandIsCxx(const CompileCommand *parsed, const char *source);
+int compileWordIsCompiler(const char *word);
+int compileWordSafe(const char *word);
+int compileCacheRun(const char *command, const char *cpus, uint32_t *peakMemory, int *status);
+void compileCacheReport(void);
+
+/** @} */ // end of compcache group
+
+#endif /* DEVCLI_COMPCACHE_H */
@@ -0,0 +1,1330 @@
+/**
+ * @file config.c
+ * @brief Builds and queries the frozen task catalog described in config.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "config.h"
+#include "membudget.h"
+#include "tape.h"
+#include "log.h"
+
+/** @addtogroup config
+ *  @{
+ */
+
+/**
+ * @def CONFIG_CACHE_MAGIC
+ * @brief First four bytes of a cache file written by `configImageSave()` ("DVCK").
+ */
+#define CONFIG_CACHE_MAGIC 0x4B435644u
+
+/**
+ * @brief Header in front of the image in a cache file.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;   /**< `CONFIG_IMAGE_VERSION` of the image that follows. */
+    uint64_t key;       /**< Caller's fingerprint of the sources the image was built from. */
+} ConfigCacheHeader;
+
+/**
+ * @brief Growable string table that stores every distinct string exactly once.
+ */
+typedef struct {
+    char *data;
+    size_t size;
+    size_t cap;
+    uint32_t *slots;    /**< Open-addressing table of offsets into `data`. */
+    size_t slotCount;
+    size_t used;
+} StringPool;
+
+/**
+ * @brief Task record while building; tasks are regrouped by category on finish.
+ */
+typedef struct {
+    uint32_t category;
+    uint32_t name;
+    uint32_t entry[CONFIG_SHELL_COUNT];
+    uint32_t extends;   /**< Name of the base task (`category.task`), or `CONFIG_NONE`. */
+} BuilderTask;
+
+struct ConfigBuilder {
+    StringPool strings;
+    uint32_t *categories;   /**< Category name offsets in first-seen order. */
+    size_t categoryCount, categoryCap;
+    BuilderTask *tasks;
+    size_t taskCount, taskCap;
+    ConfigEntry *entries;   /**< `firstDep` indexes `depNames` until finish; `CONFIG_NONE` if `dependsOn` was absent. */
+    size_t entryCount, entryCap;
+    uint32_t *depNames;
+    size_t depCount, depCap;
+    ConfigPackage *packages; /**< Indexed by `firstPackage`, which is `CONFIG_NONE` if `packages` was absent. */
+    size_t packageCount, packageCap;
+    ConfigResource *resources; /**< Indexed by `firstResource`, which is `CONFIG_NONE` if `resources` was absent. */
+    size_t resourceCount, resourceCap;
+    uint32_t *taskSlots;    /**< Hash of (category, name) offsets to task index. */
+    size_t taskSlotCount;
+};
+
+static const char *const shellNames[CONFIG_SHELL_COUNT]={"Powershell","CMD","Linux"};
+static const char *const packageManagerNames[CONFIG_PM_COUNT]={"apt","scoop","choco"};
+
+/**
+ * @brief Maps a shell name as produced by `detectShell()` to its enum value.
+ *
+ * @param name Shell name, e.g. `"Linux"`.
+ * @return ConfigShell The matching shell, or `CONFIG_SHELL_COUNT` if unknown.
+ */
+ConfigShell configShellFromName(const char *name){
+    for(int i=0; i<CONFIG_SHELL_COUNT; i++){
+        if(name && strcmp(name, shellNames[i])==0) return (ConfigShell)i;
+    }
+    return CONFIG_SHELL_COUNT;
+}
+
+/**
+ * @brief Returns the `tasks.json` key used for a shell.
+ */
+const char *configShellName(ConfigShell shell){
+    return shell<CONFIG_SHELL_COUNT ? shellNames[shell] : NULL;
+}
+
+/**
+ * @brief Maps a `packages` key such as `"apt"` to its enum value.
+ *
+ * @return ConfigPackageManager The manager, or `CONFIG_PM_COUNT` if unknown.
+ */
+ConfigPackageManager configPackageManagerFromName(const char *name){
+    for(int i=0; i<CONFIG_PM_COUNT; i++){
+        if(name && strcmp(name, packageManagerNames[i])==0) return (ConfigPackageManager)i;
+    }
+    return CONFIG_PM_COUNT;
+}
+
+/**
+ * @brief Returns the `packages` key used for a package manager.
+ */
+const char *configPackageManagerName(ConfigPackageManager manager){
+    return manager<CONFIG_PM_COUNT ? packageManagerNames[manager] : NULL;
+}
+
+/**
+ * @brief FNV-1a over `len` bytes, continuing from a previous hash value.
+ */
+static uint32_t hashBytes(uint32_t hash, const char *s, size_t len){
+    for(size_t i=0; i<len; i++){
+        hash^=(unsigned char)s[i];
+        hash*=16777619u;
+    }
+    return hash;
+}
+
+/** @brief Initial FNV-1a offset basis. */
+#define HASH_SEED 2166136261u
+
+/** @brief Seed of the second, independent task-name hash used by the perfect hash. */
+#define HASH_SEED_STEP 0x9E3779B9u
+
+/**
+ * @def CONFIG_DISPLACE_LIMIT
+ * @brief Displacements tried per bucket before the perfect hash gives up and
+ *        the builder falls back to linear probing.
+ */
+#define CONFIG_DISPLACE_LIMIT (1u<<16)
+
+/**
+ * @brief The two hashes of a `category.task` name used by the task lookup table.
+ *
+ * @details Equal to hashing the whole `category.task` string, which is what
+ *          `configFindTask()` does. `first` picks the home slot; `step` is
+ *          odd, so `first + d * step` visits every slot of a power-of-two
+ *          table as the displacement `d` grows. Its high bits also choose the
+ *          displacement bucket.
+ */
+static void taskHashes(const char *category, size_t categoryLen, const char *task, size_t taskLen, uint32_t *first, uint32_t *step){
+    uint32_t h=hashBytes(HASH_SEED, category, categoryLen);
+    h=hashBytes(h, ".", 1);
+    *first=hashBytes(h, task, taskLen);
+    uint32_t s=hashBytes(HASH_SEED_STEP, category, categoryLen);
+    s=hashBytes(s, ".", 1);
+    *step=hashBytes(s, task, taskLen)|1u;
+}
+
+/**
+ * @brief Ensures a dynamic array can hold `need` elements.
+ *
+ * @return int `0` on success, `-1` if memory could not be allocated.
+ */
+static int reserve(void **array, size_t *cap, size_t need, size_t elemSize){
+    if(need<=*cap) return 0;
+    size_t newCap=*cap ? *cap : 16;
+    while(newCap<need) newCap*=2;
+    void *grown=realloc(*array, newCap*elemSize);
+    if(!grown){
+        LOG_ERROR("Dynamic Memory not assigned while building config.");
+        return -1;
+    }
+    *array=grown;
+    *cap=newCap;
+    return 0;
+}
+
+static uint32_t poolProbe(const StringPool *pool, const char *s, size_t len, size_t *slotOut){
+    if(pool->slotCount==0){
+        if(slotOut) *slotOut=0;
+        return CONFIG_NONE;
+    }
+    size_t mask=pool->slotCount-1;
+    size_t slot=hashBytes(HASH_SEED, s, len)&mask;
+    while(pool->slots[slot]!=CONFIG_NONE){
+        const char *candidate=pool->data+pool->slots[slot];
+        if(strncmp(candidate, s, len)==0 && candidate[len]=='\0') return pool->slots[slot];
+        slot=(slot+1)&mask;
+    }
+    if(slotOut) *slotOut=slot;
+    return CONFIG_NONE;
+}
+
+static int poolRehash(StringPool *pool){
+    size_t newCount=pool->slotCount ? pool->slotCount*2 : 64;
+    uint32_t *slots=malloc(newCount*sizeof(uint32_t));
+    if(!slots){
+        LOG_ERROR("Dynamic Memory not assigned to string pool.");
+        return -1;
+    }
+    memset(slots, 0xFF, newCount*sizeof(uint32_t));
+    for(size_t i=0; i<pool->slotCount; i++){
+        uint32_t off=pool->slots[i];
+        if(off==CONFIG_NONE) continue;
+        const char *s=pool->data+off;
+        size_t slot=hashBytes(HASH_SEED, s, strlen(s))&(newCount-1);
+        while(slots[slot]!=CONFIG_NONE) slot=(slot+1)&(newCount-1);
+        slots[slot]=off;
+    }
+    free(pool->slots);
+    pool->slots=slots;
+    pool->slotCount=newCount;
+    return 0;
+}
+
+/**
+ * @brief Returns the offset of `s` in the pool, adding it if it is new.
+ *
+ * @return uint32_t The string offset, or `CONFIG_NONE` on allocation failure.
+ */
+static uint32_t poolIntern(StringPool *pool, const char *s, size_t len){
+    if((pool->used+1)*2>pool->slotCount && poolRehash(pool)!=0) return CONFIG_NONE;
+    size_t slot;
+    uint32_t found=poolProbe(pool, s, len, &slot);
+    if(found!=CONFIG_NONE) return found;
+    if(pool->size+len+1>=CONFIG_NONE){
+        LOG_ERROR("Config string table exceeds 4 GiB.");
+        return CONFIG_NONE;
+    }
+    if(reserve((void**)&pool->data, &pool->cap, pool->size+len+1, 1)!=0) return CONFIG_NONE;
+    uint32_t off=(uint32_t)pool->size;
+    memcpy(pool->data+off, s, len);
+    pool->data[off+len]='\0';
+    pool->size+=len+1;
+    pool->slots[slot]=off;
+    pool->used++;
+    return off;
+}
+
+static uint32_t internOptional(ConfigBuilder *builder, const char *s, int *failed){
+    if(!s) return CONFIG_NONE;
+    uint32_t off=poolIntern(&builder->strings, s, strlen(s));
+    if(off==CONFIG_NONE) *failed=1;
+    return off;
+}
+
+/**
+ * @brief Allocates an empty builder.
+ *
+ * @return ConfigBuilder* The builder, or `NULL` if memory could not be allocated.
+ */
+ConfigBuilder *configBuilderCreate(void){
+    ConfigBuilder *builder=calloc(1, sizeof(ConfigBuilder));
+    if(!builder){
+        LOG_ERROR("Dynamic Memory not assigned to config builder.");
+    }
+    return builder;
+}
+
+/**
+ * @brief Releases a builder and everything it owns.
+ */
+void configBuilderFree(ConfigBuilder *builder){
+    if(!builder) return;
+    free(builder->strings.data);
+    free(builder->strings.slots);
+    free(builder->categories);
+    free(builder->tasks);
+    free(builder->entries);
+    free(builder->depNames);
+    free(builder->packages);
+    free(builder->resources);
+    free(builder->taskSlots);
+    free(builder);
+}
+
+static size_t taskSlotOf(const ConfigBuilder *builder, uint32_t category, uint32_t name){
+    uint32_t key[2]={category, name};
+    return hashBytes(HASH_SEED, (const char*)key, sizeof(key))&(builder->taskSlotCount-1);
+}
+
+static uint32_t builderFindTask(const ConfigBuilder *builder, uint32_t category, uint32_t name){
+    if(builder->taskSlotCount==0) return CONFIG_NONE;
+    size_t slot=taskSlotOf(builder, category, name);
+    while(builder->taskSlots[slot]!=CONFIG_NONE){
+        const BuilderTask *task=&builder->tasks[builder->taskSlots[slot]];
+        if(builder->categories[task->category]==category && task->name==name) return builder->taskSlots[slot];
+        slot=(slot+1)&(builder->taskSlotCount-1);
+    }
+    return CONFIG_NONE;
+}
+
+static int builderRehashTasks(ConfigBuilder *builder){
+    size_t newCount=builder->taskSlotCount ? builder->taskSlotCount*2 : 64;
+    uint32_t *slots=malloc(newCount*sizeof(uint32_t));
+    if(!slots){
+        LOG_ERROR("Dynamic Memory not assigned to task table.");
+        return -1;
+    }
+    memset(slots, 0xFF, newCount*sizeof(uint32_t));
+    free(builder->taskSlots);
+    builder->taskSlots=slots;
+    builder->taskSlotCount=newCount;
+    for(size_t i=0; i<builder->taskCount; i++){
+        const BuilderTask *task=&builder->tasks[i];
+        size_t slot=taskSlotOf(builder, builder->categories[task->category], task->name);
+        while(slots[slot]!=CONFIG_NONE) slot=(slot+1)&(newCount-1);
+        slots[slot]=(uint32_t)i;
+    }
+    return 0;
+}
+
+/**
+ * @brief Returns the builder index of `category.task`, creating the task if needed.
+ */
+static uint32_t builderTask(ConfigBuilder *builder, uint32_t category, uint32_t name){
+    uint32_t found=builderFindTask(builder, category, name);
+    if(found!=CONFIG_NONE) return found;
+    size_t categoryIndex=0;
+    while(categoryIndex<builder->categoryCount && builder->categories[categoryIndex]!=category) categoryIndex++;
+    if(categoryIndex==builder->categoryCount){
+        if(reserve((void**)&builder->categories, &builder->categoryCap, builder->categoryCount+1, sizeof(uint32_t))!=0) return CONFIG_NONE;
+        builder->categories[builder->categoryCount++]=category;
+    }
+    if((builder->taskCount+1)*2>builder->taskSlotCount && builderRehashTasks(builder)!=0) return CONFIG_NONE;
+    if(reserve((void**)&builder->tasks, &builder->taskCap, builder->taskCount+1, sizeof(BuilderTask))!=0) return CONFIG_NONE;
+    BuilderTask *task=&builder->tasks[builder->taskCount];
+    task->category=(uint32_t)categoryIndex;
+    task->name=name;
+    for(int i=0; i<CONFIG_SHELL_COUNT; i++) task->entry[i]=CONFIG_NONE;
+    task->extends=CONFIG_NONE;
+    size_t slot=taskSlotOf(builder, category, name);
+    while(builder->taskSlots[slot]!=CONFIG_NONE) slot=(slot+1)&(builder->taskSlotCount-1);
+    builder->taskSlots[slot]=(uint32_t)builder->taskCount;
+    return (uint32_t)builder->taskCount++;
+}
+
+/**
+ * @brief Adds (or replaces) the entry for `category.task.shell`.
+ *
+ * @details Categories and tasks keep the order in which they are first seen,
+ *          which is the order `help` prints them in. Adding an entry for a
+ *          shell that already has one replaces it.
+ *
+ * @param builder Builder to add to.
+ * @param category Category name, e.g. `"install"`.
+ * @param task Task name, e.g. `"git"`.
+ * @param shell Shell the entry applies to.
+ * @param draft Fields of the entry; strings are copied.
+ *
+ * @return int `0` on success, `-1` on invalid input or allocation failure.
+ */
+int configBuilderAddEntry(ConfigBuilder *builder, const char *category, const char *task, ConfigShell shell, const ConfigEntryDraft *draft){
+    if(!builder || !category || !task || !draft || shell>=CONFIG_SHELL_COUNT){
+        LOG_ERROR("Invalid config entry.");
+        return -1;
+    }
+    int failed=0;
+    uint32_t categoryName=internOptional(builder, category, &failed);
+    uint32_t taskName=internOptional(builder, task, &failed);
+    if(failed) return -1;
+    uint32_t taskIndex=builderTask(builder, categoryName, taskName);
+    if(taskIndex==CONFIG_NONE) return -1;
+    if(reserve((void**)&builder->entries, &builder->entryCap, builder->entryCount+1, sizeof(ConfigEntry))!=0) return -1;
+    if(reserve((void**)&builder->depNames, &builder->depCap, builder->depCount+draft->depCount, sizeof(uint32_t))!=0) return -1;
+    if(reserve((void**)&builder->packages, &builder->packageCap, builder->packageCount+draft->packageCount, sizeof(ConfigPackage))!=0) return -1;
+    if(reserve((void**)&builder->resources, &builder->resourceCap, builder->resourceCount+draft->resourceCount, sizeof(ConfigResource))!=0) return -1;
+    ConfigEntry entry;
+    entry.use=internOptional(builder, draft->use, &failed);
+    entry.cmd=internOptional(builder, draft->cmd, &failed);
+    entry.scoop=internOptional(builder, draft->scoop, &failed);
+    entry.choco=internOptional(builder, draft->choco, &failed);
+    entry.atPath=internOptional(builder, draft->atPath, &failed);
+    entry.atDrive=internOptional(builder, draft->atDrive, &failed);
+    entry.addToPath=internOptional(builder, draft->addToPath, &failed);
+    entry.requirements=internOptional(builder, draft->requirements, &failed);
+    entry.memory=draft->memory>0 ? draft->memory : CONFIG_NONE;
+    entry.cpus=internOptional(builder, draft->cpus, &failed);
+    entry.firstDep=(draft->hasDependsOn || draft->depCount>0) ? (uint32_t)builder->depCount : CONFIG_NONE;
+    entry.depCount=0;
+    for(size_t i=0; i<draft->depCount; i++){
+        if(!draft->dependsOn[i]) continue;
+        builder->depNames[builder->depCount+entry.depCount]=internOptional(builder, draft->dependsOn[i], &failed);
+        entry.depCount++;
+    }
+    entry.firstPackage=(draft->hasPackages || draft->packageCount>0) ? (uint32_t)builder->packageCount : CONFIG_NONE;
+    entry.packageCount=0;
+    for(size_t i=0; i<draft->packageCount; i++){
+        if(!draft->packages[i].name || draft->packages[i].manager>=CONFIG_PM_COUNT) continue;
+        ConfigPackage *package=&builder->packages[builder->packageCount+entry.packageCount++];
+        package->manager=(uint32_t)draft->packages[i].manager;
+        package->name=internOptional(builder, draft->packages[i].name, &failed);
+    }
+    entry.firstResource=(draft->hasResources || draft->resourceCount>0) ? (uint32_t)builder->resourceCount : CONFIG_NONE;
+    entry.resourceCount=0;
+    for(size_t i=0; i<draft->resourceCount; i++){
+        if(!draft->resources[i].name || draft->resources[i].capacity==0) continue;
+        ConfigResource *resource=&builder->resources[builder->resourceCount+entry.resourceCount++];
+        resource->name=internOptional(builder, draft->resources[i].name, &failed);
+        resource->capacity=draft->resources[i].capacity;
+    }
+    if(failed) return -1;
+    builder->depCount+=entry.depCount;
+    builder->packageCount+=entry.packageCount;
+    builder->resourceCount+=entry.resourceCount;
+    builder->entries[builder->entryCount]=entry;
+    builder->tasks[taskIndex].entry[shell]=(uint32_t)builder->entryCount++;
+    return 0;
+}
+
+/**
+ * @brief Makes `category.task` inherit from the task named `base`.
+ *
+ * @details Resolved by `configBuilderFinish()`, after every layer has been
+ *          added: shells the task does not define are taken from the base
+ *          task as they are, and fields missing from a shell it does define
+ *          are filled in from the base task's entry for that shell. Bases may
+ *          themselves extend other tasks; a later call replaces the base.
+ *
+ * @param builder Builder to add to.
+ * @param category Category name of the inheriting task.
+ * @param task Name of the inheriting task.
+ * @param base Full name of the base task, e.g. `"build.gcc"`.
+ *
+ * @return int `0` on success, `-1` on invalid input or allocation failure.
+ */
+int configBuilderSetExtends(ConfigBuilder *builder, const char *category, const char *task, const char *base){
+    if(!builder || !category || !task || !base){
+        LOG_ERROR("Invalid config extends.");
+        return -1;
+    }
+    int failed=0;
+    uint32_t categoryName=internOptional(builder, category, &failed);
+    uint32_t taskName=internOptional(builder, task, &failed);
+    uint32_t baseName=internOptional(builder, base, &failed);
+    if(failed) return -1;
+    uint32_t taskIndex=builderTask(builder, categoryName, taskName);
+    if(taskIndex==CONFIG_NONE) return -1;
+    builder->tasks[taskIndex].extends=baseName;
+    return 0;
+}
+
+/**
+ * @brief Resolves a `category.task` dependency name to a builder task index.
+ */
+static uint32_t builderResolve(const ConfigBuilder *builder, uint32_t nameOff){
+    const char *name=builder->strings.data+nameOff;
+    const char *dot=strchr(name, '.');
+    if(!dot || dot==name || dot[1]=='\0') return CONFIG_NONE;
+    uint32_t category=poolProbe(&builder->strings, name, (size_t)(dot-name), NULL);
+    uint32_t task=poolProbe(&builder->strings, dot+1, strlen(dot+1), NULL);
+    if(category==CONFIG_NONE || task==CONFIG_NONE) return CONFIG_NONE;
+    return builderFindTask(builder, category, task);
+}
+
+/**
+ * @brief Applies the `extends` chain of task `t`, bases first.
+ *
+ * @details `state` marks tasks as unvisited (0), in progress (1) or done (2)
+ *          so that cycles are reported once and then ignored.
+ *
+ * @return int `0` on success, `-1` on allocation failure.
+ */
+static int builderInherit(ConfigBuilder *builder, size_t t, unsigned char *state){
+    if(state[t]==2) return 0;
+    if(state[t]==1){
+        LOG_ERROR("Cyclic extends at %s.%s", builder->strings.data+builder->categories[builder->tasks[t].category], builder->strings.data+builder->tasks[t].name);
+        return 0;
+    }
+    state[t]=1;
+    uint32_t extends=builder->tasks[t].extends;
+    uint32_t base=extends==CONFIG_NONE ? CONFIG_NONE : builderResolve(builder, extends);
+    if(extends!=CONFIG_NONE && base==CONFIG_NONE){
+        LOG_ERROR("No such task to extend: %s", builder->strings.data+extends);
+    }
+    if(base!=CONFIG_NONE && base!=t){
+        if(builderInherit(builder, base, state)!=0) return -1;
+        for(int s=0; s<CONFIG_SHELL_COUNT; s++){
+            uint32_t inherited=builder->tasks[base].entry[s];
+            uint32_t own=builder->tasks[t].entry[s];
+            if(inherited==CONFIG_NONE) continue;
+            if(own==CONFIG_NONE){
+                builder->tasks[t].entry[s]=inherited;
+                continue;
+            }
+            if(reserve((void**)&builder->entries, &builder->entryCap, builder->entryCount+1, sizeof(ConfigEntry))!=0) return -1;
+            const ConfigEntry *from=&builder->entries[inherited];
+            ConfigEntry merged=builder->entries[own];
+            if(merged.use==CONFIG_NONE) merged.use=from->use;
+            if(merged.cmd==CONFIG_NONE) merged.cmd=from->cmd;
+            if(merged.scoop==CONFIG_NONE) merged.scoop=from->scoop;
+            if(merged.choco==CONFIG_NONE) merged.choco=from->choco;
+            if(merged.atPath==CONFIG_NONE) merged.atPath=from->atPath;
+            if(merged.atDrive==CONFIG_NONE) merged.atDrive=from->atDrive;
+            if(merged.addToPath==CONFIG_NONE) merged.addToPath=from->addToPath;
+            if(merged.requirements==CONFIG_NONE) merged.requirements=from->requirements;
+            if(merged.memory==CONFIG_NONE) merged.memory=from->memory;
+            if(merged.cpus==CONFIG_NONE) merged.cpus=from->cpus;
+            if(merged.firstDep==CONFIG_NONE){
+                merged.firstDep=from->firstDep;
+                merged.depCount=from->depCount;
+            }
+            if(merged.firstPackage==CONFIG_NONE){
+                merged.firstPackage=from->firstPackage;
+                merged.packageCount=from->packageCount;
+            }
+            if(merged.firstResource==CONFIG_NONE){
+                merged.firstResource=from->firstResource;
+                merged.resourceCount=from->resourceCount;
+            }
+            builder->entries[builder->entryCount]=merged;
+            builder->tasks[t].entry[s]=(uint32_t)builder->entryCount++;
+        }
+    }
+    builder->tasks[t].extends=CONFIG_NONE;
+    state[t]=2;
+    return 0;
+}
+
+/**
+ * @brief Lays out a perfect hash over the task names (hash and displace).
+ *
+ * @details Tasks are grouped into `displaceCount` buckets by their step hash.
+ *          Buckets are placed largest first; for each one the smallest
+ *          displacement `d` is searched for that sends every task of the
+ *          bucket to a free slot `(first + d * step) & mask`. A lookup then
+ *          costs two hashes, one table read and a single name comparison, and
+ *          never probes. The search runs once per build, so the frozen image,
+ *          the cache and embedded catalogs all carry the finished table.
+ *
+ * @param image Image whose task count, hash and displacement sections are set up.
+ * @param hashes `first` and `step` hash of task `i` at `2*i` and `2*i+1`.
+ * @param scratch At least `taskCount` entries of scratch space.
+ *
+ * @return int `0` on success, `-1` if some bucket could not be placed (for
+ *         example two names with identical hashes) or memory ran out.
+ */
+static int layoutPerfectHash(ConfigImage *image, const uint32_t *hashes, uint32_t *scratch){
+    size_t taskCount=image->taskCount, buckets=image->displaceCount;
+    uint32_t mask=image->hashSize-1;
+    uint32_t *hash=(uint32_t*)((char*)image+image->hashOff);
+    uint32_t *displace=(uint32_t*)((char*)image+image->displaceOff);
+    memset(hash, 0xFF, (size_t)image->hashSize*sizeof(uint32_t));
+    if(taskCount==0) return 0;
+    uint32_t *bucketStart=calloc(buckets+2, sizeof(uint32_t));
+    uint32_t *bucketOrder=malloc(buckets*sizeof(uint32_t));
+    if(!bucketStart || !bucketOrder){
+        free(bucketStart);
+        free(bucketOrder);
+        return -1;
+    }
+    for(size_t i=0; i<taskCount; i++) bucketStart[(hashes[2*i+1]>>8)%buckets+2]++;
+    for(size_t b=0; b<buckets; b++) bucketStart[b+2]+=bucketStart[b+1];
+    for(size_t i=0; i<taskCount; i++) scratch[bucketStart[(hashes[2*i+1]>>8)%buckets+1]++]=(uint32_t)i;
+    size_t largest=0;
+    for(size_t b=0; b<buckets; b++){
+        bucketOrder[b]=(uint32_t)b;
+        if(bucketStart[b+1]-bucketStart[b]>largest) largest=bucketStart[b+1]-bucketStart[b];
+    }
+    size_t placed=0;
+    for(size_t size=largest; size>0; size--){
+        for(size_t b=0; b<buckets; b++){
+            if(bucketStart[b+1]-bucketStart[b]==size) bucketOrder[placed++]=(uint32_t)b;
+        }
+    }
+    for(size_t b=0; b<buckets; b++) displace[b]=0;
+    int status=0;
+    for(size_t k=0; k<placed && status==0; k++){
+        uint32_t b=bucketOrder[k];
+        const uint32_t *members=scratch+bucketStart[b];
+        size_t count=bucketStart[b+1]-bucketStart[b];
+        uint32_t d=0;
+        for(; d<CONFIG_DISPLACE_LIMIT; d++){
+            size_t j=0;
+            for(; j<count; j++){
+                uint32_t slot=(hashes[2*members[j]]+d*hashes[2*members[j]+1])&mask;
+                if(hash[slot]!=CONFIG_NONE) break;
+                hash[slot]=members[j];
+            }
+            if(j==count) break;
+            while(j-->0) hash[(hashes[2*members[j]]+d*hashes[2*members[j]+1])&mask]=CONFIG_NONE;
+        }
+        if(d==CONFIG_DISPLACE_LIMIT) status=-1;
+        displace[b]=d;
+    }
+    free(bucketStart);
+    free(bucketOrder);
+    return status;
+}
+
+static size_t alignUp(size_t value){
+    return (value+7)&~(size_t)7;
+}
+
+/**
+ * @brief Freezes the builder into one contiguous, immutable image.
+ *
+ * @details `extends` links are resolved first (see
+ *          `configBuilderSetExtends()`), so the image only holds flat
+ *          per-shell entries and lookups never walk an inheritance chain.
+ *          Then tasks are grouped by category, shell entries are emitted in
+ *          task order (entries replaced by a later `configBuilderAddEntry()`
+ *          are dropped), `dependsOn` names are resolved to task indexes, and a
+ *          `category.task` hash table is laid out for `configFindTask()`.
+ *          The builder keeps the resolved entries and must still be freed.
+ *
+ * @return ConfigImage* The image (release with `configFree()`), or `NULL` on failure.
+ */
+ConfigImage *configBuilderFinish(ConfigBuilder *builder){
+    if(!builder) return NULL;
+    unsigned char *state=calloc(builder->taskCount+1, 1);
+    if(!state){
+        LOG_ERROR("Dynamic Memory not assigned while resolving extends.");
+        return NULL;
+    }
+    for(size_t t=0; t<builder->taskCount; t++){
+        if(builderInherit(builder, t, state)!=0){
+            free(state);
+            return NULL;
+        }
+    }
+    free(state);
+    size_t categoryCount=builder->categoryCount, taskCount=builder->taskCount;
+    size_t entryCount=0, depCount=0, packageCount=0, resourceCount=0;
+    for(size_t t=0; t<taskCount; t++){
+        for(int s=0; s<CONFIG_SHELL_COUNT; s++){
+            uint32_t e=builder->tasks[t].entry[s];
+            if(e==CONFIG_NONE) continue;
+            entryCount++;
+            depCount+=builder->entries[e].depCount;
+            packageCount+=builder->entries[e].packageCount;
+            resourceCount+=builder->entries[e].resourceCount;
+        }
+    }
+    size_t hashSize=16;
+    while(hashSize<taskCount*2) hashSize*=2;
+    size_t displaceCount=(taskCount+1)/2;
+
+    size_t categoriesOff=alignUp(sizeof(ConfigImage));
+    size_t tasksOff=alignUp(categoriesOff+categoryCount*sizeof(ConfigCategory));
+    size_t entriesOff=alignUp(tasksOff+taskCount*sizeof(ConfigTask));
+    size_t depsOff=alignUp(entriesOff+entryCount*sizeof(ConfigEntry));
+    size_t packagesOff=alignUp(depsOff+depCount*sizeof(ConfigDep));
+    size_t resourcesOff=alignUp(packagesOff+packageCount*sizeof(ConfigPackage));
+    size_t hashOff=alignUp(resourcesOff+resourceCount*sizeof(ConfigResource));
+    size_t displaceOff=alignUp(hashOff+hashSize*sizeof(uint32_t));
+    size_t stringsOff=alignUp(displaceOff+displaceCount*sizeof(uint32_t));
+    size_t total=alignUp(stringsOff+builder->strings.size);
+    if(total>=CONFIG_NONE){
+        LOG_ERROR("Frozen config exceeds 4 GiB.");
+        return NULL;
+    }
+
+    ConfigImage *image=calloc(1, total);
+    uint32_t *order=malloc((taskCount+1)*sizeof(uint32_t));
+    uint32_t *finalIndex=malloc((taskCount+1)*sizeof(uint32_t));
+    uint32_t *hashes=malloc((taskCount+1)*2*sizeof(uint32_t));
+    if(!image || !order || !finalIndex || !hashes){
+        LOG_ERROR("Dynamic Memory not assigned to frozen config.");
+        free(image);
+        free(order);
+        free(finalIndex);
+        free(hashes);
+        return NULL;
+    }
+    image->magic=CONFIG_IMAGE_MAGIC;
+    image->version=CONFIG_IMAGE_VERSION;
+    image->size=total;
+    image->categoryCount=(uint32_t)categoryCount;
+    image->taskCount=(uint32_t)taskCount;
+    image->entryCount=(uint32_t)entryCount;
+    image->depCount=(uint32_t)depCount;
+    image->packageCount=(uint32_t)packageCount;
+    image->resourceCount=(uint32_t)resourceCount;
+    image->hashSize=(uint32_t)hashSize;
+    image->displaceCount=(uint32_t)displaceCount;
+    image->stringsSize=(uint32_t)builder->strings.size;
+    image->categoriesOff=(uint32_t)categoriesOff;
+    image->tasksOff=(uint32_t)tasksOff;
+    image->entriesOff=(uint32_t)entriesOff;
+    image->depsOff=(uint32_t)depsOff;
+    image->packagesOff=(uint32_t)packagesOff;
+    image->resourcesOff=(uint32_t)resourcesOff;
+    image->hashOff=(uint32_t)hashOff;
+    image->displaceOff=(uint32_t)displaceOff;
+    image->stringsOff=(uint32_t)stringsOff;
+
+    ConfigCategory *categories=(ConfigCategory*)((char*)image+categoriesOff);
+    ConfigTask *tasks=(ConfigTask*)((char*)image+tasksOff);
+    ConfigEntry *entries=(ConfigEntry*)((char*)image+entriesOff);
+    ConfigDep *deps=(ConfigDep*)((char*)image+depsOff);
+    ConfigPackage *packages=(ConfigPackage*)((char*)image+packagesOff);
+    ConfigResource *resources=(ConfigResource*)((char*)image+resourcesOff);
+    uint32_t *hash=(uint32_t*)((char*)image+hashOff);
+
+    size_t placed=0;
+    for(size_t c=0; c<categoryCount; c++){
+        categories[c].name=builder->categories[c];
+        categories[c].firstTask=(uint32_t)placed;
+        for(size_t t=0; t<taskCount; t++){
+            if(builder->tasks[t].category!=c) continue;
+            finalIndex[t]=(uint32_t)placed;
+            order[placed++]=(uint32_t)t;
+        }
+        categories[c].taskCount=(uint32_t)placed-categories[c].firstTask;
+    }
+
+    size_t e=0, d=0, p=0, r=0;
+    for(size_t i=0; i<taskCount; i++){
+        const BuilderTask *source=&builder->tasks[order[i]];
+        tasks[i].category=source->category;
+        tasks[i].name=source->name;
+        for(int s=0; s<CONFIG_SHELL_COUNT; s++){
+            if(source->entry[s]==CONFIG_NONE){
+                tasks[i].entry[s]=CONFIG_NONE;
+                continue;
+            }
+            const ConfigEntry *draft=&builder->entries[source->entry[s]];
+            entries[e]=*draft;
+            entries[e].firstDep=(uint32_t)d;
+            for(uint32_t k=0; k<draft->depCount; k++){
+                uint32_t nameOff=builder->depNames[draft->firstDep+k];
+                uint32_t target=builderResolve(builder, nameOff);
+                deps[d].name=nameOff;
+                deps[d].task=target==CONFIG_NONE ? CONFIG_NONE : finalIndex[target];
+                d++;
+            }
+            entries[e].firstPackage=(uint32_t)p;
+            if(draft->packageCount>0){
+                memcpy(&packages[p], &builder->packages[draft->firstPackage], draft->packageCount*sizeof(ConfigPackage));
+                p+=draft->packageCount;
+            }
+            entries[e].firstResource=(uint32_t)r;
+            if(draft->resourceCount>0){
+                memcpy(&resources[r], &builder->resources[draft->firstResource], draft->resourceCount*sizeof(ConfigResource));
+                r+=draft->resourceCount;
+            }
+            tasks[i].entry[s]=(uint32_t)e++;
+        }
+        const char *categoryName=builder->strings.data+builder->categories[source->category];
+        const char *taskName=builder->strings.data+source->name;
+        taskHashes(categoryName, strlen(categoryName), taskName, strlen(taskName), &hashes[2*i], &hashes[2*i+1]);
+    }
+    if(layoutPerfectHash(image, hashes, order)!=0){
+        image->displaceCount=0;
+        memset(hash, 0xFF, hashSize*sizeof(uint32_t));
+        for(size_t i=0; i<taskCount; i++){
+            size_t slot=hashes[2*i]&(hashSize-1);
+            while(hash[slot]!=CONFIG_NONE) slot=(slot+1)&(hashSize-1);
+            hash[slot]=(uint32_t)i;
+        }
+    }
+    memcpy((char*)image+stringsOff, builder->strings.data, builder->strings.size);
+    free(order);
+    free(finalIndex);
+    free(hashes);
+    LOG("Config frozen: %zu categories, %zu tasks, %zu entries, %zu bytes.", categoryCount, taskCount, entryCount, total);
+    return image;
+}
+
+/**
+ * @brief Releases an image returned by `configBuilderFinish()` or `configFreezeTape()`.
+ */
+void configFree(const ConfigImage *image){
+    free((void*)image);
+}
+
+/**
+ * @brief Checks that `size` bytes at `image` form a well-formed image.
+ *
+ * @details Every section must lie inside the image and every index or string
+ *          offset stored in it must be in range, so a truncated or corrupted
+ *          cache file is rejected instead of being dereferenced.
+ *
+ * @return int `1` if the image is usable, `0` otherwise.
+ */
+static int configImageValid(const ConfigImage *image, size_t size){
+    if(size<sizeof(ConfigImage) || image->magic!=CONFIG_IMAGE_MAGIC || image->version!=CONFIG_IMAGE_VERSION || image->size!=size) return 0;
+    if(image->hashSize==0 || (image->hashSize&(image->hashSize-1))!=0 || image->hashSize<=image->taskCount) return 0;
+    const struct { uint32_t off; uint64_t bytes; } sections[]={
+        {image->categoriesOff, (uint64_t)image->categoryCount*sizeof(ConfigCategory)},
+        {image->tasksOff, (uint64_t)image->taskCount*sizeof(ConfigTask)},
+        {image->entriesOff, (uint64_t)image->entryCount*sizeof(ConfigEntry)},
+        {image->depsOff, (uint64_t)image->depCount*sizeof(ConfigDep)},
+        {image->packagesOff, (uint64_t)image->packageCount*sizeof(ConfigPackage)},
+        {image->resourcesOff, (uint64_t)image->resourceCount*sizeof(ConfigResource)},
+        {image->hashOff, (uint64_t)image->hashSize*sizeof(uint32_t)},
+        {image->displaceOff, (uint64_t)image->displaceCount*sizeof(uint32_t)},
+        {image->stringsOff, image->stringsSize},
+    };
+    for(size_t i=0; i<sizeof(sections)/sizeof(sections[0]); i++){
+        if(sections[i].off<sizeof(ConfigImage) || sections[i].off%sizeof(uint32_t)!=0 || sections[i].off+sections[i].bytes>size) return 0;
+    }
+    if(image->stringsSize==0 || configString(image, image->stringsSize-1)[0]!='\0') return 0;
+    #define STRING_OK(off) ((off)==CONFIG_NONE || (off)<image->stringsSize)
+    const ConfigCategory *categories=configCategories(image);
+    for(uint32_t c=0; c<image->categoryCount; c++){
+        if(!STRING_OK(categories[c].name) || categories[c].name==CONFIG_NONE) return 0;
+        if((uint64_t)categories[c].firstTask+categories[c].taskCount>image->taskCount) return 0;
+    }
+    const ConfigTask *tasks=configTasks(image);
+    for(uint32_t t=0; t<image->taskCount; t++){
+        if(tasks[t].category>=image->categoryCount || tasks[t].name>=image->stringsSize) return 0;
+        for(int s=0; s<CONFIG_SHELL_COUNT; s++){
+            if(tasks[t].entry[s]!=CONFIG_NONE && tasks[t].entry[s]>=image->entryCount) return 0;
+        }
+    }
+    const ConfigEntry *entries=configEntries(image);
+    for(uint32_t e=0; e<image->entryCount; e++){
+        const ConfigEntry *entry=&entries[e];
+        if(!STRING_OK(entry->use) || !STRING_OK(entry->cmd) || !STRING_OK(entry->scoop) || !STRING_OK(entry->choco)
+           || !STRING_OK(entry->atPath) || !STRING_OK(entry->atDrive) || !STRING_OK(entry->addToPath) || !STRING_OK(entry->requirements) || !STRING_OK(entry->cpus)) return 0;
+        if((uint64_t)entry->firstDep+entry->depCount>image->depCount) return 0;
+        if((uint64_t)entry->firstPackage+entry->packageCount>image->packageCount) return 0;
+        if((uint64_t)entry->firstResource+entry->resourceCount>image->resourceCount) return 0;
+    }
+    const ConfigDep *deps=configDeps(image);
+    for(uint32_t d=0; d<image->depCount; d++){
+        if(deps[d].name>=image->stringsSize || (deps[d].task!=CONFIG_NONE && deps[d].task>=image->taskCount)) return 0;
+    }
+    const ConfigPackage *packages=configPackages(image);
+    for(uint32_t p=0; p<image->packageCount; p++){
+        if(packages[p].manager>=CONFIG_PM_COUNT || packages[p].name>=image->stringsSize) return 0;
+    }
+    const ConfigResource *resources=configResources(image);
+    for(uint32_t r=0; r<image->resourceCount; r++){
+        if(resources[r].name>=image->stringsSize || resources[r].capacity==0) return 0;
+    }
+    const uint32_t *hash=(const uint32_t*)((const char*)image+image->hashOff);
+    for(uint32_t h=0; h<image->hashSize; h++){
+        if(hash[h]!=CONFIG_NONE && hash[h]>=image->taskCount) return 0;
+    }
+    #undef STRING_OK
+    return 1;
+}
+
+/**
+ * @brief Writes `image` to a cache file, tagged with `key`.
+ *
+ * @details The image is position independent, so it is written byte for
+ *          byte and can be mapped at any address by `configImageMap()`. The
+ *          file is first written under a temporary name and then renamed over
+ *          `path`, so a concurrent reader sees either the old cache or the new
+ *          one, never a partial file, and processes that still map the old
+ *          one are unaffected.
+ *
+ * @ingroup config
+ *
+ * @param image Image to store.
+ * @param path Cache file to create or replace.
+ * @param key Fingerprint of the sources, checked by `configImageMap()`.
+ *
+ * @return int `0` on success, `-1` if the file could not be written.
+ */
+int configImageSave(const ConfigImage *image, const char *path, uint64_t key){
+    char tempPath[1024];
+    #ifdef _WIN32
+        snprintf(tempPath, sizeof(tempPath), "%s.%lu.tmp", path, (unsigned long)GetCurrentProcessId());
+    #else
+        snprintf(tempPath, sizeof(tempPath), "%s.%ld.tmp", path, (long)getpid());
+    #endif
+    FILE *f=fopen(tempPath, "wb");
+    if(!f){
+        LOG_ERROR("Could not create config cache %s", tempPath);
+        return -1;
+    }
+    ConfigCacheHeader header={CONFIG_CACHE_MAGIC, CONFIG_IMAGE_VERSION, key};
+    int ok=fwrite(&header, sizeof(header), 1, f)==1 && fwrite(image, (size_t)image->size, 1, f)==1;
+    if(fclose(f)!=0) ok=0;
+    #ifdef _WIN32
+        if(ok && !MoveFileExA(tempPath, path, MOVEFILE_REPLACE_EXISTING)) ok=0;
+    #else
+        if(ok && rename(tempPath, path)!=0) ok=0;
+    #endif
+    if(!ok){
+        remove(tempPath);
+        LOG_ERROR("Could not write config cache %s", path);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Maps a cache file written by `configImageSave()` read-only and
+ *        returns the image inside it, if it was built from the same sources.
+ *
+ * @details The file is mapped shared (`MAP_SHARED` / a read-only file
+ *          mapping), so every devcli process on the host that maps the same
+ *          cache uses the same physical pages from the page cache: there is
+ *          nothing to parse and almost no private memory per process.
+ *
+ *          Caches are never modified in place. `configImageSave()` publishes a
+ *          new version by renaming a complete file over the old one, so a
+ *          process that mapped the old version keeps a consistent image until
+ *          it unmaps it. The header carries the layout version and the
+ *          caller's source fingerprint; a mismatch, or an image that fails
+ *          validation, is treated as a miss.
+ *
+ * @ingroup config
+ *
+ * @param path Cache file.
+ * @param key Fingerprint the cache must carry.
+ *
+ * @return const ConfigImage* The mapped image (release with
+ *         `configImageUnmap()`), or `NULL` on a miss.
+ */
+const ConfigImage *configImageMap(const char *path, uint64_t key){
+    size_t size=0;
+    const char *base=NULL;
+    #ifdef _WIN32
+        HANDLE file=CreateFileA(path, GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if(file==INVALID_HANDLE_VALUE) return NULL;
+        LARGE_INTEGER fileSize;
+        if(GetFileSizeEx(file, &fileSize) && fileSize.QuadPart>=(LONGLONG)(sizeof(ConfigCacheHeader)+sizeof(ConfigImage)) && fileSize.QuadPart<CONFIG_NONE){
+            HANDLE mapping=CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if(mapping){
+                base=MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                size=(size_t)fileSize.QuadPart;
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+    #else
+        int fd=open(path, O_RDONLY);
+        if(fd<0) return NULL;
+        struct stat info;
+        if(fstat(fd, &info)==0 && (size_t)info.st_size>=sizeof(ConfigCacheHeader)+sizeof(ConfigImage) && (uint64_t)info.st_size<CONFIG_NONE){
+            void *mapped=mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if(mapped!=MAP_FAILED){
+                base=mapped;
+                size=(size_t)info.st_size;
+            }
+        }
+        close(fd);
+    #endif
+    if(!base) return NULL;
+    const ConfigCacheHeader *header=(const ConfigCacheHeader*)base;
+    const ConfigImage *image=(const ConfigImage*)(base+sizeof(ConfigCacheHeader));
+    if(header->magic!=CONFIG_CACHE_MAGIC || header->version!=CONFIG_IMAGE_VERSION || header->key!=key
+       || !configImageValid(image, size-sizeof(ConfigCacheHeader))){
+        #ifdef _WIN32
+            UnmapViewOfFile(base);
+        #else
+            munmap((void*)base, size);
+        #endif
+        return NULL;
+    }
+    return image;
+}
+
+/**
+ * @brief Releases an image returned by `configImageMap()`.
+ */
+void configImageUnmap(const ConfigImage *image){
+    if(!image) return;
+    const char *base=(const char*)image-sizeof(ConfigCacheHeader);
+    #ifdef _WIN32
+        UnmapViewOfFile(base);
+    #else
+        munmap((void*)base, sizeof(ConfigCacheHeader)+(size_t)image->size);
+    #endif
+}
+
+/**
+ * @brief Writes `image` as a C source file defining `configEmbeddedImage`.
+ *
+ * @details The image is position independent and already holds resolved
+ *          per-shell entries and the perfect hash, so the generated file is
+ *          just its bytes as a constant array. Linked into devcli with
+ *          `-DDEVCLI_EMBEDDED`, it lives in the read-only data of the binary
+ *          and startup skips path resolution, file reading and parsing. The
+ *          words are written in the byte order of the generating machine,
+ *          so generate on an architecture with the target's endianness.
+ *
+ * @ingroup config
+ *
+ * @param image Image to embed.
+ * @param path Output `.c` file.
+ *
+ * @return int `0` on success, `-1` if the file could not be written.
+ *
+ * Example usage:
+ * @code
+ * devcli embed tasks_embedded.c
+ * gcc -DDEVCLI_EMBEDDED main.c config.c tape.c bench.c plan.c pkgdb.c cJSON.c tasks_embedded.c -pthread -o devcli
+ * @endcode
+ */
+int configImageEmbed(const ConfigImage *image, const char *path){
+    FILE *f=fopen(path, "w");
+    if(!f){
+        LOG_ERROR("Could not create %s", path);
+        return -1;
+    }
+    size_t words=(size_t)(image->size+7)/8;
+    const char *name=path;
+    for(const char *p=path; *p; p++){
+        if(*p=='/' || *p=='\\') name=p+1;
+    }
+    fprintf(f, "/**\n * @file %s\n * @brief Task catalog embedded by `devcli embed`. Generated; do not edit.\n */\n\n", name);
+    fprintf(f, "#include <stdint.h>\n\n");
+    fprintf(f, "/* %u categories, %u tasks, %u entries, %llu bytes. */\n", image->categoryCount, image->taskCount, image->entryCount, (unsigned long long)image->size);
+    fprintf(f, "const uint64_t configEmbeddedImage[%zu]={\n", words);
+    for(size_t i=0; i<words; i++){
+        uint64_t word=0;
+        size_t bytes=(size_t)image->size-i*8<8 ? (size_t)image->size-i*8 : 8;
+        memcpy(&word, (const char*)image+i*8, bytes);
+        fprintf(f, "%s0x%016llxull%s", i%4==0 ? "    " : " ", (unsigned long long)word, i+1<words ? "," : "");
+        if(i%4==3 || i+1==words) fputc('\n', f);
+    }
+    fprintf(f, "};\n");
+    if(fclose(f)!=0){
+        LOG_ERROR("Could not write %s", path);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Checks whether task `task` is named `key` (`category.task`).
+ */
+static int taskNameIs(const ConfigImage *image, uint32_t task, const char *key, size_t len){
+    const ConfigTask *info=&configTasks(image)[task];
+    const char *categoryName=configString(image, configCategories(image)[info->category].name);
+    const char *taskName=configString(image, info->name);
+    size_t categoryLen=strlen(categoryName);
+    return categoryLen<len && memcmp(key, categoryName, categoryLen)==0 && key[categoryLen]=='.'
+           && strlen(taskName)==len-categoryLen-1 && memcmp(key+categoryLen+1, taskName, len-categoryLen-1)==0;
+}
+
+/**
+ * @brief Looks up a task by its `category.task` name.
+ *
+ * @details Hashes the user-facing name directly, so the caller does not need
+ *          to split it first. Matching is case-sensitive. With the perfect
+ *          hash laid out by `configBuilderFinish()` this is one table read and
+ *          one name comparison; images whose perfect hash could not be built
+ *          fall back to linear probing, bounded by the table size.
+ *
+ * @param image Frozen catalog.
+ * @param key Task name such as `install.git` (need not be null-terminated).
+ * @param len Length of `key` in bytes.
+ *
+ * @return uint32_t Task index, or `CONFIG_NONE` if there is no such task.
+ */
+uint32_t configFindTask(const ConfigImage *image, const char *key, size_t len){
+    const uint32_t *hash=(const uint32_t*)((const char*)image+image->hashOff);
+    uint32_t mask=image->hashSize-1;
+    uint32_t first=hashBytes(HASH_SEED, key, len);
+    uint32_t step=hashBytes(HASH_SEED_STEP, key, len)|1u;
+    if(image->displaceCount){
+        const uint32_t *displace=(const uint32_t*)((const char*)image+image->displaceOff);
+        uint32_t d=displace[(step>>8)%image->displaceCount];
+        uint32_t task=hash[(first+d*step)&mask];
+        return task!=CONFIG_NONE && taskNameIs(image, task, key, len) ? task : CONFIG_NONE;
+    }
+    uint32_t slot=first&mask;
+    for(uint32_t probes=0; probes<image->hashSize && hash[slot]!=CONFIG_NONE; probes++, slot=(slot+1)&mask){
+        if(taskNameIs(image, hash[slot], key, len)) return hash[slot];
+    }
+    return CONFIG_NONE;
+}
+
+/**
+ * @brief Returns the entry of `task` for `shell`, or `NULL` if it has none.
+ */
+const ConfigEntry *configTaskEntry(const ConfigImage *image, uint32_t task, ConfigShell shell){
+    if(task>=image->taskCount || shell>=CONFIG_SHELL_COUNT) return NULL;
+    uint32_t entry=configTasks(image)[task].entry[shell];
+    return entry==CONFIG_NONE ? NULL : &configEntries(image)[entry];
+}
+
+/**
+ * @brief Overlays the fields present in `over` onto `draft`.
+ */
+static void mergeDraft(ConfigEntryDraft *draft, const ConfigEntryDraft *over){
+    if(over->use) draft->use=over->use;
+    if(over->cmd) draft->cmd=over->cmd;
+    if(over->scoop) draft->scoop=over->scoop;
+    if(over->choco) draft->choco=over->choco;
+    if(over->atPath) draft->atPath=over->atPath;
+    if(over->atDrive) draft->atDrive=over->atDrive;
+    if(over->addToPath) draft->addToPath=over->addToPath;
+    if(over->requirements) draft->requirements=over->requirements;
+    if(over->memory) draft->memory=over->memory;
+    if(over->cpus) draft->cpus=over->cpus;
+    if(over->hasDependsOn){
+        draft->dependsOn=over->dependsOn;
+        draft->depCount=over->depCount;
+        draft->hasDependsOn=1;
+    }
+    if(over->hasPackages){
+        draft->packages=over->packages;
+        draft->packageCount=over->packageCount;
+        draft->hasPackages=1;
+    }
+    if(over->hasResources){
+        draft->resources=over->resources;
+        draft->resourceCount=over->resourceCount;
+        draft->hasResources=1;
+    }
+}
+
+/**
+ * @brief Growable arrays backing the `dependsOn`, `packages` and `resources`
+ *        lists of a draft.
+ */
+typedef struct {
+    const char **deps;
+    size_t depCap;
+    ConfigPackageDraft *packages;
+    size_t packageCap;
+    ConfigResourceDraft *resources;
+    size_t resourceCap;
+} DraftScratch;
+
+/**
+ * @brief Appends one package to the draft's package list.
+ *
+ * @return int `0` on success, `-1` on allocation failure.
+ */
+static int addPackageDraft(ConfigEntryDraft *draft, DraftScratch *scratch, ConfigPackageManager manager, const char *name){
+    if(reserve((void**)&scratch->packages, &scratch->packageCap, draft->packageCount+1, sizeof(ConfigPackageDraft))!=0) return -1;
+    scratch->packages[draft->packageCount].manager=manager;
+    scratch->packages[draft->packageCount].name=name;
+    draft->packageCount++;
+    draft->packages=scratch->packages;
+    return 0;
+}
+
+/**
+ * @brief Appends one resource to the draft's resource list.
+ *
+ * @details Capacities are whole numbers of at least 1; anything else is
+ *          reported and the resource is ignored.
+ *
+ * @return int `0` on success, `-1` on allocation failure.
+ */
+static int addResourceDraft(ConfigEntryDraft *draft, DraftScratch *scratch, const char *name, double capacity){
+    if(!(capacity>=1 && capacity<=CONFIG_NONE-1) || capacity!=(double)(uint32_t)capacity){
+        LOG_ERROR("Resource %s needs a whole-number capacity of at least 1.", name);
+        return 0;
+    }
+    if(reserve((void**)&scratch->resources, &scratch->resourceCap, draft->resourceCount+1, sizeof(ConfigResourceDraft))!=0) return -1;
+    scratch->resources[draft->resourceCount].name=name;
+    scratch->resources[draft->resourceCount].capacity=(uint32_t)capacity;
+    draft->resourceCount++;
+    draft->resources=scratch->resources;
+    return 0;
+}
+
+/**
+ * @brief Converts a `memory` value to MiB: a number of MiB, or a size string
+ *        such as `"512M"` or `"1.5G"` (see `memorySizeMiB()`).
+ *
+ * @return uint32_t Size in MiB rounded up, or `0` after reporting a value
+ *         that is not a size.
+ */
+static uint32_t memoryMiB(const char *text, double number){
+    uint32_t mib=0;
+    if(text) mib=memorySizeMiB(text);
+    else if(number>0 && number<(double)CONFIG_NONE) mib=(uint32_t)number+((double)(uint32_t)number<number);
+    if(mib==0) LOG_ERROR("memory needs a size such as 512 (MiB), \"512M\" or \"2G\".");
+    return mib;
+}
+
+/**
+ * @brief Returns the string value of the member keyed by the interned offset
+ *        `key`, or `NULL` if it is absent or not a string.
+ */
+static const char *tapeMemberString(const JsonTape *doc, size_t object, size_t key){
+    size_t value=tapeObjectGetInterned(doc, object, key);
+    if(value==TAPE_NONE || tapeType(doc, value)!='"') return NULL;
+    return tapeString(doc, value, NULL);
+}
+
+/**
+ * @brief Keys of a shell or `default` object, resolved to interned tape offsets.
+ */
+enum { KEY_USE, KEY_CMD, KEY_SCOOP, KEY_CHOCO, KEY_AT_PATH, KEY_AT_DRIVE, KEY_ADD_TO_PATH, KEY_REQUIREMENTS, KEY_DEPENDS_ON, KEY_PACKAGES, KEY_RESOURCES, KEY_MEMORY, KEY_CPUS, KEY_DEFAULT, KEY_EXTENDS, KEY_COUNT };
+
+/**
+ * @brief Reads one shell (or `default`) object of a tape into `draft`.
+ *
+ * @return int `0` on success, `-1` on allocation failure.
+ */
+static int readTapeDraft(const JsonTape *doc, size_t object, const size_t *keys, ConfigEntryDraft *draft, DraftScratch *scratch){
+    memset(draft, 0, sizeof(*draft));
+    size_t cmd=tapeObjectGetInterned(doc, object, keys[KEY_CMD]);
+    draft->use=tapeMemberString(doc, object, keys[KEY_USE]);
+    draft->cmd=tapeMemberString(doc, object, keys[KEY_CMD]);
+    draft->scoop=tapeMemberString(doc, cmd, keys[KEY_SCOOP]);
+    draft->choco=tapeMemberString(doc, cmd, keys[KEY_CHOCO]);
+    draft->atPath=tapeMemberString(doc, object, keys[KEY_AT_PATH]);
+    draft->atDrive=tapeMemberString(doc, object, keys[KEY_AT_DRIVE]);
+    draft->addToPath=tapeMemberString(doc, object, keys[KEY_ADD_TO_PATH]);
+    draft->requirements=tapeMemberString(doc, object, keys[KEY_REQUIREMENTS]);
+    draft->cpus=tapeMemberString(doc, object, keys[KEY_CPUS]);
+    size_t memory=tapeObjectGetInterned(doc, object, keys[KEY_MEMORY]);
+    if(memory!=TAPE_NONE && tapeType(doc, memory)=='d') draft->memory=memoryMiB(NULL, tapeNumber(doc, memory));
+    else if(memory!=TAPE_NONE && tapeType(doc, memory)=='"') draft->memory=memoryMiB(tapeString(doc, memory, NULL), 0);
+    size_t dependency=tapeObjectGetInterned(doc, object, keys[KEY_DEPENDS_ON]);
+    if(dependency!=TAPE_NONE && tapeType(doc, dependency)=='['){
+        draft->hasDependsOn=1;
+        if(reserve((void**)&scratch->deps, &scratch->depCap, tapeCount(doc, dependency)+1, sizeof(char*))!=0) return -1;
+        TAPE_FOR_EACH_ELEMENT(doc, dependency, item){
+            if(tapeType(doc, item)=='"') scratch->deps[draft->depCount++]=tapeString(doc, item, NULL);
+        }
+    }
+    draft->dependsOn=scratch->deps;
+    size_t packages=tapeObjectGetInterned(doc, object, keys[KEY_PACKAGES]);
+    if(packages!=TAPE_NONE && tapeType(doc, packages)=='{'){
+        draft->hasPackages=1;
+        TAPE_FOR_EACH_MEMBER(doc, packages, list){
+            ConfigPackageManager manager=configPackageManagerFromName(tapeString(doc, list, NULL));
+            if(manager==CONFIG_PM_COUNT) continue;
+            if(tapeType(doc, list+1)=='"' && addPackageDraft(draft, scratch, manager, tapeString(doc, list+1, NULL))!=0) return -1;
+            if(tapeType(doc, list+1)!='[') continue;
+            TAPE_FOR_EACH_ELEMENT(doc, list+1, item){
+                if(tapeType(doc, item)=='"' && addPackageDraft(draft, scratch, manager, tapeString(doc, item, NULL))!=0) return -1;
+            }
+        }
+    }
+    size_t resources=tapeObjectGetInterned(doc, object, keys[KEY_RESOURCES]);
+    if(resources!=TAPE_NONE && tapeType(doc, resources)=='{'){
+        draft->hasResources=1;
+        TAPE_FOR_EACH_MEMBER(doc, resources, resource){
+            if(tapeType(doc, resource+1)=='d' && addResourceDraft(draft, scratch, tapeString(doc, resource, NULL), tapeNumber(doc, resource+1))!=0) return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Adds every `category.task.shell` entry of a parsed `tasks.json` layer.
+ *
+ * @details Walks `category.task.shell`, including `default`, sparse shell
+ *          overrides and `extends`, over the tape: members are visited by
+ *          index and non-object subtrees are skipped in O(1). Keys are
+ *          matched case-sensitively. Each key is resolved to its interned
+ *          arena offset once, so members are matched by comparing offsets.
+ *          The tape can be freed as soon as this returns.
+ *
+ *          Calling this for several documents layers them: an entry replaces
+ *          the one for the same shell of the same task added earlier, while
+ *          the task's other shells, and every task the layer does not
+ *          mention, are kept as they are. Strings are interned by the
+ *          builder, so unchanged entries are never copied again.
+ *
+ * @ingroup config
+ *
+ * @param builder Builder to add to.
+ * @param doc Parsed configuration document.
+ * @return int `0` on success, `-1` if the root is not an object or memory ran out.
+ */
+int configBuilderAddTape(ConfigBuilder *builder, const JsonTape *doc){
+    if(doc->length==0 || tapeType(doc, 0)!='{'){
+        LOG_ERROR("Config root is not a JSON object.");
+        return -1;
+    }
+    size_t shellKeys[CONFIG_SHELL_COUNT];
+    for(int s=0; s<CONFIG_SHELL_COUNT; s++) shellKeys[s]=tapeFindString(doc, shellNames[s], strlen(shellNames[s]));
+    static const char *const keyNames[KEY_COUNT]={"use", "cmd", "scoop", "choco", "atPath", "atDrive", "addToPath", "requirements", "dependsOn", "packages", "resources", "memory", "cpus", "default", "extends"};
+    size_t keys[KEY_COUNT];
+    for(int k=0; k<KEY_COUNT; k++) keys[k]=tapeFindString(doc, keyNames[k], strlen(keyNames[k]));
+    DraftScratch defaultScratch={0}, scratch={0};
+    int failed=0;
+    TAPE_FOR_EACH_MEMBER(doc, 0, category){
+        if(failed) break;
+        if(tapeType(doc, category+1)!='{') continue;
+        const char *categoryName=tapeString(doc, category, NULL);
+        TAPE_FOR_EACH_MEMBER(doc, category+1, task){
+            if(failed) break;
+            if(tapeType(doc, task+1)!='{') continue;
+            const char *taskName=tapeString(doc, task, NULL);
+            const char *extends=tapeMemberString(doc, task+1, keys[KEY_EXTENDS]);
+            if(extends && configBuilderSetExtends(builder, categoryName, taskName, extends)!=0) failed=1;
+            size_t defaultObject=tapeObjectGetInterned(doc, task+1, keys[KEY_DEFAULT]);
+            int hasDefault=defaultObject!=TAPE_NONE && tapeType(doc, defaultObject)=='{';
+            ConfigEntryDraft defaults={0};
+            if(hasDefault && readTapeDraft(doc, defaultObject, keys, &defaults, &defaultScratch)!=0) failed=1;
+            for(int s=0; s<CONFIG_SHELL_COUNT && !failed; s++){
+                size_t shellObject=tapeObjectGetInterned(doc, task+1, shellKeys[s]);
+                int hasShell=shellObject!=TAPE_NONE && tapeType(doc, shellObject)=='{';
+                if(!hasShell && !hasDefault) continue;
+                ConfigEntryDraft draft=defaults, over;
+                if(hasShell){
+                    if(readTapeDraft(doc, shellObject, keys, &over, &scratch)!=0){
+                        failed=1;
+                        break;
+                    }
+                    mergeDraft(&draft, &over);
+                }
+                if(configBuilderAddEntry(builder, categoryName, taskName, (ConfigShell)s, &draft)!=0) failed=1;
+            }
+        }
+    }
+    free(defaultScratch.deps);
+    free(defaultScratch.packages);
+    free(defaultScratch.resources);
+    free(scratch.deps);
+    free(scratch.packages);
+    free(scratch.resources);
+    return failed ? -1 : 0;
+}
+
+/**
+ * @brief Converts a `tasks.json` document parsed with `tapeParse()` into a frozen image.
+ *
+ * @details Shorthand for a builder with a single `configBuilderAddTape()` layer.
+ *
+ * @ingroup config
+ *
+ * @param doc Parsed configuration document.
+ * @return ConfigImage* Frozen catalog, or `NULL` on failure.
+ */
+ConfigImage *configFreezeTape(const JsonTape *doc){
+    ConfigBuilder *builder=configBuilderCreate();
+    if(!builder) return NULL;
+    ConfigImage *image=configBuilderAddTape(builder, doc)==0 ? configBuilderFinish(builder) : NULL;
+    configBuilderFree(builder);
+    return image;
+}
+
+/** @} */ // end of config group
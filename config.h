@@ -0,0 +1,335 @@
+/**
+ * @file config.h
+ * @brief Frozen, read-only view of the task catalog.
+ *
+ * @details `tasks.json` is parsed once and then frozen into a `ConfigImage`: a
+ *          single contiguous allocation holding interned strings, flat arrays
+ *          of categories, tasks and shell entries, and `dependsOn` edges stored
+ *          as task indexes. Nothing in the image is ever written after
+ *          `configBuilderFinish()` returns, so any number of threads may read it
+ *          without locking, and the execution core never touches the parser.
+ *
+ *          Every reference inside the image is an offset or an index rather
+ *          than a pointer, which keeps the image position independent: it is
+ *          saved to a cache file verbatim and mapped, shared and read-only,
+ *          by every process that loads the same configuration.
+ */
+
+#ifndef DEVCLI_CONFIG_H
+#define DEVCLI_CONFIG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct JsonTape;
+
+/** @defgroup config Frozen Configuration
+ *  @brief Immutable representation of the task catalog shared by the execution core.
+ *  @{
+ */
+
+/**
+ * @def CONFIG_NONE
+ * @brief Sentinel used for an absent string offset or an unresolved index.
+ */
+#define CONFIG_NONE 0xFFFFFFFFu
+
+/**
+ * @def CONFIG_IMAGE_MAGIC
+ * @brief First four bytes of every frozen image ("DVCI" in little endian).
+ */
+#define CONFIG_IMAGE_MAGIC 0x49435644u
+
+/**
+ * @def CONFIG_IMAGE_VERSION
+ * @brief Layout version of the frozen image. Bump whenever a struct below changes.
+ */
+#define CONFIG_IMAGE_VERSION 7u
+
+/**
+ * @brief Shells for which `tasks.json` carries per-shell entries.
+ */
+typedef enum {
+    CONFIG_SHELL_POWERSHELL = 0,
+    CONFIG_SHELL_CMD,
+    CONFIG_SHELL_LINUX,
+    CONFIG_SHELL_COUNT
+} ConfigShell;
+
+/**
+ * @brief Package managers an install entry can list packages for.
+ */
+typedef enum {
+    CONFIG_PM_APT = 0,
+    CONFIG_PM_SCOOP,
+    CONFIG_PM_CHOCO,
+    CONFIG_PM_COUNT
+} ConfigPackageManager;
+
+/**
+ * @brief One shell-specific command definition (`category.task.shell`).
+ *
+ * @details String members are offsets into the image string table, or
+ *          `CONFIG_NONE` when the key was absent. Install commands on Windows
+ *          carry `scoop`/`choco` alternatives instead of a plain `cmd`, and
+ *          may list the packages they install per manager so that several
+ *          install tasks can share one package-manager transaction.
+ */
+typedef struct {
+    uint32_t use;        /**< Description printed by `help`. */
+    uint32_t cmd;        /**< Command line to execute. */
+    uint32_t scoop;      /**< Non-admin install command (Windows). */
+    uint32_t choco;      /**< Admin install command (Windows). */
+    uint32_t atPath;     /**< Probe: tool is reachable through PATH. */
+    uint32_t atDrive;    /**< Probe: tool exists somewhere on disk. */
+    uint32_t addToPath;  /**< Command template that adds the tool to PATH. */
+    uint32_t requirements; /**< pip requirements file; the task is skipped while all are installed. */
+    uint32_t firstDep;   /**< Index of the first edge in the dependency table. */
+    uint32_t depCount;   /**< Number of `dependsOn` edges. */
+    uint32_t firstPackage; /**< Index of the first package in the package table. */
+    uint32_t packageCount; /**< Number of `packages`, over all managers. */
+    uint32_t firstResource; /**< Index of the first resource in the resource table. */
+    uint32_t resourceCount; /**< Number of `resources` the task holds while it runs. */
+    uint32_t memory;     /**< Declared peak memory in MiB, or `CONFIG_NONE` if not declared. */
+    uint32_t cpus;       /**< CPU list the command is pinned to, such as `0-3,6`. */
+} ConfigEntry;
+
+/**
+ * @brief A `dependsOn` edge.
+ *
+ * @details `task` is the index of the target task, or `CONFIG_NONE` when the
+ *          name did not resolve; `name` keeps the original spelling for errors.
+ */
+typedef struct {
+    uint32_t task;
+    uint32_t name;
+} ConfigDep;
+
+/**
+ * @brief A package named under `packages` (e.g. `"apt": ["python3"]`).
+ */
+typedef struct {
+    uint32_t manager;   /**< A `ConfigPackageManager`. */
+    uint32_t name;      /**< Package name string offset. */
+} ConfigPackage;
+
+/**
+ * @brief A named resource a task holds while it runs (e.g. `"dpkg": 1`).
+ *
+ * @details At most `capacity` tasks hold the same resource at once, so a
+ *          capacity of 1 makes the tasks naming it mutually exclusive.
+ */
+typedef struct {
+    uint32_t name;      /**< Resource name string offset. */
+    uint32_t capacity;  /**< Tasks that may hold it at once; at least 1. */
+} ConfigResource;
+
+/**
+ * @brief A `category.task` pair with one entry slot per shell.
+ */
+typedef struct {
+    uint32_t category;                  /**< Index of the owning category. */
+    uint32_t name;                      /**< Task name string offset. */
+    uint32_t entry[CONFIG_SHELL_COUNT]; /**< Entry index per shell, or `CONFIG_NONE`. */
+} ConfigTask;
+
+/**
+ * @brief A top-level category; its tasks are stored contiguously.
+ */
+typedef struct {
+    uint32_t name;
+    uint32_t firstTask;
+    uint32_t taskCount;
+} ConfigCategory;
+
+/**
+ * @brief Header of a frozen image. All sections follow it in the same block.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t size;          /**< Total size of the image in bytes. */
+    uint32_t categoryCount;
+    uint32_t taskCount;
+    uint32_t entryCount;
+    uint32_t depCount;
+    uint32_t packageCount;
+    uint32_t resourceCount;
+    uint32_t hashSize;      /**< Slots in the `category.task` hash table (power of two). */
+    uint32_t displaceCount; /**< Buckets of the perfect-hash displacement table, or `0` for linear probing. */
+    uint32_t stringsSize;
+    uint32_t categoriesOff;
+    uint32_t tasksOff;
+    uint32_t entriesOff;
+    uint32_t depsOff;
+    uint32_t packagesOff;
+    uint32_t resourcesOff;
+    uint32_t hashOff;
+    uint32_t displaceOff;
+    uint32_t stringsOff;
+} ConfigImage;
+
+/**
+ * @brief A package of an entry while the catalog is being built.
+ */
+typedef struct {
+    ConfigPackageManager manager;
+    const char *name;
+} ConfigPackageDraft;
+
+/**
+ * @brief A resource of an entry while the catalog is being built.
+ */
+typedef struct {
+    const char *name;
+    uint32_t capacity;
+} ConfigResourceDraft;
+
+/**
+ * @brief Fields of one shell entry while the catalog is being built.
+ *
+ * @details All strings are copied (interned) by the builder, so the caller may
+ *          release its source document as soon as the call returns. `NULL`
+ *          fields, and a `dependsOn`, `packages` or `resources` that was not
+ *          given, count as absent and are inherited when the task `extends` another one.
+ */
+typedef struct {
+    const char *use;
+    const char *cmd;
+    const char *scoop;
+    const char *choco;
+    const char *atPath;
+    const char *atDrive;
+    const char *addToPath;
+    const char *requirements;
+    const char **dependsOn;
+    size_t depCount;
+    int hasDependsOn;   /**< `dependsOn` was given, even if empty; implied by `depCount > 0`. */
+    const ConfigPackageDraft *packages;
+    size_t packageCount;
+    int hasPackages;    /**< `packages` was given, even if empty; implied by `packageCount > 0`. */
+    const ConfigResourceDraft *resources;
+    size_t resourceCount;
+    int hasResources;   /**< `resources` was given, even if empty; implied by `resourceCount > 0`. */
+    uint32_t memory;    /**< Declared peak memory in MiB; `0` counts as absent. */
+    const char *cpus;
+} ConfigEntryDraft;
+
+/** @brief Opaque, mutable builder used to assemble an image. */
+typedef struct ConfigBuilder ConfigBuilder;
+
+ConfigShell configShellFromName(const char *name);
+const char *configShellName(ConfigShell shell);
+ConfigPackageManager configPackageManagerFromName(const char *name);
+const char *configPackageManagerName(ConfigPackageManager manager);
+
+ConfigBuilder *configBuilderCreate(void);
+int configBuilderAddEntry(ConfigBuilder *builder, const char *category, const char *task, ConfigShell shell, const ConfigEntryDraft *draft);
+int configBuilderSetExtends(ConfigBuilder *builder, const char *category, const char *task, const char *base);
+ConfigImage *configBuilderFinish(ConfigBuilder *builder);
+void configBuilderFree(ConfigBuilder *builder);
+
+int configBuilderAddTape(ConfigBuilder *builder, const struct JsonTape *doc);
+ConfigImage *configFreezeTape(const struct JsonTape *doc);
+void configFree(const ConfigImage *image);
+int configImageSave(const ConfigImage *image, const char *path, uint64_t key);
+const ConfigImage *configImageMap(const char *path, uint64_t key);
+void configImageUnmap(const ConfigImage *image);
+int configImageEmbed(const ConfigImage *image, const char *path);
+
+#ifdef DEVCLI_EMBEDDED
+/**
+ * @brief Image generated by `devcli embed`, linked in when building with
+ *        `-DDEVCLI_EMBEDDED`. Stored as 64-bit words so it is suitably aligned.
+ */
+extern const uint64_t configEmbeddedImage[];
+#endif
+
+/**
+ * @brief Returns the string stored at `offset`, or `NULL` for `CONFIG_NONE`.
+ */
+static inline const char *configString(const ConfigImage *image, uint32_t offset){
+    if(offset==CONFIG_NONE) return NULL;
+    return (const char*)image+image->stringsOff+offset;
+}
+
+/** @brief Returns the category table of an image. */
+static inline const ConfigCategory *configCategories(const ConfigImage *image){
+    return (const ConfigCategory*)((const char*)image+image->categoriesOff);
+}
+
+/** @brief Returns the task table of an image. */
+static inline const ConfigTask *configTasks(const ConfigImage *image){
+    return (const ConfigTask*)((const char*)image+image->tasksOff);
+}
+
+/** @brief Returns the shell entry table of an image. */
+static inline const ConfigEntry *configEntries(const ConfigImage *image){
+    return (const ConfigEntry*)((const char*)image+image->entriesOff);
+}
+
+/** @brief Returns the dependency edge table of an image. */
+static inline const ConfigDep *configDeps(const ConfigImage *image){
+    return (const ConfigDep*)((const char*)image+image->depsOff);
+}
+
+/** @brief Returns the package table of an image. */
+static inline const ConfigPackage *configPackages(const ConfigImage *image){
+    return (const ConfigPackage*)((const char*)image+image->packagesOff);
+}
+
+/** @brief Returns the resource table of an image. */
+static inline const ConfigResource *configResources(const ConfigImage *image){
+    return (const ConfigResource*)((const char*)image+image->resourcesOff);
+}
+
+uint32_t configFindTask(const ConfigImage *image, const char *key, size_t len);
+const ConfigEntry *configTaskEntry(const ConfigImage *image, uint32_t task, ConfigShell shell);
+
+/**
+ * @def CONFIG_FOR_EACH_CATEGORY(image, category)
+ * @brief Iterates the categories of `image` in file order; `category` is a
+ *        `const ConfigCategory *`.
+ */
+#define CONFIG_FOR_EACH_CATEGORY(image, category) \
+    for(const ConfigCategory *category=configCategories(image); category<configCategories(image)+(image)->categoryCount; category++)
+
+/**
+ * @def CONFIG_FOR_EACH_TASK(image, category, task)
+ * @brief Iterates the task indexes of `category` (a `const ConfigCategory *`);
+ *        `task` is a `uint32_t`.
+ */
+#define CONFIG_FOR_EACH_TASK(image, category, task) \
+    for(uint32_t task=(category)->firstTask; task<(category)->firstTask+(category)->taskCount; task++)
+
+/**
+ * @def CONFIG_FOR_EACH_DEP(image, entry, dep)
+ * @brief Iterates the `dependsOn` edges of `entry` (a `const ConfigEntry *`);
+ *        `dep` is a `const ConfigDep *`.
+ *
+ * @details Edges are a contiguous slice whose length was counted when the
+ *          image was frozen, so iteration is linear and `dep[i]` is O(1).
+ *          The image never changes, so there is nothing to invalidate.
+ */
+#define CONFIG_FOR_EACH_DEP(image, entry, dep) \
+    for(const ConfigDep *dep=configDeps(image)+(entry)->firstDep; dep<configDeps(image)+(entry)->firstDep+(entry)->depCount; dep++)
+
+/**
+ * @def CONFIG_FOR_EACH_PACKAGE(image, entry, package)
+ * @brief Iterates the `packages` of `entry` (a `const ConfigEntry *`), for
+ *        every manager; `package` is a `const ConfigPackage *`.
+ */
+#define CONFIG_FOR_EACH_PACKAGE(image, entry, package) \
+    for(const ConfigPackage *package=configPackages(image)+(entry)->firstPackage; package<configPackages(image)+(entry)->firstPackage+(entry)->packageCount; package++)
+
+/**
+ * @def CONFIG_FOR_EACH_RESOURCE(image, entry, resource)
+ * @brief Iterates the `resources` of `entry` (a `const ConfigEntry *`);
+ *        `resource` is a `const ConfigResource *`.
+ */
+#define CONFIG_FOR_EACH_RESOURCE(image, entry, resource) \
+    for(const ConfigResource *resource=configResources(image)+(entry)->firstResource; resource<configResources(image)+(entry)->firstResource+(entry)->resourceCount; resource++)
+
+/** @} */ // end of config group
+
+#endif /* DEVCLI_CONFIG_H */
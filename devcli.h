@@ -0,0 +1,47 @@
+/**
+ * @file devcli.h
+ * @brief Globals and helpers of main.c that the feature modules share.
+ */
+
+#ifndef DEVCLI_DEVCLI_H
+#define DEVCLI_DEVCLI_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include "config.h"
+#include "plan.h"
+
+/**
+ * @def FINGERPRINT_SEED
+ * @brief FNV-1a offset basis every cache key starts from.
+ */
+#define FINGERPRINT_SEED 14695981039346656037ull
+
+/**
+ * @def PYTHON_TREE_DEPTH
+ * @brief Deepest directory `walkPythonTree()` descends into.
+ */
+#define PYTHON_TREE_DEPTH 32
+
+/**
+ * @brief Receives one file found by `walkPythonTree()`.
+ */
+typedef void (*PythonVisitor)(const char *path, const char *name, const struct stat *info, int depth, void *context);
+
+extern const char *shell;
+extern ConfigShell shellKind;
+
+char* readFileToBuffer(char *path);
+bool cacheFile(char *out, size_t size, const char *name);
+char* wrap_for_shell(char* command);
+uint64_t fingerprintBytes(uint64_t hash, const void *data, size_t len);
+uint64_t fingerprintText(uint64_t hash, const char *text);
+uint64_t fingerprintFile(uint64_t hash, const char *path, const struct stat *info);
+int splitCommandWords(char *copy, char **words, int max);
+void walkPythonTree(const char *dir, PythonVisitor visit, void *context);
+int checkAvailability(char *foundAtPath, char *foundAtDrive, char *addFileToPath);
+void runTask(const ConfigImage *config, PlanNode *node);
+
+#endif /* DEVCLI_DEVCLI_H */
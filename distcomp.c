@@ -0,0 +1,1238 @@
+/**
+ * @file distcomp.c
+ * @brief Compile workers and the client that balances a build's compiles across them.
+ */
+
+#ifdef _WIN32
+#define _CRT_RAND_S
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <process.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#ifdef _WIN32
+#include <direct.h>
+#define GETPID() _getpid()
+#define MKDIR(path) _mkdir(path)
+typedef SOCKET DistSocket;
+#define DIST_NO_SOCKET INVALID_SOCKET
+#define distCloseSocket closesocket
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#define GETPID() getpid()
+#define MKDIR(path) mkdir(path, 0700)
+typedef int DistSocket;
+#define DIST_NO_SOCKET (-1)
+#define distCloseSocket close
+#endif
+#include <sys/stat.h>
+#include "distcomp.h"
+#include "compcache.h"
+#include "spawn.h"
+#include "tape.h"
+#include "log.h"
+
+#ifdef MSG_NOSIGNAL
+#define DIST_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define DIST_SEND_FLAGS 0
+#endif
+
+/** @addtogroup distcomp
+ *  @{
+ */
+
+/**
+ * @def DIST_PROTOCOL
+ * @brief Version sent first on every connection; a worker closes
+ *        connections of any other version.
+ */
+#define DIST_PROTOCOL 2
+
+/**
+ * @def DIST_MAX_ARG
+ * @brief Longest compiler argument a worker accepts.
+ */
+#define DIST_MAX_ARG 4096
+
+/**
+ * @def DIST_MAX_FILE
+ * @brief Largest preprocessed source, object file or message text sent over
+ *        a connection.
+ */
+#define DIST_MAX_FILE (512u<<20)
+
+/**
+ * @def DIST_QUERY_TIMEOUT_MS
+ * @brief How long a client waits for a worker's queue depth before counting
+ *        it as down.
+ */
+#define DIST_QUERY_TIMEOUT_MS 5000
+
+/**
+ * @def DIST_TOKEN_SIZE
+ * @brief Size of the buffer holding the shared secret; longer secrets are
+ *        refused.
+ */
+#define DIST_TOKEN_SIZE 128
+
+/**
+ * @def DIST_SERVE_TIMEOUT_MS
+ * @brief How long a worker waits for the next bytes from a client before
+ *        dropping the connection.
+ */
+#define DIST_SERVE_TIMEOUT_MS 30000
+
+/**
+ * @def DIST_MAX_PENDING
+ * @brief Connections a worker holds at once before they have sent its
+ *        token; further ones are closed at once.
+ */
+#define DIST_MAX_PENDING 32
+
+/**
+ * @brief A compile worker as the client sees it.
+ */
+typedef struct {
+    char host[256];
+    char port[16];
+    int slots;      /**< Compiles the worker runs at once, from its reply. */
+    int running;    /**< Compiles of this command on it right now. */
+    int down;       /**< It stopped answering; no more jobs go to it. */
+} DistWorker;
+
+/**
+ * @brief One distributed command: its sources, the workers and the results.
+ */
+typedef struct {
+    const CompileCommand *parsed;
+    const char *cpus;
+    char token[DIST_TOKEN_SIZE];                /**< Shared secret of the workers. */
+    DistWorker workers[DIST_MAX_WORKERS];
+    int workerCount;
+    int sources[COMPILE_CACHE_MAX_ARGS];        /**< Word index of each source. */
+    char objects[COMPILE_CACHE_MAX_ARGS][1100]; /**< Object file of each source. */
+    int statuses[COMPILE_CACHE_MAX_ARGS];       /**< Compile status of each source. */
+    int link;                                   /**< Objects are temporary, for a final link. */
+    atomic_int next;                            /**< Next source to compile. */
+    atomic_int remote;                          /**< Compiles a worker did. */
+    atomic_uint temp;                           /**< Makes temporary names unique. */
+    #ifdef _WIN32
+        CRITICAL_SECTION lock;
+    #else
+        pthread_mutex_t lock;
+    #endif
+} DistBuild;
+
+/**
+ * @brief State of `devcli worker`, shared by its connections.
+ */
+typedef struct {
+    int slots;          /**< Compiles run at once. */
+    int running;        /**< Compiles running now. */
+    int depth;          /**< Jobs received and not yet answered, running or waiting. */
+    int pending;        /**< Connections that have not sent the token yet. */
+    char dir[1024];     /**< Directory for the files of the jobs. */
+    char token[DIST_TOKEN_SIZE];    /**< Secret every connection must send. */
+    atomic_uint temp;
+    #ifdef _WIN32
+        CRITICAL_SECTION lock;
+        CONDITION_VARIABLE changed;
+    #else
+        pthread_mutex_t lock;
+        pthread_cond_t changed;
+    #endif
+} DistServer;
+
+/**
+ * @brief A connection accepted by `devcli worker`.
+ */
+typedef struct {
+    DistServer *server;
+    DistSocket socket;
+} DistConnection;
+
+static void distLock(DistBuild *build){
+    #ifdef _WIN32
+        EnterCriticalSection(&build->lock);
+    #else
+        pthread_mutex_lock(&build->lock);
+    #endif
+}
+
+static void distUnlock(DistBuild *build){
+    #ifdef _WIN32
+        LeaveCriticalSection(&build->lock);
+    #else
+        pthread_mutex_unlock(&build->lock);
+    #endif
+}
+
+/**
+ * @brief Starts Winsock once per caller on Windows; nothing elsewhere.
+ *
+ * @return int `0` on success.
+ */
+static int distStartup(void){
+    #ifdef _WIN32
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data)==0 ? 0 : -1;
+    #else
+        return 0;
+    #endif
+}
+
+static void distCleanup(void){
+    #ifdef _WIN32
+        WSACleanup();
+    #endif
+}
+
+/**
+ * @brief Sends all `len` bytes of `data`.
+ *
+ * @return int `0` on success, `-1` if the connection failed.
+ */
+static int sendAll(DistSocket s, const void *data, size_t len){
+    const char *p=data;
+    while(len>0){
+        int chunk=len>65536 ? 65536 : (int)len;
+        int n=send(s, p, chunk, DIST_SEND_FLAGS);
+        if(n<=0) return -1;
+        p+=n;
+        len-=(size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Receives exactly `len` bytes into `data`.
+ *
+ * @return int `0` on success, `-1` if the connection closed, failed or timed out.
+ */
+static int recvAll(DistSocket s, void *data, size_t len){
+    char *p=data;
+    while(len>0){
+        int chunk=len>65536 ? 65536 : (int)len;
+        int n=recv(s, p, chunk, 0);
+        if(n<=0) return -1;
+        p+=n;
+        len-=(size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Sends a token: four letters naming it and its value as eight hex
+ *        digits, as distcc does, so the protocol has no byte order.
+ */
+static int sendToken(DistSocket s, const char *name, uint32_t value){
+    char token[13];
+    snprintf(token, sizeof(token), "%.4s%08x", name, value);
+    return sendAll(s, token, 12);
+}
+
+/**
+ * @brief Receives a token and checks that it is `name`.
+ *
+ * @return int `0` on success, `-1` on a connection failure or another token.
+ */
+static int recvToken(DistSocket s, const char *name, uint32_t *value){
+    char token[12];
+    if(recvAll(s, token, sizeof(token))!=0 || memcmp(token, name, 4)!=0) return -1;
+    uint32_t v=0;
+    for(int i=4; i<12; i++){
+        char c=token[i];
+        int digit=c>='0' && c<='9' ? c-'0' : c>='a' && c<='f' ? c-'a'+10 : -1;
+        if(digit<0) return -1;
+        v=v<<4|(uint32_t)digit;
+    }
+    *value=v;
+    return 0;
+}
+
+/**
+ * @brief Sends the file at `path` as token `name` with its length, followed
+ *        by its bytes; a missing file is sent as empty.
+ */
+static int sendFile(DistSocket s, const char *name, const char *path){
+    struct stat info;
+    FILE *file=path && stat(path, &info)==0 ? fopen(path, "rb") : NULL;
+    if(!file) return sendToken(s, name, 0);
+    if((uint64_t)info.st_size>DIST_MAX_FILE){
+        fclose(file);
+        return -1;
+    }
+    uint32_t left=(uint32_t)info.st_size;
+    int result=sendToken(s, name, left);
+    char buffer[65536];
+    while(result==0 && left>0){
+        size_t n=fread(buffer, 1, left<sizeof(buffer) ? left : sizeof(buffer), file);
+        if(n==0) result=-1;
+        else result=sendAll(s, buffer, n);
+        left-=(uint32_t)n;
+    }
+    fclose(file);
+    return result;
+}
+
+/**
+ * @brief Receives token `name` and its bytes into the file at `path`, or
+ *        to stderr when `path` is `NULL`.
+ *
+ * @return int `0` on success, `-1` on a connection failure, a length over
+ *         `DIST_MAX_FILE`, or a file that could not be written.
+ */
+static int recvFile(DistSocket s, const char *name, const char *path){
+    uint32_t left;
+    if(recvToken(s, name, &left)!=0 || left>DIST_MAX_FILE) return -1;
+    FILE *file=path ? fopen(path, "wb") : stderr;
+    if(!file) return -1;
+    char buffer[65536];
+    int result=0;
+    while(result==0 && left>0){
+        size_t n=left<sizeof(buffer) ? left : sizeof(buffer);
+        result=recvAll(s, buffer, n);
+        if(result==0 && fwrite(buffer, 1, n, file)!=n) result=-1;
+        left-=(uint32_t)n;
+    }
+    if(path){
+        if(fclose(file)!=0) result=-1;
+        if(result!=0) remove(path);
+    }
+    else fflush(stderr);
+    return result;
+}
+
+/**
+ * @brief Fills `out` with the path of the file holding the workers' shared
+ *        secret, `.devcli/worker-token` in the home directory, and creates
+ *        `.devcli` readable by the user only.
+ *
+ * @return int `0` on success.
+ */
+static int tokenFile(char *out, size_t size){
+    #ifdef _WIN32
+        const char *home=getenv("USERPROFILE");
+        const char *sep="\\";
+    #else
+        const char *home=getenv("HOME");
+        const char *sep="/";
+    #endif
+    if(!home) return -1;
+    int n=snprintf(out, size, "%s%s.devcli", home, sep);
+    if(n<0 || (size_t)n>=size) return -1;
+    MKDIR(out);
+    n=snprintf(out, size, "%s%s.devcli%sworker-token", home, sep, sep);
+    return n>0 && (size_t)n<size ? 0 : -1;
+}
+
+/**
+ * @brief Writes a new random secret to `path`, readable by the user only,
+ *        unless the file already exists.
+ *
+ * @return int `0` if the file was written.
+ */
+static int createToken(const char *path){
+    unsigned char bytes[16];
+    #ifdef _WIN32
+        for(size_t i=0; i<sizeof(bytes); i+=sizeof(unsigned int)){
+            unsigned int value;
+            if(rand_s(&value)!=0) return -1;
+            memcpy(bytes+i, &value, sizeof(value));
+        }
+        FILE *file=fopen(path, "wx");
+    #else
+        FILE *random=fopen("/dev/urandom", "rb");
+        int ok=random && fread(bytes, 1, sizeof(bytes), random)==sizeof(bytes);
+        if(random) fclose(random);
+        if(!ok) return -1;
+        int fd=open(path, O_WRONLY|O_CREAT|O_EXCL, 0600);
+        FILE *file=fd>=0 ? fdopen(fd, "w") : NULL;
+        if(fd>=0 && !file) close(fd);
+    #endif
+    if(!file) return -1;
+    for(size_t i=0; i<sizeof(bytes); i++) fprintf(file, "%02x", bytes[i]);
+    fputc('\n', file);
+    return fclose(file)==0 ? 0 : -1;
+}
+
+/**
+ * @brief Reads the secret shared by the workers and their clients.
+ *
+ * @details `DEVCLI_WORKER_TOKEN` if set, else the first line of
+ *          `tokenFile()`. A worker (`create`) writes a random one there the
+ *          first time; copy that file, or its line into
+ *          `DEVCLI_WORKER_TOKEN`, to the machines that send it jobs.
+ *
+ * @return int `0` on success, `-1` if there is no secret or it is too long.
+ */
+static int distToken(char *token, size_t size, int create){
+    const char *value=getenv("DEVCLI_WORKER_TOKEN");
+    if(value && *value){
+        if(strlen(value)>=size) return -1;
+        strcpy(token, value);
+        return 0;
+    }
+    char path[1100];
+    if(tokenFile(path, sizeof(path))!=0) return -1;
+    FILE *file=fopen(path, "r");
+    if(!file && create && createToken(path)==0) file=fopen(path, "r");
+    if(!file) return -1;
+    int ok=fgets(token, (int)size, file)!=NULL;
+    fclose(file);
+    if(!ok) return -1;
+    token[strcspn(token, "\r\n")]='\0';
+    return token[0] ? 0 : -1;
+}
+
+/**
+ * @brief Opens a request on a new connection: the protocol version, the
+ *        shared secret and the request's `kind`.
+ *
+ * @return int `0` on success, `-1` if the connection failed.
+ */
+static int sendHello(DistSocket s, const char *token, const char *kind){
+    size_t len=strlen(token);
+    return sendToken(s, "DCLI", DIST_PROTOCOL)==0 && sendToken(s, "AUTH", (uint32_t)len)==0
+        && sendAll(s, token, len)==0 && sendToken(s, kind, 0)==0 ? 0 : -1;
+}
+
+/**
+ * @brief Returns `1` if a worker runs the compiler with the option `word`.
+ *
+ * @details Options are allowed by name, not refused, since a job's options
+ *          decide what it can do on the worker: `-O`, `-g` levels and
+ *          formats, `-m` target options, `-std=`, warnings (`-W` without a
+ *          comma, so not `-Wa,`, `-Wl,` or `-Wp,`) and the code generation
+ *          `-f` options listed here. None may carry a path. A command with
+ *          any other option is compiled here instead.
+ */
+static int distOptionAllowed(const char *word){
+    static const char *const prefixes[]={"-O", "-g0", "-g1", "-g2", "-g3", "-ggdb", "-gdwarf", "-gz",
+        "-m", "-std=", "--std=", "--target=", "-fno-", "-fvisibility=", "-fstack-protector", "-fsanitize=",
+        "-fdiagnostics-color", "-fmessage-length=", "-fmax-errors=", "-ffp-contract=", "-fcf-protection",
+        "-flto", "-fabi-version=", "-ftemplate-depth=", "-fconstexpr-"};
+    static const char *const options[]={"-g", "-w", "-ansi", "-pedantic", "-pedantic-errors", "-pthread",
+        "-fPIC", "-fpic", "-fPIE", "-fpie", "-fomit-frame-pointer", "-fexceptions", "-frtti", "-fcommon",
+        "-fstrict-aliasing", "-ffast-math", "-funroll-loops", "-ffunction-sections", "-fdata-sections",
+        "-fsigned-char", "-funsigned-char", "-fwrapv", "-ftrapv", "-fstack-clash-protection",
+        "-fasynchronous-unwind-tables", "-fpermissive", "-fshort-enums", "-fms-extensions",
+        "-ftree-vectorize", "-fopenmp", "-fcoroutines", "-fconcepts", "-fcolor-diagnostics"};
+    if(strchr(word, '/') || strchr(word, '\\')) return 0;
+    if(word[0]=='-' && word[1]=='W') return word[2]!='\0' && !strchr(word, ',');
+    for(size_t i=0; i<sizeof(options)/sizeof(options[0]); i++){
+        if(strcmp(word, options[i])==0) return 1;
+    }
+    for(size_t i=0; i<sizeof(prefixes)/sizeof(prefixes[0]); i++){
+        if(strncmp(word, prefixes[i], strlen(prefixes[i]))==0) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Finds the compiler `name` on this machine's `PATH`.
+ *
+ * @return int `0` with its path in `out`, `-1` if it is not there.
+ */
+static int findCompiler(const char *name, char *out, size_t size){
+    #ifdef _WIN32
+        const char separator=';';
+        const char *suffixes[]={".exe", ""};
+    #else
+        const char separator=':';
+        const char *suffixes[]={""};
+    #endif
+    struct stat info;
+    const char *dirs=getenv("PATH");
+    while(dirs && *dirs){
+        size_t len=strcspn(dirs, (char[]){separator, '\0'});
+        for(size_t i=0; i<sizeof(suffixes)/sizeof(suffixes[0]); i++){
+            int n=snprintf(out, size, "%.*s/%s%s", (int)len, dirs, name, suffixes[i]);
+            if(n>0 && (size_t)n<size && stat(out, &info)==0 && !(info.st_mode&S_IFDIR)) return 0;
+        }
+        dirs+=len;
+        if(*dirs==separator) dirs++;
+    }
+    return -1;
+}
+
+/**
+ * @brief Connects to a worker.
+ *
+ * @param timeoutMs Longest wait for each reply, or `0` to wait as long as
+ *        a compile takes.
+ *
+ * @return DistSocket The connection, or `DIST_NO_SOCKET`.
+ */
+static DistSocket distConnect(const DistWorker *worker, int timeoutMs){
+    struct addrinfo hints, *addresses=NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family=AF_UNSPEC;
+    hints.ai_socktype=SOCK_STREAM;
+    if(getaddrinfo(worker->host, worker->port, &hints, &addresses)!=0) return DIST_NO_SOCKET;
+    DistSocket s=DIST_NO_SOCKET;
+    for(struct addrinfo *a=addresses; a && s==DIST_NO_SOCKET; a=a->ai_next){
+        s=socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if(s==DIST_NO_SOCKET) continue;
+        if(connect(s, a->ai_addr, (int)a->ai_addrlen)!=0){
+            distCloseSocket(s);
+            s=DIST_NO_SOCKET;
+        }
+    }
+    freeaddrinfo(addresses);
+    if(s==DIST_NO_SOCKET) return s;
+    int on=1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+    #ifdef SO_NOSIGPIPE
+        setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+    #endif
+    if(timeoutMs>0){
+        #ifdef _WIN32
+            DWORD timeout=(DWORD)timeoutMs;
+        #else
+            struct timeval timeout={timeoutMs/1000, (timeoutMs%1000)*1000};
+        #endif
+        setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+    }
+    return s;
+}
+
+/**
+ * @brief Asks a worker how many jobs it has queued or running, and how many
+ *        it runs at once.
+ *
+ * @return int `0` on success, `-1` if it did not answer.
+ */
+static int queryWorker(const DistWorker *worker, const char *token, uint32_t *depth, uint32_t *slots){
+    DistSocket s=distConnect(worker, DIST_QUERY_TIMEOUT_MS);
+    if(s==DIST_NO_SOCKET) return -1;
+    int result=sendHello(s, token, "QURY")==0 && recvToken(s, "DPTH", depth)==0 && recvToken(s, "SLOT", slots)==0 ? 0 : -1;
+    distCloseSocket(s);
+    return result;
+}
+
+/**
+ * @brief Splits the first `len` bytes of `address`, written `host:port`,
+ *        `host`, `port` or `[ipv6]:port`, into `host` and `port`.
+ *
+ * @return int `0` on success, `-1` if it is malformed or a part is too long.
+ */
+static int splitAddress(const char *address, size_t len, const char *defaultHost, char *host, size_t hostSize, char *port, size_t portSize){
+    const char *hostStart=address, *portStart=NULL;
+    size_t hostLen=len, portLen=0;
+    if(len>0 && strspn(address, "0123456789")>=len){
+        hostLen=0;
+        portStart=address;
+        portLen=len;
+    }
+    else if(len>0 && address[0]=='['){
+        const char *close=memchr(address, ']', len);
+        if(!close) return -1;
+        hostStart=address+1;
+        hostLen=(size_t)(close-hostStart);
+        if(close+1<address+len){
+            if(close[1]!=':') return -1;
+            portStart=close+2;
+            portLen=(size_t)(address+len-portStart);
+        }
+    }
+    else{
+        const char *colon=NULL;
+        for(const char *p=address; p<address+len; p++){
+            if(*p==':') colon=p;
+        }
+        if(colon){
+            hostLen=(size_t)(colon-address);
+            portStart=colon+1;
+            portLen=(size_t)(address+len-portStart);
+        }
+    }
+    if(hostLen>=hostSize || portLen>=portSize) return -1;
+    if(hostLen) snprintf(host, hostSize, "%.*s", (int)hostLen, hostStart);
+    else snprintf(host, hostSize, "%s", defaultHost);
+    if(portLen) snprintf(port, portSize, "%.*s", (int)portLen, portStart);
+    else snprintf(port, portSize, "%s", DIST_DEFAULT_PORT);
+    return 0;
+}
+
+/**
+ * @brief Reads `DEVCLI_WORKERS` and asks each worker how many compiles it
+ *        runs at once; workers that do not answer are left out.
+ *
+ * @return int Compiles the reachable workers run at once together, `0` if
+ *         none answered.
+ */
+static int distWorkers(DistBuild *build, const char *list){
+    int capacity=0;
+    while(*list && build->workerCount<DIST_MAX_WORKERS){
+        size_t len=strcspn(list, ", ");
+        DistWorker *worker=&build->workers[build->workerCount];
+        memset(worker, 0, sizeof(*worker));
+        uint32_t depth, slots;
+        if(len>0 && splitAddress(list, len, "localhost", worker->host, sizeof(worker->host), worker->port, sizeof(worker->port))==0){
+            if(queryWorker(worker, build->token, &depth, &slots)==0 && slots>0){
+                worker->slots=(int)slots;
+                capacity+=worker->slots;
+                build->workerCount++;
+            }
+            else LOG_ERROR("Compile worker %s:%s does not answer or has another DEVCLI_WORKER_TOKEN; leaving it out.", worker->host, worker->port);
+        }
+        list+=len;
+        list+=strspn(list, ", ");
+    }
+    return capacity;
+}
+
+/**
+ * @brief Picks the worker for the next compile: the one with the fewest
+ *        queued or running jobs per slot.
+ *
+ * @details Each worker reports its queue depth, which counts the jobs of
+ *          every client. The compiles this command has on it are counted as
+ *          well, in case the worker has not seen the latest of them yet.
+ *          Workers that do not answer are marked down for the rest of the
+ *          command.
+ *
+ * @return int Index of the worker, now counted as running one more job, or
+ *         `-1` if none is left.
+ */
+static int pickWorker(DistBuild *build){
+    uint32_t depths[DIST_MAX_WORKERS];
+    int answered[DIST_MAX_WORKERS];
+    for(int w=0; w<build->workerCount; w++){
+        uint32_t slots;
+        answered[w]=!build->workers[w].down && queryWorker(&build->workers[w], build->token, &depths[w], &slots)==0;
+    }
+    int best=-1;
+    double bestScore=0;
+    distLock(build);
+    for(int w=0; w<build->workerCount; w++){
+        DistWorker *worker=&build->workers[w];
+        if(!answered[w]){
+            if(!worker->down) LOG_ERROR("Compile worker %s:%s stopped answering; compiling without it.", worker->host, worker->port);
+            worker->down=1;
+            continue;
+        }
+        int depth=(int)depths[w]>worker->running ? (int)depths[w] : worker->running;
+        double score=(double)(depth+1)/worker->slots;
+        if(best<0 || score<bestScore){
+            best=w;
+            bestScore=score;
+        }
+    }
+    if(best>=0) build->workers[best].running++;
+    distUnlock(build);
+    return best;
+}
+
+/**
+ * @brief Sends a preprocessed source to a worker and receives its object file.
+ *
+ * @details The worker gets the compiler's name, which it looks up on its
+ *          own `PATH`, and its code generation options, without the
+ *          preprocessor, link and output options, which only mean something
+ *          on this machine. Its messages are written to stderr here.
+ *
+ * @return int `0` if the worker answered, with `status` set to the
+ *         compiler's status; `-1` if the connection failed.
+ */
+static int remoteCompile(const DistBuild *build, const DistWorker *worker, const char *preprocessed, int cxx, const char *object, int *status){
+    const CompileCommand *parsed=build->parsed;
+    DistSocket s=distConnect(worker, 0);
+    if(s==DIST_NO_SOCKET) return -1;
+    uint32_t argc=0;
+    for(int i=0; i<parsed->count; i++) argc+=parsed->kinds[i]==COMPILE_WORD_FLAG;
+    int result=sendHello(s, build->token, "CMPL")==0 && sendToken(s, "ARGC", argc)==0 ? 0 : -1;
+    for(int i=0; i<parsed->count && result==0; i++){
+        if(parsed->kinds[i]!=COMPILE_WORD_FLAG) continue;
+        const char *word=parsed->words[i];
+        if(i==0){
+            for(const char *p=parsed->words[0]; *p; p++){
+                if(*p=='/' || *p=='\\') word=p+1;
+            }
+        }
+        size_t len=strlen(word);
+        result=sendToken(s, "ARGV", (uint32_t)len)==0 && sendAll(s, word, len)==0 ? 0 : -1;
+    }
+    uint32_t code=0;
+    if(result==0) result=sendToken(s, "LANG", cxx ? 2 : 1);
+    if(result==0) result=sendFile(s, "DOTI", preprocessed);
+    if(result==0) result=recvToken(s, "STAT", &code);
+    if(result==0) result=recvFile(s, "SERR", NULL);
+    if(result==0) result=recvFile(s, "DOTO", object);
+    distCloseSocket(s);
+    if(result==0) *status=(int)code;
+    if(result==0 && code!=0) remove(object);
+    return result;
+}
+
+/**
+ * @brief Compiles `source` into `object` on this machine, as the fallback
+ *        when no worker can.
+ */
+static int localCompile(const DistBuild *build, const char *source, const char *object){
+    const CompileCommand *parsed=build->parsed;
+    size_t len=strlen(source)+strlen(object)+16;
+    for(int i=0; i<parsed->count; i++) len+=strlen(parsed->words[i])+1;
+    char *command=malloc(len);
+    if(!command) return -1;
+    char *p=command;
+    for(int i=0; i<parsed->count; i++){
+        if(parsed->kinds[i]==COMPILE_WORD_FLAG || parsed->kinds[i]==COMPILE_WORD_PREPROCESSOR) p+=sprintf(p, "%s ", parsed->words[i]);
+    }
+    sprintf(p, "-c %s -o \"%s\"", source, object);
+    int status=spawnShell(command, build->cpus, NULL);
+    free(command);
+    return status;
+}
+
+/**
+ * @brief Preprocesses one source here and has a worker compile it, or
+ *        compiles it here if that fails.
+ */
+static void compileSource(DistBuild *build, int index){
+    const char *source=build->parsed->words[build->sources[index]];
+    int cxx=compileCommandIsCxx(build->parsed, source);
+    char preprocessed[128];
+    snprintf(preprocessed, sizeof(preprocessed), ".devcli-dist-%ld-%u.%s", (long)GETPID(), atomic_fetch_add(&build->temp, 1), cxx ? "ii" : "i");
+    int status=-1;
+    int done=0;
+    if(compileCommandPreprocess(build->parsed, source, preprocessed)==0){
+        int w=pickWorker(build);
+        if(w>=0){
+            done=remoteCompile(build, &build->workers[w], preprocessed, cxx, build->objects[index], &status)==0;
+            distLock(build);
+            build->workers[w].running--;
+            if(!done){
+                LOG_ERROR("Compile worker %s:%s failed during %s; compiling without it.", build->workers[w].host, build->workers[w].port, source);
+                build->workers[w].down=1;
+            }
+            distUnlock(build);
+            if(done) atomic_fetch_add(&build->remote, 1);
+        }
+    }
+    remove(preprocessed);
+    if(!done) status=localCompile(build, source, build->objects[index]);
+    build->statuses[index]=status;
+}
+
+/**
+ * @brief Compiles sources until none is left; several threads run this at once.
+ */
+static void distWork(DistBuild *build){
+    for(int i=atomic_fetch_add(&build->next, 1); i<build->parsed->sources; i=atomic_fetch_add(&build->next, 1)){
+        compileSource(build, i);
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI distWorker(LPVOID arg)
+#else
+static void *distWorker(void *arg)
+#endif
+{
+    distWork(arg);
+    return 0;
+}
+
+/**
+ * @brief Links the objects of `build` like the original command would have
+ *        linked its sources.
+ *
+ * @details Each source word is replaced by its object file and the
+ *          preprocessor options are dropped; libraries and link options stay
+ *          where they were, so their order relative to the objects holds.
+ *
+ * @return int Status of the link.
+ */
+static int distLink(const DistBuild *build, uint32_t *peakMemory){
+    const CompileCommand *parsed=build->parsed;
+    size_t len=16;
+    for(int i=0; i<parsed->count; i++) len+=strlen(parsed->words[i])+3;
+    for(int j=0; j<parsed->sources; j++) len+=strlen(build->objects[j])+3;
+    char *command=malloc(len);
+    if(!command) return -1;
+    char *p=command;
+    int source=0;
+    for(int i=0; i<parsed->count; i++){
+        if(parsed->kinds[i]==COMPILE_WORD_SOURCE) p+=sprintf(p, "\"%s\" ", build->objects[source++]);
+        else if(parsed->kinds[i]!=COMPILE_WORD_PREPROCESSOR) p+=sprintf(p, "%s ", parsed->words[i]);
+    }
+    int status=spawnShell(command, build->cpus, peakMemory);
+    free(command);
+    return status;
+}
+
+/**
+ * @brief Runs a compile command by farming its compiles out to the workers
+ *        in `DEVCLI_WORKERS`.
+ *
+ * @details For a gcc, g++ or clang command over one or more sources (see
+ *          `compileCommandParse()`) such as `gcc a.c b.c c.c -o app`, each
+ *          source is preprocessed here, where its headers are, and the
+ *          preprocessed text is compiled by a worker with room for it
+ *          (`pickWorker()`). With `-c` the object files land where the
+ *          compiler would put them; otherwise they are linked here, exactly
+ *          like the original command, and removed. A source whose worker
+ *          fails is compiled here instead, so a lost worker only slows the
+ *          build.
+ *
+ *          `DEVCLI_WORKERS` lists workers as `host:port` separated by commas,
+ *          e.g. `localhost:3633,buildbox:3633`; each runs `devcli worker`.
+ *          Up to as many compiles as the workers have slots together, at
+ *          most `DIST_MAX_JOBS`, are in flight at once.
+ *
+ * @ingroup distcomp
+ *
+ * @param command Command line after placeholder substitution.
+ * @param cpus CPU list for the local link, or `NULL`.
+ * @param peakMemory Receives the link's peak memory in MiB; may be `NULL`.
+ * @param status Receives the status of the command.
+ *
+ * @return int `0` if the command was run here, `-1` if it cannot be
+ *         distributed (no `DEVCLI_WORKERS`, no worker answering, or not such
+ *         a command) and the caller must run it.
+ *
+ * Example usage:
+ * @code
+ * int status;
+ * if (distCompileRun("gcc a.c b.c -o app", NULL, NULL, &status) != 0)
+ *     status = spawnShell("gcc a.c b.c -o app", NULL, NULL);
+ * @endcode
+ */
+int distCompileRun(const char *command, const char *cpus, uint32_t *peakMemory, int *status){
+    const char *list=getenv("DEVCLI_WORKERS");
+    if(!list || !*list) return -1;
+    CompileCommand parsed;
+    if(compileCommandParse(command, &parsed)!=1) return -1;
+    if(parsed.mode=='S'){
+        compileCommandFree(&parsed);
+        return -1;
+    }
+    for(int i=1; i<parsed.count; i++){
+        if(parsed.kinds[i]==COMPILE_WORD_FLAG && !distOptionAllowed(parsed.words[i])){
+            LOG("Compiling here: compile workers do not run %s.", parsed.words[i]);
+            compileCommandFree(&parsed);
+            return -1;
+        }
+    }
+    DistBuild *build=calloc(1, sizeof(DistBuild));
+    if(build && distToken(build->token, sizeof(build->token), 0)!=0){
+        LOG_ERROR("No compile worker token: set DEVCLI_WORKER_TOKEN or copy a worker's ~/.devcli/worker-token; compiling here.");
+        free(build);
+        build=NULL;
+    }
+    if(!build || distStartup()!=0){
+        free(build);
+        compileCommandFree(&parsed);
+        return -1;
+    }
+    build->parsed=&parsed;
+    build->cpus=cpus;
+    build->link=!parsed.mode;
+    int capacity=distWorkers(build, list);
+    if(capacity==0){
+        LOG_ERROR("No compile worker in DEVCLI_WORKERS answers; compiling here.");
+        distCleanup();
+        free(build);
+        compileCommandFree(&parsed);
+        return -1;
+    }
+    int count=0;
+    for(int i=1; i<parsed.count; i++){
+        if(parsed.kinds[i]!=COMPILE_WORD_SOURCE) continue;
+        const char *source=parsed.words[i];
+        build->sources[count]=i;
+        if(build->link){
+            snprintf(build->objects[count], sizeof(build->objects[count]), ".devcli-dist-%ld-%u.o", (long)GETPID(), atomic_fetch_add(&build->temp, 1));
+        }
+        else if(parsed.sources==1) snprintf(build->objects[count], sizeof(build->objects[count]), "%s", parsed.output);
+        else{
+            const char *base=source;
+            for(const char *p=source; *p; p++){
+                if(*p=='/' || *p=='\\') base=p+1;
+            }
+            snprintf(build->objects[count], sizeof(build->objects[count]), "%.*s.o", (int)(strrchr(base, '.')-base), base);
+        }
+        count++;
+    }
+    int threads=count<capacity ? count : capacity;
+    if(threads>DIST_MAX_JOBS) threads=DIST_MAX_JOBS;
+    LOG("Compiling %d source(s) on %d worker(s) with %d slot(s).", count, build->workerCount, capacity);
+    #ifdef _WIN32
+        InitializeCriticalSection(&build->lock);
+        HANDLE handles[DIST_MAX_JOBS];
+        for(int t=1; t<threads; t++) handles[t]=CreateThread(NULL, 0, distWorker, build, 0, NULL);
+        distWork(build);
+        for(int t=1; t<threads; t++){
+            if(handles[t]){
+                WaitForSingleObject(handles[t], INFINITE);
+                CloseHandle(handles[t]);
+            }
+        }
+        DeleteCriticalSection(&build->lock);
+    #else
+        pthread_mutex_init(&build->lock, NULL);
+        pthread_t handles[DIST_MAX_JOBS];
+        int started[DIST_MAX_JOBS];
+        for(int t=1; t<threads; t++) started[t]=pthread_create(&handles[t], NULL, distWorker, build)==0;
+        distWork(build);
+        for(int t=1; t<threads; t++){
+            if(started[t]) pthread_join(handles[t], NULL);
+        }
+        pthread_mutex_destroy(&build->lock);
+    #endif
+    *status=0;
+    for(int j=0; j<count && *status==0; j++) *status=build->statuses[j];
+    if(peakMemory) *peakMemory=0;
+    if(build->link){
+        if(*status==0) *status=distLink(build, peakMemory);
+        for(int j=0; j<count; j++) remove(build->objects[j]);
+    }
+    LOG("%d of %d compile(s) ran on compile workers.", atomic_load(&build->remote), count);
+    distCleanup();
+    free(build);
+    compileCommandFree(&parsed);
+    return 0;
+}
+
+static void serverLock(DistServer *server){
+    #ifdef _WIN32
+        EnterCriticalSection(&server->lock);
+    #else
+        pthread_mutex_lock(&server->lock);
+    #endif
+}
+
+static void serverUnlock(DistServer *server){
+    #ifdef _WIN32
+        LeaveCriticalSection(&server->lock);
+    #else
+        pthread_mutex_unlock(&server->lock);
+    #endif
+}
+
+/** @brief Sleeps until a compile finishes; `lock` must be held. */
+static void serverWait(DistServer *server){
+    #ifdef _WIN32
+        SleepConditionVariableCS(&server->changed, &server->lock, INFINITE);
+    #else
+        pthread_cond_wait(&server->changed, &server->lock);
+    #endif
+}
+
+static void serverWake(DistServer *server){
+    #ifdef _WIN32
+        WakeAllConditionVariable(&server->changed);
+    #else
+        pthread_cond_broadcast(&server->changed);
+    #endif
+}
+
+/**
+ * @brief Reads a job's compiler arguments and accepts them only if they are
+ *        a compiler's name and allowed options.
+ *
+ * @details Whoever can reach the worker chooses the arguments, so they must
+ *          not be able to run anything but the compiler or touch files: the
+ *          first must be a compiler's bare name, which is run from the
+ *          worker's own `PATH`, and the others must pass `compileWordSafe()`
+ *          and `distOptionAllowed()`. The output and the mode are the
+ *          worker's own.
+ *
+ * @return char* The compiler's path, quoted, and the options, joined by
+ *         spaces; `NULL` after a failure or a refused argument.
+ */
+static char *serveArguments(DistSocket s){
+    uint32_t argc;
+    if(recvToken(s, "ARGC", &argc)!=0 || argc==0 || argc>COMPILE_CACHE_MAX_ARGS) return NULL;
+    char *line=malloc((size_t)argc*(DIST_MAX_ARG+1)+1024+3);
+    if(!line) return NULL;
+    char *p=line;
+    char word[DIST_MAX_ARG+1];
+    for(uint32_t i=0; i<argc; i++){
+        uint32_t len;
+        if(recvToken(s, "ARGV", &len)!=0 || len==0 || len>DIST_MAX_ARG || recvAll(s, word, len)!=0) goto refuse;
+        word[len]='\0';
+        if(memchr(word, '\0', len) || !compileWordSafe(word)) goto refuse;
+        if(i>0){
+            if(!distOptionAllowed(word)) goto refuse;
+            p+=sprintf(p, "%s ", word);
+            continue;
+        }
+        char compiler[1024];
+        if(strchr(word, '/') || strchr(word, '\\') || !compileWordIsCompiler(word) || findCompiler(word, compiler, sizeof(compiler))!=0) goto refuse;
+        p+=sprintf(p, "\"%s\" ", compiler);
+    }
+    return line;
+refuse:
+    free(line);
+    return NULL;
+}
+
+/**
+ * @brief Fills `out` with a unique path for a job's file in the worker's
+ *        directory, ending in `suffix`.
+ */
+static void serverTemp(DistServer *server, char *out, size_t size, const char *suffix){
+    snprintf(out, size, "%s/devcli-worker-%ld-%u%s", server->dir, (long)GETPID(), atomic_fetch_add(&server->temp, 1), suffix);
+}
+
+/**
+ * @brief Reads a client's greeting and checks its token.
+ *
+ * @return int `0` if the client holds the worker's token, `-1` otherwise.
+ */
+static int serveAuthenticate(DistServer *server, DistSocket s){
+    uint32_t version, tokenLen;
+    char token[DIST_TOKEN_SIZE];
+    if(recvToken(s, "DCLI", &version)!=0 || version!=DIST_PROTOCOL) return -1;
+    if(recvToken(s, "AUTH", &tokenLen)!=0 || tokenLen>=sizeof(token) || recvAll(s, token, tokenLen)!=0) return -1;
+    size_t expected=strlen(server->token);
+    unsigned char differs=tokenLen!=expected;
+    for(size_t i=0; i<tokenLen && i<expected; i++) differs|=(unsigned char)(token[i]^server->token[i]);
+    if(differs){
+        LOG_ERROR("Refused a connection without this worker's token.");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Serves one authenticated connection: a queue-depth query or a
+ *        compile job.
+ *
+ * @details A job holds one of the worker's slots while the compiler runs;
+ *          jobs beyond the slots wait, and count towards the queue depth
+ *          the clients balance on.
+ */
+static void serveConnection(DistServer *server, DistSocket s){
+    uint32_t value;
+    char kind[12];
+    if(recvAll(s, kind, sizeof(kind))!=0) return;
+    if(memcmp(kind, "QURY", 4)==0){
+        serverLock(server);
+        int depth=server->depth;
+        serverUnlock(server);
+        if(sendToken(s, "DPTH", (uint32_t)depth)==0) sendToken(s, "SLOT", (uint32_t)server->slots);
+        return;
+    }
+    if(memcmp(kind, "CMPL", 4)!=0) return;
+    char *arguments=serveArguments(s);
+    if(!arguments){
+        LOG_ERROR("Refused a compile job with arguments a worker does not run.");
+        return;
+    }
+    char source[1200], object[1200], messages[1200];
+    if(recvToken(s, "LANG", &value)!=0 || (value!=1 && value!=2)){
+        free(arguments);
+        return;
+    }
+    serverTemp(server, source, sizeof(source), value==2 ? ".ii" : ".i");
+    serverTemp(server, object, sizeof(object), ".o");
+    serverTemp(server, messages, sizeof(messages), ".stderr");
+    if(recvFile(s, "DOTI", source)!=0){
+        free(arguments);
+        return;
+    }
+    size_t len=strlen(arguments)+strlen(source)+strlen(object)+strlen(messages)+32;
+    char *command=malloc(len);
+    int status=-1;
+    if(command){
+        snprintf(command, len, "%s-c \"%s\" -o \"%s\" 2>\"%s\"", arguments, source, object, messages);
+        serverLock(server);
+        server->depth++;
+        while(server->running>=server->slots) serverWait(server);
+        server->running++;
+        serverUnlock(server);
+        status=spawnShell(command, NULL, NULL);
+        serverLock(server);
+        server->running--;
+        server->depth--;
+        serverWake(server);
+        serverUnlock(server);
+        free(command);
+    }
+    if(sendToken(s, "STAT", (uint32_t)status)==0 && sendFile(s, "SERR", messages)==0) sendFile(s, "DOTO", status==0 ? object : NULL);
+    remove(source);
+    remove(object);
+    remove(messages);
+    free(arguments);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI serveThread(LPVOID arg)
+#else
+static void *serveThread(void *arg)
+#endif
+{
+    DistConnection *connection=arg;
+    DistServer *server=connection->server;
+    int authenticated=serveAuthenticate(server, connection->socket)==0;
+    serverLock(server);
+    server->pending--;
+    serverUnlock(server);
+    if(authenticated) serveConnection(server, connection->socket);
+    distCloseSocket(connection->socket);
+    free(connection);
+    return 0;
+}
+
+/**
+ * @brief Runs a compile worker: `devcli worker [host:]port`.
+ *
+ * @details Listens on `address` (by default `127.0.0.1` and
+ *          `DIST_DEFAULT_PORT`; `0.0.0.0:3633` serves other machines) and
+ *          answers every connection on a thread of its own. A client that
+ *          sends nothing for `DIST_SERVE_TIMEOUT_MS` is dropped, and at most
+ *          `DIST_MAX_PENDING` connections may be waiting to send the token;
+ *          more are closed unanswered. The protocol is
+ *          a stream of distcc-style tokens, four letters and eight hex
+ *          digits, some followed by that many bytes:
+ *          - a client opens with `DCLI` and the protocol version, then
+ *            `AUTH` with the shared secret (see `distToken()`);
+ *          - `QURY` asks for the queue depth, answered with `DPTH` (jobs
+ *            queued or running) and `SLOT` (jobs run at once);
+ *          - `CMPL` sends a job: `ARGC` and one `ARGV` per compiler
+ *            argument, the compiler's bare name first, then the options
+ *            `distOptionAllowed()` lets through; `LANG` (1 for C, 2 for
+ *            C++) and `DOTI` with the
+ *            preprocessed source. The answer is `STAT` with the compiler's
+ *            status, `SERR` with its messages and `DOTO` with the object
+ *            file, empty if the compile failed.
+ *
+ *          Up to one compile per processor runs at once, or
+ *          `DEVCLI_WORKER_SLOTS`. Job files go to `TMPDIR` (`%TEMP%` on
+ *          Windows) and are removed once answered. Only clients holding
+ *          the worker's token, `DEVCLI_WORKER_TOKEN` or a random one written
+ *          to `~/.devcli/worker-token` on first start, get an answer. The
+ *          token travels in the clear, so still only listen on networks you
+ *          trust.
+ *
+ * @ingroup distcomp
+ *
+ * @param address `[host:]port` to listen on, or `NULL` for the default.
+ *
+ * @return int `1` if it could not listen; otherwise it serves until killed.
+ *
+ * Example usage:
+ * @code
+ * // devcli worker 0.0.0.0:3633
+ * return distWorkerServe(argc > 2 ? argv[2] : NULL);
+ * @endcode
+ */
+int distWorkerServe(const char *address){
+    if(distStartup()!=0) return 1;
+    DistServer *server=calloc(1, sizeof(DistServer));
+    char host[256], port[16];
+    if(!server || splitAddress(address ? address : "", address ? strlen(address) : 0, "127.0.0.1", host, sizeof(host), port, sizeof(port))!=0){
+        LOG_ERROR("A compile worker address looks like 127.0.0.1:%s or 0.0.0.0:%s.", DIST_DEFAULT_PORT, DIST_DEFAULT_PORT);
+        free(server);
+        return 1;
+    }
+    if(distToken(server->token, sizeof(server->token), 1)!=0){
+        LOG_ERROR("Could not read or create the compile worker token; set DEVCLI_WORKER_TOKEN.");
+        free(server);
+        distCleanup();
+        return 1;
+    }
+    const char *slots=getenv("DEVCLI_WORKER_SLOTS");
+    server->slots=slots && atoi(slots)>0 ? atoi(slots) : tapeHardwareThreads();
+    if(server->slots<1) server->slots=1;
+    #ifdef _WIN32
+        DWORD n=GetTempPathA(sizeof(server->dir), server->dir);
+        if(n==0 || n>=sizeof(server->dir)) strcpy(server->dir, ".");
+        else if(server->dir[n-1]=='\\') server->dir[n-1]='\0';
+        InitializeCriticalSection(&server->lock);
+        InitializeConditionVariable(&server->changed);
+    #else
+        const char *dir=getenv("TMPDIR");
+        snprintf(server->dir, sizeof(server->dir), "%s", dir && *dir ? dir : "/tmp");
+        pthread_mutex_init(&server->lock, NULL);
+        pthread_cond_init(&server->changed, NULL);
+    #endif
+    struct addrinfo hints, *addresses=NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family=AF_UNSPEC;
+    hints.ai_socktype=SOCK_STREAM;
+    hints.ai_flags=AI_PASSIVE;
+    DistSocket listener=DIST_NO_SOCKET;
+    if(getaddrinfo(host, port, &hints, &addresses)==0){
+        for(struct addrinfo *a=addresses; a && listener==DIST_NO_SOCKET; a=a->ai_next){
+            listener=socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if(listener==DIST_NO_SOCKET) continue;
+            int on=1;
+            setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+            if(bind(listener, a->ai_addr, (int)a->ai_addrlen)!=0 || listen(listener, 64)!=0){
+                distCloseSocket(listener);
+                listener=DIST_NO_SOCKET;
+            }
+        }
+        freeaddrinfo(addresses);
+    }
+    if(listener==DIST_NO_SOCKET){
+        LOG_ERROR("Could not listen on %s:%s for compile jobs.", host, port);
+        free(server);
+        distCleanup();
+        return 1;
+    }
+    LOG("Compile worker listening on %s:%s with %d slot(s).", host, port, server->slots);
+    if(!getenv("DEVCLI_WORKER_TOKEN") || !*getenv("DEVCLI_WORKER_TOKEN")){
+        LOG("Clients need this worker's token: copy ~/.devcli/worker-token to them or set DEVCLI_WORKER_TOKEN.");
+    }
+    if(strcmp(host, "127.0.0.1")!=0 && strcmp(host, "localhost")!=0 && strcmp(host, "::1")!=0){
+        LOG("The worker token travels in the clear; only listen on trusted networks.");
+    }
+    fflush(stdout);
+    for(;;){
+        DistSocket s=accept(listener, NULL, NULL);
+        if(s==DIST_NO_SOCKET) continue;
+        int on=1;
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+        #ifdef SO_NOSIGPIPE
+            setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+        #endif
+        #ifdef _WIN32
+            DWORD timeout=DIST_SERVE_TIMEOUT_MS;
+        #else
+            struct timeval timeout={DIST_SERVE_TIMEOUT_MS/1000, (DIST_SERVE_TIMEOUT_MS%1000)*1000};
+        #endif
+        setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+        DistConnection *connection=malloc(sizeof(DistConnection));
+        serverLock(server);
+        int full=server->pending>=DIST_MAX_PENDING;
+        if(connection && !full) server->pending++;
+        serverUnlock(server);
+        if(!connection || full){
+            free(connection);
+            distCloseSocket(s);
+            continue;
+        }
+        connection->server=server;
+        connection->socket=s;
+        #ifdef _WIN32
+            HANDLE thread=CreateThread(NULL, 0, serveThread, connection, 0, NULL);
+            if(thread) CloseHandle(thread);
+            else serveThread(connection);
+        #else
+            pthread_t thread;
+            if(pthread_create(&thread, NULL, serveThread, connection)==0) pthread_detach(thread);
+            else serveThread(connection);
+        #endif
+    }
+}
+
+/** @} */ // end of distcomp group
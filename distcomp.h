@@ -0,0 +1,39 @@
+/**
+ * @file distcomp.h
+ * @brief Farms the compiles of a gcc or g++ command out to a pool of compile workers.
+ */
+
+#ifndef DEVCLI_DISTCOMP_H
+#define DEVCLI_DISTCOMP_H
+
+#include <stdint.h>
+
+/** @defgroup distcomp Distributed Compilation
+ *  @brief distcc-style split of a build into local preprocessing, remote compiles and a local link.
+ *  @{
+ */
+
+/**
+ * @def DIST_DEFAULT_PORT
+ * @brief TCP port of a compile worker when none is given.
+ */
+#define DIST_DEFAULT_PORT "3633"
+
+/**
+ * @def DIST_MAX_WORKERS
+ * @brief Most workers `DEVCLI_WORKERS` may list.
+ */
+#define DIST_MAX_WORKERS 32
+
+/**
+ * @def DIST_MAX_JOBS
+ * @brief Most compiles of one command in flight at once.
+ */
+#define DIST_MAX_JOBS 64
+
+int distCompileRun(const char *command, const char *cpus, uint32_t *peakMemory, int *status);
+int distWorkerServe(const char *address);
+
+/** @} */ // end of distcomp group
+
+#endif /* DEVCLI_DISTCOMP_H */
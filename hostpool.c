@@ -0,0 +1,324 @@
+/**
+ * @file hostpool.c
+ * @brief Cross-process task budget in a shared slot file with crash-safe reclamation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "hostpool.h"
+#include "tape.h"
+#include "log.h"
+
+/** @addtogroup hostpool
+ *  @{
+ */
+
+/**
+ * @def HOST_POOL_MAGIC
+ * @brief First four bytes of the slot file ("DVCS" in little endian).
+ */
+#define HOST_POOL_MAGIC 0x53435644u
+
+/**
+ * @def HOST_POOL_VERSION
+ * @brief Layout version of the slot file.
+ */
+#define HOST_POOL_VERSION 1u
+
+/**
+ * @brief Layout of the shared slot file.
+ *
+ * @details A slot is `0` when free, otherwise the owner word of the process
+ *          holding it: its pid in the high half and the low bits of its start
+ *          time in the low half, so a recycled pid is not mistaken for the
+ *          process that died. Slots are claimed and released with
+ *          compare-and-swap; nothing in the file is ever locked.
+ */
+struct HostPoolFile {
+    _Atomic uint32_t magic;
+    uint32_t version;
+    _Atomic uint64_t slots[HOST_POOL_MAX_SLOTS];
+};
+
+/**
+ * @brief Reads the budget from `DEVCLI_HOST_JOBS`.
+ *
+ * @return int Tasks allowed at once across all devcli processes, by default
+ *         one per processor; `0` turns the budget off.
+ */
+static int hostPoolCapacity(void){
+    const char *value=getenv("DEVCLI_HOST_JOBS");
+    if(!value || !value[0]) return tapeHardwareThreads();
+    char *end=NULL;
+    long capacity=strtol(value, &end, 10);
+    if(*end || capacity<0){
+        LOG_ERROR("DEVCLI_HOST_JOBS must be a number of tasks; using one per processor.");
+        return tapeHardwareThreads();
+    }
+    return capacity>HOST_POOL_MAX_SLOTS ? HOST_POOL_MAX_SLOTS : (int)capacity;
+}
+
+/**
+ * @brief Returns `1` if the budget is shared by all users (`DEVCLI_HOST_SCOPE=host`)
+ *        rather than per user, the default.
+ */
+static int hostPoolHostWide(void){
+    const char *scope=getenv("DEVCLI_HOST_SCOPE");
+    return scope && strcmp(scope, "host")==0;
+}
+
+/**
+ * @brief Sets `DEVCLI_PARENT_PID`, or removes it when `value` is `NULL`.
+ */
+static void setParent(const char *value){
+    #ifdef _WIN32
+        _putenv_s("DEVCLI_PARENT_PID", value ? value : "");
+    #else
+        if(value) setenv("DEVCLI_PARENT_PID", value, 1);
+        else unsetenv("DEVCLI_PARENT_PID");
+    #endif
+}
+
+#ifndef _WIN32
+
+/**
+ * @brief Returns the start time of process `pid` in clock ticks since boot,
+ *        or `0` where `/proc` is not available.
+ */
+static uint64_t processStartTime(long pid){
+    char path[64], line[1024];
+    snprintf(path, sizeof(path), "/proc/%ld/stat", pid);
+    FILE *file=fopen(path, "r");
+    if(!file) return 0;
+    size_t n=fread(line, 1, sizeof(line)-1, file);
+    fclose(file);
+    line[n]='\0';
+    char *p=strrchr(line, ')');
+    if(!p) return 0;
+    // Field 22 (starttime); the comm field before `)` may contain spaces.
+    for(int field=2; field<22 && p; field++) p=strchr(p+1, ' ');
+    return p ? strtoull(p+1, NULL, 10) : 0;
+}
+
+/**
+ * @brief Returns `1` if the process that wrote owner word `owner` is gone.
+ */
+static int ownerDead(uint64_t owner){
+    long pid=(long)(owner>>32);
+    if(pid<=0) return 1;
+    if(kill((pid_t)pid, 0)!=0 && errno==ESRCH) return 1;
+    uint64_t start=processStartTime(pid);
+    return start!=0 && (uint32_t)start!=(uint32_t)owner;
+}
+
+/**
+ * @brief Picks the slot file: per user under `$XDG_RUNTIME_DIR` (or
+ *        `/tmp/devcli-slots-<uid>`), or `/tmp/devcli-slots` host-wide.
+ *
+ * @details `hostPoolOpen()` does not follow a symbolic link here and only
+ *          uses a per-user file that the user owns with mode 0600.
+ */
+static void hostPoolPath(char *out, size_t size, int hostWide){
+    const char *runtime=getenv("XDG_RUNTIME_DIR");
+    if(hostWide) snprintf(out, size, "/tmp/devcli-slots");
+    else if(runtime && runtime[0]) snprintf(out, size, "%s/devcli-slots", runtime);
+    else snprintf(out, size, "/tmp/devcli-slots-%ld", (long)getuid());
+}
+
+#endif
+
+/**
+ * @brief Joins the budget shared by every devcli process of this user (or host).
+ *
+ * @details The budget is `DEVCLI_HOST_JOBS` tasks (one per processor by
+ *          default, `0` for none), counted over all devcli processes at once,
+ *          so several invocations on one build host no longer each assume
+ *          they own every core. Slots live in a small file mapped shared by
+ *          all of them; `DEVCLI_HOST_SCOPE=host` uses one file for all users
+ *          instead of one per user. A process that crashes while holding
+ *          slots does not leak them: whoever finds a slot whose owner no
+ *          longer exists takes it over.
+ *
+ *          A devcli started by a task of another devcli runs inside the slot
+ *          of that task (it sees `DEVCLI_PARENT_PID`) and does not take more;
+ *          waiting for a slot its parent holds would deadlock.
+ *
+ * @ingroup hostpool
+ *
+ * @param pool Receives the budget; release with `hostPoolClose()`.
+ *
+ * @return int `0` if a budget applies, `-1` otherwise.
+ *
+ * Example usage:
+ * @code
+ * HostPool pool;
+ * hostPoolOpen(&pool);
+ * int slot = hostPoolTryAcquire(&pool);
+ * if (slot != HOST_POOL_NONE) {
+ *     system("make");
+ *     hostPoolRelease(&pool, slot);
+ * }
+ * hostPoolClose(&pool);
+ * @endcode
+ */
+int hostPoolOpen(HostPool *pool){
+    memset(pool, 0, sizeof(*pool));
+    const char *parent=getenv("DEVCLI_PARENT_PID");
+    if(parent && parent[0]){
+        LOG("Running inside a task of devcli process %s; using its host slot.", parent);
+        return -1;
+    }
+    pool->capacity=hostPoolCapacity();
+    if(pool->capacity==0) return -1;
+    int hostWide=hostPoolHostWide();
+    #ifdef _WIN32
+        snprintf(pool->prefix, sizeof(pool->prefix), "%s\\devcli_slot_", hostWide ? "Global" : "Local");
+        char self[32];
+        snprintf(self, sizeof(self), "%lu", (unsigned long)GetCurrentProcessId());
+    #else
+        char path[512];
+        hostPoolPath(path, sizeof(path), hostWide);
+        int fd=open(path, O_RDWR|O_CREAT|O_CLOEXEC|O_NOFOLLOW, hostWide ? 0666 : 0600);
+        if(fd<0){
+            LOG_ERROR("Could not open the host slot file %s; running without a host budget.", path);
+            return -1;
+        }
+        struct stat info;
+        // Another user may have planted the per-user file in a shared /tmp.
+        if(fstat(fd, &info)!=0 || !S_ISREG(info.st_mode) || (!hostWide && (info.st_uid!=getuid() || (info.st_mode&0777)!=0600))){
+            close(fd);
+            LOG_ERROR("%s is not a regular file private to this user; running without a host budget.", path);
+            return -1;
+        }
+        if(hostWide) fchmod(fd, 0666);
+        if((size_t)info.st_size<sizeof(struct HostPoolFile) && ftruncate(fd, sizeof(struct HostPoolFile))!=0){
+            close(fd);
+            LOG_ERROR("Could not size the host slot file %s; running without a host budget.", path);
+            return -1;
+        }
+        void *mapped=mmap(NULL, sizeof(struct HostPoolFile), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if(mapped==MAP_FAILED) return -1;
+        pool->file=mapped;
+        uint32_t expected=0;
+        if(!atomic_compare_exchange_strong(&pool->file->magic, &expected, HOST_POOL_MAGIC) && expected!=HOST_POOL_MAGIC){
+            LOG_ERROR("%s is not a devcli slot file; running without a host budget.", path);
+            munmap(mapped, sizeof(struct HostPoolFile));
+            pool->file=NULL;
+            return -1;
+        }
+        pool->file->version=HOST_POOL_VERSION;
+        uint64_t start=processStartTime((long)getpid());
+        pool->owner=((uint64_t)(uint32_t)getpid()<<32)|(uint32_t)start;
+        char self[32];
+        snprintf(self, sizeof(self), "%ld", (long)getpid());
+    #endif
+    const char *saved=getenv("DEVCLI_PARENT_PID");
+    pool->savedParent=saved ? strdup(saved) : NULL;
+    setParent(self);
+    pool->active=1;
+    return 0;
+}
+
+/**
+ * @brief Takes a slot of the budget without blocking.
+ *
+ * @details Free slots below the capacity are claimed with a compare-and-swap.
+ *          A slot held by a process that has exited is claimed the same way,
+ *          swapping the dead owner's word for ours, so two processes that
+ *          find the same dead slot cannot both get it.
+ *
+ * @ingroup hostpool
+ *
+ * @return int Slot index, `HOST_POOL_NONE` if every slot is in use, or
+ *         `HOST_POOL_UNMANAGED` if no budget applies.
+ */
+int hostPoolTryAcquire(HostPool *pool){
+    if(!pool->active) return HOST_POOL_UNMANAGED;
+    #ifdef _WIN32
+        for(int i=0; i<pool->capacity; i++){
+            if(!pool->slots[i]){
+                char name[96];
+                snprintf(name, sizeof(name), "%s%d", pool->prefix, i);
+                pool->slots[i]=CreateMutexA(NULL, FALSE, name);
+                if(!pool->slots[i]) continue;
+            }
+            DWORD result=WaitForSingleObject(pool->slots[i], 0);
+            if(result==WAIT_OBJECT_0 || result==WAIT_ABANDONED){
+                return i;
+            }
+        }
+    #else
+        for(int pass=0; pass<2; pass++){
+            for(int i=0; i<pool->capacity; i++){
+                uint64_t current=atomic_load(&pool->file->slots[i]);
+                if(current!=0 && (pass==0 || current==pool->owner || !ownerDead(current))) continue;
+                if(atomic_compare_exchange_strong(&pool->file->slots[i], &current, pool->owner)){
+                    if(current!=0) LOG("Reclaimed host slot %d from exited process %ld.", i, (long)(current>>32));
+                    return i;
+                }
+            }
+        }
+    #endif
+    if(!pool->waiting){
+        pool->waiting=1;
+        LOG("All %d host slots are in use by other devcli processes; waiting.", pool->capacity);
+    }
+    return HOST_POOL_NONE;
+}
+
+/**
+ * @brief Gives back a slot from `hostPoolTryAcquire()`.
+ *
+ * @details On Windows the slot is a mutex owned by the calling thread, so it
+ *          must be released by the thread that took it.
+ *
+ * @ingroup hostpool
+ */
+void hostPoolRelease(HostPool *pool, int slot){
+    if(!pool->active || slot<0) return;
+    #ifdef _WIN32
+        ReleaseMutex(pool->slots[slot]);
+    #else
+        uint64_t expected=pool->owner;
+        atomic_compare_exchange_strong(&pool->file->slots[slot], &expected, 0);
+    #endif
+}
+
+/**
+ * @brief Leaves the budget; slots still held are freed.
+ *
+ * @ingroup hostpool
+ */
+void hostPoolClose(HostPool *pool){
+    if(pool->active){
+        setParent(pool->savedParent);
+        #ifdef _WIN32
+            for(int i=0; i<HOST_POOL_MAX_SLOTS; i++){
+                if(pool->slots[i]) CloseHandle(pool->slots[i]);
+            }
+        #else
+            for(int i=0; i<pool->capacity; i++){
+                uint64_t expected=pool->owner;
+                atomic_compare_exchange_strong(&pool->file->slots[i], &expected, 0);
+            }
+            munmap(pool->file, sizeof(struct HostPoolFile));
+        #endif
+    }
+    free(pool->savedParent);
+    memset(pool, 0, sizeof(*pool));
+}
+
+/** @} */ // end of hostpool group
@@ -0,0 +1,61 @@
+/**
+ * @file hostpool.h
+ * @brief Concurrency budget shared by every devcli process of a user or host.
+ */
+
+#ifndef DEVCLI_HOSTPOOL_H
+#define DEVCLI_HOSTPOOL_H
+
+#include <stdint.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/** @defgroup hostpool Host Budget
+ *  @brief Caps the tasks running at once across simultaneous devcli invocations.
+ *  @{
+ */
+
+/**
+ * @def HOST_POOL_MAX_SLOTS
+ * @brief Largest budget; also the number of slots in the shared file.
+ */
+#define HOST_POOL_MAX_SLOTS 1024
+
+/**
+ * @def HOST_POOL_NONE
+ * @brief Returned by `hostPoolTryAcquire()` when the whole budget is in use.
+ */
+#define HOST_POOL_NONE (-1)
+
+/**
+ * @def HOST_POOL_UNMANAGED
+ * @brief Returned by `hostPoolTryAcquire()` when no budget applies.
+ */
+#define HOST_POOL_UNMANAGED (-2)
+
+/**
+ * @brief This process's view of the budget.
+ */
+typedef struct {
+    int active;         /**< `0` if no budget applies; every request then succeeds. */
+    int capacity;       /**< Tasks allowed at once. */
+    int waiting;        /**< A wait for a slot has already been reported. */
+    char *savedParent;  /**< `DEVCLI_PARENT_PID` before `hostPoolOpen()`, restored on close. */
+    #ifdef _WIN32
+        HANDLE slots[HOST_POOL_MAX_SLOTS];  /**< Named mutex per slot, opened on first use. */
+        char prefix[64];
+    #else
+        struct HostPoolFile *file;  /**< Shared mapping of the slot file. */
+        uint64_t owner;     /**< Owner word of this process. */
+    #endif
+} HostPool;
+
+int hostPoolOpen(HostPool *pool);
+int hostPoolTryAcquire(HostPool *pool);
+void hostPoolRelease(HostPool *pool, int slot);
+void hostPoolClose(HostPool *pool);
+
+/** @} */ // end of hostpool group
+
+#endif /* DEVCLI_HOSTPOOL_H */
@@ -0,0 +1,261 @@
+/**
+ * @file isolation.c
+ * @brief Moves a run into its own cgroup v2 with `cpu.weight` and `memory.high`.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+#include "isolation.h"
+#include "log.h"
+
+/** @addtogroup isolation
+ *  @{
+ */
+
+#ifndef _WIN32
+
+/**
+ * @brief Finds where the cgroup v2 hierarchy is mounted, from `/proc/self/mountinfo`.
+ *
+ * @details Usually `/sys/fs/cgroup`, or `/sys/fs/cgroup/unified` on hosts
+ *          that still mount the v1 controllers next to it.
+ *
+ * @return int `0` if it was found.
+ */
+static int cgroupMount(char *out, size_t size){
+    FILE *file=fopen("/proc/self/mountinfo", "r");
+    if(!file) return -1;
+    char line[1024];
+    int found=-1;
+    while(found!=0 && fgets(line, sizeof(line), file)){
+        if(!strstr(line, " - cgroup2 ")) continue;
+        char point[512];
+        if(sscanf(line, "%*s %*s %*s %*s %511s", point)==1 && strlen(point)<size){
+            strcpy(out, point);
+            found=0;
+        }
+    }
+    fclose(file);
+    return found;
+}
+
+/**
+ * @brief Reads this process's cgroup v2 path (the `0::` line of `/proc/self/cgroup`).
+ *
+ * @return int `0` if it was found.
+ */
+static int cgroupOfSelf(char *out, size_t size){
+    FILE *file=fopen("/proc/self/cgroup", "r");
+    if(!file) return -1;
+    char line[1024];
+    int found=-1;
+    while(found!=0 && fgets(line, sizeof(line), file)){
+        if(strncmp(line, "0::", 3)!=0) continue;
+        line[strcspn(line, "\n")]='\0';
+        if(strlen(line+3)<size){
+            strcpy(out, line+3);
+            found=0;
+        }
+    }
+    fclose(file);
+    return found;
+}
+
+/**
+ * @brief Writes `value` to the control file `name` of the cgroup `dir`.
+ *
+ * @return int `0` on success, otherwise the `errno` of the failure.
+ */
+static int cgroupWrite(const char *dir, const char *name, const char *value){
+    char path[1300];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    int fd=open(path, O_WRONLY|O_CLOEXEC);
+    if(fd<0) return errno;
+    int error=write(fd, value, strlen(value))<0 ? errno : 0;
+    close(fd);
+    return error;
+}
+
+/**
+ * @brief Returns `1` if the space-separated control file `name` of `dir`
+ *        (such as `cgroup.controllers`) lists `word`.
+ */
+static int cgroupLists(const char *dir, const char *name, const char *word){
+    char path[1300], line[256];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *file=fopen(path, "r");
+    if(!file) return 0;
+    int listed=0;
+    if(fgets(line, sizeof(line), file)){
+        for(char *item=strtok(line, " \n"); item && !listed; item=strtok(NULL, " \n")) listed=strcmp(item, word)==0;
+    }
+    fclose(file);
+    return listed;
+}
+
+/**
+ * @brief Makes `controller` available to the children of `dir`.
+ *
+ * @return int `0` if it is, after reporting why not otherwise.
+ */
+static int cgroupEnable(const char *dir, const char *controller){
+    if(cgroupLists(dir, "cgroup.subtree_control", controller)) return 0;
+    if(!cgroupLists(dir, "cgroup.controllers", controller)){
+        LOG_ERROR("The %s controller is not delegated to %s; its limit is not applied.", controller, dir);
+        return -1;
+    }
+    char value[32];
+    snprintf(value, sizeof(value), "+%s", controller);
+    int error=cgroupWrite(dir, "cgroup.subtree_control", value);
+    if(error==EBUSY) LOG_ERROR("Other processes share cgroup %s, so its %s controller cannot be enabled; start devcli in a scope of its own.", dir, controller);
+    else if(error) LOG_ERROR("Could not enable the %s controller in %s: %s.", controller, dir, strerror(error));
+    return error ? -1 : 0;
+}
+
+/**
+ * @brief Removes the cgroups left by earlier runs under `dir`.
+ *
+ * @details A run cannot remove its own cgroup, since it is still inside it
+ *          when it ends. Removing a cgroup fails while it has processes, so
+ *          the groups of runs still going are left alone.
+ */
+static void cgroupSweep(const char *dir){
+    DIR *listing=opendir(dir);
+    if(!listing) return;
+    struct dirent *item;
+    char path[1400];
+    while((item=readdir(listing))){
+        if(strncmp(item->d_name, "devcli-", 7)!=0) continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, item->d_name);
+        rmdir(path);
+    }
+    closedir(listing);
+}
+
+#endif
+
+/**
+ * @brief Confines this process, and every task it starts, to a cgroup of its
+ *        own with a CPU weight and a memory throttle.
+ *
+ * @details A `devcli-<pid>` cgroup is created below the one devcli runs in,
+ *          which must be delegated to the user (as with `systemd-run --user
+ *          --scope -p Delegate=yes`), and devcli moves itself into it, so
+ *          every child inherits it from the moment it is started. The limits
+ *          are set on that cgroup:
+ *          - `cpu.weight` (1-10000, default 100) is the run's CPU share when
+ *            the CPUs are contended; below 100 interactive programs win.
+ *          - `memory.high` makes the kernel reclaim from and slow down the
+ *            run before it pushes the rest of the host into swap.
+ *
+ *          Each limit needs its controller enabled in the parent cgroup,
+ *          which the kernel only allows once no process is left in it
+ *          directly; where that fails the run is still grouped, and the
+ *          reason is reported. The cgroup is removed by the next run.
+ *
+ *          On Windows the process joins a job object with weight-based CPU
+ *          rate control instead; there is no counterpart of `memory.high`.
+ *
+ * @ingroup isolation
+ *
+ * @param isolation Receives the state; release with `isolationClose()`.
+ * @param cpuWeight `cpu.weight` for the run.
+ * @param memoryHigh `memory.high` in MiB, or `0` for none.
+ *
+ * @return int `0` if the run is confined, `-1` otherwise.
+ *
+ * Example usage:
+ * @code
+ * Isolation isolation;
+ * isolationOpen(&isolation, ISOLATION_DEFAULT_WEIGHT, 8192);
+ * system("make -j16");
+ * isolationClose(&isolation);
+ * @endcode
+ */
+int isolationOpen(Isolation *isolation, int cpuWeight, uint32_t memoryHigh){
+    memset(isolation, 0, sizeof(*isolation));
+    if(cpuWeight<1) cpuWeight=1;
+    if(cpuWeight>10000) cpuWeight=10000;
+    #ifdef _WIN32
+        isolation->job=CreateJobObjectA(NULL, NULL);
+        if(!isolation->job || !AssignProcessToJobObject(isolation->job, GetCurrentProcess())){
+            LOG_ERROR("Could not place this run in a job object; running without isolation.");
+            if(isolation->job) CloseHandle(isolation->job);
+            isolation->job=NULL;
+            return -1;
+        }
+        JOBOBJECT_CPU_RATE_CONTROL_INFORMATION rate;
+        memset(&rate, 0, sizeof(rate));
+        rate.ControlFlags=JOB_OBJECT_CPU_RATE_CONTROL_ENABLE|JOB_OBJECT_CPU_RATE_CONTROL_WEIGHT_BASED;
+        int weight=(cpuWeight*5+50)/100;
+        rate.Weight=weight<1 ? 1 : weight>9 ? 9 : weight;
+        if(!SetInformationJobObject(isolation->job, JobObjectCpuRateControlInformation, &rate, sizeof(rate))){
+            LOG_ERROR("Could not set the CPU weight of this run's job object.");
+        }
+        if(memoryHigh) LOG("memory.high has no counterpart on Windows; only the CPU weight is applied.");
+        LOG("Confined this run to a job object with CPU weight %lu of 9.", (unsigned long)rate.Weight);
+    #else
+        char mount[512], self[512], parent[1100];
+        if(cgroupMount(mount, sizeof(mount))!=0 || cgroupOfSelf(self, sizeof(self))!=0){
+            LOG_ERROR("No cgroup v2 hierarchy found; running without isolation.");
+            return -1;
+        }
+        snprintf(parent, sizeof(parent), "%s%s", mount, strcmp(self, "/")==0 ? "" : self);
+        cgroupSweep(parent);
+        snprintf(isolation->path, sizeof(isolation->path), "%s/devcli-%ld", parent, (long)getpid());
+        if(mkdir(isolation->path, 0755)!=0 && errno!=EEXIST){
+            LOG_ERROR("Could not create cgroup %s (%s); it needs a cgroup delegated to you, e.g. systemd-run --user --scope -p Delegate=yes devcli ...", isolation->path, strerror(errno));
+            return -1;
+        }
+        char pid[32];
+        snprintf(pid, sizeof(pid), "%ld", (long)getpid());
+        int error=cgroupWrite(isolation->path, "cgroup.procs", pid);
+        if(error){
+            LOG_ERROR("Could not move devcli into cgroup %s (%s); running without isolation.", isolation->path, strerror(error));
+            rmdir(isolation->path);
+            return -1;
+        }
+        char value[32];
+        if(cgroupEnable(parent, "cpu")==0){
+            snprintf(value, sizeof(value), "%d", cpuWeight);
+            if((error=cgroupWrite(isolation->path, "cpu.weight", value))) LOG_ERROR("Could not set cpu.weight: %s.", strerror(error));
+        }
+        if(memoryHigh && cgroupEnable(parent, "memory")==0){
+            snprintf(value, sizeof(value), "%llu", (unsigned long long)memoryHigh<<20);
+            if((error=cgroupWrite(isolation->path, "memory.high", value))) LOG_ERROR("Could not set memory.high: %s.", strerror(error));
+        }
+        if(memoryHigh) LOG("Confined this run to cgroup %s (cpu.weight %d, memory.high %u MiB).", isolation->path, cpuWeight, memoryHigh);
+        else LOG("Confined this run to cgroup %s (cpu.weight %d).", isolation->path, cpuWeight);
+    #endif
+    isolation->active=1;
+    return 0;
+}
+
+/**
+ * @brief Releases the handles of `isolationOpen()`.
+ *
+ * @details The process stays confined until it exits. It cannot move back
+ *          into its parent cgroup, which no longer takes processes once a
+ *          controller is enabled in it, and it has no work left outside
+ *          anyway.
+ *
+ * @ingroup isolation
+ */
+void isolationClose(Isolation *isolation){
+    #ifdef _WIN32
+        if(isolation->job) CloseHandle(isolation->job);
+    #endif
+    memset(isolation, 0, sizeof(*isolation));
+}
+
+/** @} */ // end of isolation group
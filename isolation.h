@@ -0,0 +1,43 @@
+/**
+ * @file isolation.h
+ * @brief Confines the tasks of a run to a cgroup v2 subtree (a job object on Windows).
+ */
+
+#ifndef DEVCLI_ISOLATION_H
+#define DEVCLI_ISOLATION_H
+
+#include <stdint.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/** @defgroup isolation Isolation
+ *  @brief Keeps heavy runs from starving the interactive programs next to them.
+ *  @{
+ */
+
+/**
+ * @def ISOLATION_DEFAULT_WEIGHT
+ * @brief `cpu.weight` of a run when none is given: half of the default 100,
+ *        so other programs get twice the CPU share of devcli's tasks.
+ */
+#define ISOLATION_DEFAULT_WEIGHT 50
+
+/**
+ * @brief The cgroup (or job object) a run was moved into.
+ */
+typedef struct {
+    int active;         /**< This process and everything it starts are confined. */
+    #ifdef _WIN32
+        HANDLE job;
+    #else
+        char path[1200];    /**< Directory of the run's cgroup. */
+    #endif
+} Isolation;
+
+int isolationOpen(Isolation *isolation, int cpuWeight, uint32_t memoryHigh);
+void isolationClose(Isolation *isolation);
+
+/** @} */ // end of isolation group
+
+#endif /* DEVCLI_ISOLATION_H */
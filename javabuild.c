@@ -0,0 +1,993 @@
+/**
+ * @file javabuild.c
+ * @brief Runs javac on the changed sources of a command only, in one batch, locally or on a warm compiler server.
+ */
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <direct.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#define MKDIR(path) _mkdir(path)
+typedef SOCKET JavaSocket;
+#define JAVA_NO_SOCKET INVALID_SOCKET
+#define javaCloseSocket closesocket
+#else
+#include <dirent.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#define MKDIR(path) mkdir(path, 0700)
+typedef int JavaSocket;
+#define JAVA_NO_SOCKET (-1)
+#define javaCloseSocket close
+#endif
+#include "javabuild.h"
+#include "devcli.h"
+#include "spawn.h"
+#include "log.h"
+
+/** @addtogroup javabuild
+ *  @{
+ */
+
+/**
+ * @def JAVA_STATE_VERSION
+ * @brief First line of every state file; changing it compiles everything once more.
+ */
+#define JAVA_STATE_VERSION "devcli-javac-1"
+
+/**
+ * @def JAVA_ARGFILE_SOURCES
+ * @brief Sources above which javac gets them from an `@argfile`, keeping the
+ *        command line below the Windows limit.
+ */
+#define JAVA_ARGFILE_SOURCES 64
+
+/**
+ * @def JAVA_SERVER_START_MS
+ * @brief Longest wait for a freshly started compiler server to publish its port.
+ */
+#define JAVA_SERVER_START_MS 20000
+
+/**
+ * @brief Source of the compiler server, compiled once into the server
+ *        directory.
+ *
+ * @details It listens on the loopback interface, publishes its port and a
+ *          random token in the port file, and runs each request through
+ *          `ToolProvider.getSystemJavaCompiler()` in the same JVM, so the
+ *          compiler's classes stay loaded and JIT-compiled between builds.
+ *          Requests are served one at a time. It exits after
+ *          `JAVA_SERVER_IDLE_MINUTES` without a request.
+ */
+static const char javaServerSource[]=
+    "import java.io.*;\n"
+    "import java.net.*;\n"
+    "import java.nio.charset.StandardCharsets;\n"
+    "import java.nio.file.*;\n"
+    "import java.security.SecureRandom;\n"
+    "import java.util.*;\n"
+    "import javax.tools.*;\n"
+    "\n"
+    "public class DevcliJavac {\n"
+    "    public static void main(String[] args) throws Exception {\n"
+    "        JavaCompiler compiler = ToolProvider.getSystemJavaCompiler();\n"
+    "        if (compiler == null) System.exit(1);\n"
+    "        Path portFile = Paths.get(args[0]);\n"
+    "        byte[] secret = new byte[16];\n"
+    "        new SecureRandom().nextBytes(secret);\n"
+    "        StringBuilder token = new StringBuilder();\n"
+    "        for (byte b : secret) token.append(String.format(\"%02x\", b));\n"
+    "        try (ServerSocket server = new ServerSocket(0, 50, InetAddress.getLoopbackAddress())) {\n"
+    "            server.setSoTimeout(Integer.parseInt(args[1]) * 60000);\n"
+    "            String published = server.getLocalPort() + \" \" + token + \"\\n\";\n"
+    "            Path temp = Paths.get(args[0] + \".tmp\");\n"
+    "            Files.write(temp, published.getBytes(StandardCharsets.UTF_8));\n"
+    "            Files.move(temp, portFile, StandardCopyOption.REPLACE_EXISTING);\n"
+    "            while (true) {\n"
+    "                Socket client;\n"
+    "                try {\n"
+    "                    client = server.accept();\n"
+    "                } catch (SocketTimeoutException e) {\n"
+    "                    break;\n"
+    "                }\n"
+    "                try (Socket c = client) {\n"
+    "                    serve(compiler, c, token.toString());\n"
+    "                } catch (IOException e) {\n"
+    "                }\n"
+    "            }\n"
+    "            try {\n"
+    "                if (new String(Files.readAllBytes(portFile), StandardCharsets.UTF_8).equals(published)) Files.delete(portFile);\n"
+    "            } catch (IOException e) {\n"
+    "            }\n"
+    "        }\n"
+    "    }\n"
+    "\n"
+    "    static void serve(JavaCompiler compiler, Socket c, String token) throws IOException {\n"
+    "        c.setSoTimeout(60000);\n"
+    "        BufferedReader in = new BufferedReader(new InputStreamReader(c.getInputStream(), StandardCharsets.UTF_8));\n"
+    "        if (!(\"" JAVA_STATE_VERSION " \" + token).equals(in.readLine())) return;\n"
+    "        List<String> words = new ArrayList<>();\n"
+    "        for (String line; (line = in.readLine()) != null && !line.isEmpty(); ) words.add(line);\n"
+    "        ByteArrayOutputStream messages = new ByteArrayOutputStream();\n"
+    "        int status;\n"
+    "        try {\n"
+    "            status = compiler.run(null, messages, messages, words.toArray(new String[0]));\n"
+    "        } catch (RuntimeException e) {\n"
+    "            e.printStackTrace(new PrintStream(messages, true));\n"
+    "            status = 4;\n"
+    "        }\n"
+    "        OutputStream out = c.getOutputStream();\n"
+    "        out.write((status + \"\\n\").getBytes(StandardCharsets.UTF_8));\n"
+    "        messages.writeTo(out);\n"
+    "        out.flush();\n"
+    "    }\n"
+    "}\n";
+
+/**
+ * @brief A javac command split into its options and its sources.
+ */
+typedef struct {
+    char *copy;                 /**< The command, cut into words in place. */
+    char **options;             /**< `javac` first, then every option and its value. */
+    int optionCount;
+    char **sources;             /**< Source files, wildcards expanded; each allocated. */
+    int sourceCount;
+    const char *outputDir;      /**< `-d` value, or `NULL` for next to each source. */
+    char *classPath;            /**< Class path set by `completeClassPath()`, or `NULL`. */
+    int launcherOptions;        /**< The command has `-J` options, which only a new JVM takes. */
+} JavacCommand;
+
+/**
+ * @brief Hash of one source as recorded in the state file.
+ */
+typedef struct {
+    uint64_t hash;
+    char *path;
+} JavaSourceState;
+
+/**
+ * @brief Returns `1` for javac options whose value is the next word.
+ */
+static int takesValue(const char *word){
+    static const char *const options[]={"-d", "-s", "-h", "-cp", "-classpath", "--class-path", "-sourcepath",
+        "--source-path", "-processorpath", "--processor-path", "-processor", "--module-path", "-p",
+        "--module-source-path", "--upgrade-module-path", "-bootclasspath", "--boot-class-path", "-extdirs",
+        "-endorseddirs", "--system", "-encoding", "-source", "--source", "-target", "--target", "--release",
+        "--add-modules", "--limit-modules", "--add-exports", "--add-reads", "--patch-module", "--module", "-m",
+        "--default-module-for-created-files", "-Xmaxerrs", "-Xmaxwarns"};
+    for(size_t i=0; i<sizeof(options)/sizeof(options[0]); i++){
+        if(strcmp(word, options[i])==0) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Returns `2` for javac options whose value is a path list, `1` for
+ *        a single path, `0` otherwise; the compiler server needs those
+ *        values absolute since it does not run in the task's directory.
+ */
+static int pathOption(const char *word){
+    static const char *const lists[]={"-cp", "-classpath", "--class-path", "-sourcepath", "--source-path",
+        "-processorpath", "--processor-path", "--module-path", "-p", "--upgrade-module-path", "-bootclasspath",
+        "--boot-class-path", "-extdirs", "-endorseddirs"};
+    static const char *const paths[]={"-d", "-s", "-h", "--system"};
+    for(size_t i=0; i<sizeof(lists)/sizeof(lists[0]); i++){
+        if(strcmp(word, lists[i])==0) return 2;
+    }
+    for(size_t i=0; i<sizeof(paths)/sizeof(paths[0]); i++){
+        if(strcmp(word, paths[i])==0) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Returns `1` if `name` matches `pattern`, where `*` matches any run
+ *        of characters and `?` any one character.
+ */
+static int wildcardMatch(const char *pattern, const char *name){
+    if(*pattern=='\0') return *name=='\0';
+    if(*pattern=='*') return wildcardMatch(pattern+1, name) || (*name && wildcardMatch(pattern, name+1));
+    return *name && (*pattern=='?' || *pattern==*name) && wildcardMatch(pattern+1, name+1);
+}
+
+/**
+ * @brief `qsort()` comparator putting expanded sources in name order, so
+ *        the javac command does not depend on the directory's order.
+ */
+static int compareNames(const void *a, const void *b){
+    return strcmp(*(char *const*)a, *(char *const*)b);
+}
+
+/**
+ * @brief Appends a copy of `path` to the command's sources.
+ *
+ * @return int `0` on success, `-1` past `JAVA_MAX_SOURCES` or out of memory.
+ */
+static int addSource(JavacCommand *parsed, const char *path){
+    if(parsed->sourceCount==JAVA_MAX_SOURCES) return -1;
+    char *copy=strdup(path);
+    if(!copy) return -1;
+    parsed->sources[parsed->sourceCount++]=copy;
+    return 0;
+}
+
+/**
+ * @brief Adds the sources a word names: itself, or every file its wildcard
+ *        in its last component, such as `*.java`, matches, so the batch is the same
+ *        whether or not the shell expands wildcards.
+ *
+ * @return int `0` on success, `-1` if a wildcard matches nothing.
+ */
+static int expandSource(JavacCommand *parsed, const char *word){
+    const char *base=word;
+    for(const char *p=word; *p; p++){
+        if(*p=='/' || *p=='\\') base=p+1;
+    }
+    if(!strpbrk(base, "*?")) return addSource(parsed, word);
+    if(strpbrk(word, "*?")<base) return -1;
+    char dir[4096], path[4096];
+    snprintf(dir, sizeof(dir), "%.*s", base==word ? 1 : (int)(base-word), base==word ? "." : word);
+    int before=parsed->sourceCount, result=0;
+    #ifdef _WIN32
+        char pattern[4096];
+        snprintf(pattern, sizeof(pattern), "%s\\*", dir);
+        WIN32_FIND_DATAA found;
+        HANDLE find=FindFirstFileA(pattern, &found);
+        if(find==INVALID_HANDLE_VALUE) return -1;
+        do{
+            const char *name=found.cFileName;
+    #else
+        DIR *listing=opendir(dir);
+        if(!listing) return -1;
+        const struct dirent *entry;
+        while((entry=readdir(listing))){
+            const char *name=entry->d_name;
+    #endif
+            if(result==0 && name[0]!='.' && wildcardMatch(base, name)){
+                snprintf(path, sizeof(path), "%.*s%s", (int)(base-word), word, name);
+                result=addSource(parsed, path);
+            }
+    #ifdef _WIN32
+        }while(FindNextFileA(find, &found));
+        FindClose(find);
+    #else
+        }
+        closedir(listing);
+    #endif
+    if(result!=0 || parsed->sourceCount==before) return -1;
+    qsort(parsed->sources+before, (size_t)(parsed->sourceCount-before), sizeof(char*), compareNames);
+    return 0;
+}
+
+/**
+ * @brief Splits a javac command into options and sources.
+ *
+ * @details Only a plain `javac` with options and `.java` files is taken:
+ *          shell syntax other than double quotes, `@argfiles`, and commands
+ *          without sources (`javac -version`) are left to the shell.
+ *
+ * @return int `0` if `command` is such a javac run, `-1` otherwise.
+ */
+static int parseJavac(const char *command, JavacCommand *parsed){
+    memset(parsed, 0, sizeof(*parsed));
+    #ifdef _WIN32
+        const char *special=";&|<>$`%^@";
+    #else
+        const char *special=";&|<>$`'\\@";
+    #endif
+    if(command[strcspn(command, special)] || strchr(command, '\n')) return -1;
+    size_t len=strlen(command);
+    parsed->copy=strdup(command);
+    parsed->options=malloc((len/2+4)*sizeof(char*));
+    parsed->sources=malloc(JAVA_MAX_SOURCES*sizeof(char*));
+    if(!parsed->copy || !parsed->options || !parsed->sources) return -1;
+    // Options are kept in the word array itself; there are never more of
+    // them than words already looked at.
+    int count=splitCommandWords(parsed->copy, parsed->options, (int)(len/2+4)), value=0;
+    if(count<0) return -1;
+    for(int i=0; i<count; i++){
+        char *word=parsed->options[i];
+        size_t wordLen=strlen(word);
+        if(parsed->optionCount==0){
+            const char *base=word;
+            for(const char *p=word; *p; p++){
+                if(*p=='/' || *p=='\\') base=p+1;
+            }
+            if(strcmp(base, "javac")!=0 && strcmp(base, "javac.exe")!=0) return -1;
+            parsed->options[parsed->optionCount++]=word;
+        }
+        else if(value || word[0]=='-'){
+            if(value && strcmp(parsed->options[parsed->optionCount-1], "-d")==0) parsed->outputDir=word;
+            if(strncmp(word, "-J", 2)==0) parsed->launcherOptions=1;
+            parsed->options[parsed->optionCount++]=word;
+            value=!value && takesValue(word);
+        }
+        else if(wordLen>5 && strcmp(word+wordLen-5, ".java")==0){
+            if(expandSource(parsed, word)!=0) return -1;
+        }
+        else return -1;
+    }
+    return value || parsed->sourceCount==0 ? -1 : 0;
+}
+
+/**
+ * @brief Frees what `parseJavac()` allocated.
+ */
+static void javacFree(JavacCommand *parsed){
+    for(int i=0; i<parsed->sourceCount; i++) free(parsed->sources[i]);
+    free(parsed->sources);
+    free(parsed->options);
+    free(parsed->classPath);
+    free(parsed->copy);
+}
+
+/**
+ * @brief Reads a whole source file.
+ *
+ * @return char* The text, `'\0'`-terminated, with its length in `*size`,
+ *         or `NULL` if it cannot be read.
+ */
+static char *readSource(const char *path, size_t *size){
+    FILE *file=fopen(path, "rb");
+    if(!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long len=ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *text=len>=0 ? malloc((size_t)len+1) : NULL;
+    if(text && fread(text, 1, (size_t)len, file)!=(size_t)len){
+        free(text);
+        text=NULL;
+    }
+    fclose(file);
+    if(!text) return NULL;
+    text[len]='\0';
+    *size=(size_t)len;
+    return text;
+}
+
+/**
+ * @brief Finds the `package` declaration of a source and writes its name,
+ *        with `/` between the parts, to `out`; empty for the default package.
+ */
+static void sourcePackage(const char *text, char *out, size_t size){
+    const char *p=text;
+    out[0]='\0';
+    for(;;){
+        while(*p==' ' || *p=='\t' || *p=='\r' || *p=='\n' || *p=='\f') p++;
+        if(p[0]=='/' && p[1]=='/') p+=strcspn(p, "\n");
+        else if(p[0]=='/' && p[1]=='*'){
+            const char *end=strstr(p+2, "*/");
+            if(!end) return;
+            p=end+2;
+        }
+        else break;
+    }
+    if(strncmp(p, "package", 7)!=0 || !(p[7]==' ' || p[7]=='\t' || p[7]=='\r' || p[7]=='\n')) return;
+    p+=7;
+    size_t n=0;
+    for(; *p && *p!=';' && n+1<size; p++){
+        if(*p=='.') out[n++]='/';
+        else if(*p!=' ' && *p!='\t' && *p!='\r' && *p!='\n') out[n++]=*p;
+    }
+    out[n]='\0';
+}
+
+/**
+ * @brief Writes the class path root of a source compiled without `-d`: its
+ *        directory, less the directories of its package.
+ */
+static void sourceRoot(const char *source, char *out, size_t size){
+    const char *slash=NULL;
+    for(const char *p=source; *p; p++){
+        if(*p=='/' || *p=='\\') slash=p;
+    }
+    size_t dirLen=slash ? (size_t)(slash-source) : 0;
+    char package[1024]="";
+    size_t length;
+    char *text=readSource(source, &length);
+    if(text){
+        sourcePackage(text, package, sizeof(package));
+        free(text);
+    }
+    size_t n=strlen(package);
+    int matches=n>0 && n<=dirLen && (n==dirLen || source[dirLen-n-1]=='/' || source[dirLen-n-1]=='\\');
+    for(size_t i=0; matches && i<n; i++){
+        char c=source[dirLen-n+i];
+        matches=c==package[i] || (c=='\\' && package[i]=='/');
+    }
+    if(matches) dirLen=n==dirLen ? 0 : dirLen-n-1;
+    if(dirLen>0) snprintf(out, size, "%.*s", (int)dirLen, source);
+    else snprintf(out, size, "%s", slash && source==slash ? "/" : ".");
+}
+
+/**
+ * @brief Gives the command an explicit class path that also finds the
+ *        classes of the sources it skips.
+ *
+ * @details The class path is the `-cp` value, or `CLASSPATH`, or `.`,
+ *          javac's default, followed by the output directory, or without
+ *          `-d` by the package roots of the skipped sources (`sourceRoot()`),
+ *          whose classes lie next to them. It is always set as a `-cp`
+ *          option, so the compiler server, which runs elsewhere with a class
+ *          path of its own, gets the command's.
+ */
+static void completeClassPath(JavacCommand *parsed, const char *compiled){
+    #ifdef _WIN32
+        const char separator=';';
+    #else
+        const char separator=':';
+    #endif
+    int at=-1;
+    for(int i=1; i+1<parsed->optionCount; i++){
+        const char *word=parsed->options[i];
+        if(strcmp(word, "-cp")==0 || strcmp(word, "-classpath")==0 || strcmp(word, "--class-path")==0) at=i+1;
+    }
+    const char *base=at>0 ? parsed->options[at] : getenv("CLASSPATH");
+    if(!base || !*base) base=".";
+    size_t len=strlen(base)+(parsed->outputDir ? strlen(parsed->outputDir) : 0)+4;
+    for(int i=0; i<parsed->sourceCount; i++) len+=compiled[i] ? 0 : strlen(parsed->sources[i])+2;
+    parsed->classPath=malloc(len);
+    if(!parsed->classPath) return;
+    char *p=parsed->classPath+sprintf(parsed->classPath, "%s", base);
+    if(parsed->outputDir) sprintf(p, "%c%s", separator, parsed->outputDir);
+    for(int i=0; i<parsed->sourceCount && !parsed->outputDir; i++){
+        char root[4096];
+        if(compiled[i]) continue;
+        sourceRoot(parsed->sources[i], root, sizeof(root));
+        size_t n=strlen(root);
+        int seen=0;
+        for(const char *q=parsed->classPath; q && !seen; q=strchr(q, separator)){
+            if(*q==separator) q++;
+            seen=strncmp(q, root, n)==0 && (q[n]==separator || q[n]=='\0');
+        }
+        if(!seen) p+=sprintf(p, "%c%s", separator, root);
+    }
+    if(at>0) parsed->options[at]=parsed->classPath;
+    else{
+        parsed->options[parsed->optionCount++]="-cp";
+        parsed->options[parsed->optionCount++]=parsed->classPath;
+    }
+}
+
+/**
+ * @brief Returns `1` if the class file javac writes for `source` exists.
+ *
+ * @details The class is `<output>/<package>/<Name>.class` with `-d`, and
+ *          next to the source without. `package-info.java` and
+ *          `module-info.java`, which may produce no class, always count as
+ *          present.
+ */
+static int classExists(const JavacCommand *parsed, const char *source, const char *text){
+    const char *base=source;
+    for(const char *p=source; *p; p++){
+        if(*p=='/' || *p=='\\') base=p+1;
+    }
+    if(strcmp(base, "package-info.java")==0 || strcmp(base, "module-info.java")==0) return 1;
+    char package[1024], path[4096];
+    struct stat info;
+    int n;
+    if(parsed->outputDir){
+        sourcePackage(text, package, sizeof(package));
+        n=snprintf(path, sizeof(path), "%s/%s%s%.*s.class", parsed->outputDir, package, package[0] ? "/" : "", (int)strlen(base)-5, base);
+    }
+    else n=snprintf(path, sizeof(path), "%.*s.class", (int)strlen(source)-5, source);
+    return n>0 && (size_t)n<sizeof(path) && stat(path, &info)==0;
+}
+
+/**
+ * @brief Hashes every option of the command; a change to any of them
+ *        compiles every source again.
+ */
+static uint64_t optionsHash(const JavacCommand *parsed){
+    uint64_t hash=fingerprintBytes(FINGERPRINT_SEED, JAVA_STATE_VERSION, sizeof(JAVA_STATE_VERSION));
+    for(int i=0; i<parsed->optionCount; i++) hash=fingerprintText(hash, parsed->options[i]);
+    const char *classpath=getenv("CLASSPATH");
+    return fingerprintText(hash, classpath ? classpath : "");
+}
+
+/**
+ * @brief Writes the path of the state file of the command's output
+ *        directory to `out`.
+ */
+static void statePath(const JavacCommand *parsed, char *out, size_t size){
+    snprintf(out, size, "%s/%s", parsed->outputDir ? parsed->outputDir : ".", JAVA_STATE_NAME);
+}
+
+/**
+ * @brief Loads the recorded source hashes, if they were recorded with the
+ *        same options.
+ *
+ * @return int Number of entries in `*entries`, which the caller frees with
+ *         `stateFree()`.
+ */
+static int stateLoad(const JavacCommand *parsed, uint64_t options, JavaSourceState **entries){
+    char path[4096], line[4200];
+    unsigned long long hash, recorded;
+    int count=0, capacity=0;
+    *entries=NULL;
+    statePath(parsed, path, sizeof(path));
+    FILE *file=fopen(path, "r");
+    if(!file) return 0;
+    if(!fgets(line, sizeof(line), file) || sscanf(line, JAVA_STATE_VERSION " %llx", &recorded)!=1 || recorded!=(unsigned long long)options){
+        fclose(file);
+        return 0;
+    }
+    while(fgets(line, sizeof(line), file)){
+        line[strcspn(line, "\r\n")]='\0';
+        char *space=strchr(line, ' ');
+        if(!space || sscanf(line, "%llx", &hash)!=1) continue;
+        if(count==capacity){
+            capacity=capacity ? capacity*2 : 64;
+            JavaSourceState *grown=realloc(*entries, (size_t)capacity*sizeof(JavaSourceState));
+            if(!grown) break;
+            *entries=grown;
+        }
+        (*entries)[count].hash=hash;
+        (*entries)[count].path=strdup(space+1);
+        if((*entries)[count].path) count++;
+    }
+    fclose(file);
+    return count;
+}
+
+static void stateFree(JavaSourceState *entries, int count){
+    for(int i=0; i<count; i++) free(entries[i].path);
+    free(entries);
+}
+
+/**
+ * @brief Rewrites the state file through a temporary file.
+ *
+ * @details Entries of sources outside this command are kept, so commands
+ *          sharing an output directory with the same options do not undo
+ *          each other. Sources in `compiled` get `hashes[i]` when the
+ *          compile succeeded and are dropped when it failed.
+ */
+static void stateSave(const JavacCommand *parsed, uint64_t options, const JavaSourceState *old, int oldCount,
+                      const uint64_t *hashes, const char *compiled, int succeeded){
+    char path[4096], temp[4200];
+    statePath(parsed, path, sizeof(path));
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    FILE *file=fopen(temp, "w");
+    if(!file) return;
+    fprintf(file, JAVA_STATE_VERSION " %016llx\n", (unsigned long long)options);
+    for(int i=0; i<oldCount; i++){
+        int listed=0;
+        for(int j=0; j<parsed->sourceCount && !listed; j++) listed=strcmp(old[i].path, parsed->sources[j])==0;
+        if(!listed) fprintf(file, "%016llx %s\n", (unsigned long long)old[i].hash, old[i].path);
+    }
+    for(int j=0; j<parsed->sourceCount; j++){
+        if(compiled[j] && !succeeded) continue;
+        if(hashes[j]) fprintf(file, "%016llx %s\n", (unsigned long long)hashes[j], parsed->sources[j]);
+    }
+    if(fclose(file)!=0){
+        remove(temp);
+        return;
+    }
+    remove(path);
+    rename(temp, path);
+}
+
+/**
+ * @brief Appends `word` and a space to `out`, in double quotes if it has a
+ *        space.
+ */
+static char *appendWord(char *out, const char *word){
+    return out+sprintf(out, strchr(word, ' ') ? "\"%s\" " : "%s ", word);
+}
+
+/**
+ * @brief Runs javac in a new process on the options and the sources marked
+ *        in `compiled`.
+ *
+ * @details More than `JAVA_ARGFILE_SOURCES` sources are passed in an
+ *          `@argfile` next to the state file.
+ */
+static int compileLocal(const JavacCommand *parsed, const char *compiled, int count, const char *cpus, uint32_t *peakMemory){
+    char argfile[4200];
+    size_t len=64+sizeof(argfile);
+    for(int i=0; i<parsed->optionCount; i++) len+=strlen(parsed->options[i])+3;
+    for(int i=0; i<parsed->sourceCount; i++) len+=compiled[i] ? strlen(parsed->sources[i])+3 : 0;
+    char *line=malloc(len);
+    if(!line){
+        LOG_ERROR("Dynamic Memory allocation failed.");
+        return -1;
+    }
+    char *p=line;
+    for(int i=0; i<parsed->optionCount; i++) p=appendWord(p, parsed->options[i]);
+    argfile[0]='\0';
+    if(count>JAVA_ARGFILE_SOURCES){
+        statePath(parsed, argfile, sizeof(argfile));
+        strcat(argfile, ".args");
+        FILE *file=fopen(argfile, "w");
+        if(file){
+            for(int i=0; i<parsed->sourceCount; i++){
+                if(!compiled[i]) continue;
+                fputc('"', file);
+                for(const char *s=parsed->sources[i]; *s; s++){
+                    if(*s=='\\' || *s=='"') fputc('\\', file);
+                    fputc(*s, file);
+                }
+                fputs("\"\n", file);
+            }
+            if(fclose(file)!=0) argfile[0]='\0';
+            else{
+                *p++='@';
+                p=appendWord(p, argfile);
+            }
+        }
+        else argfile[0]='\0';
+    }
+    if(!argfile[0]){
+        for(int i=0; i<parsed->sourceCount; i++){
+            if(compiled[i]) p=appendWord(p, parsed->sources[i]);
+        }
+    }
+    p[-1]='\0';
+    int status=spawnShell(line, cpus, peakMemory);
+    if(argfile[0]) remove(argfile);
+    free(line);
+    return status;
+}
+
+/**
+ * @brief Fills `out` with the directory of devcli's Java helpers,
+ *        `.devcli/java` in the home directory, and creates it readable by
+ *        the user only, since it also holds the compiler server's token.
+ *
+ * @ingroup javabuild
+ *
+ * @return int `0` if the directory exists.
+ */
+int javaHelperDirectory(char *out, size_t size){
+    #ifdef _WIN32
+        const char *home=getenv("USERPROFILE");
+        const char *sep="\\";
+    #else
+        const char *home=getenv("HOME");
+        const char *sep="/";
+    #endif
+    if(!home) return -1;
+    int n=snprintf(out, size, "%s%s.devcli", home, sep);
+    if(n<0 || (size_t)n>=size) return -1;
+    MKDIR(out);
+    n=snprintf(out, size, "%s%s.devcli%sjava", home, sep, sep);
+    if(n<0 || (size_t)n>=size) return -1;
+    MKDIR(out);
+    struct stat info;
+    return stat(out, &info)==0 && (info.st_mode&S_IFDIR) ? 0 : -1;
+}
+
+/**
+ * @brief Compiles one of devcli's Java helpers, such as the compiler server
+ *        or the JUnit runner, into the helper directory.
+ *
+ * @details The source is written to `<name>.java` when it differs from the
+ *          one there, and javac runs only when `<name>.class` is missing or
+ *          the source was rewritten, so helpers are built once per devcli
+ *          version.
+ *
+ * @ingroup javabuild
+ *
+ * @param name Class name of the helper.
+ * @param source Its Java source.
+ * @param classPath Class path it compiles against, such as JUnit's, or `NULL`.
+ * @param dir Receives the helper directory, to put on the class path.
+ *
+ * @return int `0` if the class is ready, `-1` if it could not be built.
+ *
+ * Example usage:
+ * @code
+ * char dir[4096], line[4200];
+ * if (javaHelperBuild("Hello", "public class Hello { public static void main(String[] a) {} }", NULL, dir, sizeof(dir)) == 0) {
+ *     snprintf(line, sizeof(line), "java -cp \"%s\" Hello", dir);
+ *     spawnShell(line, NULL, NULL);
+ * }
+ * @endcode
+ */
+int javaHelperBuild(const char *name, const char *source, const char *classPath, char *dir, size_t size){
+    char sourceFile[4200], classFile[4200];
+    struct stat info;
+    if(javaHelperDirectory(dir, size)!=0) return -1;
+    snprintf(sourceFile, sizeof(sourceFile), "%s/%s.java", dir, name);
+    snprintf(classFile, sizeof(classFile), "%s/%s.class", dir, name);
+    size_t length=0;
+    char *existing=readSource(sourceFile, &length);
+    int current=existing && strcmp(existing, source)==0;
+    free(existing);
+    if(!current){
+        FILE *file=fopen(sourceFile, "wb");
+        if(!file || fwrite(source, 1, strlen(source), file)!=strlen(source)){
+            if(file) fclose(file);
+            return -1;
+        }
+        fclose(file);
+        remove(classFile);
+    }
+    if(stat(classFile, &info)==0) return 0;
+    size_t lineSize=strlen(sourceFile)+strlen(dir)+(classPath ? strlen(classPath) : 0)+32;
+    char *line=malloc(lineSize);
+    if(!line) return -1;
+    if(classPath) snprintf(line, lineSize, "javac -cp \"%s\" -d \"%s\" \"%s\"", classPath, dir, sourceFile);
+    else snprintf(line, lineSize, "javac -d \"%s\" \"%s\"", dir, sourceFile);
+    LOG("Building %s in %s.", name, dir);
+    int status=spawnShell(line, NULL, NULL);
+    free(line);
+    return status==0 && stat(classFile, &info)==0 ? 0 : -1;
+}
+
+/**
+ * @brief Reads the port and token a running server published.
+ *
+ * @return int `0` if the port file exists and is complete.
+ */
+static int readPortFile(const char *path, unsigned *port, char *token, size_t size){
+    char line[256];
+    FILE *file=fopen(path, "r");
+    if(!file) return -1;
+    int ok=fgets(line, sizeof(line), file) && sscanf(line, "%u %63s", port, token)==2 && strlen(token)<size;
+    fclose(file);
+    return ok ? 0 : -1;
+}
+
+/**
+ * @brief Builds the compiler server with `javaHelperBuild()` and starts it
+ *        in the background.
+ *
+ * @return int `0` once the server published its port file, `-1` if it
+ *         could not be built or did not start in `JAVA_SERVER_START_MS`.
+ */
+static int startServer(const char *dir, const char *portFile){
+    char line[9000], helperDir[4096];
+    struct stat info;
+    if(javaHelperBuild("DevcliJavac", javaServerSource, NULL, helperDir, sizeof(helperDir))!=0) return -1;
+    remove(portFile);
+    #ifdef _WIN32
+        snprintf(line, sizeof(line), "start \"\" /B javaw -cp \"%s\" DevcliJavac \"%s\" %d", dir, portFile, JAVA_SERVER_IDLE_MINUTES);
+    #else
+        snprintf(line, sizeof(line), "java -cp \"%s\" DevcliJavac \"%s\" %d </dev/null >/dev/null 2>&1 &", dir, portFile, JAVA_SERVER_IDLE_MINUTES);
+    #endif
+    LOG("Starting the javac server; it exits after %d idle minutes.", JAVA_SERVER_IDLE_MINUTES);
+    if(spawnShell(line, NULL, NULL)!=0) return -1;
+    for(int waited=0; waited<JAVA_SERVER_START_MS; waited+=100){
+        if(stat(portFile, &info)==0) return 0;
+        #ifdef _WIN32
+            Sleep(100);
+        #else
+            usleep(100000);
+        #endif
+    }
+    return -1;
+}
+
+/**
+ * @brief Writes `path` to `out` as an absolute path, against `cwd`.
+ */
+static char *appendAbsolute(char *out, const char *path, size_t len, const char *cwd){
+    #ifdef _WIN32
+        int absolute=len>0 && (path[0]=='\\' || path[0]=='/' || (len>1 && path[1]==':'));
+    #else
+        int absolute=len>0 && path[0]=='/';
+    #endif
+    if(!absolute) out+=sprintf(out, "%s/", cwd);
+    memcpy(out, path, len);
+    return out+len;
+}
+
+/**
+ * @brief Sends one request to the compiler server on `port` and relays its
+ *        messages to stderr.
+ *
+ * @details Relative paths in the sources and in path options are made
+ *          absolute first, since the server runs in another directory.
+ *
+ * @return int `0` with javac's exit status in `*status`, `-1` if the server
+ *         could not be reached.
+ */
+static int compileOnServer(const JavacCommand *parsed, const char *compiled, unsigned port, const char *token, int *status){
+    char cwd[4096];
+    #ifdef _WIN32
+        const char separator=';';
+        if(!GetCurrentDirectoryA(sizeof(cwd), cwd)) return -1;
+    #else
+        const char separator=':';
+        if(!getcwd(cwd, sizeof(cwd))) return -1;
+    #endif
+    size_t len=256+strlen(token);
+    for(int i=1; i<parsed->optionCount; i++) len+=(strlen(parsed->options[i])+1)*(strlen(cwd)+2);
+    for(int i=0; i<parsed->sourceCount; i++) len+=compiled[i] ? strlen(parsed->sources[i])+strlen(cwd)+3 : 0;
+    char *request=malloc(len);
+    if(!request) return -1;
+    char *p=request+sprintf(request, "%s %s\n", JAVA_STATE_VERSION, token);
+    for(int i=1; i<parsed->optionCount; i++){
+        const char *word=parsed->options[i];
+        int kind=i>1 ? pathOption(parsed->options[i-1]) : 0;
+        if(kind==0){
+            p+=sprintf(p, "%s\n", word);
+            continue;
+        }
+        while(*word){
+            size_t part=kind==2 ? strcspn(word, (char[]){separator, '\0'}) : strlen(word);
+            p=appendAbsolute(p, word, part, cwd);
+            word+=part;
+            if(*word) *p++=*word++;
+        }
+        *p++='\n';
+    }
+    for(int i=0; i<parsed->sourceCount; i++){
+        if(!compiled[i]) continue;
+        p=appendAbsolute(p, parsed->sources[i], strlen(parsed->sources[i]), cwd);
+        *p++='\n';
+    }
+    *p++='\n';
+    #ifdef _WIN32
+        WSADATA data;
+        if(WSAStartup(MAKEWORD(2, 2), &data)!=0){
+            free(request);
+            return -1;
+        }
+    #endif
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family=AF_INET;
+    address.sin_port=htons((unsigned short)port);
+    address.sin_addr.s_addr=htonl(INADDR_LOOPBACK);
+    JavaSocket s=socket(AF_INET, SOCK_STREAM, 0);
+    int result=-1;
+    if(s!=JAVA_NO_SOCKET && connect(s, (struct sockaddr*)&address, sizeof(address))==0){
+        size_t sent=0, total=(size_t)(p-request);
+        while(sent<total){
+            int n=send(s, request+sent, (int)(total-sent), 0);
+            if(n<=0) break;
+            sent+=(size_t)n;
+        }
+        char buffer[65536];
+        int n, header=1;
+        char statusText[16];
+        size_t statusLen=0;
+        while(sent==total && (n=recv(s, buffer, sizeof(buffer), 0))>0){
+            int from=0;
+            while(header && from<n){
+                char c=buffer[from++];
+                if(c=='\n'){
+                    statusText[statusLen]='\0';
+                    *status=atoi(statusText);
+                    header=0;
+                    result=0;
+                }
+                else if(statusLen+1<sizeof(statusText)) statusText[statusLen++]=c;
+            }
+            if(from<n) fwrite(buffer+from, 1, (size_t)(n-from), stderr);
+        }
+        fflush(stderr);
+    }
+    if(s!=JAVA_NO_SOCKET) javaCloseSocket(s);
+    #ifdef _WIN32
+        WSACleanup();
+    #endif
+    free(request);
+    return result;
+}
+
+/**
+ * @brief Compiles on the compiler server, starting it when none is
+ *        running.
+ *
+ * @return int `0` with javac's status in `*status`, `-1` if no server could
+ *         be used and javac must run locally.
+ */
+static int compileWarm(const JavacCommand *parsed, const char *compiled, int *status){
+    char dir[4096], portFile[4200], token[64];
+    unsigned port;
+    if(parsed->launcherOptions || javaHelperDirectory(dir, sizeof(dir))!=0) return -1;
+    snprintf(portFile, sizeof(portFile), "%s/port", dir);
+    if(readPortFile(portFile, &port, token, sizeof(token))==0 && compileOnServer(parsed, compiled, port, token, status)==0) return 0;
+    if(startServer(dir, portFile)!=0 || readPortFile(portFile, &port, token, sizeof(token))!=0){
+        LOG_ERROR("The javac server did not start; compiling with javac.");
+        return -1;
+    }
+    return compileOnServer(parsed, compiled, port, token, status);
+}
+
+/**
+ * @brief Runs a javac command on the sources that changed since their last
+ *        successful compile, all in one javac run.
+ *
+ * @details For a javac command such as `build.java` (see `parseJavac()`),
+ *          wildcards such as `*.java` are expanded here, so entering `*` as
+ *          the name compiles every source of the directory in one batch on
+ *          every shell. Each source is hashed and compared with the hash
+ *          recorded in `.devcli_javac` in the output directory by the last
+ *          successful compile with the same options and `CLASSPATH`; a
+ *          source whose hash matches and whose class file exists is
+ *          skipped, and the rest go to a single javac run. If nothing
+ *          changed javac does not start at all. Classes of skipped sources
+ *          stay on the class path through the output directory, so a
+ *          changed source that uses them still compiles, as it would in an
+ *          IDE; a change to a class's signature does not recompile its
+ *          unchanged users, so after such an edit delete `.devcli_javac`.
+ *
+ *          With `DEVCLI_JAVAC_SERVER=1` the compile runs in a resident JVM
+ *          through `javax.tools` (`compileWarm()`), skipping JVM startup
+ *          and class loading; the server is built and started on first use
+ *          and falls back to a local javac when it cannot be reached.
+ *
+ * @ingroup javabuild
+ *
+ * @param command Command line after placeholder substitution.
+ * @param cpus CPU list for `spawnShell()`, or `NULL`.
+ * @param peakMemory Receives javac's peak memory in MiB; `0` for the server.
+ * @param status Receives javac's exit status, or `0` if nothing changed.
+ *
+ * @return int `0` if the command was run here, `-1` if it is not a plain
+ *         javac command and the caller must run it.
+ *
+ * Example usage:
+ * @code
+ * int status;
+ * if (javaBuildRun("javac -d out *.java", NULL, NULL, &status) != 0)
+ *     status = spawnShell("javac -d out *.java", NULL, NULL);
+ * @endcode
+ */
+int javaBuildRun(const char *command, const char *cpus, uint32_t *peakMemory, int *status){
+    JavacCommand parsed;
+    if(parseJavac(command, &parsed)!=0){
+        javacFree(&parsed);
+        return -1;
+    }
+    uint64_t options=optionsHash(&parsed);
+    JavaSourceState *old;
+    int oldCount=stateLoad(&parsed, options, &old);
+    uint64_t *hashes=calloc((size_t)parsed.sourceCount, sizeof(uint64_t));
+    char *compiled=calloc((size_t)parsed.sourceCount, 1);
+    if(!hashes || !compiled){
+        LOG_ERROR("Dynamic Memory allocation failed.");
+        free(hashes);
+        free(compiled);
+        stateFree(old, oldCount);
+        javacFree(&parsed);
+        return -1;
+    }
+    int count=0;
+    for(int i=0; i<parsed.sourceCount; i++){
+        size_t size;
+        char *text=readSource(parsed.sources[i], &size);
+        compiled[i]=1;
+        if(text){
+            hashes[i]=fingerprintBytes(FINGERPRINT_SEED, text, size)|1;
+            for(int j=0; j<oldCount && compiled[i]; j++){
+                if(old[j].hash==hashes[i] && strcmp(old[j].path, parsed.sources[i])==0 && classExists(&parsed, parsed.sources[i], text)) compiled[i]=0;
+            }
+            free(text);
+        }
+        count+=compiled[i];
+    }
+    if(peakMemory) *peakMemory=0;
+    *status=0;
+    if(count==0){
+        LOG("All %d Java sources are unchanged; skipping javac.", parsed.sourceCount);
+    }
+    else{
+        const char *server=getenv("DEVCLI_JAVAC_SERVER");
+        LOG("Compiling %d of %d Java sources in one javac run.", count, parsed.sourceCount);
+        completeClassPath(&parsed, compiled);
+        if(!(server && strcmp(server, "1")==0 && compileWarm(&parsed, compiled, status)==0)) *status=compileLocal(&parsed, compiled, count, cpus, peakMemory);
+        stateSave(&parsed, options, old, oldCount, hashes, compiled, *status==0);
+    }
+    free(hashes);
+    free(compiled);
+    stateFree(old, oldCount);
+    javacFree(&parsed);
+    return 0;
+}
+
+/** @} */ // end of javabuild group
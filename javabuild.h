@@ -0,0 +1,42 @@
+/**
+ * @file javabuild.h
+ * @brief Compiles the changed sources of a javac command in one batch, optionally on a warm compiler server.
+ */
+
+#ifndef DEVCLI_JAVABUILD_H
+#define DEVCLI_JAVABUILD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @defgroup javabuild Java Builds
+ *  @brief Incremental, batched javac runs and the resident `javax.tools` compiler server.
+ *  @{
+ */
+
+/**
+ * @def JAVA_STATE_NAME
+ * @brief File, in the class output directory, holding the hash of every
+ *        source compiled there.
+ */
+#define JAVA_STATE_NAME ".devcli_javac"
+
+/**
+ * @def JAVA_MAX_SOURCES
+ * @brief Most sources one javac command may name after wildcards are expanded.
+ */
+#define JAVA_MAX_SOURCES 4096
+
+/**
+ * @def JAVA_SERVER_IDLE_MINUTES
+ * @brief Minutes the compiler server waits for a request before it exits.
+ */
+#define JAVA_SERVER_IDLE_MINUTES 30
+
+int javaBuildRun(const char *command, const char *cpus, uint32_t *peakMemory, int *status);
+int javaHelperDirectory(char *out, size_t size);
+int javaHelperBuild(const char *name, const char *source, const char *classPath, char *dir, size_t size);
+
+/** @} */ // end of javabuild group
+
+#endif /* DEVCLI_JAVABUILD_H */
@@ -0,0 +1,548 @@
+/**
+ * @file javatest.c
+ * @brief Spreads the test classes of a JUnitCore command over reused runner JVMs fed through pipes.
+ */
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <dirent.h>
+#include <pthread.h>
+#endif
+#include "javatest.h"
+#include "devcli.h"
+#include "javabuild.h"
+#include "jobserver.h"
+#include "spawn.h"
+#include "tape.h"
+#include "log.h"
+
+/** @addtogroup javatest
+ *  @{
+ */
+
+/**
+ * @def JUNIT_MAIN
+ * @brief Main class of the commands handled here.
+ */
+#define JUNIT_MAIN "org.junit.runner.JUnitCore"
+
+/**
+ * @brief Source of the runner JVM.
+ *
+ * @details It reads one class name per line from its standard input, runs
+ *          it with its own `JUnitCore`, and answers on its standard output
+ *          with `DONE <class> <run> <failed> <ignored> <ms>`. Whatever the
+ *          tests print goes to standard error, so it cannot be mistaken
+ *          for an answer. A class that cannot be loaded, or whose run
+ *          throws, counts as one failure and the runner goes on with the
+ *          next class.
+ */
+static const char junitRunnerSource[]=
+    "import java.io.*;\n"
+    "import org.junit.runner.JUnitCore;\n"
+    "import org.junit.runner.Result;\n"
+    "import org.junit.runner.notification.Failure;\n"
+    "\n"
+    "public class DevcliJUnitRunner {\n"
+    "    public static void main(String[] args) throws IOException {\n"
+    "        PrintStream answers = new PrintStream(new FileOutputStream(FileDescriptor.out), true, \"UTF-8\");\n"
+    "        System.setOut(System.err);\n"
+    "        BufferedReader requests = new BufferedReader(new InputStreamReader(System.in, \"UTF-8\"));\n"
+    "        answers.println(\"READY\");\n"
+    "        for (String name; (name = requests.readLine()) != null; ) {\n"
+    "            name = name.trim();\n"
+    "            if (name.isEmpty()) continue;\n"
+    "            long start = System.nanoTime();\n"
+    "            int run = 0, failed = 1, ignored = 0;\n"
+    "            try {\n"
+    "                Result result = new JUnitCore().run(Class.forName(name, false, DevcliJUnitRunner.class.getClassLoader()));\n"
+    "                for (Failure failure : result.getFailures()) {\n"
+    "                    System.err.println(name + \": \" + failure.getTestHeader());\n"
+    "                    System.err.println(failure.getTrace());\n"
+    "                }\n"
+    "                run = result.getRunCount();\n"
+    "                failed = result.getFailureCount();\n"
+    "                ignored = result.getIgnoreCount();\n"
+    "            } catch (Throwable t) {\n"
+    "                System.err.println(name + \": could not run\");\n"
+    "                t.printStackTrace();\n"
+    "            }\n"
+    "            System.err.flush();\n"
+    "            answers.println(\"DONE \" + name + \" \" + run + \" \" + failed + \" \" + ignored + \" \" + (System.nanoTime() - start) / 1000000);\n"
+    "        }\n"
+    "    }\n"
+    "}\n";
+
+/**
+ * @brief A JUnitCore command split into its launcher options and its classes.
+ */
+typedef struct {
+    char *copy;                 /**< The command, cut into words in place. */
+    char **options;             /**< `java` first, then every launcher option except the class path. */
+    int optionCount;
+    const char *classPath;      /**< `-cp` value, or `NULL`. */
+    char **classes;             /**< Test classes, wildcards expanded; each allocated. */
+    int classCount;
+} JunitCommand;
+
+/**
+ * @brief What happened to one test class.
+ */
+typedef enum {
+    JUNIT_PENDING = 0,
+    JUNIT_PASSED,
+    JUNIT_FAILED,
+    JUNIT_CRASHED       /**< Its runner JVM exited before answering. */
+} JunitState;
+
+typedef struct {
+    JunitState state;
+    int run, failed, ignored;
+    long millis;
+} JunitResult;
+
+/**
+ * @brief The classes of one command and the runners working through them.
+ */
+typedef struct {
+    const JunitCommand *parsed;
+    char *runnerCommand;        /**< Command line that starts one runner JVM. */
+    JunitResult *results;       /**< One per class. */
+    atomic_int next;            /**< Next class to hand out. */
+} JunitPool;
+
+/**
+ * @brief One thread of the pool, feeding classes to its own runner JVM.
+ */
+typedef struct {
+    JunitPool *pool;
+    uint32_t peakMemory;        /**< Largest peak of the runners it started, in MiB. */
+} JunitFeeder;
+
+/**
+ * @brief Returns `1` if `name` matches `pattern`, where `*` matches any run
+ *        of characters and `?` any one character.
+ */
+static int wildcardMatch(const char *pattern, const char *name){
+    if(*pattern=='\0') return *name=='\0';
+    if(*pattern=='*') return wildcardMatch(pattern+1, name) || (*name && wildcardMatch(pattern, name+1));
+    return *name && (*pattern=='?' || *pattern==*name) && wildcardMatch(pattern+1, name+1);
+}
+
+static int compareNames(const void *a, const void *b){
+    return strcmp(*(char *const*)a, *(char *const*)b);
+}
+
+/**
+ * @brief Appends a copy of `name` to the classes unless it is there already.
+ *
+ * @return int `0` on success, `-1` past `JUNIT_MAX_CLASSES` or out of memory.
+ */
+static int addClass(JunitCommand *parsed, const char *name){
+    for(int i=0; i<parsed->classCount; i++){
+        if(strcmp(parsed->classes[i], name)==0) return 0;
+    }
+    if(parsed->classCount==JUNIT_MAX_CLASSES) return -1;
+    char *copy=strdup(name);
+    if(!copy) return -1;
+    parsed->classes[parsed->classCount++]=copy;
+    return 0;
+}
+
+/**
+ * @brief Adds the classes in one class path directory whose simple name
+ *        matches `pattern`, skipping nested classes.
+ */
+static int addMatches(JunitCommand *parsed, const char *dir, const char *package, size_t packageLen, const char *pattern){
+    char path[4096], name[1024];
+    int n=snprintf(path, sizeof(path), "%s/%.*s", dir, (int)packageLen, package);
+    if(n<0 || (size_t)n>=sizeof(path)) return 0;
+    for(char *p=path+strlen(dir)+1; *p; p++){
+        if(*p=='.') *p='/';
+    }
+    int result=0;
+    #ifdef _WIN32
+        char search[4200];
+        snprintf(search, sizeof(search), "%s\\*.class", path);
+        WIN32_FIND_DATAA found;
+        HANDLE find=FindFirstFileA(search, &found);
+        if(find==INVALID_HANDLE_VALUE) return 0;
+        do{
+            const char *file=found.cFileName;
+    #else
+        DIR *listing=opendir(path);
+        if(!listing) return 0;
+        const struct dirent *entry;
+        while((entry=readdir(listing))){
+            const char *file=entry->d_name;
+    #endif
+            size_t len=strlen(file);
+            if(result==0 && len>6 && strcmp(file+len-6, ".class")==0 && !strchr(file, '$') && len-6<sizeof(name)){
+                snprintf(name, sizeof(name), "%.*s", (int)(len-6), file);
+                if(wildcardMatch(pattern, name)){
+                    char full[2048];
+                    snprintf(full, sizeof(full), "%.*s%s%s", (int)packageLen, package, packageLen ? "." : "", name);
+                    result=addClass(parsed, full);
+                }
+            }
+    #ifdef _WIN32
+        }while(FindNextFileA(find, &found));
+        FindClose(find);
+    #else
+        }
+        closedir(listing);
+    #endif
+    return result;
+}
+
+/**
+ * @brief Adds the classes a word names: itself, or every class whose
+ *        simple name matches its wildcard, such as `*Test` or
+ *        `com.example.*Test`, in the directories of the class path.
+ *
+ * @details Jars on the class path are not searched, so wildcards find the
+ *          classes of the project being built rather than of libraries.
+ *
+ * @return int `0` on success, `-1` if a wildcard matches nothing.
+ */
+static int expandClass(JunitCommand *parsed, const char *word){
+    const char *dot=strrchr(word, '.');
+    const char *simple=dot ? dot+1 : word;
+    if(!strpbrk(simple, "*?")) return addClass(parsed, word);
+    if(strpbrk(word, "*?")<simple) return -1;
+    #ifdef _WIN32
+        const char separator=';';
+    #else
+        const char separator=':';
+    #endif
+    const char *classPath=parsed->classPath ? parsed->classPath : getenv("CLASSPATH");
+    if(!classPath || !*classPath) classPath=".";
+    int before=parsed->classCount;
+    struct stat info;
+    char dir[4096];
+    while(*classPath){
+        size_t len=strcspn(classPath, (char[]){separator, '\0'});
+        snprintf(dir, sizeof(dir), "%.*s", (int)len, len ? classPath : ".");
+        if(stat(dir, &info)==0 && (info.st_mode&S_IFDIR) && addMatches(parsed, dir, word, dot ? (size_t)(dot-word) : 0, simple)!=0) return -1;
+        classPath+=len;
+        if(*classPath) classPath++;
+    }
+    if(parsed->classCount==before) return -1;
+    qsort(parsed->classes+before, (size_t)(parsed->classCount-before), sizeof(char*), compareNames);
+    return 0;
+}
+
+/**
+ * @brief Splits a `java ... org.junit.runner.JUnitCore <classes>` command.
+ *
+ * @details Only plain JUnit 4 runs are taken: shell syntax other than
+ *          double quotes, `-jar` and module launches, and JUnitCore options
+ *          such as `--filter` are left to the shell.
+ *
+ * @return int `0` if `command` is such a run, `-1` otherwise.
+ */
+static int parseJunit(const char *command, JunitCommand *parsed){
+    memset(parsed, 0, sizeof(*parsed));
+    #ifdef _WIN32
+        const char *special=";&|<>$`%^@";
+    #else
+        const char *special=";&|<>$`'\\@";
+    #endif
+    if(command[strcspn(command, special)] || strchr(command, '\n')) return -1;
+    size_t len=strlen(command);
+    parsed->copy=strdup(command);
+    parsed->options=malloc((len/2+2)*sizeof(char*));
+    parsed->classes=malloc(JUNIT_MAX_CLASSES*sizeof(char*));
+    if(!parsed->copy || !parsed->options || !parsed->classes) return -1;
+    static const char *const valued[]={"-p", "--module-path", "--upgrade-module-path", "--add-modules",
+        "--add-opens", "--add-exports", "--add-reads", "--patch-module", "--limit-modules"};
+    // Options are kept in the word array itself; there are never more of
+    // them than words already looked at.
+    int count=splitCommandWords(parsed->copy, parsed->options, (int)(len/2+2));
+    if(count<0) return -1;
+    int mainSeen=0, classPathNext=0, valueNext=0;
+    for(int w=0; w<count; w++){
+        char *word=parsed->options[w];
+        if(parsed->optionCount==0){
+            const char *base=word;
+            for(const char *p=word; *p; p++){
+                if(*p=='/' || *p=='\\') base=p+1;
+            }
+            if(strcmp(base, "java")!=0 && strcmp(base, "java.exe")!=0) return -1;
+            parsed->options[parsed->optionCount++]=word;
+        }
+        else if(classPathNext){
+            parsed->classPath=word;
+            classPathNext=0;
+        }
+        else if(valueNext){
+            parsed->options[parsed->optionCount++]=word;
+            valueNext=0;
+        }
+        else if(mainSeen){
+            if(word[0]=='-' || expandClass(parsed, word)!=0) return -1;
+        }
+        else if(strcmp(word, JUNIT_MAIN)==0) mainSeen=1;
+        else if(strcmp(word, "-cp")==0 || strcmp(word, "-classpath")==0 || strcmp(word, "--class-path")==0) classPathNext=1;
+        else if(word[0]!='-' || strcmp(word, "-jar")==0 || strcmp(word, "-m")==0 || strcmp(word, "--module")==0 || strcmp(word, "--source")==0) return -1;
+        else{
+            for(size_t i=0; i<sizeof(valued)/sizeof(valued[0]); i++){
+                if(strcmp(word, valued[i])==0) valueNext=1;
+            }
+            parsed->options[parsed->optionCount++]=word;
+        }
+    }
+    return mainSeen && parsed->classCount>0 ? 0 : -1;
+}
+
+static void junitFree(JunitCommand *parsed){
+    for(int i=0; i<parsed->classCount; i++) free(parsed->classes[i]);
+    free(parsed->classes);
+    free(parsed->options);
+    free(parsed->copy);
+}
+
+/**
+ * @brief Builds the runner against the command's class path and the line
+ *        that starts one runner JVM with the command's launcher options.
+ *
+ * @return char* The command line, or `NULL` if the runner could not be
+ *         built, for instance because JUnit is not on the class path.
+ */
+static char *runnerCommand(const JunitCommand *parsed){
+    #ifdef _WIN32
+        const char separator=';';
+    #else
+        const char separator=':';
+    #endif
+    char dir[4096];
+    const char *classPath=parsed->classPath ? parsed->classPath : getenv("CLASSPATH");
+    if(!classPath || !*classPath) classPath=".";
+    if(javaHelperBuild("DevcliJUnitRunner", junitRunnerSource, classPath, dir, sizeof(dir))!=0) return NULL;
+    size_t len=strlen(classPath)+strlen(dir)+64;
+    for(int i=0; i<parsed->optionCount; i++) len+=strlen(parsed->options[i])+3;
+    char *line=malloc(len);
+    if(!line) return NULL;
+    char *p=line;
+    for(int i=0; i<parsed->optionCount; i++) p+=sprintf(p, strchr(parsed->options[i], ' ') ? "\"%s\" " : "%s ", parsed->options[i]);
+    sprintf(p, "-cp \"%s%c%s\" DevcliJUnitRunner", classPath, separator, dir);
+    return line;
+}
+
+/**
+ * @brief Starts a runner JVM and waits until it is ready for classes.
+ *
+ * @return SpawnPipe* The runner, or `NULL` if it exited first.
+ */
+static SpawnPipe *startRunner(JunitFeeder *feeder){
+    char line[256];
+    SpawnPipe *child=spawnPiped(feeder->pool->runnerCommand);
+    if(!child) return NULL;
+    while(spawnPipeReadLine(child, line, sizeof(line))==0){
+        if(strcmp(line, "READY")==0) return child;
+    }
+    uint32_t peak=0;
+    spawnPipeClose(child, &peak);
+    if(peak>feeder->peakMemory) feeder->peakMemory=peak;
+    return NULL;
+}
+
+/**
+ * @brief Hands classes to one runner JVM until none is left.
+ *
+ * @details Each class runs on its own in the runner, so a failing class
+ *          does not affect the others. A class whose runner exits before
+ *          answering, for instance through `System.exit()` or running out
+ *          of memory, is reported as crashed and the next class gets a
+ *          fresh runner.
+ */
+static void feedRunner(JunitFeeder *feeder){
+    JunitPool *pool=feeder->pool;
+    const JunitCommand *parsed=pool->parsed;
+    SpawnPipe *child=NULL;
+    char request[2048], answer[2400];
+    for(int i=atomic_fetch_add(&pool->next, 1); i<parsed->classCount; i=atomic_fetch_add(&pool->next, 1)){
+        const char *name=parsed->classes[i];
+        JunitResult *result=&pool->results[i];
+        if(!child) child=startRunner(feeder);
+        int answered=0;
+        snprintf(request, sizeof(request), "%s\n", name);
+        size_t nameLen=strlen(name);
+        if(child && spawnPipeWrite(child, request)==0){
+            while(!answered && spawnPipeReadLine(child, answer, sizeof(answer))==0){
+                answered=strncmp(answer, "DONE ", 5)==0 && strncmp(answer+5, name, nameLen)==0 && answer[5+nameLen]==' '
+                    && sscanf(answer+6+nameLen, "%d %d %d %ld", &result->run, &result->failed, &result->ignored, &result->millis)==4;
+            }
+        }
+        if(answered){
+            result->state=result->failed>0 ? JUNIT_FAILED : JUNIT_PASSED;
+            if(result->failed>0) LOG_ERROR("FAIL %s: %d of %d tests failed (%ld ms)", name, result->failed, result->run, result->millis);
+            else LOG("PASS %s: %d tests, %d ignored (%ld ms)", name, result->run, result->ignored, result->millis);
+            continue;
+        }
+        result->state=JUNIT_CRASHED;
+        if(child){
+            uint32_t peak=0;
+            int status=spawnPipeClose(child, &peak);
+            if(peak>feeder->peakMemory) feeder->peakMemory=peak;
+            child=NULL;
+            LOG_ERROR("CRASH %s: its runner JVM exited with status %d; the next class gets a new one.", name, status);
+        }
+        else LOG_ERROR("CRASH %s: no runner JVM could be started.", name);
+    }
+    if(child){
+        uint32_t peak=0;
+        spawnPipeClose(child, &peak);
+        if(peak>feeder->peakMemory) feeder->peakMemory=peak;
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI feederThread(LPVOID arg)
+#else
+static void *feederThread(void *arg)
+#endif
+{
+    feedRunner(arg);
+    return 0;
+}
+
+/**
+ * @brief Returns how many runner JVMs to start: `DEVCLI_JUNIT_RUNNERS`, or
+ *        one per two processors, since a JVM runs several threads of its
+ *        own; `0` turns runners off.
+ */
+static int runnerCount(int classes){
+    const char *setting=getenv("DEVCLI_JUNIT_RUNNERS");
+    int runners=setting && *setting ? atoi(setting) : tapeHardwareThreads()/2;
+    if(setting && *setting && runners<=0) return 0;
+    if(runners<1) runners=1;
+    if(runners>JUNIT_MAX_RUNNERS) runners=JUNIT_MAX_RUNNERS;
+    return runners<classes ? runners : classes;
+}
+
+/**
+ * @brief Runs the test classes of a JUnitCore command in a pool of reused
+ *        runner JVMs.
+ *
+ * @details For a command such as `test.java` with several classes, or a
+ *          wildcard such as `*Test` (see `parseJunit()`; entering `*` as
+ *          the name runs every test class of the class path's
+ *          directories), the runner is built once with `javaHelperBuild()`
+ *          against the command's class path. Up to `runnerCount()` runner
+ *          JVMs then start: the first on the task's jobserver token, each
+ *          other one only with a token of its own
+ *          (`jobserverAcquireExtra()`), so `-j` and the scheduler's limits
+ *          hold. Each is fed one class at a time over a pipe, so
+ *          JVM startup and JUnit's class loading are paid once per runner
+ *          rather than once per class. Each class gets its own `PASS`,
+ *          `FAIL` or `CRASH` line and a summary follows.
+ *
+ *          Classes of one runner share its JVM, so static state one class
+ *          leaves behind is seen by later ones; set
+ *          `DEVCLI_JUNIT_RUNNERS=0` to run the command unchanged when that
+ *          matters. A single class, a task pinned to CPUs, and commands
+ *          the runner cannot be built for also run unchanged.
+ *
+ * @ingroup javatest
+ *
+ * @param command Command line after placeholder substitution.
+ * @param cpus CPU list of the entry; runners cannot be pinned, so a list
+ *        makes the command run unchanged.
+ * @param peakMemory Receives the peaks of the runners running at once,
+ *        added up, in MiB.
+ * @param status Receives `0` if every class passed, `1` otherwise.
+ *
+ * @return int `0` if the classes were run here, `-1` if the caller must
+ *         run the command.
+ *
+ * Example usage:
+ * @code
+ * int status;
+ * if (javaTestRun("java org.junit.runner.JUnitCore *Test", NULL, NULL, &status) != 0)
+ *     status = spawnShell("java org.junit.runner.JUnitCore FooTest", NULL, NULL);
+ * @endcode
+ */
+int javaTestRun(const char *command, const char *cpus, uint32_t *peakMemory, int *status){
+    JunitCommand parsed;
+    int runners;
+    if(cpus) return -1;
+    if(parseJunit(command, &parsed)!=0 || parsed.classCount<2 || (runners=runnerCount(parsed.classCount))==0){
+        junitFree(&parsed);
+        return -1;
+    }
+    JunitPool pool;
+    memset(&pool, 0, sizeof(pool));
+    pool.parsed=&parsed;
+    pool.runnerCommand=runnerCommand(&parsed);
+    pool.results=calloc((size_t)parsed.classCount, sizeof(JunitResult));
+    if(!pool.runnerCommand || !pool.results){
+        free(pool.runnerCommand);
+        free(pool.results);
+        junitFree(&parsed);
+        return -1;
+    }
+    atomic_init(&pool.next, 0);
+    Jobserver jobserver;
+    int tokens[JUNIT_MAX_RUNNERS];
+    int acquired=jobserverAcquireExtra(&jobserver, tokens, runners-1);
+    if(acquired<runners-1) LOG("%d jobserver token(s) free; starting %d runner JVM(s) instead of %d.", acquired, acquired+1, runners);
+    runners=acquired+1;
+    LOG("Running %d test classes in %d runner JVM(s).", parsed.classCount, runners);
+    JunitFeeder feeders[JUNIT_MAX_RUNNERS];
+    for(int t=0; t<runners; t++){
+        feeders[t].pool=&pool;
+        feeders[t].peakMemory=0;
+    }
+    #ifdef _WIN32
+        HANDLE handles[JUNIT_MAX_RUNNERS];
+        for(int t=1; t<runners; t++) handles[t]=CreateThread(NULL, 0, feederThread, &feeders[t], 0, NULL);
+        feedRunner(&feeders[0]);
+        for(int t=1; t<runners; t++){
+            if(handles[t]){
+                WaitForSingleObject(handles[t], INFINITE);
+                CloseHandle(handles[t]);
+            }
+        }
+    #else
+        pthread_t handles[JUNIT_MAX_RUNNERS];
+        int started[JUNIT_MAX_RUNNERS];
+        for(int t=1; t<runners; t++) started[t]=pthread_create(&handles[t], NULL, feederThread, &feeders[t])==0;
+        feedRunner(&feeders[0]);
+        for(int t=1; t<runners; t++){
+            if(started[t]) pthread_join(handles[t], NULL);
+        }
+    #endif
+    jobserverReleaseExtra(&jobserver, tokens, acquired);
+    int tests=0, failures=0, ignored=0, failedClasses=0;
+    uint32_t peak=0;
+    for(int t=0; t<runners; t++) peak+=feeders[t].peakMemory;
+    for(int i=0; i<parsed.classCount; i++){
+        tests+=pool.results[i].run;
+        failures+=pool.results[i].failed;
+        ignored+=pool.results[i].ignored;
+        if(pool.results[i].state!=JUNIT_PASSED) failedClasses++;
+    }
+    if(failedClasses>0){
+        LOG_ERROR("%d of %d test classes failed: %d tests, %d failures, %d ignored.", failedClasses, parsed.classCount, tests, failures, ignored);
+        for(int i=0; i<parsed.classCount; i++){
+            if(pool.results[i].state!=JUNIT_PASSED) LOG_ERROR("  %s%s", parsed.classes[i], pool.results[i].state==JUNIT_CRASHED ? " (crashed)" : "");
+        }
+    }
+    else LOG("All %d test classes passed: %d tests, %d ignored.", parsed.classCount, tests, ignored);
+    if(peakMemory) *peakMemory=peak;
+    *status=failedClasses>0 ? 1 : 0;
+    free(pool.runnerCommand);
+    free(pool.results);
+    junitFree(&parsed);
+    return 0;
+}
+
+/** @} */ // end of javatest group
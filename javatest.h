@@ -0,0 +1,32 @@
+/**
+ * @file javatest.h
+ * @brief Runs the classes of a JUnit command in a few long-lived runner JVMs.
+ */
+
+#ifndef DEVCLI_JAVATEST_H
+#define DEVCLI_JAVATEST_H
+
+#include <stdint.h>
+
+/** @defgroup javatest Java Test Runners
+ *  @brief JUnit 4 test classes fed over a pipe to reused JVMs, with a result per class.
+ *  @{
+ */
+
+/**
+ * @def JUNIT_MAX_CLASSES
+ * @brief Most test classes one command may name after wildcards are expanded.
+ */
+#define JUNIT_MAX_CLASSES 4096
+
+/**
+ * @def JUNIT_MAX_RUNNERS
+ * @brief Most runner JVMs one command starts at once.
+ */
+#define JUNIT_MAX_RUNNERS 32
+
+int javaTestRun(const char *command, const char *cpus, uint32_t *peakMemory, int *status);
+
+/** @} */ // end of javatest group
+
+#endif /* DEVCLI_JAVATEST_H */
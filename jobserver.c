@@ -0,0 +1,521 @@
+/**
+ * @file jobserver.c
+ * @brief Creates, joins and hands out tokens of a GNU make jobserver.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+#include "jobserver.h"
+#include "log.h"
+
+/** @addtogroup jobserver
+ *  @{
+ */
+
+/**
+ * @def JOBSERVER_TOKEN_BYTE
+ * @brief Byte written for each token of a pool devcli creates, as GNU make does.
+ */
+#define JOBSERVER_TOKEN_BYTE '+'
+
+/**
+ * @brief Returns the value of the last `--jobserver-auth=` (or the older
+ *        `--jobserver-fds=`) option in `flags`, copied into `out`.
+ *
+ * @return int `0` if one was found.
+ */
+static int jobserverAuth(const char *flags, char *out, size_t size){
+    static const char *const options[]={"--jobserver-auth=", "--jobserver-fds="};
+    const char *found=NULL;
+    for(size_t i=0; i<sizeof(options)/sizeof(options[0]); i++){
+        for(const char *p=strstr(flags, options[i]); p; p=strstr(p+1, options[i])){
+            if(!found || p>found) found=p+strlen(options[i]);
+        }
+    }
+    if(!found) return -1;
+    size_t len=strcspn(found, " ");
+    if(len==0 || len>=size) return -1;
+    memcpy(out, found, len);
+    out[len]='\0';
+    return 0;
+}
+
+/**
+ * @brief Sets `MAKEFLAGS` to `value`, or removes it for `NULL`.
+ */
+static void setMakeflags(const char *value){
+    #ifdef _WIN32
+        _putenv_s("MAKEFLAGS", value ? value : "");
+    #else
+        if(value) setenv("MAKEFLAGS", value, 1);
+        else unsetenv("MAKEFLAGS");
+    #endif
+}
+
+/**
+ * @brief Advertises the pool to children: `-jN --jobserver-auth=<auth>`
+ *        after whatever `MAKEFLAGS` already held, so it takes precedence.
+ */
+static int exportJobserver(Jobserver *js, int jobs, const char *auth){
+    size_t len=(js->savedFlags ? strlen(js->savedFlags) : 0)+strlen(auth)+48;
+    char *flags=malloc(len);
+    if(!flags) return -1;
+    snprintf(flags, len, "%s%s-j%d --jobserver-auth=%s", js->savedFlags ? js->savedFlags : "", js->savedFlags && js->savedFlags[0] ? " " : "", jobs, auth);
+    setMakeflags(flags);
+    free(flags);
+    return 0;
+}
+
+#ifdef _WIN32
+
+static int joinJobserver(Jobserver *js, const char *auth){
+    js->semaphore=OpenSemaphoreA(SEMAPHORE_ALL_ACCESS, FALSE, auth);
+    return js->semaphore ? 0 : -1;
+}
+
+static int createJobserver(Jobserver *js, int jobs){
+    char name[64];
+    snprintf(name, sizeof(name), "devcli_jobserver_%lu", (unsigned long)GetCurrentProcessId());
+    js->semaphore=CreateSemaphoreA(NULL, jobs-1, jobs>1 ? jobs-1 : 1, name);
+    if(!js->semaphore) return -1;
+    return exportJobserver(js, jobs, name);
+}
+
+#else
+
+/**
+ * @brief Opens `fd`'s pipe again, non-blocking and close-on-exec.
+ *
+ * @details Making the inherited descriptor itself non-blocking would change
+ *          it for the parent make as well, so a new open file description is
+ *          made through `/proc` instead.
+ */
+static int reopenNonBlocking(int fd){
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+    return open(path, O_RDONLY|O_NONBLOCK|O_CLOEXEC);
+}
+
+/**
+ * @brief Uses the jobserver of the make that started devcli.
+ *
+ * @details Understands both forms GNU make passes down: `fifo:PATH` (make
+ *          4.4) and `R,W` descriptor numbers. Descriptors that make closed
+ *          because the recipe was not marked recursive are detected and the
+ *          jobserver is not joined.
+ *
+ * @return int `0` on success.
+ */
+static int joinJobserver(Jobserver *js, const char *auth){
+    if(strncmp(auth, "fifo:", 5)==0){
+        js->readFd=open(auth+5, O_RDONLY|O_NONBLOCK|O_CLOEXEC);
+        js->writeFd=js->readFd>=0 ? open(auth+5, O_WRONLY|O_CLOEXEC) : -1;
+        return js->writeFd>=0 ? 0 : -1;
+    }
+    int readFd, writeFd;
+    if(sscanf(auth, "%d,%d", &readFd, &writeFd)!=2 || readFd<0 || writeFd<0) return -1;
+    if(fcntl(readFd, F_GETFD)==-1 || fcntl(writeFd, F_GETFD)==-1) return -1;
+    js->readFd=reopenNonBlocking(readFd);
+    js->writeFd=js->readFd>=0 ? fcntl(writeFd, F_DUPFD_CLOEXEC, 0) : -1;
+    return js->writeFd>=0 ? 0 : -1;
+}
+
+/**
+ * @brief Creates a pool of `jobs - 1` tokens.
+ *
+ * @details The pool is a FIFO that is unlinked as soon as it is open. devcli
+ *          reads it through its own non-blocking descriptor, while children
+ *          inherit ordinary blocking ones and see them as `--jobserver-auth=R,W`,
+ *          which every GNU make since 4.2 and ninja understand.
+ *
+ * @return int `0` on success.
+ */
+static int createJobserver(Jobserver *js, int jobs){
+    const char *directory=getenv("TMPDIR");
+    char path[512];
+    snprintf(path, sizeof(path), "%s/devcli-jobserver.%ld", directory && directory[0] ? directory : "/tmp", (long)getpid());
+    unlink(path);
+    if(mkfifo(path, 0600)!=0) return -1;
+    js->readFd=open(path, O_RDONLY|O_NONBLOCK|O_CLOEXEC);
+    js->writeFd=js->readFd>=0 ? open(path, O_WRONLY) : -1;
+    js->childReadFd=js->writeFd>=0 ? open(path, O_RDONLY) : -1;
+    unlink(path);
+    if(js->childReadFd<0) return -1;
+    char tokens[1024];
+    memset(tokens, JOBSERVER_TOKEN_BYTE, sizeof(tokens));
+    for(int left=jobs-1; left>0; ){
+        int chunk=left<(int)sizeof(tokens) ? left : (int)sizeof(tokens);
+        ssize_t written=write(js->writeFd, tokens, (size_t)chunk);
+        if(written<=0) return -1;
+        left-=(int)written;
+    }
+    char auth[32];
+    snprintf(auth, sizeof(auth), "%d,%d", js->childReadFd, js->writeFd);
+    return exportJobserver(js, jobs, auth);
+}
+
+#endif
+
+/**
+ * @brief Clears `js` and creates the pipe or event that wakes its waiter.
+ *
+ * @return int `0` on success.
+ */
+static int jobserverInit(Jobserver *js){
+    memset(js, 0, sizeof(*js));
+    js->implicitFree=1;
+    const char *flags=getenv("MAKEFLAGS");
+    js->savedFlags=flags ? strdup(flags) : NULL;
+    #ifdef _WIN32
+        js->wake=CreateEventA(NULL, FALSE, FALSE, NULL);
+        if(!js->wake) return -1;
+    #else
+        js->readFd=js->writeFd=js->childReadFd=-1;
+        js->wakeFds[0]=js->wakeFds[1]=-1;
+        if(pipe(js->wakeFds)!=0) return -1;
+        for(int i=0; i<2; i++){
+            fcntl(js->wakeFds[i], F_SETFD, FD_CLOEXEC);
+            fcntl(js->wakeFds[i], F_SETFL, O_NONBLOCK);
+        }
+    #endif
+    return 0;
+}
+
+/**
+ * @brief Sets up the jobserver for a run of up to `jobs` tasks.
+ *
+ * @details If devcli was started by a make that runs a jobserver (its
+ *          `MAKEFLAGS` carries `--jobserver-auth`), devcli joins it and its
+ *          tasks draw from that budget. Otherwise it creates a pool of
+ *          `jobs - 1` tokens and exports it through `MAKEFLAGS`, so a `make`,
+ *          `ninja` or `cmake --build` started by any task takes its extra
+ *          jobs from the same pool instead of assuming it has every core:
+ *          the build of one task may use all `jobs` while nothing else runs,
+ *          and shrinks when other tasks start. If neither works, the run goes
+ *          ahead without a jobserver.
+ *
+ * @ingroup jobserver
+ *
+ * @param js Receives the jobserver; release with `jobserverClose()`.
+ * @param jobs Size of the pool, counting the implicit token.
+ *
+ * @return int `0` if a jobserver is active, `-1` otherwise.
+ *
+ * Example usage:
+ * @code
+ * Jobserver js;
+ * jobserverOpen(&js, 8);
+ * int token = jobserverTryAcquire(&js);
+ * if (token != JOBSERVER_NONE) {
+ *     system("make");     // may use up to 7 more tokens
+ *     jobserverRelease(&js, token);
+ * }
+ * jobserverClose(&js);
+ * @endcode
+ */
+int jobserverOpen(Jobserver *js, int jobs){
+    if(jobserverInit(js)!=0) return -1;
+    const char *flags=js->savedFlags;
+    char auth[256];
+    if(flags && jobserverAuth(flags, auth, sizeof(auth))==0){
+        if(joinJobserver(js, auth)==0){
+            js->active=1;
+            LOG("Sharing the jobserver of the parent make (%s).", auth);
+            return 0;
+        }
+        LOG("The parent make's jobserver (%s) is not available; using a new one.", auth);
+        #ifdef _WIN32
+            if(js->semaphore) CloseHandle(js->semaphore);
+            js->semaphore=NULL;
+        #else
+            if(js->readFd>=0) close(js->readFd);
+            if(js->writeFd>=0) close(js->writeFd);
+            js->readFd=js->writeFd=-1;
+        #endif
+    }
+    if(jobs<1) jobs=1;
+    if(createJobserver(js, jobs)!=0){
+        LOG_ERROR("Could not create a jobserver; nested builds choose their own parallelism.");
+        jobserverClose(js);
+        return -1;
+    }
+    js->active=1;
+    js->owned=1;
+    js->tokens=jobs-1;
+    return 0;
+}
+
+/**
+ * @brief Joins the jobserver that `MAKEFLAGS` advertises, without creating
+ *        one or changing `MAKEFLAGS`.
+ *
+ * @details For a task that splits its own work over several processes,
+ *          such as a sharded test run: the task already holds a token, which
+ *          is the implicit one here, and each process it starts beyond the
+ *          first takes one from the pool.
+ *
+ * @ingroup jobserver
+ *
+ * @param js Receives the jobserver; release with `jobserverClose()`.
+ *
+ * @return int `0` if joined; `-1` if there is no jobserver to join, and
+ *         `js` is inactive.
+ *
+ * Example usage:
+ * @code
+ * Jobserver js;
+ * int extra = 0;
+ * if (jobserverJoin(&js) == 0) {
+ *     jobserverTryAcquire(&js);   // the task's own token
+ *     while (extra < 3 && (tokens[extra] = jobserverTryAcquire(&js)) != JOBSERVER_NONE) extra++;
+ * }
+ * @endcode
+ */
+int jobserverJoin(Jobserver *js){
+    char auth[256];
+    if(jobserverInit(js)==0 && js->savedFlags && jobserverAuth(js->savedFlags, auth, sizeof(auth))==0 && joinJobserver(js, auth)==0){
+        js->active=1;
+        return 0;
+    }
+    jobserverClose(js);
+    return -1;
+}
+
+/**
+ * @brief Takes a token for each process a task starts beyond its first.
+ *
+ * @details Joins the run's jobserver (`jobserverJoin()`), counts the task's
+ *          own token as the implicit one, and takes up to `wanted` tokens
+ *          from the pool without blocking. A task that gets fewer starts
+ *          fewer processes, so a run never has more than `-j` of them.
+ *
+ * @ingroup jobserver
+ *
+ * @param js Receives the jobserver; release with `jobserverReleaseExtra()`.
+ * @param tokens Receives the tokens taken; room for `wanted`.
+ * @param wanted Processes beyond the first the task would like to start.
+ *
+ * @return int Tokens taken; `wanted` if there is no jobserver to join,
+ *         since then nothing limits the task.
+ *
+ * Example usage:
+ * @code
+ * Jobserver js;
+ * int tokens[7];
+ * int processes = 1 + jobserverAcquireExtra(&js, tokens, 7);
+ * // ... start and wait for `processes` processes ...
+ * jobserverReleaseExtra(&js, tokens, processes - 1);
+ * @endcode
+ */
+int jobserverAcquireExtra(Jobserver *js, int *tokens, int wanted){
+    if(jobserverJoin(js)!=0){
+        for(int i=0; i<wanted; i++) tokens[i]=JOBSERVER_IMPLICIT;
+        return wanted;
+    }
+    jobserverTryAcquire(js);
+    int taken=0;
+    while(taken<wanted && (tokens[taken]=jobserverTryAcquire(js))!=JOBSERVER_NONE) taken++;
+    return taken;
+}
+
+/**
+ * @brief Gives back the tokens of `jobserverAcquireExtra()` and leaves the
+ *        jobserver.
+ *
+ * @ingroup jobserver
+ */
+void jobserverReleaseExtra(Jobserver *js, const int *tokens, int count){
+    for(int i=0; i<count; i++) jobserverRelease(js, tokens[i]);
+    jobserverClose(js);
+}
+
+/**
+ * @brief Takes a token without blocking.
+ *
+ * @ingroup jobserver
+ *
+ * @return int `JOBSERVER_IMPLICIT`, the token byte taken from the pool, or
+ *         `JOBSERVER_NONE` if every token is in use. Without an active
+ *         jobserver, always `JOBSERVER_IMPLICIT`.
+ */
+int jobserverTryAcquire(Jobserver *js){
+    if(!js->active) return JOBSERVER_IMPLICIT;
+    if(js->implicitFree){
+        js->implicitFree=0;
+        return JOBSERVER_IMPLICIT;
+    }
+    #ifdef _WIN32
+        return WaitForSingleObject(js->semaphore, 0)==WAIT_OBJECT_0 ? JOBSERVER_TOKEN_BYTE : JOBSERVER_NONE;
+    #else
+        unsigned char byte;
+        ssize_t n;
+        do n=read(js->readFd, &byte, 1); while(n<0 && errno==EINTR);
+        return n==1 ? (int)byte : JOBSERVER_NONE;
+    #endif
+}
+
+/**
+ * @brief Gives back a token from `jobserverTryAcquire()`.
+ *
+ * @details Pool tokens are written back as the byte that was read, so
+ *          other clients of a parent make's jobserver see what they wrote.
+ *
+ * @ingroup jobserver
+ */
+void jobserverRelease(Jobserver *js, int token){
+    if(!js->active || token==JOBSERVER_NONE) return;
+    if(token==JOBSERVER_IMPLICIT){
+        js->implicitFree=1;
+        jobserverWake(js);
+        return;
+    }
+    #ifdef _WIN32
+        ReleaseSemaphore(js->semaphore, 1, NULL);
+    #else
+        unsigned char byte=(unsigned char)token;
+        ssize_t n;
+        do n=write(js->writeFd, &byte, 1); while(n<0 && errno==EINTR);
+        if(n!=1) LOG_ERROR("Could not return a jobserver token.");
+    #endif
+}
+
+/**
+ * @brief Blocks until a pool token may be free or `jobserverWake()` is called.
+ *
+ * @details Only one thread may wait at a time. A token that becomes free is
+ *          not taken; call `jobserverTryAcquire()` again, knowing that a
+ *          child make may get it first.
+ *
+ * @ingroup jobserver
+ */
+void jobserverWait(Jobserver *js){
+    if(!js->active) return;
+    #ifdef _WIN32
+        HANDLE handles[2]={js->wake, js->semaphore};
+        if(WaitForMultipleObjects(2, handles, FALSE, INFINITE)==WAIT_OBJECT_0+1){
+            ReleaseSemaphore(js->semaphore, 1, NULL);
+        }
+    #else
+        struct pollfd fds[2]={{js->readFd, POLLIN, 0}, {js->wakeFds[0], POLLIN, 0}};
+        while(poll(fds, 2, -1)<0 && errno==EINTR);
+        char drain[64];
+        while(read(js->wakeFds[0], drain, sizeof(drain))>0);
+    #endif
+}
+
+/**
+ * @brief Blocks until `jobserverWake()` is called or `timeoutMs` milliseconds
+ *        have passed, whether or not pool tokens are free.
+ *
+ * @details Used while something other than a token is missing. Without an
+ *          active jobserver this simply sleeps.
+ *
+ * @ingroup jobserver
+ */
+void jobserverSleep(Jobserver *js, int timeoutMs){
+    #ifdef _WIN32
+        if(js->wake) WaitForSingleObject(js->wake, (DWORD)timeoutMs);
+        else Sleep((DWORD)timeoutMs);
+    #else
+        if(js->wakeFds[0]<0){
+            usleep((useconds_t)timeoutMs*1000);
+            return;
+        }
+        struct pollfd fds[1]={{js->wakeFds[0], POLLIN, 0}};
+        if(poll(fds, 1, timeoutMs)>0){
+            char drain[64];
+            while(read(js->wakeFds[0], drain, sizeof(drain))>0);
+        }
+    #endif
+}
+
+/**
+ * @brief Interrupts a thread blocked in `jobserverWait()`.
+ *
+ * @ingroup jobserver
+ */
+void jobserverWake(Jobserver *js){
+    #ifdef _WIN32
+        if(js->wake) SetEvent(js->wake);
+    #else
+        if(js->wakeFds[1]>=0){
+            char byte=0;
+            if(write(js->wakeFds[1], &byte, 1)<0 && errno!=EAGAIN) LOG_ERROR("Could not wake the jobserver waiter.");
+        }
+    #endif
+}
+
+/**
+ * @brief Closes the jobserver and restores `MAKEFLAGS`.
+ *
+ * @details For a pool devcli created, tokens a child never gave back (for
+ *          example because it crashed) are reported.
+ *
+ * @ingroup jobserver
+ */
+void jobserverClose(Jobserver *js){
+    if(js->owned){
+        setMakeflags(js->savedFlags);
+        int returned=0;
+        #ifdef _WIN32
+            while(WaitForSingleObject(js->semaphore, 0)==WAIT_OBJECT_0) returned++;
+        #else
+            unsigned char byte;
+            while(read(js->readFd, &byte, 1)==1) returned++;
+        #endif
+        if(returned<js->tokens) LOG("%d jobserver token(s) were not returned by child processes.", js->tokens-returned);
+    }
+    #ifdef _WIN32
+        if(js->semaphore) CloseHandle(js->semaphore);
+        if(js->wake) CloseHandle(js->wake);
+    #else
+        int fds[]={js->readFd, js->writeFd, js->childReadFd, js->wakeFds[0], js->wakeFds[1]};
+        for(size_t i=0; i<sizeof(fds)/sizeof(fds[0]); i++){
+            if(fds[i]>=0) close(fds[i]);
+        }
+    #endif
+    free(js->savedFlags);
+    memset(js, 0, sizeof(*js));
+    #ifndef _WIN32
+        js->readFd=js->writeFd=js->childReadFd=-1;
+        js->wakeFds[0]=js->wakeFds[1]=-1;
+    #endif
+}
+
+/**
+ * @brief Returns the `-jN` that `MAKEFLAGS` carries, the job count of the
+ *        run the caller belongs to, or `0` if it carries none.
+ *
+ * @details Tools that split their own work, such as `cmake --build` or
+ *          sharded test runs, size themselves to this rather than to every
+ *          processor.
+ *
+ * @ingroup jobserver
+ *
+ * @return int The job count, or `0`.
+ *
+ * Example usage:
+ * @code
+ * int jobs = jobserverJobs();
+ * if (jobs == 0) jobs = tapeHardwareThreads();
+ * @endcode
+ */
+int jobserverJobs(void){
+    const char *flags=getenv("MAKEFLAGS");
+    for(const char *p=flags; p && (p=strstr(p, "-j")); p+=2){
+        if((p==flags || p[-1]==' ') && p[2]>='1' && p[2]<='9') return atoi(p+2);
+    }
+    return 0;
+}
+
+/** @} */ // end of jobserver group
@@ -0,0 +1,70 @@
+/**
+ * @file jobserver.h
+ * @brief GNU make compatible jobserver shared by devcli and the builds it starts.
+ */
+
+#ifndef DEVCLI_JOBSERVER_H
+#define DEVCLI_JOBSERVER_H
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/** @defgroup jobserver Jobserver
+ *  @brief One token budget for devcli's tasks and nested make, ninja or cmake --build.
+ *  @{
+ */
+
+/**
+ * @def JOBSERVER_NONE
+ * @brief Returned by `jobserverTryAcquire()` when no token is free.
+ */
+#define JOBSERVER_NONE (-1)
+
+/**
+ * @def JOBSERVER_IMPLICIT
+ * @brief Returned by `jobserverTryAcquire()` for the implicit token; pool
+ *        tokens are returned as the byte read from the pipe (0-255).
+ */
+#define JOBSERVER_IMPLICIT 256
+
+/**
+ * @brief A jobserver devcli created, or joined through `MAKEFLAGS`.
+ *
+ * @details Whoever runs a job holds a token. Like every make, devcli owns
+ *          one implicit token; the others are single bytes in a pipe (a
+ *          named semaphore on Windows) that child makes read from and write
+ *          back to as well.
+ */
+typedef struct {
+    int active;         /**< `0` if no jobserver could be set up; every request then succeeds. */
+    int owned;          /**< Created by this process, rather than inherited from a parent make. */
+    int tokens;         /**< Tokens put into the pool when `owned`. */
+    int implicitFree;   /**< The implicit token is not in use. */
+    char *savedFlags;   /**< `MAKEFLAGS` before `jobserverOpen()`, restored on close. */
+    #ifdef _WIN32
+        HANDLE semaphore;
+        HANDLE wake;
+    #else
+        int readFd;         /**< Non-blocking read end used by devcli itself. */
+        int writeFd;        /**< Write end; inherited by children when `owned`. */
+        int childReadFd;    /**< Blocking read end passed to children, or `-1` if joined. */
+        int wakeFds[2];     /**< Self-pipe that interrupts `jobserverWait()`. */
+    #endif
+} Jobserver;
+
+int jobserverOpen(Jobserver *js, int jobs);
+int jobserverJoin(Jobserver *js);
+int jobserverAcquireExtra(Jobserver *js, int *tokens, int wanted);
+void jobserverReleaseExtra(Jobserver *js, const int *tokens, int count);
+int jobserverTryAcquire(Jobserver *js);
+void jobserverRelease(Jobserver *js, int token);
+void jobserverWait(Jobserver *js);
+void jobserverSleep(Jobserver *js, int timeoutMs);
+void jobserverWake(Jobserver *js);
+void jobserverClose(Jobserver *js);
+int jobserverJobs(void);
+
+/** @} */ // end of jobserver group
+
+#endif /* DEVCLI_JOBSERVER_H */
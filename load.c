@@ -0,0 +1,266 @@
+/**
+ * @file load.c
+ * @brief Concurrency limit that follows pressure-stall information and the load average.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#include "load.h"
+#include "tape.h"
+#include "log.h"
+
+/** @addtogroup load
+ *  @{
+ */
+
+/**
+ * @def LOAD_CPU_HIGH
+ * @brief CPU pressure (percent of time some task waited for a CPU) at which
+ *        the limit shrinks.
+ */
+#define LOAD_CPU_HIGH 25.0
+
+/**
+ * @def LOAD_CPU_LOW
+ * @brief CPU pressure below which the limit may grow again.
+ */
+#define LOAD_CPU_LOW 10.0
+
+/**
+ * @def LOAD_MEMORY_HIGH
+ * @brief Memory pressure (percent of time some task stalled on reclaim or
+ *        swap) at which the limit shrinks.
+ */
+#define LOAD_MEMORY_HIGH 10.0
+
+/**
+ * @def LOAD_MEMORY_LOW
+ * @brief Memory pressure below which the limit may grow again.
+ */
+#define LOAD_MEMORY_LOW 2.0
+
+/**
+ * @def LOAD_PER_CPU_HIGH
+ * @brief Load average per processor at which the limit shrinks.
+ */
+#define LOAD_PER_CPU_HIGH 1.25
+
+/**
+ * @def LOAD_PER_CPU_LOW
+ * @brief Load average per processor below which the limit may grow again.
+ */
+#define LOAD_PER_CPU_LOW 0.75
+
+/**
+ * @def LOAD_SHRINK_SAMPLES
+ * @brief Consecutive busy samples before the limit shrinks.
+ */
+#define LOAD_SHRINK_SAMPLES 2
+
+/**
+ * @def LOAD_GROW_SAMPLES
+ * @brief Consecutive calm samples before the limit grows by one.
+ */
+#define LOAD_GROW_SAMPLES 4
+
+/**
+ * @brief Returns a monotonic timestamp in seconds.
+ */
+static double loadNow(void){
+    #ifdef _WIN32
+        LARGE_INTEGER frequency, counter;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&counter);
+        return (double)counter.QuadPart/(double)frequency.QuadPart;
+    #else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (double)ts.tv_sec+(double)ts.tv_nsec/1e9;
+    #endif
+}
+
+#ifndef _WIN32
+
+/**
+ * @brief Reads `some avg10` from a pressure-stall file such as
+ *        `/proc/pressure/cpu`.
+ *
+ * @return double Percentage of the last ten seconds in which at least one
+ *         task stalled, or `-1` if the kernel does not provide the file.
+ */
+static double readPressure(const char *path){
+    FILE *file=fopen(path, "r");
+    if(!file) return -1;
+    char line[256];
+    double value=-1;
+    while(fgets(line, sizeof(line), file)){
+        if(sscanf(line, "some avg10=%lf", &value)==1) break;
+        value=-1;
+    }
+    fclose(file);
+    return value;
+}
+
+#endif
+
+/**
+ * @brief Samples the load of the host into `control->sample`.
+ *
+ * @details On Windows, which has neither pressure-stall information nor a
+ *          load average, the load is estimated as the busy share of all
+ *          processors since the previous sample times their number.
+ */
+static void loadSample(LoadControl *control){
+    LoadSample *sample=&control->sample;
+    sample->cpuPressure=-1;
+    sample->memoryPressure=-1;
+    sample->load=-1;
+    #ifdef _WIN32
+        FILETIME idle, kernel, user;
+        if(GetSystemTimes(&idle, &kernel, &user)){
+            uint64_t idleTime=((uint64_t)idle.dwHighDateTime<<32)|idle.dwLowDateTime;
+            uint64_t totalTime=(((uint64_t)kernel.dwHighDateTime<<32)|kernel.dwLowDateTime)+(((uint64_t)user.dwHighDateTime<<32)|user.dwLowDateTime);
+            if(control->totalTime && totalTime>control->totalTime){
+                double busy=1.0-(double)(idleTime-control->idleTime)/(double)(totalTime-control->totalTime);
+                sample->load=busy*control->processors;
+            }
+            control->idleTime=idleTime;
+            control->totalTime=totalTime;
+        }
+    #else
+        sample->cpuPressure=readPressure("/proc/pressure/cpu");
+        sample->memoryPressure=readPressure("/proc/pressure/memory");
+        double load[1];
+        if(getloadavg(load, 1)==1) sample->load=load[0];
+    #endif
+}
+
+/**
+ * @brief Classifies a sample: `1` if the host has room for more tasks, `-1`
+ *        if it is overloaded, `0` in between.
+ *
+ * @details The gap between the high and low thresholds is the dead band that
+ *          keeps the limit from oscillating around a single threshold.
+ */
+static int loadVerdict(const LoadControl *control){
+    const LoadSample *sample=&control->sample;
+    double perCpu=sample->load>=0 ? sample->load/control->processors : -1;
+    if(sample->cpuPressure>=LOAD_CPU_HIGH || sample->memoryPressure>=LOAD_MEMORY_HIGH || perCpu>=LOAD_PER_CPU_HIGH) return -1;
+    if(sample->cpuPressure<LOAD_CPU_LOW && sample->memoryPressure<LOAD_MEMORY_LOW && perCpu<LOAD_PER_CPU_LOW) return 1;
+    return 0;
+}
+
+/**
+ * @brief Takes a new sample and applies the `--max-load` cap and, when
+ *        adaptive, the hysteresis described at `loadLimit()`.
+ */
+static void loadUpdate(LoadControl *control, int running){
+    control->lastSample=loadNow();
+    loadSample(control);
+    const LoadSample *sample=&control->sample;
+    int overloaded=control->maxLoad>0 && sample->load>=control->maxLoad;
+    if(overloaded!=control->overloaded){
+        control->overloaded=overloaded;
+        if(overloaded) LOG("Load average %.2f reached --max-load %.2f; holding back new tasks.", sample->load, control->maxLoad);
+        else LOG("Load average %.2f is below --max-load again.", sample->load);
+    }
+    if(!control->adaptive) return;
+    int verdict=loadVerdict(control);
+    if(verdict<0) control->streak=control->streak<0 ? control->streak-1 : -1;
+    else if(verdict>0 && running>=control->limit) control->streak=control->streak>0 ? control->streak+1 : 1;
+    else control->streak=0;
+    int limit=control->limit;
+    if(control->streak<=-LOAD_SHRINK_SAMPLES && limit>1) limit-=limit/4>1 ? limit/4 : 1;
+    else if(control->streak>=LOAD_GROW_SAMPLES && limit<control->jobs) limit++;
+    if(limit!=control->limit){
+        LOG("Host load (CPU pressure %.1f%%, memory pressure %.1f%%, load %.2f); running up to %d task(s) at once.",
+            sample->cpuPressure, sample->memoryPressure, sample->load, limit);
+        control->limit=limit;
+        control->streak=0;
+    }
+}
+
+/**
+ * @brief Sets up the concurrency limit of a run.
+ *
+ * @details With neither `adaptive` nor `maxLoad` the limit is simply `jobs`
+ *          and the host is never sampled. An adaptive run that starts on a
+ *          host that is already busy starts at half of `jobs`, since the
+ *          first samples would come too late for the tasks launched at once.
+ *
+ * @ingroup load
+ *
+ * @param control Receives the limit.
+ * @param jobs Largest number of tasks at once (`-j`).
+ * @param adaptive Scale the limit between 1 and `jobs` to the host load.
+ * @param maxLoad Start no task while the one-minute load average is at least
+ *        this and another task is running, as `make -l` does; `0` for no cap.
+ *
+ * Example usage:
+ * @code
+ * LoadControl control;
+ * loadOpen(&control, 8, 1, 6.0);
+ * if (running < loadLimit(&control, running)) startTask();
+ * @endcode
+ */
+void loadOpen(LoadControl *control, int jobs, int adaptive, double maxLoad){
+    memset(control, 0, sizeof(*control));
+    control->jobs=jobs<1 ? 1 : jobs;
+    control->limit=control->jobs;
+    control->adaptive=adaptive;
+    control->maxLoad=maxLoad>0 ? maxLoad : 0;
+    control->processors=tapeHardwareThreads();
+    if(control->processors<1) control->processors=1;
+    if(!adaptive && control->maxLoad==0) return;
+    loadUpdate(control, 0);
+    const LoadSample *sample=&control->sample;
+    if(adaptive && loadVerdict(control)<0 && control->jobs>1){
+        control->limit=control->jobs/2;
+        LOG("Host is busy (CPU pressure %.1f%%, memory pressure %.1f%%, load %.2f); starting with %d task(s) at once.",
+            sample->cpuPressure, sample->memoryPressure, sample->load, control->limit);
+    }
+    #ifndef _WIN32
+        if(adaptive && sample->cpuPressure<0) LOG("No pressure-stall information on this system; adapting to the load average only.");
+    #endif
+    if(sample->load<0 && control->maxLoad>0) LOG_ERROR("The load average is not available on this system; --max-load has no effect.");
+}
+
+/**
+ * @brief Returns how many tasks may run at once right now.
+ *
+ * @details Samples the host at most every `LOAD_SAMPLE_MS`. When adaptive,
+ *          the limit shrinks by a quarter (at least one) after
+ *          `LOAD_SHRINK_SAMPLES` busy samples in a row: CPU or memory
+ *          pressure, or the load average per processor, above its high
+ *          threshold. It grows by one after `LOAD_GROW_SAMPLES` calm samples
+ *          in a row, all below their low thresholds, and only while the limit
+ *          is what holds tasks back. Samples between the thresholds reset
+ *          both counts, and so does every change, so each change is judged
+ *          on samples taken after it. Shrinking fast and growing slowly keeps
+ *          the limit from oscillating.
+ *
+ *          While the load average is at least `maxLoad`, the result is 1: a
+ *          task starts only when no other is running.
+ *
+ *          Not thread-safe; the scheduler calls it under its lock.
+ *
+ * @ingroup load
+ *
+ * @param control Limit set up by `loadOpen()`.
+ * @param running Tasks of this run currently running.
+ *
+ * @return int Allowed number of running tasks, from 1 to `jobs`.
+ */
+int loadLimit(LoadControl *control, int running){
+    if(!control->adaptive && control->maxLoad==0) return control->jobs;
+    if(loadNow()-control->lastSample>=LOAD_SAMPLE_MS/1000.0) loadUpdate(control, running);
+    return control->overloaded ? 1 : control->limit;
+}
+
+/** @} */ // end of load group
@@ -0,0 +1,55 @@
+/**
+ * @file load.h
+ * @brief Scales the number of running tasks to the load of the host.
+ */
+
+#ifndef DEVCLI_LOAD_H
+#define DEVCLI_LOAD_H
+
+#include <stdint.h>
+
+/** @defgroup load Load Control
+ *  @brief Adapts concurrency to pressure-stall information and the load average.
+ *  @{
+ */
+
+/**
+ * @def LOAD_SAMPLE_MS
+ * @brief Interval between two samples of the host load.
+ */
+#define LOAD_SAMPLE_MS 1000
+
+/**
+ * @brief The host load as last sampled; a figure is negative when unknown.
+ */
+typedef struct {
+    double cpuPressure;     /**< `some avg10` of `/proc/pressure/cpu`, in percent. */
+    double memoryPressure;  /**< `some avg10` of `/proc/pressure/memory`, in percent. */
+    double load;            /**< One-minute load average. */
+} LoadSample;
+
+/**
+ * @brief Concurrency limit of one run and the samples it follows.
+ */
+typedef struct {
+    int adaptive;       /**< Scale the limit to the host load (`--adaptive`). */
+    double maxLoad;     /**< Start no task while the load average is at least this (`--max-load`); `0` for no cap. */
+    int jobs;           /**< Upper bound on the limit (`-j`). */
+    int limit;          /**< Tasks allowed to run at once right now. */
+    int overloaded;     /**< The last sample was at or above `maxLoad`. */
+    int streak;         /**< Consecutive samples asking for the same change; negative to shrink. */
+    int processors;     /**< Logical processors, the reference for the load average. */
+    double lastSample;  /**< Monotonic time of the last sample, in seconds. */
+    LoadSample sample;
+    #ifdef _WIN32
+        uint64_t idleTime;  /**< Idle time at the last sample, to estimate the load from `GetSystemTimes()`. */
+        uint64_t totalTime; /**< Kernel plus user time at the last sample. */
+    #endif
+} LoadControl;
+
+void loadOpen(LoadControl *control, int jobs, int adaptive, double maxLoad);
+int loadLimit(LoadControl *control, int running);
+
+/** @} */ // end of load group
+
+#endif /* DEVCLI_LOAD_H */
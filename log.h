@@ -0,0 +1,75 @@
+/**
+ * @file log.h
+ * @brief Colour codes and logging macros shared by every DevCLI source file.
+ */
+
+#ifndef DEVCLI_LOG_H
+#define DEVCLI_LOG_H
+
+#include <stdio.h>
+
+/**
+ * @def RED
+ * @brief ANSI escape code for red-colored text.
+ */
+#define RED "\033[31m"
+
+/**
+ * @def GREEN
+ * @brief ANSI escape code for green-colored text.
+ */
+#define GREEN "\033[32m"
+
+/**
+ * @def YELLOW
+ * @brief ANSI escape code for yellow-colored text.
+ */
+#define YELLOW "\033[33m"
+
+/**
+ * @def BLUE
+ * @brief ANSI escape code for blue-colored text.
+ */
+#define BLUE "\033[34m"
+
+/**
+ * @def RESET
+ * @brief ANSI escape code to reset text formatting to default.
+ */
+#define RESET "\033[0m"
+
+/**
+ * @def LOG(msg, ...)
+ * @brief Prints a formatted log message with file name and line number.
+ *
+ * @details Outputs messages in blue for context and green for the main text.
+ *          Useful for debugging and tracking execution flow.
+ *
+ * @param msg The format string for the log message.
+ * @param ... Optional arguments matching the format specifiers in `msg`.
+ *
+ * Example:
+ * @code
+ * LOG("Task %s executed successfully", taskName);
+ * @endcode
+ */
+#define LOG(msg, ...) do{printf(BLUE "[%s:Line %d] [log]" RESET GREEN msg RESET "\n",__FILE__,__LINE__, ##__VA_ARGS__);}while(0)
+
+/**
+ * @def LOG_ERROR(msg, ...)
+ * @brief Prints a formatted error message with file name and line number to stderr.
+ *
+ * @details Outputs messages in yellow for context and red for the error text.
+ *          Helps identify error location quickly during debugging.
+ *
+ * @param msg The format string for the error message.
+ * @param ... Optional arguments matching the format specifiers in `msg`.
+ *
+ * Example:
+ * @code
+ * LOG_ERROR("Failed to execute task: %s", taskName);
+ * @endcode
+ */
+#define LOG_ERROR(msg, ...) do{fprintf(stderr,YELLOW "[%s:Line %d] [error]" RESET RED msg RESET "\n",__FILE__,__LINE__,##__VA_ARGS__);}while(0)
+
+#endif /* DEVCLI_LOG_H */
@@ -17,12 +17,36 @@
  * - Placeholder substitution for dynamic user input (`{{path}}`, `{{name}}`).
  * - Automatic detection of shell environment.
  * - Installation optimization using tool availability checks.
+ * - Missing packages of all install tasks of a command installed in one transaction.
+ * - Independent tasks run in parallel (`-j N`); tasks sharing a declared
+ *   resource such as the dpkg lock or the build directory never overlap.
+ * - Acts as a GNU make jobserver, so nested `make`, `ninja` or `cmake --build`
+ *   runs share the `-j N` budget with devcli's own tasks.
+ * - Simultaneous devcli runs share one host-wide task budget
+ *   (`DEVCLI_HOST_JOBS`), so parallel CI jobs do not oversubscribe the machine.
+ * - Optionally follows the host load (`--adaptive`, `--max-load`), running
+ *   fewer tasks at once while the machine is under CPU or memory pressure.
+ * - Starts memory-hungry tasks only while their declared or learned peak
+ *   memory fits in the memory budget (`--memory-budget`).
+ * - Optionally confines a run to its own cgroup with a lower CPU weight
+ *   (`--cgroup`, `--cpu-weight`) and pins single tasks to CPUs (`cpus`).
+ * - Built-in compile cache for gcc and g++ tasks such as `build.gcc`,
+ *   keyed by the preprocessed source, the compiler and its flags.
+ * - distcc-style compile workers (`devcli worker`, `DEVCLI_WORKERS`) that
+ *   gcc and g++ commands spread their compiles over.
+ * - Test tasks run only the tests affected by the files changed since their
+ *   last run, found from Python imports and C includes (`--all` runs all).
  * - Logging for debugging and error tracking.
  *
  * @section usage_sec Usage
  * @code
  * devcli <command>
+ * devcli -j 4 <command>
+ * devcli -j 16 --adaptive --max-load 12 <command>
+ * devcli --all test.py
  * devcli help
+ * devcli bench
+ * devcli worker 0.0.0.0:3633
  * @endcode
  *
  * Example:
@@ -36,10 +60,34 @@
  * - @ref helpers "Helper Utilities"
  * - @ref sys_utils "System Utilities"
  * - @ref user_interaction "User Interaction"
+ * - @ref config "Frozen Configuration"
+ * - @ref tape "Tape DOM"
+ * - @ref bench "Benchmarks"
+ * - @ref plan "Planning"
+ * - @ref pkgdb "Package Databases"
+ * - @ref sched "Scheduling"
+ * - @ref jobserver "Jobserver"
+ * - @ref hostpool "Host Budget"
+ * - @ref load "Load Control"
+ * - @ref membudget "Memory Budget"
+ * - @ref spawn "Process Spawning"
+ * - @ref isolation "Isolation"
+ * - @ref compcache "Compile Cache"
+ * - @ref distcomp "Distributed Compilation"
+ * - @ref cmakebuild "CMake Builds"
+ * - @ref javabuild "Java Builds"
+ * - @ref javatest "Java Test Runners"
+ * - @ref pyshard "Test Sharding"
+ * - @ref testselect "Test Selection"
  *
  * @section build_sec Build Instructions
  * @code
- * gcc main.c -lcjson -o devcli
+ * gcc main.c config.c tape.c bench.c plan.c pkgdb.c sched.c jobserver.c hostpool.c load.c membudget.c spawn.c isolation.c compcache.c distcomp.c cmakebuild.c javabuild.c javatest.c pyshard.c testselect.c cJSON.c -pthread -o devcli
+ * @endcode
+ * To compile a fixed catalog into the binary:
+ * @code
+ * devcli embed tasks_embedded.c
+ * gcc -DDEVCLI_EMBEDDED main.c config.c tape.c bench.c plan.c pkgdb.c sched.c jobserver.c hostpool.c load.c membudget.c spawn.c isolation.c compcache.c distcomp.c cmakebuild.c javabuild.c javatest.c pyshard.c testselect.c cJSON.c tasks_embedded.c -pthread -o devcli
  * @endcode
  *
  * @section license_sec License
@@ -54,73 +102,43 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef _WIN32
 #include <windows.h>
+#endif
 #include <stdbool.h>
 #include <errno.h>
-#include "cJSON.h"
-/**
- * @def RED
- * @brief ANSI escape code for red-colored text.
- */
-#define RED "\033[31m"
-
-/**
- * @def GREEN
- * @brief ANSI escape code for green-colored text.
- */
-#define GREEN "\033[32m"
-
-/**
- * @def YELLOW
- * @brief ANSI escape code for yellow-colored text.
- */
-#define YELLOW "\033[33m"
-
-/**
- * @def BLUE
- * @brief ANSI escape code for blue-colored text.
- */
-#define BLUE "\033[34m"
-
-/**
- * @def RESET
- * @brief ANSI escape code to reset text formatting to default.
- */
-#define RESET "\033[0m"
-
-/**
- * @def LOG(msg, ...)
- * @brief Prints a formatted log message with file name and line number.
- *
- * @details Outputs messages in blue for context and green for the main text.
- *          Useful for debugging and tracking execution flow.
- *
- * @param msg The format string for the log message.
- * @param ... Optional arguments matching the format specifiers in `msg`.
- *
- * Example:
- * @code
- * LOG("Task %s executed successfully", taskName);
- * @endcode
- */
-#define LOG(msg, ...) do{printf(BLUE "[%s:Line %d] [log]" RESET GREEN msg RESET "\n",__FILE__,__LINE__, ##__VA_ARGS__);}while(0)
-
-/**
- * @def LOG_ERROR(msg, ...)
- * @brief Prints a formatted error message with file name and line number to stderr.
- *
- * @details Outputs messages in yellow for context and red for the error text.
- *          Helps identify error location quickly during debugging.
- *
- * @param msg The format string for the error message.
- * @param ... Optional arguments matching the format specifiers in `msg`.
- *
- * Example:
- * @code
- * LOG_ERROR("Failed to execute task: %s", taskName);
- * @endcode
- */
-#define LOG_ERROR(msg, ...) do{fprintf(stderr,YELLOW "[%s:Line %d] [error]" RESET RED msg RESET "\n",__FILE__,__LINE__,##__VA_ARGS__);}while(0)
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#define GETCWD _getcwd
+#define ISATTY _isatty
+#define MKDIR(path) _mkdir(path)
+#else
+#include <dirent.h>
+#include <unistd.h>
+#define GETCWD getcwd
+#define ISATTY isatty
+#define MKDIR(path) mkdir(path, 0755)
+#endif
+#include "bench.h"
+#include "cmakebuild.h"
+#include "compcache.h"
+#include "config.h"
+#include "devcli.h"
+#include "distcomp.h"
+#include "isolation.h"
+#include "javabuild.h"
+#include "javatest.h"
+#include "membudget.h"
+#include "pkgdb.h"
+#include "plan.h"
+#include "pyshard.h"
+#include "sched.h"
+#include "spawn.h"
+#include "tape.h"
+#include "testselect.h"
+#include "log.h"
 
 /**
  * @var shell
@@ -132,6 +150,14 @@
  */
 const char *shell;
 
+/**
+ * @var shellKind
+ * @brief The detected shell as an index into the per-shell entries of the frozen config.
+ *
+ * @details Set by `detectShell()` together with `shell`.
+ */
+ConfigShell shellKind=CONFIG_SHELL_COUNT;
+
 /** @defgroup init Initialization & Configuration
  *  @brief Functions responsible for setting up environment and configuration.
  *  @{
@@ -171,21 +197,238 @@ void detectShell(){
     #else
         shell="Linux";
     #endif
+    shellKind=configShellFromName(shell);
     LOG("Shell Detected: %s", shell);
 }
 
+/**
+ * @def PATH_MAX_LENGTH
+ * @brief Size of the buffers holding directory and `tasks.json` paths.
+ */
+#define PATH_MAX_LENGTH 1024
+
+/**
+ * @def PATH_CACHE_ENTRIES
+ * @brief Number of working directories remembered by the path cache.
+ */
+#define PATH_CACHE_ENTRIES 32
+
+/**
+ * @def PATH_SEPARATOR
+ * @brief Directory separator used when forming paths.
+ */
+#ifdef _WIN32
+#define PATH_SEPARATOR '\\'
+#else
+#define PATH_SEPARATOR '/'
+#endif
+
+/**
+ * @brief Checks whether `path` names an existing regular file, using `stat()` only.
+ *
+ * @ingroup init
+ *
+ * @param path Path to check.
+ *
+ * @return bool `true` if the file exists and is a regular file.
+ */
+bool isRegularFile(const char *path){
+    struct stat info;
+    return stat(path, &info)==0 && (info.st_mode & S_IFMT)==S_IFREG;
+}
+
+/**
+ * @brief Fills `out` with `$<variable>` or, failing that, `$<fallback><fallbackSuffix>`, followed by `suffix`.
+ *
+ * @details Used for the XDG locations: `userDirectory(out, size, "XDG_CONFIG_HOME",
+ *          "HOME", "/.config", "/devcli/tasks.json")` yields
+ *          `~/.config/devcli/tasks.json` unless `XDG_CONFIG_HOME` is set.
+ *
+ * @ingroup init
+ *
+ * @return bool `true` if neither variable was missing and the path fit in `out`.
+ */
+bool userDirectory(char *out, size_t size, const char *variable, const char *fallback, const char *fallbackSuffix, const char *suffix){
+    const char *root=getenv(variable);
+    if(root && root[0]){
+        fallbackSuffix="";
+    }
+    else{
+        root=fallback ? getenv(fallback) : NULL;
+        if(!root || !root[0]) return false;
+    }
+    int n=snprintf(out, size, "%s%s%s", root, fallbackSuffix, suffix);
+    return n>0 && (size_t)n<size;
+}
+
+/**
+ * @brief Fills `out` with the path of `name` in the per-user devcli cache
+ *        directory, creating the directory if needed.
+ *
+ * @details The directory is `$XDG_CACHE_HOME/devcli` (`~/.cache/devcli` by
+ *          default) or `%LOCALAPPDATA%\devcli` on Windows.
+ *
+ * @ingroup init
+ *
+ * @return bool `true` if the location is known and the path fit in `out`.
+ */
+bool cacheFile(char *out, size_t size, const char *name){
+    #ifdef _WIN32
+        if(!userDirectory(out, size, "LOCALAPPDATA", NULL, "", "\\devcli")) return false;
+    #else
+        if(!userDirectory(out, size, "XDG_CACHE_HOME", "HOME", "/.cache", "/devcli")) return false;
+    #endif
+    char *parent=strrchr(out, PATH_SEPARATOR);
+    if(parent){
+        *parent='\0';
+        MKDIR(out);
+        *parent=PATH_SEPARATOR;
+    }
+    MKDIR(out);
+    size_t len=strlen(out);
+    int n=snprintf(out+len, size-len, "%c%s", PATH_SEPARATOR, name);
+    return n>0 && (size_t)n<size-len;
+}
+
+/**
+ * @brief Fills `out` with the path of the file remembering `tasks.json` per directory.
+ *
+ * @details `paths` in the cache directory (see `cacheFile()`). Each line holds
+ *          a working directory and the `tasks.json` resolved for it, separated
+ *          by a tab, most recent first.
+ *
+ * @ingroup init
+ */
+bool pathCacheFile(char *out, size_t size){
+    return cacheFile(out, size, "paths");
+}
+
+/**
+ * @brief Looks up the `tasks.json` remembered for `directory` in the path cache.
+ *
+ * @details A remembered path is only returned if it still names a regular file,
+ *          so a moved or deleted `tasks.json` falls through to a fresh search.
+ *
+ * @ingroup init
+ *
+ * @param directory Absolute working directory.
+ * @param out Buffer receiving the remembered path.
+ * @param size Size of `out`.
+ *
+ * @return bool `true` if a valid path was found.
+ */
+bool pathCacheLookup(const char *directory, char *out, size_t size){
+    char cachePath[1024], line[2 * PATH_MAX_LENGTH + 2];
+    if(!pathCacheFile(cachePath, sizeof(cachePath))) return false;
+    FILE *f=fopen(cachePath, "r");
+    if(!f) return false;
+    size_t dirLength=strlen(directory);
+    bool found=false;
+    while(!found && fgets(line, sizeof(line), f)){
+        line[strcspn(line, "\r\n")]='\0';
+        if(strncmp(line, directory, dirLength)!=0 || line[dirLength]!='\t') continue;
+        const char *path=line+dirLength+1;
+        if(strlen(path)<size && isRegularFile(path)){
+            strcpy(out, path);
+            found=true;
+        }
+        break;
+    }
+    fclose(f);
+    return found;
+}
+
+/**
+ * @brief Records `path` as the `tasks.json` for `directory` in the path cache.
+ *
+ * @details The entry is moved to the front and the file is trimmed to
+ *          `PATH_CACHE_ENTRIES` lines. Like the compiled config cache, the new
+ *          file is written under a temporary name and renamed into place, so a
+ *          concurrent reader sees either the old or the new list. Failures are
+ *          ignored; the cache only saves work.
+ *
+ * @ingroup init
+ */
+void pathCacheStore(const char *directory, const char *path){
+    char cachePath[1024], tempPath[1100], line[2 * PATH_MAX_LENGTH + 2];
+    if(!pathCacheFile(cachePath, sizeof(cachePath))) return;
+    #ifdef _WIN32
+        snprintf(tempPath, sizeof(tempPath), "%s.%lu.tmp", cachePath, (unsigned long)GetCurrentProcessId());
+    #else
+        snprintf(tempPath, sizeof(tempPath), "%s.%ld.tmp", cachePath, (long)getpid());
+    #endif
+    FILE *out=fopen(tempPath, "w");
+    if(!out) return;
+    fprintf(out, "%s\t%s\n", directory, path);
+    size_t kept=1, dirLength=strlen(directory);
+    FILE *in=fopen(cachePath, "r");
+    while(in && kept<PATH_CACHE_ENTRIES && fgets(line, sizeof(line), in)){
+        if(!strchr(line, '\n')) continue;
+        if(strncmp(line, directory, dirLength)==0 && line[dirLength]=='\t') continue;
+        fputs(line, out);
+        kept++;
+    }
+    if(in) fclose(in);
+    if(fclose(out)!=0 || rename(tempPath, cachePath)!=0) remove(tempPath);
+}
+
+/**
+ * @brief Searches `start` and its parents for `tasks.json`, up to the repository root.
+ *
+ * @details Each level costs one `stat()` of `tasks.json` and, if that misses,
+ *          one of `.git`; the directory holding `.git` (a directory, or a file
+ *          in worktrees) is the last one searched. Outside a repository the
+ *          walk ends at the filesystem root.
+ *
+ * @ingroup init
+ *
+ * @param start Absolute directory to start from.
+ * @param out Buffer receiving the path of the nearest `tasks.json`.
+ * @param size Size of `out`.
+ *
+ * @return bool `true` if a `tasks.json` was found.
+ */
+bool findTasksUpward(const char *start, char *out, size_t size){
+    char directory[PATH_MAX_LENGTH];
+    if(strlen(start)>=sizeof(directory)) return false;
+    strcpy(directory, start);
+    const char separator[2]={PATH_SEPARATOR, '\0'};
+    for(;;){
+        size_t length=strlen(directory);
+        bool root=length>0 && directory[length-1]==PATH_SEPARATOR;
+        int n=snprintf(out, size, "%s%stasks.json", directory, root ? "" : separator);
+        if(n>0 && (size_t)n<size && isRegularFile(out)) return true;
+        snprintf(out, size, "%s%s.git", directory, root ? "" : separator);
+        struct stat info;
+        if(stat(out, &info)==0) return false;
+        char *last=strrchr(directory, PATH_SEPARATOR);
+        if(!last || root) return false;
+        if(last==directory || (last==directory+2 && directory[1]==':')) last[1]='\0';
+        else *last='\0';
+    }
+}
+
 /**
  * @brief Resolves the file path of the `tasks.json` configuration file.
  *
  * @details This function determines the location of `tasks.json` using the following
- *          priority order:
- *          1. Cached path from `.devcli_config` file (if valid).
- *          2. Parent directory path (`../tasks.json`).
- *          3. Current directory path (`./tasks.json`).
- *          4. Manual user input (prompted if none of the above are found).
- *
- *          If the user provides a valid path manually, it is stored in
- *          `.devcli_config` for subsequent executions in the same environment.
+ *          priority order, testing candidates with `stat()` only so that the chosen
+ *          file is opened exactly once, by `readFileToBuffer()`:
+ *          1. `DEVCLI_CONFIG`, if set. A missing file is an error rather than a
+ *             reason to keep searching.
+ *          2. A `tasks.json` in the current directory or the nearest parent, up
+ *             to the repository root (see `findTasksUpward()`).
+ *          3. The path remembered for the current directory in the path cache
+ *             (see `pathCacheFile()`), if it still exists.
+ *          4. The user location `$XDG_CONFIG_HOME/devcli/tasks.json`
+ *             (`~/.config/devcli/tasks.json`, or `%APPDATA%\devcli\tasks.json`
+ *             on Windows).
+ *          5. Manual user input, only when standard input is a terminal. In CI
+ *             and other non-interactive runs the function fails immediately.
+ *
+ *          A path found by steps 4 or 5 is remembered for the current directory,
+ *          so later runs from the same place skip the prompt. The search in step
+ *          2 always runs first, so a remembered path never hides a project file.
  *
  *          The function allocates memory for the returned string using `strdup()`.
  *          In the current implementation, this memory is always freed later in the
@@ -198,14 +441,8 @@ void detectShell(){
  *               The current implementation ensures proper cleanup of this memory.
  *               Returns `NULL` if no valid path is found (including invalid user input).
  *
- * @note This function uses an internal static buffer for temporary storage but
- *       duplicates the final path using `strdup()` before returning it.
- *
- * @warning If `.devcli_config` contains an outdated path (e.g., user moved `tasks.json`
- *          manually), the function will fail on first attempt before falling back to
- *          manual input.
- *
- * @todo Implement validation for cached path before returning it to prevent edge-case errors.
+ * @note The path cache replaces the `.devcli_config` file earlier versions wrote to
+ *       the working directory; such a file is no longer read.
  *
  * Example usage:
  * @code
@@ -219,58 +456,52 @@ void detectShell(){
  * @endcode
  */
 char* resolveJSONPath() {
-    static char cachedPath[260]={0};
-    FILE *f;
-    f=fopen(".devcli_config","r");
-    if(f && fgets(cachedPath,sizeof(cachedPath),f)){
-        fclose(f);
-        size_t len=strlen(cachedPath);
-        if(len>0 && cachedPath[len-1]=='\n'){
-            cachedPath[len-1]='\0';
-        }
-        f=fopen(cachedPath,"r");
-        if(f){
-            fclose(f);
-            LOG("Using cached path from config: %s",cachedPath);
-            return strdup(cachedPath);
+    char path[PATH_MAX_LENGTH], directory[PATH_MAX_LENGTH];
+    const char *explicitPath=getenv("DEVCLI_CONFIG");
+    if(explicitPath && explicitPath[0]){
+        if(!isRegularFile(explicitPath)){
+            LOG_ERROR("DEVCLI_CONFIG names %s, which is not a file.", explicitPath);
+            return NULL;
         }
+        LOG("Using DEVCLI_CONFIG: %s", explicitPath);
+        return strdup(explicitPath);
     }
-    f=fopen("../tasks.json","r");
-    if (f) {
-        fclose(f);
-        LOG("Using \"../tasks.json\"");
-        strcpy(cachedPath,"../tasks.json");
-        return strdup(cachedPath);
+    if(!GETCWD(directory, sizeof(directory))){
+        LOG_ERROR("Current directory could not be determined: %s", strerror(errno));
+        return NULL;
     }
-    f=fopen("tasks.json","r");
-    if (f) {
-        fclose(f);
-        LOG("Using \"./tasks.json\"");
-        strcpy(cachedPath,"./tasks.json");
-        return strdup(cachedPath);
+    if(findTasksUpward(directory, path, sizeof(path))){
+        LOG("Using \"%s\"", path);
+        return strdup(path);
     }
-    printf(RED "Warning: tasks.json not found in expected locations.\n");
-    printf(YELLOW "You may have altered the cloned setup. Please enter path to tasks.json manually: " RESET);
-    fgets(cachedPath,sizeof(cachedPath),stdin);
-    size_t len=strlen(cachedPath);
-    if(len>0 && cachedPath[len-1]=='\n'){
-        cachedPath[len-1]='\0';
+    if(pathCacheLookup(directory, path, sizeof(path))){
+        LOG("Using cached path for this directory: %s", path);
+        return strdup(path);
     }
-    f=fopen(cachedPath,"r");
-    if (!f) {
-        LOG_ERROR("Provided path is also invalid.");
+    #ifdef _WIN32
+    if(userDirectory(path, sizeof(path), "APPDATA", NULL, "", "\\devcli\\tasks.json") && isRegularFile(path)){
+    #else
+    if(userDirectory(path, sizeof(path), "XDG_CONFIG_HOME", "HOME", "/.config", "/devcli/tasks.json") && isRegularFile(path)){
+    #endif
+        LOG("Using user catalog: %s", path);
+    }
+    else if(!ISATTY(0)){
+        LOG_ERROR("tasks.json not found from %s up to the repository root; set DEVCLI_CONFIG to its path.", directory);
         return NULL;
     }
     else{
-        LOG("Using manually entered path: %s", cachedPath);
-    }
-    FILE *cfg=fopen(".devcli_config","w");
-    if(cfg){
-        fprintf(cfg,"%s\n",cachedPath);
-        fclose(cfg);
+        printf(RED "Warning: tasks.json not found in expected locations.\n");
+        printf(YELLOW "You may have altered the cloned setup. Please enter path to tasks.json manually: " RESET);
+        if(!fgets(path, sizeof(path), stdin)) path[0]='\0';
+        path[strcspn(path, "\r\n")]='\0';
+        if(!isRegularFile(path)){
+            LOG_ERROR("Provided path is also invalid.");
+            return NULL;
+        }
+        LOG("Using manually entered path: %s", path);
     }
-    fclose(f);
-    return strdup(cachedPath);
+    pathCacheStore(directory, path);
+    return strdup(path);
 }
 
 /**
@@ -349,61 +580,336 @@ char* readFileToBuffer(char *path){
     return(tasks);
 }
 
-/** @} */ // end of init group
+/**
+ * @def CONFIG_CACHE_NAME
+ * @brief File name of the compiled image next to `tasks.json`, used when
+ *        there is no per-user cache directory.
+ */
+#define CONFIG_CACHE_NAME ".devcli_cache"
 
-/** @defgroup helpers Helper Utilities
- *  @brief Utility functions for string manipulation and command processing.
- *  @{
+/**
+ * @brief Fills `out` with the path of the compiled image for a project
+ *        `tasks.json`.
+ *
+ * @details The image is `config-<hash>` in the cache directory (see
+ *          `cacheFile()`), where the hash is of the absolute path of
+ *          `tasks.json`, so every process using the same catalog maps the
+ *          same file whatever its working directory, and read-only trees
+ *          get no file written into them. Without a cache directory, the
+ *          image is `CONFIG_CACHE_NAME` next to `tasks.json`.
+ *
+ * @ingroup init
+ *
+ * @return bool `true` if the path fit in `out`.
  */
+bool configCacheFile(const char *projectPath, char *out, size_t size){
+    char absolute[PATH_MAX_LENGTH];
+    #ifdef _WIN32
+        if(!_fullpath(absolute, projectPath, sizeof(absolute))) snprintf(absolute, sizeof(absolute), "%s", projectPath);
+    #else
+        char *resolved=realpath(projectPath, NULL);
+        snprintf(absolute, sizeof(absolute), "%s", resolved ? resolved : projectPath);
+        free(resolved);
+    #endif
+    uint64_t hash=fingerprintBytes(FINGERPRINT_SEED, absolute, strlen(absolute));
+    char name[32];
+    snprintf(name, sizeof(name), "config-%016llx", (unsigned long long)hash);
+    if(cacheFile(out, size, name)) return true;
+    const char *slash=strrchr(absolute, PATH_SEPARATOR);
+    #ifdef _WIN32
+        if(!slash) slash=strrchr(absolute, '/');
+    #endif
+    int n=slash ? snprintf(out, size, "%.*s%c%s", (int)(slash-absolute), absolute, PATH_SEPARATOR, CONFIG_CACHE_NAME)
+                : snprintf(out, size, "%s", CONFIG_CACHE_NAME);
+    return n>0 && (size_t)n<size;
+}
 
 /**
- * @brief Extracts a substring from the given input string based on start and end indices.
+ * @brief Fills `out` with the path of the global or user configuration layer.
  *
- * @details Creates a new string by copying characters from `userInput` starting
- *          at index `start` and ending at index `last` (inclusive).
- *          The result is null-terminated and stored in dynamically allocated memory.
+ * @details The global catalog is `DEVCLI_GLOBAL_TASKS` if set, otherwise
+ *          `%PROGRAMDATA%\devcli\tasks.json` on Windows and
+ *          `/etc/devcli/tasks.json` elsewhere. The user override file is
+ *          `%USERPROFILE%\.devcli\tasks.json` or `$HOME/.devcli/tasks.json`.
  *
- *          This function is used internally to split commands like
- *          `install.git` into separate components (`install` and `git`)
- *          for searching commands and dependencies in `tasks.json`.
+ * @ingroup init
  *
- *          In the current implementation, the function is always called with
- *          valid indices, so there is no risk of out-of-bounds access unless
- *          the code is modified incorrectly.
+ * @param user `true` for the user layer, `false` for the global layer.
+ * @param out Buffer for the path.
+ * @param size Size of `out`.
  *
- * @param userInput The original string from which the slice will be taken.
- * @param start The starting index (0-based) of the slice.
- * @param last The ending index (0-based, inclusive) of the slice.
+ * @return bool `true` if a path could be formed.
+ */
+bool configLayerPath(bool user, char *out, size_t size){
+    #ifdef _WIN32
+        const char *root=getenv(user ? "USERPROFILE" : "PROGRAMDATA");
+        const char *suffix=user ? "\\.devcli\\tasks.json" : "\\devcli\\tasks.json";
+    #else
+        const char *root=user ? getenv("HOME") : "";
+        const char *suffix=user ? "/.devcli/tasks.json" : "/etc/devcli/tasks.json";
+    #endif
+    if(!user && getenv("DEVCLI_GLOBAL_TASKS")){
+        root=getenv("DEVCLI_GLOBAL_TASKS");
+        suffix="";
+    }
+    if(!root) return false;
+    int n=snprintf(out, size, "%s%s", root, suffix);
+    return n>0 && (size_t)n<size;
+}
+
+/**
+ * @brief FNV-1a over `len` bytes, continuing from `hash`; start a key from
+ *        `FINGERPRINT_SEED`.
  *
- * @return char* A heap-allocated substring extracted from the input.
- *               In the current implementation, memory is freed later in the program.
+ * @ingroup init
+ */
+uint64_t fingerprintBytes(uint64_t hash, const void *data, size_t len){
+    const unsigned char *bytes=data;
+    for(size_t i=0; i<len; i++) hash=(hash^bytes[i])*1099511628211ull;
+    return hash;
+}
+
+/**
+ * @brief Folds `text` and its terminator into `hash`, so that consecutive
+ *        strings cannot run into each other.
  *
- * @ingroup helpers
- * 
- * @note This function assumes valid index values as provided by the program logic.
- *       It does not perform bounds checking internally.
+ * @ingroup init
+ */
+uint64_t fingerprintText(uint64_t hash, const char *text){
+    return fingerprintBytes(hash, text, strlen(text)+1);
+}
+
+/**
+ * @brief Folds a file's path, size and modification time into a cache key.
+ */
+uint64_t fingerprintFile(uint64_t hash, const char *path, const struct stat *info){
+    uint64_t fields[3]={(uint64_t)info->st_size, (uint64_t)info->st_mtime, 0};
+    #if defined(__linux__)
+        fields[2]=(uint64_t)info->st_mtim.tv_nsec;
+    #endif
+    return fingerprintBytes(fingerprintText(hash, path), fields, sizeof(fields));
+}
+
+/**
+ * @brief Splits a command line into words in place, at spaces and tabs,
+ *        removing double quotes.
  *
- * @warning Altering how this function is called or modifying the index logic without
- *          understanding the program may lead to undefined behavior.
+ * @details Callers refuse other shell syntax before splitting; a quoted
+ *          word keeps its spaces.
+ *
+ * @ingroup init
+ *
+ * @param copy Writable copy of the command; the words point into it.
+ * @param words Receives the words.
+ * @param max Size of `words`.
+ *
+ * @return int Number of words, or `-1` if there are more than `max` or a
+ *         quote is not closed.
+ */
+int splitCommandWords(char *copy, char **words, int max){
+    int count=0;
+    char *in=copy, *out=copy;
+    while(*in){
+        while(*in==' ' || *in=='\t') in++;
+        if(!*in) break;
+        if(count==max) return -1;
+        words[count++]=out;
+        int quoted=0;
+        while(*in && (quoted || (*in!=' ' && *in!='\t'))){
+            if(*in=='"') quoted=!quoted;
+            else *out++=*in;
+            in++;
+        }
+        if(quoted) return -1;
+        if(*in) in++;
+        *out++='\0';
+    }
+    return count;
+}
+
+/**
+ * @brief Walks one directory of `walkPythonTree()`.
+ */
+static void walkPythonLevel(const char *dir, int depth, PythonVisitor visit, void *context){
+    char path[4096];
+    struct stat info;
+    const char *where=dir[0] ? dir : ".";
+    snprintf(path, sizeof(path), "%s/pyvenv.cfg", where);
+    if(depth>PYTHON_TREE_DEPTH || stat(path, &info)==0) return;
+    #ifdef _WIN32
+        char pattern[4096];
+        snprintf(pattern, sizeof(pattern), "%s\\*", where);
+        WIN32_FIND_DATAA found;
+        HANDLE find=FindFirstFileA(pattern, &found);
+        if(find==INVALID_HANDLE_VALUE) return;
+        do{
+            const char *name=found.cFileName;
+    #else
+        DIR *listing=opendir(where);
+        if(!listing) return;
+        const struct dirent *entry;
+        while((entry=readdir(listing))){
+            const char *name=entry->d_name;
+    #endif
+            if(name[0]=='.' || strcmp(name, "__pycache__")==0 || strcmp(name, "node_modules")==0) continue;
+            int n=dir[0] ? snprintf(path, sizeof(path), "%s/%s", dir, name) : snprintf(path, sizeof(path), "%s", name);
+            if(n<0 || (size_t)n>=sizeof(path) || stat(path, &info)!=0) continue;
+            if(info.st_mode&S_IFDIR) walkPythonLevel(path, depth+1, visit, context);
+            else visit(path, name, &info, depth, context);
+    #ifdef _WIN32
+        }while(FindNextFileA(find, &found));
+        FindClose(find);
+    #else
+        }
+        closedir(listing);
+    #endif
+}
+
+/**
+ * @brief Calls `visit` for every file of a Python project below `dir`.
+ *
+ * @details Hidden directories, `__pycache__`, `node_modules` and virtual
+ *          environments (directories with a `pyvenv.cfg`) are skipped, and
+ *          so is anything deeper than `PYTHON_TREE_DEPTH`. Files come in
+ *          the order the directories list them.
+ *
+ * @ingroup init
+ *
+ * @param dir Directory to walk; `""` walks the working directory and
+ *        yields paths relative to it.
+ * @param visit Called with each file's path, name, `stat()` result, depth
+ *        below `dir` (`0` for its own files) and `context`.
+ * @param context Passed through to `visit`.
+ *
+ * Example usage:
+ * @code
+ * static void count(const char *path, const char *name, const struct stat *info, int depth, void *context){
+ *     ++*(int*)context;
+ * }
+ * int files = 0;
+ * walkPythonTree("", count, &files);
+ * @endcode
+ */
+void walkPythonTree(const char *dir, PythonVisitor visit, void *context){
+    walkPythonLevel(dir, 0, visit, context);
+}
+
+/**
+ * @brief Loads the configuration from every layer and merges it into one image.
+ *
+ * @details Layers are applied lowest first:
+ *          1. The global company catalog (see `configLayerPath()`), if present.
+ *          2. The project `tasks.json` found by `resolveJSONPath()`.
+ *          3. The per-user override file, if present.
+ *
+ *          A higher layer replaces individual `category.task.shell` entries and
+ *          leaves everything else it does not mention untouched, so an override
+ *          file only needs the entries it changes.
+ *
+ *          The merged image is cached in `configCacheFile()`, keyed by the
+ *          path, size and modification time of every layer. When no layer has
+ *          changed, the cache is mapped with `configImageMap()` instead and no
+ *          JSON is parsed at all; concurrent devcli processes then share one
+ *          physical copy of the image. After a rebuild, the fresh cache is
+ *          mapped as well, so the private copy can be dropped right away.
+ *
+ * @ingroup init
+ *
+ * @param projectPath Path of the project `tasks.json`.
+ * @param mapped Set to `true` if the result is a mapping of the cache.
+ *
+ * @return const ConfigImage* Merged, frozen configuration (release with
+ *         `configImageUnmap()` if `mapped`, `configFree()` otherwise), or
+ *         `NULL` if a layer could not be loaded.
  *
  * Example usage:
  * @code
- * char *part = slice("install.git", 0, 6); // "install"
- * // Used internally for command resolution
- * free(part); // Freed later by program logic
+ * bool mapped;
+ * const ConfigImage *config = loadConfig(path, &mapped);
+ * if (config) {
+ *     help(config);
+ *     if (mapped) configImageUnmap(config);
+ *     else configFree(config);
+ * }
  * @endcode
  */
-char *slice(char *userInput, int start, int last){
-    int length=((last+1)-start);
-    char *output=(char*)malloc((length+1)*sizeof(char));
-    LOG("Slicing input from %d to %d", start, last);
-    for(int i=0; i<length; i++){
-        output[i]=userInput[start+i];
+const ConfigImage* loadConfig(const char *projectPath, bool *mapped){
+    char globalPath[1024], userPath[1024];
+    const char *layers[3];
+    size_t layerCount=0;
+    if(configLayerPath(false, globalPath, sizeof(globalPath))) layers[layerCount++]=globalPath;
+    layers[layerCount++]=projectPath;
+    if(configLayerPath(true, userPath, sizeof(userPath))) layers[layerCount++]=userPath;
+
+    uint64_t key=FINGERPRINT_SEED;
+    size_t present=0;
+    for(size_t i=0; i<layerCount; i++){
+        struct stat info;
+        if(stat(layers[i], &info)!=0){
+            if(layers[i]==projectPath){
+                LOG_ERROR("Could not stat %s", projectPath);
+                return NULL;
+            }
+            continue;
+        }
+        layers[present++]=layers[i];
+        key=fingerprintFile(key, layers[i], &info);
     }
-    output[length]='\0';
-    return output;
+    *mapped=false;
+    char cachePath[PATH_MAX_LENGTH+64];
+    bool cached=configCacheFile(projectPath, cachePath, sizeof(cachePath));
+    const ConfigImage *shared=cached ? configImageMap(cachePath, key) : NULL;
+    if(shared){
+        LOG("Mapped compiled config from %s (%llu bytes, shared).", cachePath, (unsigned long long)shared->size);
+        *mapped=true;
+        return shared;
+    }
+
+    ConfigBuilder *builder=configBuilderCreate();
+    if(!builder) return NULL;
+    int failed=0;
+    for(size_t i=0; i<present && !failed; i++){
+        char *tasks=readFileToBuffer((char*)layers[i]);
+        if(tasks==NULL){
+            LOG_ERROR("File was read incorrectly: %s", layers[i]);
+            failed=1;
+            break;
+        }
+        JsonTape doc;
+        size_t length=strlen(tasks);
+        int indexed=length>=TAPE_PARALLEL_MIN_BYTES && tapeHardwareThreads()>1;
+        int parsed=indexed ? tapeParseIndexed(tasks, length, &doc, 0) : tapeParse(tasks, length, &doc);
+        if(parsed!=0){
+            LOG_ERROR("Parsing %s failed at byte %zu: %.20s", layers[i], doc.errorOffset, tasks+doc.errorOffset);
+            failed=1;
+        }
+        else{
+            LOG("Layer %s parsed successfully.", layers[i]);
+            if(configBuilderAddTape(builder, &doc)!=0) failed=1;
+            tapeFree(&doc);
+        }
+        free(tasks);
+    }
+    ConfigImage *config=failed ? NULL : configBuilderFinish(builder);
+    configBuilderFree(builder);
+    if(config && cached && configImageSave(config, cachePath, key)==0){
+        shared=configImageMap(cachePath, key);
+        if(shared){
+            configFree(config);
+            *mapped=true;
+            return shared;
+        }
+    }
+    return config;
 }
 
+/** @} */ // end of init group
+
+/** @defgroup helpers Helper Utilities
+ *  @brief Utility functions for string manipulation and command processing.
+ *  @{
+ */
+
 /**
  * @brief Replaces placeholders in a command string with user-provided values.
  *
@@ -563,6 +1069,9 @@ char* wrap_for_shell(char* command) {
  * @endcode
  */
 bool isAdmin() {
+    #ifndef _WIN32
+        return false;
+    #else
         BOOL isAdmin = FALSE;
         PSID adminGroup = NULL;
         SID_IDENTIFIER_AUTHORITY NtAuthority = SECURITY_NT_AUTHORITY;
@@ -580,7 +1089,8 @@ bool isAdmin() {
             }
             FreeSid(adminGroup);
         }
-    return isAdmin;
+        return isAdmin;
+    #endif
 }
 
 /**
@@ -700,9 +1210,207 @@ int checkAvailability(char *foundAtPath, char *foundAtDrive, char *addFileToPath
  */
 
 /**
- * @brief Executes a user-specified command by resolving it from the JSON configuration.
+ * @brief Runs a task's command through the first runner that takes it.
+ *
+ * @details `compileCacheRun()` serves single gcc or g++ compiles from the
+ *          compile cache, `distCompileRun()` farms other gcc or g++ commands
+ *          out to the workers in `DEVCLI_WORKERS`, and `cmakeBuildRun()` turns
+ *          a `cmake` configure into a configure-if-changed and an incremental
+ *          build, `javaBuildRun()` compiles the changed sources of a javac
+ *          command in one batch, `javaTestRun()` runs the classes of a JUnit
+ *          command in reused runner JVMs, and `pytestShardRun()` splits a
+ *          pytest run into duration-balanced shards. Anything else is
+ *          wrapped with `wrap_for_shell()` and run by `spawnShell()`.
+ *
+ * @param command Command after placeholder substitution.
+ * @param cpus CPU list of the entry, or `NULL`.
+ * @param peakMemory Receives the command's peak memory in MiB.
  *
- * @details This function forms the core execution logic of the tool. It processes
+ * @return int Exit status of the command.
+ *
+ * @ingroup exec
+ */
+static int runTaskCommand(const char *command, const char *cpus, uint32_t *peakMemory){
+    int status;
+    if(compileCacheRun(command, cpus, peakMemory, &status)==0) return status;
+    if(distCompileRun(command, cpus, peakMemory, &status)==0) return status;
+    if(cmakeBuildRun(command, cpus, peakMemory, &status)==0) return status;
+    if(javaBuildRun(command, cpus, peakMemory, &status)==0) return status;
+    if(javaTestRun(command, cpus, peakMemory, &status)==0) return status;
+    if(pytestShardRun(command, cpus, peakMemory, &status)==0) return status;
+    char* finalCommand = wrap_for_shell((char*)command);
+    status = spawnShell(finalCommand, cpus, peakMemory);
+    free(finalCommand);
+    return status;
+}
+
+/**
+ * @brief Runs a `test.*` task's command, narrowed to the tests affected by
+ *        the files changed since its last run.
+ *
+ * @details `testSelectBegin()` chooses the tests; a command it does not
+ *          understand runs unchanged, and one with no affected test does
+ *          not run at all. The chosen command goes through
+ *          `runTaskCommand()`, so a narrowed pytest run is still sharded.
+ *
+ * @param command Command after placeholder substitution.
+ * @param cpus CPU list of the entry, or `NULL`.
+ * @param peakMemory Receives the command's peak memory in MiB.
+ *
+ * @return int Exit status of the command, `0` if it was skipped.
+ *
+ * @ingroup exec
+ */
+static int runTestCommand(const char *command, const char *cpus, uint32_t *peakMemory){
+    TestSelection *selection=testSelectBegin(command);
+    if(!selection) return runTaskCommand(command, cpus, peakMemory);
+    const char *selected=testSelectCommand(selection);
+    int status=selected ? runTaskCommand(selected, cpus, peakMemory) : 0;
+    testSelectEnd(selection, status);
+    return status;
+}
+
+/**
+ * @brief Executes one node of a plan; its dependencies have already run.
+ *
+ * @details Nodes whose tool was handled by `planInstallPackages()` are
+ *          skipped, and so are nodes with a `requirements` file whose every
+ *          requirement is already installed (see `pkgdbRequirementsSatisfied()`).
+ *          Otherwise, using the entry for the detected shell:
+ *          - For `install.*` commands:
+ *            - Checks tool availability using `checkAvailability()`, unless
+ *              the entry has no probes (e.g. `install.all`).
+ *            - Determines admin privileges via `isAdmin()` (Windows only).
+ *            - Selects appropriate installation command (Chocolatey, Scoop, or Linux equivalent).
+ *          - For other commands:
+ *            - Handles placeholder substitution (`{{path}}`, `{{name}}`) via
+ *              `replacePlaceholder()`.
+ *            - Runs the command with `runTaskCommand()`: single gcc or g++
+ *              compiles, such as `build.gcc`, come from the compile cache
+ *              when their inputs are unchanged, other gcc or g++ commands
+ *              are farmed out to compile workers, `cmake` configures such as
+ *              `build.filesByCmake` only configure when their inputs
+ *              changed, javac commands such as `build.java` compile only
+ *              their changed sources, JUnit commands such as `test.java`
+ *              with several classes share a few runner JVMs, and the rest is wrapped with `wrap_for_shell()`.
+ *              `test.*` tasks go through `runTestCommand()` first, which runs
+ *              only the tests affected by the files changed since last time.
+ *          - Executes final command using `spawnShell()`, which works like
+ *            `system()`, pins the command to the entry's `cpus` if it lists
+ *            any, and stores the command's peak memory in `node->peakMemory`.
+ *
+ *          The image is only read, never written, so this function can be called
+ *          from several threads on the same image; `schedRun()` calls it from
+ *          each of its workers, each with a different node.
+ *
+ * @param config Frozen configuration.
+ * @param node Plan node to run; receives `peakMemory`.
+ *
+ * @return void
+ *
+ * @ingroup exec
+ */
+void runTask(const ConfigImage *config, PlanNode *node){
+    const ConfigTask *taskInfo=&configTasks(config)[node->task];
+    const char *input1=configString(config, configCategories(config)[taskInfo->category].name);
+    const char *input2=configString(config, taskInfo->name);
+    const ConfigEntry *shellCommand=node->entry;
+    if (!shellCommand) {
+        LOG_ERROR("Shell-specific command missing for %s.%s", input1, input2);
+        return;
+    }
+    if (node->status!=PLAN_PENDING) {
+        LOG("%s.%s was already handled while installing packages.", input1, input2);
+        return;
+    }
+    LOG("Found shell-specific command object");
+    const char *requirements=configString(config, shellCommand->requirements);
+    if (requirements) {
+        PackageIndex installed;
+        if (pkgdbOpenPython(&installed)==0) {
+            int satisfied=pkgdbRequirementsSatisfied(&installed, requirements);
+            pkgdbClose(&installed);
+            if (satisfied) {
+                LOG("Every requirement in %s is already installed; skipping %s.%s.", requirements, input1, input2);
+                return;
+            }
+        }
+    }
+    const char *runningCommand=configString(config, shellCommand->cmd);
+    int (*run)(const char*, const char*, uint32_t*)=strcmp(input1, "test")==0 ? runTestCommand : runTaskCommand;
+    bool windowsShell=(shellKind==CONFIG_SHELL_CMD || shellKind==CONFIG_SHELL_POWERSHELL);
+    bool install=strcmp(input1, "install")==0;
+    if (!runningCommand && !(install && windowsShell)) {
+        if (shellCommand->depCount==0) LOG_ERROR("No valid 'cmd' string found in JSON for this command");
+        return;
+    }
+    LOG("Final command to run: %s", runningCommand ? runningCommand : "(package manager specific)");
+    if(install){
+        char *foundAtPath=(char*)configString(config, shellCommand->atPath);
+        char *foundAtDrive=(char*)configString(config, shellCommand->atDrive);
+        char *addFileToPath=(char*)configString(config, shellCommand->addToPath);
+        int result=1;
+        if(foundAtPath || foundAtDrive || addFileToPath){
+            LOG("Checking: atPath=%s, atDrive=%s, addToPath=%s", foundAtPath, foundAtDrive, addFileToPath);
+            result=checkAvailability(foundAtPath, foundAtDrive, addFileToPath);
+        }
+        if(result==0){
+            LOG("File is already in path or has been added temporarily.");
+        }
+        else{
+            const char *installCommand=runningCommand;
+            if (windowsShell){
+                installCommand=configString(config, isAdmin() ? shellCommand->choco : shellCommand->scoop);
+            }
+            if (!installCommand) {
+                LOG_ERROR("No valid 'cmd' string found in JSON for this command");
+            }
+            else{
+                LOG("Executing: %s", installCommand);
+                char* finalCommand = wrap_for_shell((char*)installCommand);
+                int status = spawnShell(finalCommand, configString(config, shellCommand->cpus), &node->peakMemory);
+                free(finalCommand);
+                if (status != 0) {
+                    LOG_ERROR("Command execution failed with status: %d", status);
+                }
+            }
+        }
+    }
+    else if(strstr(runningCommand, "{{path}}") || strstr(runningCommand, "{{name}}")){
+        char *commandWithPath=strdup(runningCommand);
+        if(strstr(commandWithPath, "{{path}}")){
+            char *replaced=replacePlaceholder(commandWithPath, "{{path}}");
+            free(commandWithPath);
+            commandWithPath=replaced;
+        }
+        if(commandWithPath && strstr(commandWithPath, "{{name}}")){
+            char *replaced=replacePlaceholder(commandWithPath, "{{name}}");
+            free(commandWithPath);
+            commandWithPath=replaced;
+        }
+        if(!commandWithPath){
+            LOG_ERROR("Dynamic Memory allocation failed.");
+            return;
+        }
+        LOG("Executing command: %s", commandWithPath);
+        int status=run(commandWithPath, configString(config, shellCommand->cpus), &node->peakMemory);
+        if (status != 0) {
+            LOG_ERROR("Command execution failed with status: %d", status);
+        }
+        free(commandWithPath);
+    }
+    else{
+        int status=run(runningCommand, configString(config, shellCommand->cpus), &node->peakMemory);
+        if (status != 0) {
+            LOG_ERROR("Command execution failed with status: %d", status);
+        }
+    }
+}
+
+/**
+ * @brief Executes a user-specified command by resolving it from the frozen configuration.
+ *
+ * @details This function is the entry point of the execution core. It processes
  *          user commands of the format:
  *
  *          @code
@@ -713,40 +1421,33 @@ int checkAvailability(char *foundAtPath, char *foundAtDrive, char *addFileToPath
  *
  *          The steps performed by this function include:
  *          1. **Validation:** Ensures the command follows the expected format.
- *          2. **Splitting:** Divides the command into `input1` (category) and
- *             `input2` (subcommand) using the `slice()` function.
- *          3. **Command Resolution:** Looks up `input1` and `input2` in the
- *             JSON object (`root`) and retrieves the shell-specific command object.
- *          4. **Dependency Handling:** If the command specifies a `dependsOn` array,
- *             executes dependencies recursively before the main command.
- *          5. **Execution Logic:**
- *             - For `install.*` commands:
- *               - Checks tool availability using `check_availability()`.
- *               - Determines admin privileges via `is_admin()` (Windows only).
- *               - Selects appropriate installation command (Chocolatey, Scoop, or Linux equivalent).
- *             - For other commands:
- *               - Handles placeholder substitution (`{{path}}`, `{{name}}`) via
- *                 `replacePlaceholder()`.
- *               - Wraps commands for shell compatibility using `wrap_for_shell()`.
- *             - Executes final command using `system()`.
- *
- *          6. **Error Handling:** Logs all failures (invalid JSON structure, missing
- *             keys, or execution errors).
- *
- *          **Memory Management:** All intermediate strings (splits, replacements,
- *          wrapped commands) are allocated and freed within the function. The caller
- *          does not need to manage any additional memory.
- *
- * @param root Pointer to the root cJSON object representing the parsed `tasks.json`.
+ *          2. **Command Resolution:** Looks the whole `category.subcommand` name up
+ *             in the hash table of the frozen configuration with `configFindTask()`.
+ *          3. **Planning:** Lists the task and its `dependsOn` closure with
+ *             `planBuild()`, each task once and after its dependencies.
+ *          4. **Installation:** Installs the missing packages of all install
+ *             tasks in the plan in one package-manager transaction with
+ *             `planInstallPackages()` (apt on Linux, Chocolatey or Scoop on
+ *             Windows depending on `isAdmin()`).
+ *          5. **Execution:** Runs the remaining nodes with `runTask()` through
+ *             `schedRun()`, up to `options->jobs` at a time, each once its
+ *             dependencies have finished and it can hold the `resources` it
+ *             declares.
+ *          6. **Report:** Logs the hit rate of the compile cache with
+ *             `compileCacheReport()`.
+ *
+ *          **Memory Management:** The plan is freed before returning; the
+ *          configuration is only read.
+ *
+ * @param config Frozen configuration built from `tasks.json`.
  * @param userInput The user-entered command string (e.g., `install.git`).
  * @param len Length of the userInput string.
+ * @param options Concurrency and isolation options (`-j`, `--adaptive`,
+ *        `--max-load`, `--memory-budget`, `--cgroup`, `--cpu-weight`).
  *
  * @return void
  *
  * @ingroup exec
- * 
- * @note The function uses recursion for handling dependencies. Excessively deep
- *       dependency chains may impact performance or stack usage.
  *
  * @warning Altering the execution flow without understanding the dependency resolution,
  *          privilege checks, and placeholder handling may cause command failures or
@@ -754,10 +1455,11 @@ int checkAvailability(char *foundAtPath, char *foundAtDrive, char *addFileToPath
  *
  * Example usage:
  * @code
- * runCommands(root, "install.git", strlen("install.git"));
+ * SchedOptions options = {1, 0, 0, 0, 0, ISOLATION_DEFAULT_WEIGHT};
+ * runCommands(config, "install.git", strlen("install.git"), &options);
  * @endcode
  */
-void runCommands(cJSON *root, char *userInput, int len){
+void runCommands(const ConfigImage *config, char *userInput, int len, const SchedOptions *options){
     LOG("Starting command: %s", userInput);
     int index=-1;
     for (int i=0; i<len-1; i++) {
@@ -774,134 +1476,21 @@ void runCommands(cJSON *root, char *userInput, int len){
         LOG_ERROR("Invalid command syntax near '.'");
         return;
     }
-    char *input1 = slice(userInput, 0, index - 1);
-    char *input2 = slice(userInput, index + 1, len - 1);
-    cJSON *command=cJSON_GetObjectItem(root, input1);
-    if (!command) {
-        LOG_ERROR("No such category: %s", input1);
+    uint32_t task=configFindTask(config, userInput, (size_t)len);
+    if (task==CONFIG_NONE) {
+        LOG_ERROR("No such category: %.*s", len, userInput);
         return;
     }
-    if(cJSON_IsObject(command)){
-        cJSON *fullCommand=cJSON_GetObjectItem(command, input2);
-        if (!fullCommand) {
-            LOG_ERROR("No such category: %s.%s", input1,input2);
-            return;
-        }
-        if(cJSON_IsObject(fullCommand)){
-            cJSON *shellCommand=cJSON_GetObjectItem(fullCommand, shell);
-            if (!shellCommand) {
-                LOG_ERROR("Shell-specific command missing for %s.%s", input1, input2);
-                return;
-            }
-            if(cJSON_IsObject(shellCommand)){
-                LOG("Found shell-specific command object");
-                cJSON *dependency = cJSON_GetObjectItem(shellCommand, "dependsOn");
-                if(cJSON_IsArray(dependency)){
-                    int size= cJSON_GetArraySize(dependency);
-                    for(int i=0; i<size; i++){
-                        cJSON *Item = cJSON_GetArrayItem(dependency,i);
-                        if (cJSON_IsString(Item)) {
-                            runCommands(root, Item->valuestring, strlen(Item->valuestring));
-                        }
-                    }
-                }
-                cJSON *runningCommand=cJSON_GetObjectItem(shellCommand, "cmd");
-                LOG("Final command to run: %s", runningCommand->valuestring);
-                char value[100];
-                if (!runningCommand || (!cJSON_IsString(runningCommand) && (strcmp(shell, "CMD") == 0 || strcmp(shell, "Powershell") == 0) && strcmp(input1, "install")!=0)) {
-                    LOG_ERROR("No valid 'cmd' string found in JSON for this command");
-                }
-                else {
-                    if(strcmp(input1, "install")==0){
-                        if(strcmp(input2, "all")!=0){
-                            cJSON *foundAtPath=cJSON_GetObjectItem(shellCommand, "atPath");
-                            cJSON *foundAtDrive=cJSON_GetObjectItem(shellCommand, "atDrive");
-                            cJSON *addFileToPath=cJSON_GetObjectItem(shellCommand, "addToPath");
-                            LOG("Checking: atPath=%s, atDrive=%s, addToPath=%s", foundAtPath->valuestring, foundAtDrive->valuestring, addFileToPath->valuestring);
-                            int result=checkAvailability(foundAtPath->valuestring, foundAtDrive->valuestring, addFileToPath->valuestring);
-                            if(result==0){
-                                LOG("File is already in path or has been added temporarily.");
-                            }
-                            else{
-                                if (strcmp(shell, "CMD") == 0 || strcmp(shell, "Powershell") == 0){
-                                    bool adminCheck=isAdmin();
-                                    if(adminCheck==true){
-                                        cJSON *adminCommand=cJSON_GetObjectItem(runningCommand, "choco");
-                                        if (!adminCommand || !cJSON_IsString(adminCommand)) {
-                                            LOG_ERROR("No valid 'cmd' string found in JSON for this command");
-                                        }
-                                        else{
-                                            LOG("Executing: %s", adminCommand->valuestring);
-                                            char* finalCommand = wrap_for_shell(adminCommand->valuestring);
-                                            int status = system(finalCommand);
-                                            free(finalCommand);
-                                            if (status != 0) {
-                                                LOG_ERROR("Command execution failed with status: %d", status);
-                                            }
-                                        }
-                                    }
-                                    else{
-                                        cJSON *adminCommand=cJSON_GetObjectItem(runningCommand, "scoop");
-                                        if (!adminCommand || !cJSON_IsString(adminCommand)) {
-                                            LOG_ERROR("No valid 'cmd' string found in JSON for this command");
-                                        }
-                                        else{
-                                            LOG("Executing: %s", adminCommand->valuestring);
-                                            char* finalCommand = wrap_for_shell(adminCommand->valuestring);
-                                            int status = system(finalCommand);
-                                            free(finalCommand);
-                                            if (status != 0) {
-                                                LOG_ERROR("Command execution failed with status: %d", status);
-                                            }
-                                        }
-                                    }
-                                }
-                                else{
-                                    LOG("Executing: %s", runningCommand->valuestring);
-                                    int status=system(runningCommand->valuestring);
-                                    if (status != 0) {
-                                        LOG_ERROR("Command execution failed with status: %d", status);
-                                    }
-                                }
-                            }
-                        }
-                    }
-                    else if(strstr(runningCommand->valuestring, "{{path}}") || strstr(runningCommand->valuestring, "{{name}}")){
-                        char *commandWithPath;
-                        if(strstr(runningCommand->valuestring, "{{path}}")){
-                            char *val="{{path}}";
-                            commandWithPath= replacePlaceholder(runningCommand->valuestring, val);
-                        }
-                        if(strstr(runningCommand->valuestring, "{{name}}")){
-                            char *val="{{name}}";
-                            commandWithPath= replacePlaceholder(runningCommand->valuestring, val);
-                        }
-                        char* finalCommand = wrap_for_shell(commandWithPath);
-                        int status = system(finalCommand);
-                        LOG("Executing command: %s", commandWithPath);
-                        free(finalCommand);
-                        if (status != 0) {
-                            LOG_ERROR("Command execution failed with status: %d", status);
-                        }
-                        free(commandWithPath);
-                    }
-                    else{
-                        char* finalCommand = wrap_for_shell(runningCommand->valuestring);
-                        int status = system(finalCommand);
-                        free(finalCommand);
-                        if (status != 0) {
-                            LOG_ERROR("Command execution failed with status: %d", status);
-                        }                    
-                    }
-                }
-            if (!cJSON_IsObject(shellCommand)) {
-                    LOG_ERROR("Shell command object is not valid");
-                }
-            }
-        }
+    Plan plan;
+    if (planBuild(config, task, shellKind, &plan) != 0) return;
+    ConfigPackageManager manager=CONFIG_PM_APT;
+    if (shellKind==CONFIG_SHELL_CMD || shellKind==CONFIG_SHELL_POWERSHELL) {
+        manager=isAdmin() ? CONFIG_PM_CHOCO : CONFIG_PM_SCOOP;
     }
-    free(input1);
-    free(input2);
+    planInstallPackages(&plan, manager);
+    schedRun(&plan, options);
+    compileCacheReport();
+    planFree(&plan);
 }
 
 /** @} */ // end of exec group
@@ -914,15 +1503,15 @@ void runCommands(cJSON *root, char *userInput, int len){
 /**
  * @brief Displays a list of available commands and their descriptions.
  *
- * @details This function iterates through the parsed JSON configuration (`root`)
+ * @details This function iterates through the frozen configuration (`config`)
  *          and prints all commands in the format:
  *
  *          @code
  *          category.subcommand        Description
  *          @endcode
  *
- *          It fetches shell-specific command objects for the current shell
- *          (using the global `shell` variable) and retrieves the `use` key,
+ *          It fetches shell-specific entries for the current shell
+ *          (using the global `shellKind` variable) and retrieves the `use` key,
  *          which contains a short description of the command.
  *
  *          Output is formatted into two columns:
@@ -932,7 +1521,7 @@ void runCommands(cJSON *root, char *userInput, int len){
  *          If a shell-specific command object is missing or invalid for any
  *          entry, the function logs an error and stops.
  *
- * @param root Pointer to the root cJSON object representing the parsed `tasks.json`.
+ * @param config Frozen configuration built from `tasks.json`.
  *
  * @return void
  *
@@ -946,36 +1535,30 @@ void runCommands(cJSON *root, char *userInput, int len){
  *
  * Example usage:
  * @code
- * help(root);
+ * help(config);
  * @endcode
  */
-void help(cJSON *root){
-    cJSON *object=root->child;
-    char *input1;
+void help(const ConfigImage *config){
+    const ConfigTask *tasks=configTasks(config);
     char command[100];
     printf("%-30s %-30s\n", "Command", "Operation");
     printf("---------------------------------------------------------------------------------------------\n");
-    while(object!=NULL){
-        input1=object->string;
-        cJSON *input2= object->child;
-        while(input2!=NULL){
-            snprintf(command,sizeof(command),"%s.%s",input1, input2->string);
-            cJSON *shellObject=cJSON_GetObjectItem(input2, shell);
+    CONFIG_FOR_EACH_CATEGORY(config, category){
+        const char *input1=configString(config, category->name);
+        CONFIG_FOR_EACH_TASK(config, category, t){
+            const char *input2=configString(config, tasks[t].name);
+            snprintf(command,sizeof(command),"%s.%s",input1, input2);
+            const ConfigEntry *shellObject=configTaskEntry(config, t, shellKind);
             if (!shellObject) {
-                LOG_ERROR("Shell-specific command missing for %s.%s", input1, input2->string);
+                LOG_ERROR("Shell-specific command missing for %s.%s", input1, input2);
                 return;
             }
-            if(cJSON_IsObject(shellObject)){
-                cJSON *use=cJSON_GetObjectItem(shellObject, "use");
-                if(cJSON_IsString(use)){
-                    printf("%-30s %-30s\n",command, use->valuestring);
-                }
-            }
-            command[0] = '\0';
-            input2=input2->next;
+            const char *use=configString(config, shellObject->use);
+            if(use){
+                printf("%-30s %-30s\n",command, use);
             }
-            object=object->next;
         }
+    }
 }
 
 /** @} */ // end of userinteraction group
@@ -985,32 +1568,51 @@ void help(cJSON *root){
  *
  * @details This function initializes the CLI tool and orchestrates the entire
  *          workflow for executing user commands. The steps include:
- *          1. **Argument validation:** Ensures the tool is called with exactly
- *             one command-line argument. Logs an error and exits if incorrect.
+ *          1. **Argument validation:** Reads the options `--external`,
+ *             `-j N` (tasks run at once, by default one per processor),
+ *             `--adaptive` (fewer tasks while the host is under pressure) and
+ *             `--max-load L` (no new task while the load average is at least
+ *             `L`) and `--memory-budget SIZE` (memory the running tasks may
+ *             need together, by default what is available at start),
+ *             `--cgroup` and `--cpu-weight N` (confine the run to a cgroup of
+ *             its own), `--all` (test tasks run every test, not only those
+ *             affected by changes), then ensures exactly one command is left. Logs an error and exits if
+ *             incorrect. `worker [host:]port` needs no catalog and serves
+ *             compile jobs with `distWorkerServe()` until killed.
+ *             In builds with `-DDEVCLI_EMBEDDED`, the catalog generated by
+ *             `devcli embed` is then used directly and steps 2-4 are skipped,
+ *             unless the first argument is `--external`.
  *          2. **Path resolution:** Calls `resolveJSONPath()` to determine the
  *             location of `tasks.json`. If not found, logs an error and exits.
- *          3. **File loading:** Reads the contents of `tasks.json` into a buffer
- *             using `readFileToBuffer()`. Logs and exits if reading fails.
- *          4. **Parsing:** Parses the JSON buffer into a cJSON object (`root`).
- *             Logs and exits if parsing fails.
+ *          3. **Maintenance commands:** For `bench` and `verify`, reads the
+ *             project `tasks.json` with `readFileToBuffer()`, runs
+ *             `benchParsers()` or `verifyParsers()` on it and exits.
+ *          4. **Loading:** Calls `loadConfig()`, which merges the global,
+ *             project and user layers into an immutable `ConfigImage`, or
+ *             loads it from the compiled cache when no layer has changed.
+ *             Logs and exits on failure.
  *          5. **Shell detection:** Calls `detectShell()` to identify the current
  *             shell environment (e.g., CMD, PowerShell, Linux).
  *          6. **Command execution:**
  *             - If the command is `help` → Calls `help()` to display all commands.
+ *             - If the command is `embed <file.c>` → Writes the loaded catalog
+ *               as C source with `configImageEmbed()`.
  *             - Otherwise → Passes the command to `runCommands()` for execution.
- *          7. **Cleanup:** Frees allocated memory and deletes the cJSON object
+ *          7. **Cleanup:** Frees allocated memory and the frozen configuration
  *             before exiting.
  *
- * @param argc Number of command-line arguments. Must be `2` for proper execution.
+ * @param argc Number of command-line arguments. Must be `2`, after options, for proper execution.
  * @param argv Array of command-line arguments:
- *             - `argv[1]` → The command to execute (e.g., `install.git` or `help`).
+ *             - `argv[1]` → The command to execute (e.g., `install.git`, `help` or `bench`),
+ *               after any options such as `-j 4`.
  *
  * @return int Returns:
  *         - `0` → Successful execution.
  *         - `1` → Error occurred (invalid arguments, missing file, parse failure).
  *
  * @note The program expects a valid `tasks.json` file to function correctly.
- *       If not found in default locations, the tool prompts the user for its path.
+ *       If not found in default locations, the tool prompts the user for its path
+ *       when run from a terminal and fails otherwise.
  *
  * @warning Modifying the initialization or cleanup sequence without understanding
  *          the dependencies may cause crashes, memory leaks, or incorrect behavior.
@@ -1022,37 +1624,134 @@ void help(cJSON *root){
  * @endcode
  */
 int main(int argc, char* argv[]){
-    if(argc!=2){
-        LOG_ERROR("DEVCLI tool was invoked improperly. Kindly try again in format: devcli <command>. Use 'devcli help' command to know more.");
-        return 1;
-    }
-    LOG("Running DEVCLI tool.");
-    char *path = resolveJSONPath();
-    if(path==NULL){
-        LOG_ERROR("JSON file path could not be found.");
+    bool external=false;
+    SchedOptions options={tapeHardwareThreads(), 0, 0, 0, 0, ISOLATION_DEFAULT_WEIGHT};
+    while(argc>1 && argv[1][0]=='-'){
+        if(strcmp(argv[1], "--external")==0){
+            external=true;
+        }
+        else if(strncmp(argv[1], "-j", 2)==0){
+            const char *count=argv[1][2] ? argv[1]+2 : (argc>2 ? argv[2] : NULL);
+            if(!argv[1][2] && count){
+                argv++;
+                argc--;
+            }
+            char *end=NULL;
+            long value=count ? strtol(count, &end, 10) : 0;
+            if(!count || *end || value<1 || value>1024){
+                LOG_ERROR("Option -j needs a number of tasks from 1 to 1024.");
+                return 1;
+            }
+            options.jobs=(int)value;
+        }
+        else if(strcmp(argv[1], "--adaptive")==0){
+            options.adaptive=1;
+        }
+        else if(strcmp(argv[1], "--max-load")==0){
+            char *end=NULL;
+            double value=argc>2 ? strtod(argv[2], &end) : 0;
+            if(argc<=2 || *end || !(value>0)){
+                LOG_ERROR("Option --max-load needs a load average above 0.");
+                return 1;
+            }
+            options.maxLoad=value;
+            argv++;
+            argc--;
+        }
+        else if(strcmp(argv[1], "--memory-budget")==0){
+            options.memoryBudget=argc>2 ? memorySizeMiB(argv[2]) : 0;
+            if(options.memoryBudget==0){
+                LOG_ERROR("Option --memory-budget needs a size such as 8G or 512M.");
+                return 1;
+            }
+            argv++;
+            argc--;
+        }
+        else if(strcmp(argv[1], "--all")==0){
+            testSelectAll();
+        }
+        else if(strcmp(argv[1], "--cgroup")==0){
+            options.isolate=1;
+        }
+        else if(strcmp(argv[1], "--cpu-weight")==0){
+            char *end=NULL;
+            long value=argc>2 ? strtol(argv[2], &end, 10) : 0;
+            if(argc<=2 || *end || value<1 || value>10000){
+                LOG_ERROR("Option --cpu-weight needs a cgroup CPU weight from 1 to 10000.");
+                return 1;
+            }
+            options.isolate=1;
+            options.cpuWeight=(int)value;
+            argv++;
+            argc--;
+        }
+        else break;
+        argv++;
+        argc--;
     }
-    char *tasks=readFileToBuffer(path);
-    free(path);
-    if(tasks==NULL){
-        LOG_ERROR("File was read incorrectly.");
+    if(argc>1 && argc<=3 && strcmp(argv[1], "worker")==0) return distWorkerServe(argc>2 ? argv[2] : NULL);
+    bool extraArgs=argc>2 && (strcmp(argv[1], "verify")==0 || (argc==3 && strcmp(argv[1], "embed")==0));
+    if(argc>1 && argc!=3 && strcmp(argv[1], "embed")==0){
+        LOG_ERROR("Usage: devcli embed <file.c>");
         return 1;
     }
-    LOG("File successfully read to buffer.");
-    cJSON *root=cJSON_Parse(tasks);
-    if(root==NULL){
-        LOG_ERROR("Parsing failed before: %s", cJSON_GetErrorPtr());
-        free(tasks);
+    if(argc!=2 && !extraArgs){
+        LOG_ERROR("DEVCLI tool was invoked improperly. Kindly try again in format: devcli <command>. Use 'devcli help' command to know more.");
         return 1;
     }
-    LOG("File parsed successfully.");
-    free(tasks);
-    detectShell();
+    LOG("Running DEVCLI tool.");
     char *userInput = argv[1];
-    if (strcmp(userInput, "help") == 0) help(root);
+    const ConfigImage *config=NULL;
+    bool mapped=false, embedded=false;
+    #ifdef DEVCLI_EMBEDDED
+        bool maintenance=strcmp(userInput, "bench")==0 || strcmp(userInput, "verify")==0 || strcmp(userInput, "embed")==0;
+        if(!external && !maintenance){
+            config=(const ConfigImage*)configEmbeddedImage;
+            embedded=true;
+            LOG("Using the catalog embedded at build time.");
+        }
+    #else
+        (void)external;
+    #endif
+    if(!embedded){
+        char *path = resolveJSONPath();
+        if(path==NULL){
+            LOG_ERROR("JSON file path could not be found.");
+            return 1;
+        }
+        if (strcmp(userInput, "bench") == 0 || strcmp(userInput, "verify") == 0){
+            char *tasks=readFileToBuffer(path);
+            free(path);
+            if(tasks==NULL){
+                LOG_ERROR("File was read incorrectly.");
+                return 1;
+            }
+            LOG("File successfully read to buffer.");
+            int status=strcmp(userInput, "bench") == 0 ? benchParsers(tasks, strlen(tasks)) : verifyParsers(argv+2, (size_t)(argc-2), tasks, strlen(tasks));
+            free(tasks);
+            return status;
+        }
+        config=loadConfig(path, &mapped);
+        free(path);
+        if(config==NULL){
+            LOG_ERROR("Config could not be loaded.");
+            return 1;
+        }
+    }
+    int status=0;
+    if (strcmp(userInput, "embed") == 0){
+        status=configImageEmbed(config, argv[2])==0 ? 0 : 1;
+        if(status==0) LOG("Catalog written to %s; build with -DDEVCLI_EMBEDDED and add it to the sources.", argv[2]);
+    }
     else{
-        int len = strlen(userInput);
-        runCommands(root, userInput, len);
+        detectShell();
+        if (strcmp(userInput, "help") == 0) help(config);
+        else{
+            int len = strlen(userInput);
+            runCommands(config, userInput, len, &options);
+        }
     }
-    cJSON_Delete(root);
-    return 0;
-}
\ No newline at end of file
+    if(mapped) configImageUnmap(config);
+    else if(!embedded) configFree(config);
+    return status;
+}
@@ -0,0 +1,266 @@
+/**
+ * @file membudget.c
+ * @brief Records the peak memory of tasks and reads the memory the host has available.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#include "membudget.h"
+#include "devcli.h"
+#include "log.h"
+
+/** @addtogroup membudget
+ *  @{
+ */
+
+/**
+ * @def MEMORY_HISTORY_NAME
+ * @brief File, in the per-user cache directory (see `cacheFile()`), holding
+ *        the peak memory learned per task.
+ */
+#define MEMORY_HISTORY_NAME "memory"
+
+/**
+ * @brief Returns the index of `task` in `history`, or `history->count`.
+ */
+static size_t historyFind(const MemoryHistory *history, const char *task){
+    size_t i=0;
+    while(i<history->count && strcmp(history->names[i], task)!=0) i++;
+    return i;
+}
+
+/**
+ * @brief Adds `task` with `peak` to the end of `history`.
+ *
+ * @return int `0` on success, `-1` on allocation failure.
+ */
+static int historyAppend(MemoryHistory *history, const char *task, uint32_t peak){
+    if(history->count==history->cap){
+        size_t cap=history->cap ? history->cap*2 : 16;
+        char **names=realloc(history->names, cap*sizeof(char*));
+        if(!names) return -1;
+        history->names=names;
+        uint32_t *peaks=realloc(history->peaks, cap*sizeof(uint32_t));
+        if(!peaks) return -1;
+        history->peaks=peaks;
+        unsigned char *recorded=realloc(history->recorded, cap);
+        if(!recorded) return -1;
+        history->recorded=recorded;
+        history->cap=cap;
+    }
+    char *name=strdup(task);
+    if(!name) return -1;
+    history->names[history->count]=name;
+    history->recorded[history->count]=0;
+    history->peaks[history->count++]=peak;
+    return 0;
+}
+
+/**
+ * @brief Loads the peaks recorded by earlier runs of this user.
+ *
+ * @details Each line of the history file holds a task and its peak in MiB,
+ *          separated by a tab. A missing or unreadable file leaves the
+ *          history empty; it only improves estimates.
+ *
+ * @ingroup membudget
+ *
+ * @param history Receives the peaks; release with `memoryHistoryFree()`.
+ *
+ * Example usage:
+ * @code
+ * MemoryHistory history;
+ * memoryHistoryLoad(&history);
+ * uint32_t peak = memoryHistoryPeak(&history, "build.g++");
+ * memoryHistoryFree(&history);
+ * @endcode
+ */
+void memoryHistoryLoad(MemoryHistory *history){
+    memset(history, 0, sizeof(*history));
+    char path[1100];
+    FILE *file=cacheFile(path, sizeof(path), MEMORY_HISTORY_NAME) ? fopen(path, "r") : NULL;
+    if(!file) return;
+    char line[512];
+    while(fgets(line, sizeof(line), file)){
+        char *tab=strchr(line, '\t');
+        if(!tab) continue;
+        *tab='\0';
+        unsigned long peak=strtoul(tab+1, NULL, 10);
+        if(peak>0 && peak<=UINT32_MAX && historyFind(history, line)==history->count && historyAppend(history, line, (uint32_t)peak)!=0) break;
+    }
+    fclose(file);
+}
+
+/**
+ * @brief Returns the peak learned for `task` in MiB, or `0` if none was recorded.
+ *
+ * @ingroup membudget
+ */
+uint32_t memoryHistoryPeak(const MemoryHistory *history, const char *task){
+    size_t i=historyFind(history, task);
+    return i<history->count ? history->peaks[i] : 0;
+}
+
+/**
+ * @brief Records that `task` just peaked at `peak` MiB.
+ *
+ * @details The estimate is the larger of the new peak and seven eighths of
+ *          the old estimate: a task that needed more memory is believed at
+ *          once, while one that got lighter is trusted only gradually, since
+ *          a run that happened to be small (an incremental build, say) says
+ *          little about the next one.
+ *
+ * @ingroup membudget
+ */
+void memoryHistoryRecord(MemoryHistory *history, const char *task, uint32_t peak){
+    if(peak==0) return;
+    size_t i=historyFind(history, task);
+    if(i==history->count){
+        if(historyAppend(history, task, peak)==0){
+            history->recorded[i]=1;
+            history->changed=1;
+        }
+        return;
+    }
+    uint32_t decayed=history->peaks[i]-history->peaks[i]/8;
+    uint32_t estimate=peak>decayed ? peak : decayed;
+    if(estimate!=history->peaks[i]){
+        history->peaks[i]=estimate;
+        history->recorded[i]=1;
+        history->changed=1;
+    }
+}
+
+/**
+ * @brief Writes the history back if anything was recorded.
+ *
+ * @details The file on disk is read again first and only the tasks this
+ *          run recorded replace its entries, so peaks saved meanwhile by a
+ *          concurrent run are kept. The result is written under a
+ *          temporary name and renamed into place, so a concurrent run reads
+ *          either the old or the new one.
+ *
+ * @ingroup membudget
+ */
+void memoryHistorySave(const MemoryHistory *history){
+    if(!history->changed) return;
+    char path[1100], tempPath[1200];
+    if(!cacheFile(path, sizeof(path), MEMORY_HISTORY_NAME)) return;
+    MemoryHistory merged;
+    memoryHistoryLoad(&merged);
+    for(size_t i=0; i<history->count; i++){
+        if(!history->recorded[i]) continue;
+        size_t at=historyFind(&merged, history->names[i]);
+        if(at<merged.count) merged.peaks[at]=history->peaks[i];
+        else historyAppend(&merged, history->names[i], history->peaks[i]);
+    }
+    #ifdef _WIN32
+        snprintf(tempPath, sizeof(tempPath), "%s.%lu.tmp", path, (unsigned long)GetCurrentProcessId());
+    #else
+        snprintf(tempPath, sizeof(tempPath), "%s.%ld.tmp", path, (long)getpid());
+    #endif
+    FILE *file=fopen(tempPath, "w");
+    if(file){
+        for(size_t i=0; i<merged.count; i++) fprintf(file, "%s\t%u\n", merged.names[i], merged.peaks[i]);
+        #ifdef _WIN32
+            if(fclose(file)==0) remove(path);
+            else file=NULL;
+        #else
+            if(fclose(file)!=0) file=NULL;
+        #endif
+    }
+    if(!file || rename(tempPath, path)!=0){
+        remove(tempPath);
+        LOG_ERROR("Could not save the memory used by tasks to %s.", path);
+    }
+    memoryHistoryFree(&merged);
+}
+
+/**
+ * @brief Releases a history loaded by `memoryHistoryLoad()`.
+ *
+ * @ingroup membudget
+ */
+void memoryHistoryFree(MemoryHistory *history){
+    for(size_t i=0; i<history->count; i++) free(history->names[i]);
+    free(history->names);
+    free(history->peaks);
+    free(history->recorded);
+    memset(history, 0, sizeof(*history));
+}
+
+/**
+ * @brief Returns the memory the host can give to new work without swapping, in MiB.
+ *
+ * @details `MemAvailable` from `/proc/meminfo` on Linux, the available
+ *          physical pages elsewhere on POSIX, and `ullAvailPhys` on Windows.
+ *
+ * @ingroup membudget
+ *
+ * @return uint32_t Available memory in MiB, or `0` if it cannot be told.
+ */
+uint32_t memoryAvailable(void){
+    uint64_t bytes=0;
+    #ifdef _WIN32
+        MEMORYSTATUSEX status;
+        status.dwLength=sizeof(status);
+        if(GlobalMemoryStatusEx(&status)) bytes=status.ullAvailPhys;
+    #else
+        FILE *file=fopen("/proc/meminfo", "r");
+        if(file){
+            char line[128];
+            unsigned long long kib;
+            while(fgets(line, sizeof(line), file)){
+                if(sscanf(line, "MemAvailable: %llu kB", &kib)==1){
+                    bytes=(uint64_t)kib*1024;
+                    break;
+                }
+            }
+            fclose(file);
+        }
+        #ifdef _SC_AVPHYS_PAGES
+            if(bytes==0){
+                long pages=sysconf(_SC_AVPHYS_PAGES), pageSize=sysconf(_SC_PAGESIZE);
+                if(pages>0 && pageSize>0) bytes=(uint64_t)pages*(uint64_t)pageSize;
+            }
+        #endif
+    #endif
+    uint64_t mib=bytes>>20;
+    return mib>UINT32_MAX ? UINT32_MAX : (uint32_t)mib;
+}
+
+/**
+ * @brief Parses a size such as `"512"` (MiB), `"512M"` or `"1.5G"`.
+ *
+ * @details Suffixes `K`, `M`, `G` and `T` may be followed by `B` or `iB`;
+ *          all are powers of 1024.
+ *
+ * @ingroup membudget
+ *
+ * @return uint32_t Size in MiB rounded up, or `0` if `text` is not a size.
+ */
+uint32_t memorySizeMiB(const char *text){
+    char *end=NULL;
+    double value=strtod(text, &end);
+    if(end==text) return 0;
+    switch(*end){
+        case 'k': case 'K': value/=1024; end++; break;
+        case 'm': case 'M': end++; break;
+        case 'g': case 'G': value*=1024; end++; break;
+        case 't': case 'T': value*=1024.0*1024; end++; break;
+        default: break;
+    }
+    if(*end=='i') end++;
+    if(*end=='B' || *end=='b') end++;
+    if(*end || !(value>0 && value<(double)UINT32_MAX)) return 0;
+    uint32_t mib=(uint32_t)value;
+    return (double)mib<value ? mib+1 : mib;
+}
+
+/** @} */ // end of membudget group
@@ -0,0 +1,40 @@
+/**
+ * @file membudget.h
+ * @brief Peak memory learned per task and the memory the host can spare.
+ */
+
+#ifndef DEVCLI_MEMBUDGET_H
+#define DEVCLI_MEMBUDGET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @defgroup membudget Memory Budget
+ *  @brief Estimates how much memory tasks need so that heavy ones are not started together.
+ *  @{
+ */
+
+/**
+ * @brief Largest memory use recorded per task, loaded from and saved to the
+ *        per-user cache directory.
+ */
+typedef struct {
+    char **names;       /**< `category.task`, unsorted. */
+    uint32_t *peaks;    /**< Peak in MiB, parallel to `names`. */
+    unsigned char *recorded; /**< Set for tasks this run recorded, parallel to `names`. */
+    size_t count;
+    size_t cap;
+    int changed;        /**< Something was recorded since loading. */
+} MemoryHistory;
+
+void memoryHistoryLoad(MemoryHistory *history);
+uint32_t memoryHistoryPeak(const MemoryHistory *history, const char *task);
+void memoryHistoryRecord(MemoryHistory *history, const char *task, uint32_t peak);
+void memoryHistorySave(const MemoryHistory *history);
+void memoryHistoryFree(MemoryHistory *history);
+uint32_t memoryAvailable(void);
+uint32_t memorySizeMiB(const char *text);
+
+/** @} */ // end of membudget group
+
+#endif /* DEVCLI_MEMBUDGET_H */
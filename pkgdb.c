@@ -0,0 +1,783 @@
+/**
+ * @file pkgdb.c
+ * @brief Reads `/var/lib/dpkg/status` and Python `site-packages` metadata directly.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include "pkgdb.h"
+#include "log.h"
+
+/** @addtogroup pkgdb
+ *  @{
+ */
+
+/**
+ * @def DPKG_STATUS_PATH
+ * @brief dpkg's database of installed packages; `DEVCLI_DPKG_STATUS` overrides it.
+ */
+#define DPKG_STATUS_PATH "/var/lib/dpkg/status"
+
+/**
+ * @def PKGDB_MAX_SEGMENTS
+ * @brief Release segments compared in a Python version (`1.2.3` has three).
+ */
+#define PKGDB_MAX_SEGMENTS 8
+
+/**
+ * @def PKGDB_PATH_LENGTH
+ * @brief Size of the buffers holding site-packages paths.
+ */
+#define PKGDB_PATH_LENGTH 1024
+
+#ifdef _WIN32
+#define PKGDB_LIST_SEPARATOR ';'
+#else
+#define PKGDB_LIST_SEPARATOR ':'
+#endif
+
+/**
+ * @brief FNV-1a over `len` bytes.
+ */
+static uint32_t hashName(const char *s, size_t len){
+    uint32_t hash=2166136261u;
+    for(size_t i=0; i<len; i++){
+        hash^=(unsigned char)s[i];
+        hash*=16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Appends a record; names are not de-duplicated until the table is built.
+ *
+ * @return int `0` on success, `-1` on allocation failure.
+ */
+static int indexAdd(PackageIndex *index, size_t nameOff, size_t nameLen, size_t versionOff, size_t versionLen){
+    if(index->count==index->cap){
+        size_t cap=index->cap ? index->cap*2 : 256;
+        PackageRecord *grown=realloc(index->records, cap*sizeof(PackageRecord));
+        if(!grown){
+            LOG_ERROR("Dynamic Memory not assigned to package index.");
+            return -1;
+        }
+        index->records=grown;
+        index->cap=cap;
+    }
+    PackageRecord *record=&index->records[index->count++];
+    record->nameOff=(uint32_t)nameOff;
+    record->nameLen=(uint32_t)nameLen;
+    record->versionOff=(uint32_t)versionOff;
+    record->versionLen=(uint32_t)versionLen;
+    return 0;
+}
+
+/**
+ * @brief Hashes every record by name. The first record of a name wins.
+ *
+ * @return int `0` on success, `-1` on allocation failure.
+ */
+static int indexBuild(PackageIndex *index){
+    size_t slotCount=16;
+    while(slotCount<index->count*2) slotCount*=2;
+    index->slots=malloc(slotCount*sizeof(uint32_t));
+    if(!index->slots){
+        LOG_ERROR("Dynamic Memory not assigned to package index.");
+        return -1;
+    }
+    memset(index->slots, 0xFF, slotCount*sizeof(uint32_t));
+    index->slotCount=slotCount;
+    for(size_t i=0; i<index->count; i++){
+        const PackageRecord *record=&index->records[i];
+        if(!pkgdbFind(index, index->base+record->nameOff, record->nameLen)){
+            size_t slot=hashName(index->base+record->nameOff, record->nameLen)&(slotCount-1);
+            while(index->slots[slot]!=0xFFFFFFFFu) slot=(slot+1)&(slotCount-1);
+            index->slots[slot]=(uint32_t)i;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Looks up an installed package by its exact (already normalized) name.
+ *
+ * @ingroup pkgdb
+ *
+ * @return const PackageRecord* The record, or `NULL` if it is not installed.
+ */
+const PackageRecord *pkgdbFind(const PackageIndex *index, const char *name, size_t len){
+    if(index->slotCount==0) return NULL;
+    size_t slot=hashName(name, len)&(index->slotCount-1);
+    while(index->slots[slot]!=0xFFFFFFFFu){
+        const PackageRecord *record=&index->records[index->slots[slot]];
+        if(record->nameLen==len && memcmp(index->base+record->nameOff, name, len)==0) return record;
+        slot=(slot+1)&(index->slotCount-1);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Releases an index opened with `pkgdbOpenDpkg()` or `pkgdbOpenPython()`.
+ */
+void pkgdbClose(PackageIndex *index){
+    #ifndef _WIN32
+        if(index->mappedSize) munmap((void*)index->base, index->mappedSize);
+    #endif
+    free(index->storage);
+    free(index->records);
+    free(index->slots);
+    memset(index, 0, sizeof(*index));
+}
+
+/**
+ * @brief Returns the value of a `Field: value` line if the line starts with `field`.
+ */
+static const char *fieldValue(const char *line, size_t len, const char *field, size_t *valueLen){
+    size_t fieldLen=strlen(field);
+    if(len<=fieldLen || memcmp(line, field, fieldLen)!=0) return NULL;
+    *valueLen=len-fieldLen;
+    while(*valueLen>0 && line[fieldLen+*valueLen-1]==' ') (*valueLen)--;
+    return line+fieldLen;
+}
+
+/**
+ * @brief Indexes the packages dpkg lists as installed.
+ *
+ * @details The status file is mapped read-only and scanned once; records
+ *          point into the mapping, so nothing is copied. A stanza counts if
+ *          its `Status:` ends in `installed` (`install ok installed`,
+ *          `hold ok installed`); removed packages that left configuration
+ *          files behind do not. No process is started.
+ *
+ * @ingroup pkgdb
+ *
+ * @param index Receives the index; release with `pkgdbClose()`.
+ *
+ * @return int `0` on success, `-1` if there is no readable dpkg database
+ *         (e.g. not a Debian-based system), in which case the caller falls
+ *         back to running probes.
+ */
+int pkgdbOpenDpkg(PackageIndex *index){
+    memset(index, 0, sizeof(*index));
+    #ifdef _WIN32
+        return -1;
+    #else
+        const char *path=getenv("DEVCLI_DPKG_STATUS");
+        if(!path || !path[0]) path=DPKG_STATUS_PATH;
+        int fd=open(path, O_RDONLY);
+        if(fd<0) return -1;
+        struct stat info;
+        void *mapped=MAP_FAILED;
+        if(fstat(fd, &info)==0 && info.st_size>0 && (uint64_t)info.st_size<0xFFFFFFFFu){
+            mapped=mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        if(mapped==MAP_FAILED) return -1;
+        index->base=mapped;
+        index->mappedSize=(size_t)info.st_size;
+        const char *p=index->base, *end=index->base+index->mappedSize;
+        const char *name=NULL, *version=NULL;
+        size_t nameLen=0, versionLen=0;
+        int installed=0;
+        while(p<=end){
+            const char *eol=memchr(p, '\n', (size_t)(end-p));
+            if(!eol) eol=end;
+            size_t len=(size_t)(eol-p);
+            size_t valueLen;
+            const char *value;
+            if(len==0){
+                if(name && installed && indexAdd(index, (size_t)(name-index->base), nameLen, version ? (size_t)(version-index->base) : 0, version ? versionLen : 0)!=0){
+                    pkgdbClose(index);
+                    return -1;
+                }
+                name=version=NULL;
+                installed=0;
+            }
+            else if((value=fieldValue(p, len, "Package: ", &valueLen))){
+                name=value;
+                nameLen=valueLen;
+            }
+            else if((value=fieldValue(p, len, "Version: ", &valueLen))){
+                version=value;
+                versionLen=valueLen;
+            }
+            else if((value=fieldValue(p, len, "Status: ", &valueLen))){
+                installed=valueLen>=10 && memcmp(value+valueLen-10, " installed", 10)==0;
+            }
+            p=eol+1;
+        }
+        if(indexBuild(index)!=0){
+            pkgdbClose(index);
+            return -1;
+        }
+        return 0;
+    #endif
+}
+
+/**
+ * @brief Copies `len` bytes into the index storage.
+ *
+ * @return size_t Offset of the copy, or `(size_t)-1` on allocation failure.
+ */
+static size_t storeBytes(PackageIndex *index, const char *s, size_t len){
+    if(index->storageSize+len>index->storageCap){
+        size_t cap=index->storageCap ? index->storageCap : 4096;
+        while(cap<index->storageSize+len) cap*=2;
+        char *grown=realloc(index->storage, cap);
+        if(!grown){
+            LOG_ERROR("Dynamic Memory not assigned to package index.");
+            return (size_t)-1;
+        }
+        index->storage=grown;
+        index->storageCap=cap;
+    }
+    memcpy(index->storage+index->storageSize, s, len);
+    index->storageSize+=len;
+    return index->storageSize-len;
+}
+
+/**
+ * @brief Normalizes a Python project name (PEP 503): lowercase, and runs of
+ *        `-`, `_` and `.` become one `-`.
+ *
+ * @return size_t Length written to `out` (at most `size`).
+ */
+static size_t normalizeName(const char *name, size_t len, char *out, size_t size){
+    size_t n=0;
+    for(size_t i=0; i<len && n<size; i++){
+        char c=name[i];
+        if(c=='-' || c=='_' || c=='.'){
+            if(n>0 && out[n-1]=='-') continue;
+            out[n++]='-';
+        }
+        else{
+            out[n++]=(char)tolower((unsigned char)c);
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief Ends with `suffix`?
+ */
+static int endsWith(const char *s, size_t len, const char *suffix){
+    size_t suffixLen=strlen(suffix);
+    return len>=suffixLen && memcmp(s+len-suffixLen, suffix, suffixLen)==0;
+}
+
+/**
+ * @brief Records one `*.dist-info` or `*.egg-info` entry of a site-packages directory.
+ *
+ * @details Only the directory name is read: `<name>-<version>.dist-info`,
+ *          or `<name>-<version>[-py3.X].egg-info`. The name part never holds
+ *          a `-`, since installers escape it to `_`.
+ */
+static int addPythonEntry(PackageIndex *index, const char *entry){
+    size_t len=strlen(entry);
+    int distInfo=endsWith(entry, len, ".dist-info");
+    if(!distInfo && !endsWith(entry, len, ".egg-info")) return 0;
+    len-=distInfo ? 10 : 9;
+    const char *dash=memchr(entry, '-', len);
+    size_t nameLen=dash ? (size_t)(dash-entry) : len;
+    const char *version=dash ? dash+1 : entry+len;
+    size_t versionLen=dash ? len-nameLen-1 : 0;
+    if(!distInfo){
+        const char *more=memchr(version, '-', versionLen);
+        if(more) versionLen=(size_t)(more-version);
+    }
+    char normalized[256];
+    size_t normalizedLen=normalizeName(entry, nameLen, normalized, sizeof(normalized));
+    size_t nameOff=storeBytes(index, normalized, normalizedLen);
+    size_t versionOff=storeBytes(index, version, versionLen);
+    if(nameOff==(size_t)-1 || versionOff==(size_t)-1) return -1;
+    return indexAdd(index, nameOff, normalizedLen, versionOff, versionLen);
+}
+
+/**
+ * @brief Calls `visit` with the name of every entry of `path`.
+ *
+ * @return int `0` if the directory was listed, `-1` if it could not be
+ *         opened, `-2` if `visit` failed.
+ */
+static int listDirectory(const char *path, int (*visit)(void *context, const char *dir, const char *name), void *context){
+    #ifdef _WIN32
+        char pattern[PKGDB_PATH_LENGTH];
+        snprintf(pattern, sizeof(pattern), "%s\\*", path);
+        WIN32_FIND_DATAA found;
+        HANDLE find=FindFirstFileA(pattern, &found);
+        if(find==INVALID_HANDLE_VALUE) return -1;
+        int status=0;
+        do{
+            if(visit(context, path, found.cFileName)!=0) status=-2;
+        }while(status==0 && FindNextFileA(find, &found));
+        FindClose(find);
+        return status;
+    #else
+        DIR *dir=opendir(path);
+        if(!dir) return -1;
+        int status=0;
+        const struct dirent *entry;
+        while(status==0 && (entry=readdir(dir))){
+            if(visit(context, path, entry->d_name)!=0) status=-2;
+        }
+        closedir(dir);
+        return status;
+    #endif
+}
+
+/**
+ * @brief State of the search for the site-packages directories pip installs into.
+ */
+typedef struct {
+    PackageIndex *index;
+    int found;              /**< Directories that were indexed. */
+    int failed;             /**< Memory ran out. */
+    char versions[8][32];   /**< `python3.X` directories seen under the prefix. */
+    int versionCount;
+} SiteSearch;
+
+/**
+ * @brief Directory visitor that indexes Python metadata entries.
+ */
+static int visitSitePackages(void *context, const char *dir, const char *name){
+    (void)dir;
+    return addPythonEntry((PackageIndex*)context, name);
+}
+
+/**
+ * @brief Indexes one site-packages directory, if it exists.
+ */
+static void scanSitePackages(SiteSearch *search, const char *path){
+    if(search->failed) return;
+    int status=listDirectory(path, visitSitePackages, search->index);
+    if(status==0) search->found++;
+    else if(status==-2) search->failed=1;
+}
+
+/**
+ * @brief Directory visitor for `<prefix>/lib`: indexes the `site-packages`
+ *        and `dist-packages` of every `python3.X` found there.
+ */
+static int visitLibDirectory(void *context, const char *dir, const char *name){
+    SiteSearch *search=(SiteSearch*)context;
+    if(strncmp(name, "python3", 7)!=0 || strlen(name)>=sizeof(search->versions[0])) return 0;
+    char path[PKGDB_PATH_LENGTH];
+    if(snprintf(path, sizeof(path), "%s/%s/site-packages", dir, name)<(int)sizeof(path)) scanSitePackages(search, path);
+    if(snprintf(path, sizeof(path), "%s/%s/dist-packages", dir, name)<(int)sizeof(path)) scanSitePackages(search, path);
+    if(search->versionCount<(int)(sizeof(search->versions)/sizeof(search->versions[0]))){
+        strcpy(search->versions[search->versionCount++], name);
+    }
+    return search->failed ? -1 : 0;
+}
+
+/**
+ * @brief Finds the installation prefix of the Python environment pip uses.
+ *
+ * @details `VIRTUAL_ENV` if a virtual environment is active, otherwise the
+ *          parent of the first `PATH` directory holding `pip3` (`pip.exe` on
+ *          Windows), located with `stat()` only.
+ *
+ * @return int `1` if a prefix was found and is `VIRTUAL_ENV`, `0` if it was
+ *         found on `PATH`, `-1` if there is none.
+ */
+static int pythonPrefix(char *out, size_t size){
+    const char *venv=getenv("VIRTUAL_ENV");
+    if(venv && venv[0]){
+        snprintf(out, size, "%s", venv);
+        return 1;
+    }
+    const char *path=getenv("PATH");
+    #ifdef _WIN32
+        const char *pip="\\pip.exe";
+    #else
+        const char *pip="/pip3";
+    #endif
+    while(path && *path){
+        const char *next=strchr(path, PKGDB_LIST_SEPARATOR);
+        size_t len=next ? (size_t)(next-path) : strlen(path);
+        struct stat info;
+        if(len>0 && len+strlen(pip)<size){
+            snprintf(out, size, "%.*s%s", (int)len, path, pip);
+            if(stat(out, &info)==0){
+                out[len]='\0';
+                char *slash=strrchr(out, '/');
+                #ifdef _WIN32
+                    char *backslash=strrchr(out, '\\');
+                    if(!slash || (backslash && backslash>slash)) slash=backslash;
+                #endif
+                if(slash && slash!=out){
+                    *slash='\0';
+                    return 0;
+                }
+            }
+        }
+        path=next ? next+1 : NULL;
+    }
+    return -1;
+}
+
+/**
+ * @brief Indexes the Python distributions visible to the active `pip`.
+ *
+ * @details `DEVCLI_SITE_PACKAGES`, a `PATH`-style list of directories, is
+ *          used if set. Otherwise the directories follow from
+ *          `pythonPrefix()`: `<prefix>/lib/python3.X/{site,dist}-packages`
+ *          (`<prefix>\Lib\site-packages` on Windows), Debian's
+ *          `/usr/lib/python3/dist-packages` for the system Python, and the
+ *          user site `~/.local/lib/python3.X/site-packages` of the same
+ *          Python versions outside virtual environments. Only the names of
+ *          the `*.dist-info` and `*.egg-info` entries are read.
+ *
+ *          If no directory is found, for example because `pip3` is a
+ *          version-manager shim, the index is reported as unavailable rather
+ *          than empty, so the caller runs pip as before.
+ *
+ * @ingroup pkgdb
+ *
+ * @param index Receives the index; release with `pkgdbClose()`.
+ *
+ * @return int `0` on success, `-1` if no site-packages directory was found
+ *         or memory ran out.
+ */
+int pkgdbOpenPython(PackageIndex *index){
+    memset(index, 0, sizeof(*index));
+    SiteSearch search;
+    memset(&search, 0, sizeof(search));
+    search.index=index;
+    char path[PKGDB_PATH_LENGTH];
+    const char *list=getenv("DEVCLI_SITE_PACKAGES");
+    if(list && list[0]){
+        while(*list){
+            const char *next=strchr(list, PKGDB_LIST_SEPARATOR);
+            size_t len=next ? (size_t)(next-list) : strlen(list);
+            if(len>0 && len<sizeof(path)){
+                snprintf(path, sizeof(path), "%.*s", (int)len, list);
+                scanSitePackages(&search, path);
+            }
+            if(!next) break;
+            list=next+1;
+        }
+    }
+    else{
+        char prefix[PKGDB_PATH_LENGTH];
+        int kind=pythonPrefix(prefix, sizeof(prefix));
+        if(kind>=0){
+            #ifdef _WIN32
+                if(snprintf(path, sizeof(path), "%s\\Lib\\site-packages", prefix)<(int)sizeof(path)) scanSitePackages(&search, path);
+            #else
+                if(snprintf(path, sizeof(path), "%s/lib", prefix)<(int)sizeof(path)) listDirectory(path, visitLibDirectory, &search);
+                if(strcmp(prefix, "/usr")==0 || strcmp(prefix, "/usr/local")==0){
+                    scanSitePackages(&search, "/usr/lib/python3/dist-packages");
+                }
+                const char *home=getenv("HOME");
+                for(int v=0; kind==0 && home && v<search.versionCount; v++){
+                    if(snprintf(path, sizeof(path), "%s/.local/lib/%s/site-packages", home, search.versions[v])<(int)sizeof(path)) scanSitePackages(&search, path);
+                }
+            #endif
+        }
+    }
+    index->base=index->storage;
+    if(search.failed || search.found==0 || indexBuild(index)!=0){
+        pkgdbClose(index);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Character order used by dpkg: `~` sorts before everything, even the
+ *        end of the string, and letters sort before other symbols.
+ */
+static int debianOrder(int c){
+    if(isdigit(c)) return 0;
+    if(isalpha(c)) return c;
+    if(c=='~') return -1;
+    if(c) return c+256;
+    return 0;
+}
+
+/**
+ * @brief Compares two epoch-less, revision-less version fragments like dpkg's `verrevcmp()`.
+ */
+static int debianCompareFragment(const char *a, const char *aEnd, const char *b, const char *bEnd){
+    #define AT(p, end) ((p)<(end) ? (unsigned char)*(p) : 0)
+    while(a<aEnd || b<bEnd){
+        int firstDiff=0;
+        while((a<aEnd && !isdigit(AT(a, aEnd))) || (b<bEnd && !isdigit(AT(b, bEnd)))){
+            int ac=debianOrder(AT(a, aEnd)), bc=debianOrder(AT(b, bEnd));
+            if(ac!=bc) return ac-bc;
+            a++;
+            b++;
+        }
+        while(AT(a, aEnd)=='0') a++;
+        while(AT(b, bEnd)=='0') b++;
+        while(isdigit(AT(a, aEnd)) && isdigit(AT(b, bEnd))){
+            if(!firstDiff) firstDiff=AT(a, aEnd)-AT(b, bEnd);
+            a++;
+            b++;
+        }
+        if(isdigit(AT(a, aEnd))) return 1;
+        if(isdigit(AT(b, bEnd))) return -1;
+        if(firstDiff) return firstDiff;
+    }
+    #undef AT
+    return 0;
+}
+
+/**
+ * @brief Splits a Debian version into epoch, upstream version and revision.
+ */
+static void debianSplit(const char *v, size_t len, unsigned long *epoch, const char **upstream, const char **upstreamEnd, const char **revision, const char **revisionEnd){
+    const char *end=v+len;
+    const char *colon=memchr(v, ':', len);
+    *epoch=0;
+    if(colon){
+        for(const char *p=v; p<colon; p++) *epoch=*epoch*10+(unsigned long)(isdigit((unsigned char)*p) ? *p-'0' : 0);
+        v=colon+1;
+    }
+    const char *dash=NULL;
+    for(const char *p=v; p<end; p++){
+        if(*p=='-') dash=p;
+    }
+    *upstream=v;
+    *upstreamEnd=dash ? dash : end;
+    *revision=dash ? dash+1 : end;
+    *revisionEnd=end;
+}
+
+/**
+ * @brief Compares two Debian package versions (`[epoch:]upstream[-revision]`)
+ *        with dpkg's ordering rules.
+ *
+ * @ingroup pkgdb
+ *
+ * @return int Negative, zero or positive as `a` is older than, equal to or newer than `b`.
+ */
+int pkgdbDebianCompare(const char *a, size_t aLen, const char *b, size_t bLen){
+    unsigned long aEpoch, bEpoch;
+    const char *aUp, *aUpEnd, *aRev, *aRevEnd, *bUp, *bUpEnd, *bRev, *bRevEnd;
+    debianSplit(a, aLen, &aEpoch, &aUp, &aUpEnd, &aRev, &aRevEnd);
+    debianSplit(b, bLen, &bEpoch, &bUp, &bUpEnd, &bRev, &bRevEnd);
+    if(aEpoch!=bEpoch) return aEpoch<bEpoch ? -1 : 1;
+    int status=debianCompareFragment(aUp, aUpEnd, bUp, bUpEnd);
+    if(status) return status;
+    return debianCompareFragment(aRev, aRevEnd, bRev, bRevEnd);
+}
+
+/**
+ * @brief Checks an apt package specification against the dpkg index.
+ *
+ * @details `spec` is what would be passed to `apt install`: `name`,
+ *          `name:arch` or `name=version`. A version must match exactly,
+ *          as apt would install exactly that version.
+ *
+ * @ingroup pkgdb
+ *
+ * @return int `1` if the package is installed (at that version), `0` otherwise.
+ */
+int pkgdbAptSatisfied(const PackageIndex *index, const char *spec){
+    size_t nameLen=strcspn(spec, ":=");
+    const PackageRecord *record=pkgdbFind(index, spec, nameLen);
+    if(!record) return 0;
+    const char *version=strchr(spec, '=');
+    if(!version) return 1;
+    version++;
+    return pkgdbDebianCompare(index->base+record->versionOff, record->versionLen, version, strlen(version))==0;
+}
+
+/**
+ * @brief Parses the release segments of a Python version (`1.2.3rc1` → 1, 2, 3).
+ *
+ * @return size_t Number of segments; `*rest` is set to what follows them.
+ */
+static size_t pythonRelease(const char *v, size_t len, uint64_t *segments, const char **rest){
+    const char *p=v, *end=v+len;
+    if(p<end && (*p=='v' || *p=='V')) p++;
+    const char *bang=memchr(p, '!', (size_t)(end-p));
+    if(bang) p=bang+1;
+    size_t count=0;
+    while(p<end && isdigit((unsigned char)*p)){
+        uint64_t value=0;
+        while(p<end && isdigit((unsigned char)*p)) value=value*10+(uint64_t)(*p++-'0');
+        if(count<PKGDB_MAX_SEGMENTS) segments[count++]=value;
+        if(p+1<end && *p=='.' && isdigit((unsigned char)p[1])) p++;
+        else break;
+    }
+    *rest=p;
+    return count;
+}
+
+/**
+ * @brief Ranks what follows the release: pre-releases and dev releases sort
+ *        before the release, post-releases after it.
+ */
+static int pythonSuffixRank(const char *s, const char *end){
+    while(s<end && (*s=='.' || *s=='-' || *s=='_')) s++;
+    if(s==end || *s=='+') return 0;
+    if((size_t)(end-s)>=4 && strncmp(s, "post", 4)==0) return 1;
+    if((size_t)(end-s)>=3 && strncmp(s, "rev", 3)==0) return 1;
+    if((size_t)(end-s)>=3 && strncmp(s, "dev", 3)==0) return -2;
+    if(isdigit((unsigned char)*s)) return 1;
+    return -1;
+}
+
+/**
+ * @brief Compares two Python versions.
+ *
+ * @details Covers the common PEP 440 cases: release segments compare
+ *          numerically with missing ones taken as zero (`1.0 == 1.0.0`),
+ *          `devN` sorts before `aN`/`bN`/`rcN`, which sort before the
+ *          release, and `postN` after it. Epochs and local versions are
+ *          ignored.
+ *
+ * @ingroup pkgdb
+ *
+ * @return int Negative, zero or positive as `a` is older than, equal to or newer than `b`.
+ */
+int pkgdbPythonCompare(const char *a, size_t aLen, const char *b, size_t bLen){
+    uint64_t aSeg[PKGDB_MAX_SEGMENTS], bSeg[PKGDB_MAX_SEGMENTS];
+    const char *aRest, *bRest;
+    size_t aCount=pythonRelease(a, aLen, aSeg, &aRest);
+    size_t bCount=pythonRelease(b, bLen, bSeg, &bRest);
+    for(size_t i=0; i<aCount || i<bCount; i++){
+        uint64_t x=i<aCount ? aSeg[i] : 0, y=i<bCount ? bSeg[i] : 0;
+        if(x!=y) return x<y ? -1 : 1;
+    }
+    const char *aEnd=a+aLen, *bEnd=b+bLen;
+    const char *aPlus=memchr(aRest, '+', (size_t)(aEnd-aRest)), *bPlus=memchr(bRest, '+', (size_t)(bEnd-bRest));
+    if(aPlus) aEnd=aPlus;
+    if(bPlus) bEnd=bPlus;
+    int aRank=pythonSuffixRank(aRest, aEnd), bRank=pythonSuffixRank(bRest, bEnd);
+    if(aRank!=bRank) return aRank<bRank ? -1 : 1;
+    return debianCompareFragment(aRest, aEnd, bRest, bEnd);
+}
+
+/**
+ * @brief Checks whether the release of `installed` starts with that of `prefix`
+ *        (`1.2.*` matches `1.2` and `1.2.7`).
+ */
+static int pythonReleasePrefix(const char *installed, size_t installedLen, const char *prefix, size_t prefixLen){
+    uint64_t iSeg[PKGDB_MAX_SEGMENTS], pSeg[PKGDB_MAX_SEGMENTS];
+    const char *rest;
+    size_t iCount=pythonRelease(installed, installedLen, iSeg, &rest);
+    size_t pCount=pythonRelease(prefix, prefixLen, pSeg, &rest);
+    for(size_t i=0; i<pCount; i++){
+        if((i<iCount ? iSeg[i] : 0)!=pSeg[i]) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Checks one version clause such as `>=2.0` or `==1.4.*`.
+ */
+static int pythonClauseHolds(const char *installed, size_t installedLen, const char *op, size_t opLen, const char *version, size_t versionLen){
+    int wildcard=versionLen>=2 && memcmp(version+versionLen-2, ".*", 2)==0;
+    if(wildcard) versionLen-=2;
+    int cmp=pkgdbPythonCompare(installed, installedLen, version, versionLen);
+    if(opLen==2 && memcmp(op, "==", 2)==0) return wildcard ? pythonReleasePrefix(installed, installedLen, version, versionLen) : cmp==0;
+    if(opLen==3 && memcmp(op, "===", 3)==0) return installedLen==versionLen && memcmp(installed, version, versionLen)==0;
+    if(opLen==2 && memcmp(op, "!=", 2)==0) return wildcard ? !pythonReleasePrefix(installed, installedLen, version, versionLen) : cmp!=0;
+    if(opLen==2 && memcmp(op, ">=", 2)==0) return cmp>=0;
+    if(opLen==2 && memcmp(op, "<=", 2)==0) return cmp<=0;
+    if(opLen==1 && *op=='>') return cmp>0;
+    if(opLen==1 && *op=='<') return cmp<0;
+    if(opLen==2 && memcmp(op, "~=", 2)==0){
+        const char *lastDot=NULL;
+        for(const char *p=version; p<version+versionLen; p++){
+            if(*p=='.') lastDot=p;
+        }
+        return cmp>=0 && lastDot && pythonReleasePrefix(installed, installedLen, version, (size_t)(lastDot-version));
+    }
+    return 0;
+}
+
+/**
+ * @brief Checks one line of a requirements file against the Python index.
+ *
+ * @return int `1` if satisfied or blank, `0` if not satisfied or not understood.
+ */
+static int requirementHolds(const PackageIndex *index, const char *line, size_t len){
+    const char *end=line+len;
+    for(const char *p=line; p<end; p++){
+        if(*p=='#' && (p==line || isspace((unsigned char)p[-1]))){
+            end=p;
+            break;
+        }
+    }
+    while(line<end && isspace((unsigned char)*line)) line++;
+    while(end>line && isspace((unsigned char)end[-1])) end--;
+    if(line==end) return 1;
+    if(*line=='-' || memchr(line, ';', (size_t)(end-line)) || memchr(line, '@', (size_t)(end-line)) || memchr(line, '/', (size_t)(end-line))) return 0;
+    const char *p=line;
+    while(p<end && (isalnum((unsigned char)*p) || *p=='-' || *p=='_' || *p=='.')) p++;
+    if(p==line) return 0;
+    char name[256];
+    size_t nameLen=normalizeName(line, (size_t)(p-line), name, sizeof(name));
+    const PackageRecord *record=pkgdbFind(index, name, nameLen);
+    if(!record) return 0;
+    const char *installed=index->base+record->versionOff;
+    while(p<end && isspace((unsigned char)*p)) p++;
+    if(p<end && *p=='['){
+        p=memchr(p, ']', (size_t)(end-p));
+        if(!p) return 0;
+        p++;
+    }
+    while(p<end){
+        while(p<end && (isspace((unsigned char)*p) || *p==',')) p++;
+        if(p==end) break;
+        const char *op=p;
+        while(p<end && strchr("=!<>~", *p)) p++;
+        size_t opLen=(size_t)(p-op);
+        while(p<end && isspace((unsigned char)*p)) p++;
+        const char *version=p;
+        while(p<end && *p!=',' && !isspace((unsigned char)*p)) p++;
+        if(opLen==0 || p==version) return 0;
+        if(!pythonClauseHolds(installed, record->versionLen, op, opLen, version, (size_t)(p-version))) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Checks whether every requirement in a pip requirements file is
+ *        already installed.
+ *
+ * @details Understands `name`, `name[extras]` and comma-separated version
+ *          clauses with `==`, `===`, `!=`, `~=`, `>=`, `<=`, `>` and `<`,
+ *          including `.*` wildcards. Lines it does not understand (options
+ *          such as `-r` or `-e`, URLs, environment markers) make the file
+ *          count as unsatisfied, so pip still runs for them.
+ *
+ * @ingroup pkgdb
+ *
+ * @param index Index from `pkgdbOpenPython()`.
+ * @param path Requirements file.
+ *
+ * @return int `1` if every requirement is satisfied, `0` otherwise or if the
+ *         file cannot be read.
+ */
+int pkgdbRequirementsSatisfied(const PackageIndex *index, const char *path){
+    FILE *f=fopen(path, "r");
+    if(!f) return 0;
+    char line[1024];
+    int satisfied=1;
+    while(satisfied && fgets(line, sizeof(line), f)){
+        size_t len=strlen(line);
+        if(len==sizeof(line)-1 && line[len-1]!='\n') satisfied=0;
+        else satisfied=requirementHolds(index, line, len);
+    }
+    fclose(f);
+    return satisfied;
+}
+
+/** @} */ // end of pkgdb group
@@ -0,0 +1,56 @@
+/**
+ * @file pkgdb.h
+ * @brief Read-only views of the dpkg and Python package databases.
+ */
+
+#ifndef DEVCLI_PKGDB_H
+#define DEVCLI_PKGDB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @defgroup pkgdb Package Databases
+ *  @brief Answers "is package X at version Y installed" without running apt or pip.
+ *  @{
+ */
+
+/**
+ * @brief One installed package; offsets are relative to the index's `base`.
+ */
+typedef struct {
+    uint32_t nameOff;
+    uint32_t nameLen;
+    uint32_t versionOff;
+    uint32_t versionLen;
+} PackageRecord;
+
+/**
+ * @brief Installed packages of one database, hashed by name.
+ *
+ * @details For dpkg, `base` is a read-only mapping of the status file and
+ *          records point into it. For Python, names and versions are copied
+ *          into `storage`, which is then `base`.
+ */
+typedef struct {
+    const char *base;
+    size_t mappedSize;      /**< Size of the mapping, or `0` if `base` is `storage`. */
+    char *storage;
+    size_t storageSize, storageCap;
+    PackageRecord *records;
+    size_t count, cap;
+    uint32_t *slots;        /**< Open-addressing table of record indexes. */
+    size_t slotCount;
+} PackageIndex;
+
+int pkgdbOpenDpkg(PackageIndex *index);
+int pkgdbOpenPython(PackageIndex *index);
+void pkgdbClose(PackageIndex *index);
+const PackageRecord *pkgdbFind(const PackageIndex *index, const char *name, size_t len);
+int pkgdbAptSatisfied(const PackageIndex *index, const char *spec);
+int pkgdbRequirementsSatisfied(const PackageIndex *index, const char *path);
+int pkgdbDebianCompare(const char *a, size_t aLen, const char *b, size_t bLen);
+int pkgdbPythonCompare(const char *a, size_t aLen, const char *b, size_t bLen);
+
+/** @} */ // end of pkgdb group
+
+#endif /* DEVCLI_PKGDB_H */
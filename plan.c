@@ -0,0 +1,294 @@
+/**
+ * @file plan.c
+ * @brief Builds execution plans and installs their packages in shared transactions.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "plan.h"
+#include "devcli.h"
+#include "pkgdb.h"
+#include "log.h"
+
+/** @addtogroup plan
+ *  @{
+ */
+
+/**
+ * @brief Command that installs a list of packages with each manager, in one
+ *        transaction. Package names are appended, separated by spaces.
+ */
+static const char *const transactionCommands[CONFIG_PM_COUNT]={"sudo apt install -y", "scoop install", "choco install -y"};
+
+/**
+ * @brief Formats `category.task` of `task` into `out`.
+ */
+static const char *taskLabel(const ConfigImage *config, uint32_t task, char *out, size_t size){
+    const ConfigTask *info=&configTasks(config)[task];
+    snprintf(out, size, "%s.%s", configString(config, configCategories(config)[info->category].name), configString(config, info->name));
+    return out;
+}
+
+/**
+ * @brief Appends `task` to the plan after everything it depends on.
+ *
+ * @details `state` marks tasks as unvisited (0), in progress (1) or placed
+ *          (2). An edge back to a task in progress is a cycle; it is reported
+ *          and ignored, so the rest of the plan still runs.
+ */
+static void planVisit(Plan *plan, uint32_t task, ConfigShell shell, unsigned char *state){
+    if(state[task]==2) return;
+    char label[256];
+    if(state[task]==1){
+        LOG_ERROR("Cyclic dependsOn at %s", taskLabel(plan->config, task, label, sizeof(label)));
+        return;
+    }
+    state[task]=1;
+    const ConfigEntry *entry=configTaskEntry(plan->config, task, shell);
+    if(entry){
+        CONFIG_FOR_EACH_DEP(plan->config, entry, dep){
+            if(dep->task==CONFIG_NONE){
+                LOG_ERROR("No such command: %s", configString(plan->config, dep->name));
+                continue;
+            }
+            planVisit(plan, dep->task, shell, state);
+        }
+    }
+    state[task]=2;
+    plan->nodeOf[task]=(uint32_t)plan->count;
+    plan->nodes[plan->count].task=task;
+    plan->nodes[plan->count].entry=entry;
+    plan->nodes[plan->count].status=PLAN_PENDING;
+    plan->nodes[plan->count].peakMemory=0;
+    plan->count++;
+}
+
+/**
+ * @brief Builds the plan for running `root` in `shell`.
+ *
+ * @details Walks the `dependsOn` edges depth first and lists every reachable
+ *          task once, each after all of its dependencies, so a tool several
+ *          tasks need is installed once. Tasks without an entry for `shell`
+ *          are listed as well, with a `NULL` entry, so the runner can report
+ *          them; their dependencies are not followed.
+ *
+ * @ingroup plan
+ *
+ * @param config Frozen configuration.
+ * @param root Index of the requested task.
+ * @param shell Shell whose entries are used.
+ * @param plan Receives the plan; release with `planFree()`.
+ *
+ * @return int `0` on success, `-1` on allocation failure.
+ *
+ * Example usage:
+ * @code
+ * Plan plan;
+ * if (planBuild(config, configFindTask(config, "run.java", 8), shellKind, &plan) == 0) {
+ *     for (size_t i = 0; i < plan.count; i++) runTask(config, &plan.nodes[i]);
+ *     planFree(&plan);
+ * }
+ * @endcode
+ */
+int planBuild(const ConfigImage *config, uint32_t root, ConfigShell shell, Plan *plan){
+    memset(plan, 0, sizeof(*plan));
+    plan->config=config;
+    unsigned char *state=calloc(config->taskCount+1, 1);
+    plan->nodes=malloc((config->taskCount+1)*sizeof(PlanNode));
+    plan->nodeOf=malloc((config->taskCount+1)*sizeof(uint32_t));
+    if(!state || !plan->nodes || !plan->nodeOf){
+        LOG_ERROR("Dynamic Memory not assigned to plan.");
+        free(state);
+        planFree(plan);
+        return -1;
+    }
+    memset(plan->nodeOf, 0xFF, (config->taskCount+1)*sizeof(uint32_t));
+    planVisit(plan, root, shell, state);
+    free(state);
+    return 0;
+}
+
+/**
+ * @brief Returns the number of packages `entry` lists for `manager`.
+ */
+static size_t packageCount(const ConfigImage *config, const ConfigEntry *entry, ConfigPackageManager manager){
+    size_t count=0;
+    CONFIG_FOR_EACH_PACKAGE(config, entry, package){
+        if(package->manager==(uint32_t)manager) count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Checks the apt packages `entry` lists against the dpkg database.
+ *
+ * @return int `1` if every one of them is installed.
+ */
+static int packagesInstalled(const ConfigImage *config, const ConfigEntry *entry, const PackageIndex *dpkg){
+    CONFIG_FOR_EACH_PACKAGE(config, entry, package){
+        if(package->manager==CONFIG_PM_APT && !pkgdbAptSatisfied(dpkg, configString(config, package->name))) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Forms the transaction command installing the packages of `nodes`.
+ *
+ * @details Packages listed by several nodes appear once. Names are interned
+ *          in the image, so equal names have equal offsets. With a dpkg
+ *          index, packages that are already installed are left out.
+ *
+ * @return char* Heap-allocated command, or `NULL` on allocation failure.
+ */
+static char *transactionCommand(const Plan *plan, ConfigPackageManager manager, const uint32_t *nodes, size_t nodeCount, const PackageIndex *dpkg){
+    const ConfigImage *config=plan->config;
+    size_t length=strlen(transactionCommands[manager])+1, total=0;
+    for(size_t i=0; i<nodeCount; i++) total+=plan->nodes[nodes[i]].entry->packageCount;
+    uint32_t *names=malloc((total+1)*sizeof(uint32_t));
+    if(!names) return NULL;
+    size_t nameCount=0;
+    for(size_t i=0; i<nodeCount; i++){
+        CONFIG_FOR_EACH_PACKAGE(config, plan->nodes[nodes[i]].entry, package){
+            if(package->manager!=(uint32_t)manager) continue;
+            if(dpkg && pkgdbAptSatisfied(dpkg, configString(config, package->name))) continue;
+            size_t k=0;
+            while(k<nameCount && names[k]!=package->name) k++;
+            if(k<nameCount) continue;
+            names[nameCount++]=package->name;
+            length+=strlen(configString(config, package->name))+1;
+        }
+    }
+    char *command=malloc(length);
+    if(command){
+        strcpy(command, transactionCommands[manager]);
+        for(size_t k=0; k<nameCount; k++){
+            strcat(command, " ");
+            strcat(command, configString(config, names[k]));
+        }
+    }
+    free(names);
+    return command;
+}
+
+/**
+ * @brief Runs one package transaction for `nodes`.
+ *
+ * @return int `0` if the transaction succeeded.
+ */
+static int runTransaction(const Plan *plan, ConfigPackageManager manager, const uint32_t *nodes, size_t nodeCount, const PackageIndex *dpkg){
+    char *command=transactionCommand(plan, manager, nodes, nodeCount, dpkg);
+    if(!command){
+        LOG_ERROR("Dynamic Memory allocation failed.");
+        return -1;
+    }
+    LOG("Executing: %s", command);
+    char *finalCommand=wrap_for_shell(command);
+    int status=system(finalCommand);
+    free(finalCommand);
+    free(command);
+    if(status!=0){
+        LOG_ERROR("Command execution failed with status: %d", status);
+    }
+    return status;
+}
+
+/**
+ * @brief Installs the missing packages of every install node in one transaction.
+ *
+ * @details An `install.*` node takes part if its entry lists `packages` for
+ *          `manager` and every task it depends on takes part as well, so
+ *          nothing that must run first is skipped over. For apt, whether a
+ *          node is present is read from the dpkg database
+ *          (`pkgdbOpenDpkg()`) without starting a process, and only the
+ *          packages that are missing are installed; on systems without one,
+ *          and for the Windows managers, the tool probes (`atPath`,
+ *          `atDrive`) decide. When everything is present, no package manager
+ *          runs at all. The packages of all missing nodes are then installed by
+ *          a single command, e.g. `sudo apt install -y python3 cmake git`, so
+ *          package indexes are read and the package lock is taken once.
+ *
+ *          The outcome is recorded on each node: `PLAN_PRESENT`,
+ *          `PLAN_INSTALLED` or `PLAN_FAILED`. If the shared transaction fails,
+ *          each node is retried alone so that a single bad package does not
+ *          fail the others and the failure is attributed to the right task.
+ *          Nodes that do not take part stay `PLAN_PENDING` and are run by the
+ *          caller with their own `cmd`, as before.
+ *
+ * @ingroup plan
+ *
+ * @param plan Plan built by `planBuild()`.
+ * @param manager Package manager of the current shell.
+ */
+void planInstallPackages(Plan *plan, ConfigPackageManager manager){
+    const ConfigImage *config=plan->config;
+    unsigned char *batchable=calloc(plan->count+1, 1);
+    uint32_t *missing=malloc((plan->count+1)*sizeof(uint32_t));
+    if(!batchable || !missing){
+        LOG_ERROR("Dynamic Memory not assigned to install batch.");
+        free(batchable);
+        free(missing);
+        return;
+    }
+    size_t missingCount=0;
+    char label[256];
+    PackageIndex dpkg;
+    int haveDpkg=manager==CONFIG_PM_APT && pkgdbOpenDpkg(&dpkg)==0;
+    if(haveDpkg) LOG("Read %zu installed packages from the dpkg database.", dpkg.count);
+    for(size_t i=0; i<plan->count; i++){
+        PlanNode *node=&plan->nodes[i];
+        const char *category=configString(config, configCategories(config)[configTasks(config)[node->task].category].name);
+        if(!node->entry || strcmp(category, "install")!=0 || packageCount(config, node->entry, manager)==0) continue;
+        int ready=1;
+        CONFIG_FOR_EACH_DEP(config, node->entry, dep){
+            if(dep->task!=CONFIG_NONE && plan->nodeOf[dep->task]!=CONFIG_NONE && !batchable[plan->nodeOf[dep->task]]) ready=0;
+        }
+        if(!ready) continue;
+        batchable[i]=1;
+        int present=haveDpkg ? packagesInstalled(config, node->entry, &dpkg)
+                             : checkAvailability((char*)configString(config, node->entry->atPath), (char*)configString(config, node->entry->atDrive), (char*)configString(config, node->entry->addToPath))==0;
+        if(present){
+            node->status=PLAN_PRESENT;
+            LOG("%s: already available.", taskLabel(config, node->task, label, sizeof(label)));
+        }
+        else{
+            missing[missingCount++]=(uint32_t)i;
+        }
+    }
+    if(missingCount>0){
+        LOG("Installing %zu tool(s) in one %s transaction.", missingCount, configPackageManagerName(manager));
+        int status=runTransaction(plan, manager, missing, missingCount, haveDpkg ? &dpkg : NULL);
+        for(size_t k=0; k<missingCount; k++){
+            PlanNode *node=&plan->nodes[missing[k]];
+            if(status!=0 && missingCount>1){
+                LOG("Retrying %s on its own.", taskLabel(config, node->task, label, sizeof(label)));
+                node->status=runTransaction(plan, manager, &missing[k], 1, haveDpkg ? &dpkg : NULL)==0 ? PLAN_INSTALLED : PLAN_FAILED;
+            }
+            else{
+                node->status=status==0 ? PLAN_INSTALLED : PLAN_FAILED;
+            }
+            if(node->status==PLAN_INSTALLED){
+                LOG("%s: installed.", taskLabel(config, node->task, label, sizeof(label)));
+            }
+            else{
+                LOG_ERROR("%s: installation failed.", taskLabel(config, node->task, label, sizeof(label)));
+            }
+        }
+    }
+    if(haveDpkg) pkgdbClose(&dpkg);
+    free(batchable);
+    free(missing);
+}
+
+/**
+ * @brief Releases the arrays of a plan.
+ */
+void planFree(Plan *plan){
+    free(plan->nodes);
+    free(plan->nodeOf);
+    plan->nodes=NULL;
+    plan->nodeOf=NULL;
+    plan->count=0;
+}
+
+/** @} */ // end of plan group
@@ -0,0 +1,56 @@
+/**
+ * @file plan.h
+ * @brief Execution plans: the `dependsOn` closure of a task in run order.
+ */
+
+#ifndef DEVCLI_PLAN_H
+#define DEVCLI_PLAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+
+/** @defgroup plan Planning
+ *  @brief Turns a requested task into an ordered, de-duplicated list of nodes.
+ *  @{
+ */
+
+/**
+ * @brief What has happened to a plan node so far.
+ */
+typedef enum {
+    PLAN_PENDING = 0,   /**< Not run yet. */
+    PLAN_PRESENT,       /**< Install node whose tool was already available. */
+    PLAN_INSTALLED,     /**< Install node satisfied by a package transaction. */
+    PLAN_FAILED         /**< Install node whose package transaction failed. */
+} PlanStatus;
+
+/**
+ * @brief One task of a plan.
+ */
+typedef struct {
+    uint32_t task;              /**< Task index in the image. */
+    const ConfigEntry *entry;   /**< Entry for the plan's shell, or `NULL` if it has none. */
+    PlanStatus status;
+    uint32_t peakMemory;        /**< Peak memory of the commands `runTask()` ran for it, in MiB; `0` if unknown. */
+} PlanNode;
+
+/**
+ * @brief A task and everything it depends on, dependencies first.
+ *
+ * @details Every task appears once, however many tasks depend on it.
+ */
+typedef struct {
+    const ConfigImage *config;
+    PlanNode *nodes;
+    size_t count;
+    uint32_t *nodeOf;   /**< Node index per task index, or `CONFIG_NONE` if not in the plan. */
+} Plan;
+
+int planBuild(const ConfigImage *config, uint32_t root, ConfigShell shell, Plan *plan);
+void planInstallPackages(Plan *plan, ConfigPackageManager manager);
+void planFree(Plan *plan);
+
+/** @} */ // end of plan group
+
+#endif /* DEVCLI_PLAN_H */
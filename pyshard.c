@@ -0,0 +1,866 @@
+/**
+ * @file pyshard.c
+ * @brief Runs a pytest command as concurrent shards planned from a cached collection and past durations.
+ */
+
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#define MKDIR(path) _mkdir(path)
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#define MKDIR(path) mkdir(path, 0755)
+#endif
+#include "pyshard.h"
+#include "devcli.h"
+#include "jobserver.h"
+#include "spawn.h"
+#include "tape.h"
+#include "log.h"
+
+/** @addtogroup pyshard
+ *  @{
+ */
+
+/**
+ * @def PYTEST_SHARD_VERSION
+ * @brief First input of every key; changing it collects and plans again.
+ */
+#define PYTEST_SHARD_VERSION "devcli-pytest-1"
+
+/**
+ * @def PYTEST_DEFAULT_SECONDS
+ * @brief Duration assumed for every test while none has been measured.
+ */
+#define PYTEST_DEFAULT_SECONDS 0.1
+
+/**
+ * @brief pytest plugin loaded into every collection and shard run.
+ *
+ * @details `--devcli-collect` writes the collected node IDs.
+ *          `--devcli-plan` with `--devcli-shard=N` deselects the tests the
+ *          plan puts in other shards; tests the plan does not know run in
+ *          shard 0. `--devcli-stale` writes the tests collected but not
+ *          planned (`new`) and planned but not collected (`gone`). Both run
+ *          last, after options such as `-k` have deselected their tests.
+ *          `--devcli-report` writes each test's outcome and its setup, call
+ *          and teardown time added up.
+ */
+static const char pytestPluginSource[]=
+    "import pytest\n"
+    "\n"
+    "_tests = {}\n"
+    "\n"
+    "\n"
+    "def pytest_addoption(parser):\n"
+    "    group = parser.getgroup(\"devcli\")\n"
+    "    group.addoption(\"--devcli-collect\", default=None)\n"
+    "    group.addoption(\"--devcli-plan\", default=None)\n"
+    "    group.addoption(\"--devcli-shard\", type=int, default=0)\n"
+    "    group.addoption(\"--devcli-stale\", default=None)\n"
+    "    group.addoption(\"--devcli-report\", default=None)\n"
+    "\n"
+    "\n"
+    "@pytest.hookimpl(trylast=True)\n"
+    "def pytest_collection_modifyitems(config, items):\n"
+    "    path = config.getoption(\"devcli_plan\")\n"
+    "    if not path:\n"
+    "        return\n"
+    "    planned = {}\n"
+    "    with open(path, encoding=\"utf-8\") as f:\n"
+    "        next(f, None)\n"
+    "        for line in f:\n"
+    "            shard, _, nodeid = line.rstrip(\"\\r\\n\").partition(\"\\t\")\n"
+    "            planned[nodeid] = int(shard)\n"
+    "    stale = config.getoption(\"devcli_stale\")\n"
+    "    if stale:\n"
+    "        collected = set(item.nodeid for item in items)\n"
+    "        with open(stale, \"w\", encoding=\"utf-8\") as f:\n"
+    "            for item in items:\n"
+    "                if item.nodeid not in planned:\n"
+    "                    f.write(\"new\\t\" + item.nodeid + \"\\n\")\n"
+    "            for nodeid in planned:\n"
+    "                if nodeid not in collected:\n"
+    "                    f.write(\"gone\\t\" + nodeid + \"\\n\")\n"
+    "    shard = config.getoption(\"devcli_shard\")\n"
+    "    dropped = [item for item in items if planned.get(item.nodeid, 0) != shard]\n"
+    "    if dropped:\n"
+    "        config.hook.pytest_deselected(items=dropped)\n"
+    "        items[:] = [item for item in items if planned.get(item.nodeid, 0) == shard]\n"
+    "\n"
+    "\n"
+    "def pytest_collection_finish(session):\n"
+    "    path = session.config.getoption(\"devcli_collect\")\n"
+    "    if path:\n"
+    "        with open(path, \"w\", encoding=\"utf-8\") as f:\n"
+    "            for item in session.items:\n"
+    "                f.write(item.nodeid + \"\\n\")\n"
+    "\n"
+    "\n"
+    "def pytest_runtest_logreport(report):\n"
+    "    test = _tests.setdefault(report.nodeid, [0.0, \"passed\"])\n"
+    "    test[0] += report.duration\n"
+    "    if report.failed:\n"
+    "        test[1] = \"failed\" if report.when == \"call\" else \"error\"\n"
+    "    elif report.skipped and test[1] == \"passed\":\n"
+    "        test[1] = \"skipped\"\n"
+    "\n"
+    "\n"
+    "def pytest_unconfigure(config):\n"
+    "    path = config.getoption(\"devcli_report\")\n"
+    "    if path:\n"
+    "        with open(path, \"w\", encoding=\"utf-8\") as f:\n"
+    "            for nodeid, (duration, outcome) in _tests.items():\n"
+    "                f.write(\"%s\\t%.6f\\t%s\\n\" % (outcome, duration, nodeid))\n";
+
+/**
+ * @brief A pytest command split into words.
+ */
+typedef struct {
+    char *copy;                         /**< The command, cut into words in place. */
+    char *words[PYTEST_MAX_WORDS];
+    int count;
+} PytestCommand;
+
+/**
+ * @brief The lines of a file read whole, split in place.
+ */
+typedef struct {
+    char *text;
+    char **lines;
+    int count;
+} PytestLines;
+
+/**
+ * @brief Measured duration of one test.
+ */
+typedef struct {
+    const char *id;
+    double seconds;
+} PytestDuration;
+
+/**
+ * @brief One concurrent pytest process.
+ */
+typedef struct {
+    char *command;
+    uint32_t peakMemory;
+    int status;
+} PytestShard;
+
+/**
+ * @brief Splits `command` into words, removing double quotes, and checks
+ *        that it is a plain pytest run that can be split.
+ *
+ * @details `pytest`, `py.test` and `python -m pytest` are taken. Options
+ *          whose meaning depends on running every test in one process
+ *          (`-x`, `--maxfail`, `--lf`, `--ff`, `--sw`, `--pdb`), options
+ *          that do not run tests, and pytest-xdist's `-n` are left to
+ *          pytest, and so is shell syntax other than double quotes.
+ *
+ * @return int `0` if the command can be sharded, `-1` otherwise.
+ */
+static int parsePytest(const char *command, PytestCommand *parsed){
+    memset(parsed, 0, sizeof(*parsed));
+    #ifdef _WIN32
+        const char *special=";&|<>$`%^";
+    #else
+        const char *special=";&|<>$`'\\";
+    #endif
+    if(command[strcspn(command, special)] || strchr(command, '\n')) return -1;
+    parsed->copy=strdup(command);
+    if(!parsed->copy) return -1;
+    int count=splitCommandWords(parsed->copy, parsed->words, PYTEST_MAX_WORDS);
+    if(count<=0) return -1;
+    parsed->count=count;
+    const char *base=parsed->words[0];
+    for(const char *p=parsed->words[0]; *p; p++){
+        if(*p=='/' || *p=='\\') base=p+1;
+    }
+    int first;
+    if(strcmp(base, "pytest")==0 || strcmp(base, "pytest.exe")==0 || strcmp(base, "py.test")==0) first=1;
+    else if(parsed->count>2 && strcmp(parsed->words[1], "-m")==0 && strcmp(parsed->words[2], "pytest")==0
+        && (strncmp(base, "python", 6)==0 || strcmp(base, "py")==0 || strcmp(base, "py.exe")==0)) first=3;
+    else return -1;
+    static const char *const refused[]={"--exitfirst", "--maxfail", "--pdb", "--trace", "--lf", "--last-failed",
+        "--ff", "--failed-first", "--nf", "--new-first", "--sw", "--stepwise", "--sw-skip", "--co", "--collect-only",
+        "--collectonly", "-n", "--numprocesses", "--dist", "-h", "--help", "--version", "-V", "--fixtures",
+        "--fixtures-per-test", "--markers", "--setup-only", "--setup-plan", "--cache-show", "--cache-clear"};
+    for(int i=first; i<parsed->count; i++){
+        const char *word=parsed->words[i];
+        for(size_t r=0; r<sizeof(refused)/sizeof(refused[0]); r++){
+            size_t len=strlen(refused[r]);
+            if(strncmp(word, refused[r], len)==0 && (word[len]=='\0' || word[len]=='=')) return -1;
+        }
+        if(word[0]=='-' && word[1]!='-' && word[1]!='k' && word[1]!='m' && word[1]!='p' && word[1]!='o' && word[1]!='c'
+            && !strchr(word, '=') && strpbrk(word+1, "xn")) return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Appends `word` and a space to `out`, in double quotes if it has a
+ *        space.
+ */
+static char *appendWord(char *out, const char *word){
+    return out+sprintf(out, strchr(word, ' ') ? "\"%s\" " : "%s ", word);
+}
+
+/**
+ * @brief Returns `1` if `name` is a file pytest collects tests from or
+ *        that changes how it collects them.
+ */
+static int isTestInput(const char *name){
+    size_t len=strlen(name);
+    if(len<3 || strcmp(name+len-3, ".py")!=0) return strcmp(name, "pytest.ini")==0 || strcmp(name, "pyproject.toml")==0
+        || strcmp(name, "setup.cfg")==0 || strcmp(name, "tox.ini")==0;
+    return strncmp(name, "test_", 5)==0 || (len>8 && strcmp(name+len-8, "_test.py")==0) || strcmp(name, "conftest.py")==0;
+}
+
+/**
+ * @brief Adds the hash of a file found by `walkPythonTree()` to the sum
+ *        in `context` if pytest reads it.
+ *
+ * @details Each file's hash covers its path and is added up, so the order
+ *          the directory lists them in does not matter.
+ */
+static void hashTest(const char *path, const char *name, const struct stat *info, int depth, void *context){
+    (void)info;
+    (void)depth;
+    uint64_t *fields=context;
+    if(!isTestInput(name)) return;
+    FILE *file=fopen(path, "rb");
+    if(!file) return;
+    uint64_t hash=fingerprintText(FINGERPRINT_SEED, path);
+    char buffer[65536];
+    size_t got;
+    while((got=fread(buffer, 1, sizeof(buffer), file))>0) hash=fingerprintBytes(hash, buffer, got);
+    fclose(file);
+    fields[0]+=hash;
+    fields[1]++;
+}
+
+/**
+ * @brief Key of the cached collection: the command, `PYTHONPATH` and the
+ *        contents of every test file, `conftest.py` and pytest
+ *        configuration file.
+ */
+static uint64_t collectionKey(const PytestCommand *parsed){
+    uint64_t hash=fingerprintText(FINGERPRINT_SEED, PYTEST_SHARD_VERSION);
+    for(int i=0; i<parsed->count; i++) hash=fingerprintText(hash, parsed->words[i]);
+    const char *pythonPath=getenv("PYTHONPATH");
+    hash=fingerprintText(hash, pythonPath ? pythonPath : "");
+    uint64_t fields[2]={0, 0};
+    walkPythonTree(".", hashTest, fields);
+    return fingerprintBytes(hash, fields, sizeof(fields));
+}
+
+/**
+ * @brief Reads a whole file and splits it into lines in place.
+ *
+ * @return int `0` on success; a missing file reads as no lines and `-1`.
+ */
+static int readLines(const char *path, PytestLines *out){
+    memset(out, 0, sizeof(*out));
+    FILE *file=fopen(path, "rb");
+    if(!file) return -1;
+    fseek(file, 0, SEEK_END);
+    long len=ftell(file);
+    fseek(file, 0, SEEK_SET);
+    out->text=len>=0 ? malloc((size_t)len+1) : NULL;
+    if(out->text && fread(out->text, 1, (size_t)len, file)!=(size_t)len){
+        free(out->text);
+        out->text=NULL;
+    }
+    fclose(file);
+    if(!out->text) return -1;
+    out->text[len]='\0';
+    int lines=1;
+    for(char *p=out->text; *p; p++) lines+=*p=='\n';
+    out->lines=malloc((size_t)lines*sizeof(char*));
+    if(!out->lines){
+        free(out->text);
+        out->text=NULL;
+        return -1;
+    }
+    for(char *p=out->text; *p; ){
+        char *end=strchr(p, '\n');
+        if(end) *end='\0';
+        size_t n=strlen(p);
+        if(n>0 && p[n-1]=='\r') p[n-1]='\0';
+        if(*p) out->lines[out->count++]=p;
+        if(!end) break;
+        p=end+1;
+    }
+    return 0;
+}
+
+static void linesFree(PytestLines *lines){
+    free(lines->lines);
+    free(lines->text);
+    memset(lines, 0, sizeof(*lines));
+}
+
+/**
+ * @brief Writes `text` to `path` through a temporary file.
+ *
+ * @return int `0` on success.
+ */
+static int writeFileAtomic(const char *path, const char *text, size_t len){
+    char temp[4200];
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    FILE *file=fopen(temp, "wb");
+    if(!file) return -1;
+    int ok=fwrite(text, 1, len, file)==len;
+    if(fclose(file)!=0 || !ok){
+        remove(temp);
+        return -1;
+    }
+    remove(path);
+    return rename(temp, path)==0 ? 0 : -1;
+}
+
+/**
+ * @brief Creates the shard directory with a `.gitignore` and the plugin,
+ *        and fills `out` with its absolute path for `PYTHONPATH`.
+ *
+ * @return int `0` if the directory and the plugin are ready.
+ */
+static int prepareDirectory(char *out, size_t size){
+    char cwd[4096], path[4200];
+    #ifdef _WIN32
+        if(!GetCurrentDirectoryA(sizeof(cwd), cwd)) return -1;
+    #else
+        if(!getcwd(cwd, sizeof(cwd))) return -1;
+    #endif
+    MKDIR(".pytest_cache");
+    MKDIR(PYTEST_SHARD_DIR);
+    int n=snprintf(out, size, "%s/%s", cwd, PYTEST_SHARD_DIR);
+    if(n<0 || (size_t)n>=size) return -1;
+    snprintf(path, sizeof(path), "%s/.gitignore", PYTEST_SHARD_DIR);
+    struct stat info;
+    if(stat(path, &info)!=0 && writeFileAtomic(path, "*\n", 2)!=0) return -1;
+    snprintf(path, sizeof(path), "%s/devcli_pytest_shard.py", PYTEST_SHARD_DIR);
+    int current=0;
+    FILE *file=fopen(path, "rb");
+    if(file){
+        char buffer[sizeof(pytestPluginSource)+1];
+        size_t got=fread(buffer, 1, sizeof(buffer), file);
+        current=got==sizeof(pytestPluginSource)-1 && memcmp(buffer, pytestPluginSource, got)==0;
+        fclose(file);
+    }
+    if(current) return 0;
+    return writeFileAtomic(path, pytestPluginSource, sizeof(pytestPluginSource)-1);
+}
+
+/**
+ * @brief Builds the command line of a collection or shard run: the
+ *        original command with the plugin on `PYTHONPATH`, `extra`
+ *        options, and its output sent to `log`.
+ *
+ * @details The shards run without pytest's cache provider, which would
+ *          otherwise have every shard rewrite `.pytest_cache/v` at once.
+ */
+static char *pluginCommand(const PytestCommand *parsed, const char *pluginDir, const char *extra, const char *log){
+    size_t len=2*strlen(pluginDir)+strlen(extra)+strlen(log)+128;
+    for(int i=0; i<parsed->count; i++) len+=strlen(parsed->words[i])+3;
+    char *line=malloc(len);
+    if(!line){
+        LOG_ERROR("Dynamic Memory allocation failed.");
+        return NULL;
+    }
+    char *p=line;
+    #ifdef _WIN32
+        p+=sprintf(p, "set \"PYTHONPATH=%s;%%PYTHONPATH%%\" && ", pluginDir);
+    #else
+        p+=sprintf(p, "PYTHONPATH=\"%s${PYTHONPATH:+:$PYTHONPATH}\" ", pluginDir);
+    #endif
+    for(int i=0; i<parsed->count; i++) p=appendWord(p, parsed->words[i]);
+    sprintf(p, "-p devcli_pytest_shard -p no:cacheprovider %s > \"%s\" 2>&1", extra, log);
+    return line;
+}
+
+/**
+ * @brief Returns the cached collection if its key matches, or collects
+ *        the node IDs with `pytest --collect-only` and caches them.
+ *
+ * @return int `0` with the IDs in `ids` (its first line is the key), `-1`
+ *         if collection failed.
+ */
+static int loadCollection(const PytestCommand *parsed, const char *pluginDir, uint64_t key, PytestLines *ids){
+    char path[4200], keyLine[32];
+    snprintf(path, sizeof(path), "%s/collection", PYTEST_SHARD_DIR);
+    snprintf(keyLine, sizeof(keyLine), "%016llx", (unsigned long long)key);
+    if(readLines(path, ids)==0 && ids->count>0 && strcmp(ids->lines[0], keyLine)==0){
+        LOG("Test files are unchanged; reusing the collection of %d tests.", ids->count-1);
+        return 0;
+    }
+    linesFree(ids);
+    char collected[4200], log[4200], extra[4400];
+    snprintf(collected, sizeof(collected), "%s/collected", PYTEST_SHARD_DIR);
+    snprintf(log, sizeof(log), "%s/collect.log", PYTEST_SHARD_DIR);
+    snprintf(extra, sizeof(extra), "--collect-only -q \"--devcli-collect=%s\"", collected);
+    char *line=pluginCommand(parsed, pluginDir, extra, log);
+    if(!line) return -1;
+    LOG("Collecting tests once for the shard plan.");
+    remove(collected);
+    int status=spawnShell(line, NULL, NULL);
+    free(line);
+    PytestLines found;
+    if(status!=0 || readLines(collected, &found)!=0){
+        LOG("Collection failed (see %s); running pytest unsharded.", log);
+        return -1;
+    }
+    size_t len=strlen(keyLine)+2;
+    for(int i=0; i<found.count; i++) len+=strlen(found.lines[i])+1;
+    char *text=malloc(len);
+    if(!text){
+        linesFree(&found);
+        return -1;
+    }
+    char *p=text+sprintf(text, "%s\n", keyLine);
+    for(int i=0; i<found.count; i++) p+=sprintf(p, "%s\n", found.lines[i]);
+    linesFree(&found);
+    remove(collected);
+    int result=writeFileAtomic(path, text, (size_t)(p-text))==0 && readLines(path, ids)==0 ? 0 : -1;
+    free(text);
+    return result;
+}
+
+static int compareDurationIds(const void *a, const void *b){
+    return strcmp(((const PytestDuration*)a)->id, ((const PytestDuration*)b)->id);
+}
+
+/**
+ * @brief Finds the measured duration of `id` in the sorted `durations`.
+ *
+ * @return double Its seconds, or `-1` if it was never measured.
+ */
+static double durationOf(const PytestDuration *durations, int count, const char *id){
+    PytestDuration probe={id, 0};
+    const PytestDuration *found=count>0 ? bsearch(&probe, durations, (size_t)count, sizeof(PytestDuration), compareDurationIds) : NULL;
+    return found ? found->seconds : -1;
+}
+
+/**
+ * @brief Parses the durations file (`seconds<TAB>id` lines) into an array
+ *        sorted by ID.
+ *
+ * @return int Number of entries; `*durations` points into `lines`.
+ */
+static int loadDurations(PytestLines *lines, PytestDuration **durations){
+    char path[4200];
+    snprintf(path, sizeof(path), "%s/durations", PYTEST_SHARD_DIR);
+    *durations=NULL;
+    if(readLines(path, lines)!=0) return 0;
+    *durations=malloc((size_t)(lines->count+1)*sizeof(PytestDuration));
+    if(!*durations) return 0;
+    int count=0;
+    for(int i=0; i<lines->count; i++){
+        char *tab=strchr(lines->lines[i], '\t');
+        if(!tab) continue;
+        *tab='\0';
+        (*durations)[count].seconds=atof(lines->lines[i]);
+        (*durations)[count].id=tab+1;
+        count++;
+    }
+    qsort(*durations, (size_t)count, sizeof(PytestDuration), compareDurationIds);
+    return count;
+}
+
+/**
+ * @brief One test waiting to be placed in a shard.
+ */
+typedef struct {
+    const char *id;
+    double seconds;
+} PytestWork;
+
+static int compareWork(const void *a, const void *b){
+    const PytestWork *x=a, *y=b;
+    if(x->seconds!=y->seconds) return x->seconds<y->seconds ? 1 : -1;
+    return strcmp(x->id, y->id);
+}
+
+/**
+ * @brief Returns the shard plan: from the plan file if it was made for the
+ *        same collection, durations and shard count, otherwise planned
+ *        again and saved.
+ *
+ * @details Tests are placed longest first, each in the shard with the
+ *          least work so far (the LPT rule), which keeps the slowest shard
+ *          within a third of the best split. Tests never measured count as
+ *          the mean of those that were, or `PYTEST_DEFAULT_SECONDS`.
+ *
+ * @return int `0` with `plan` holding the key line and `shard<TAB>id` lines.
+ */
+static int loadPlan(const PytestLines *ids, const PytestDuration *durations, int durationCount, uint64_t key, int shards, PytestLines *plan){
+    char path[4200], keyLine[32];
+    snprintf(path, sizeof(path), "%s/plan", PYTEST_SHARD_DIR);
+    snprintf(keyLine, sizeof(keyLine), "%016llx", (unsigned long long)key);
+    if(readLines(path, plan)==0 && plan->count>0 && strcmp(plan->lines[0], keyLine)==0){
+        LOG("Tests and timings are unchanged; reusing the plan of %d shards.", shards);
+        return 0;
+    }
+    linesFree(plan);
+    int count=ids->count-1;
+    PytestWork *work=malloc((size_t)count*sizeof(PytestWork));
+    double known=0, mean=PYTEST_DEFAULT_SECONDS;
+    int measured=0;
+    if(!work) return -1;
+    for(int i=0; i<count; i++){
+        work[i].id=ids->lines[i+1];
+        work[i].seconds=durationOf(durations, durationCount, work[i].id);
+        if(work[i].seconds>=0){
+            known+=work[i].seconds;
+            measured++;
+        }
+    }
+    if(measured>0) mean=known/measured;
+    for(int i=0; i<count; i++){
+        if(work[i].seconds<0) work[i].seconds=mean;
+    }
+    qsort(work, (size_t)count, sizeof(PytestWork), compareWork);
+    double load[PYTEST_MAX_SHARDS]={0};
+    size_t len=strlen(keyLine)+2;
+    for(int i=0; i<count; i++) len+=strlen(work[i].id)+8;
+    char *text=malloc(len);
+    if(!text){
+        free(work);
+        return -1;
+    }
+    char *p=text+sprintf(text, "%s\n", keyLine);
+    for(int i=0; i<count; i++){
+        int best=0;
+        for(int s=1; s<shards; s++){
+            if(load[s]<load[best]) best=s;
+        }
+        load[best]+=work[i].seconds;
+        p+=sprintf(p, "%d\t%s\n", best, work[i].id);
+    }
+    double slowest=0;
+    for(int s=0; s<shards; s++){
+        if(load[s]>slowest) slowest=load[s];
+    }
+    LOG("Planned %d shards for %d tests (%d timed); the slowest shard should take about %.1f s.", shards, count, measured, slowest);
+    free(work);
+    int result=writeFileAtomic(path, text, (size_t)(p-text))==0 && readLines(path, plan)==0 ? 0 : -1;
+    free(text);
+    return result;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI shardThread(LPVOID arg)
+#else
+static void *shardThread(void *arg)
+#endif
+{
+    PytestShard *shard=arg;
+    shard->status=spawnShell(shard->command, NULL, &shard->peakMemory);
+    return 0;
+}
+
+/**
+ * @brief Prints the log of a shard to standard output.
+ */
+static void printLog(const char *path){
+    FILE *file=fopen(path, "rb");
+    if(!file) return;
+    char buffer[65536];
+    size_t got;
+    while((got=fread(buffer, 1, sizeof(buffer), file))>0) fwrite(buffer, 1, got, stdout);
+    fclose(file);
+    fflush(stdout);
+}
+
+/**
+ * @brief Merges the shard reports into one summary, and records their
+ *        durations.
+ *
+ * @details The durations file is rewritten only when a test is new, its
+ *          file is gone, or it took more than a quarter and 50 ms longer or
+ *          shorter than recorded, so ordinary jitter does not change the
+ *          plan. Tests of files this run did not collect, such as those left
+ *          out by test selection, keep their durations. Tests in `stale`
+ *          as `gone` no longer exist, so their missing reports are no
+ *          failure.
+ *
+ * @return int Number of tests that failed, errored, or did not report.
+ */
+static int mergeReports(const PytestLines *ids, int shards, const PytestDuration *durations, int durationCount, const PytestLines *stale){
+    int passed=0, failed=0, errors=0, skipped=0, changed=0;
+    double total=0;
+    int count=ids->count-1;
+    double *seconds=malloc((size_t)(count>0 ? count : 1)*sizeof(double));
+    PytestDuration *sorted=malloc((size_t)(count>0 ? count : 1)*sizeof(PytestDuration));
+    if(!seconds || !sorted){
+        free(seconds);
+        free(sorted);
+        return count;
+    }
+    for(int i=0; i<count; i++){
+        sorted[i].id=ids->lines[i+1];
+        sorted[i].seconds=i;
+    }
+    qsort(sorted, (size_t)count, sizeof(PytestDuration), compareDurationIds);
+    for(int i=0; i<count; i++) seconds[i]=-1;
+    char path[4200];
+    for(int s=0; s<shards; s++){
+        PytestLines report;
+        snprintf(path, sizeof(path), "%s/shard-%d.report", PYTEST_SHARD_DIR, s);
+        if(readLines(path, &report)!=0) continue;
+        for(int i=0; i<report.count; i++){
+            char *outcome=report.lines[i], *time=strchr(outcome, '\t'), *id=time ? strchr(time+1, '\t') : NULL;
+            if(!id) continue;
+            *time++='\0';
+            *id++='\0';
+            double took=atof(time);
+            total+=took;
+            if(strcmp(outcome, "passed")==0) passed++;
+            else if(strcmp(outcome, "skipped")==0) skipped++;
+            else{
+                if(strcmp(outcome, "error")==0) errors++;
+                else failed++;
+                LOG_ERROR("%s %s", strcmp(outcome, "error")==0 ? "ERROR" : "FAILED", id);
+            }
+            PytestDuration probe={id, 0};
+            const PytestDuration *at=bsearch(&probe, sorted, (size_t)count, sizeof(PytestDuration), compareDurationIds);
+            if(at) seconds[(int)at->seconds]=took;
+        }
+        linesFree(&report);
+    }
+    int missing=0;
+    for(int i=0; i<count; i++){
+        double old=durationOf(durations, durationCount, ids->lines[i+1]);
+        if(seconds[i]<0){
+            int gone=0;
+            for(int j=0; j<stale->count && !gone; j++){
+                gone=strncmp(stale->lines[j], "gone\t", 5)==0 && strcmp(stale->lines[j]+5, ids->lines[i+1])==0;
+            }
+            missing+=!gone;
+            seconds[i]=gone ? -1 : old;
+            if(gone) changed=1;
+            continue;
+        }
+        double diff=seconds[i]>old ? seconds[i]-old : old-seconds[i];
+        if(old<0 || (diff>0.05 && diff>old/4)) changed=1;
+    }
+    char *kept=calloc((size_t)(durationCount>0 ? durationCount : 1), 1);
+    for(int i=0; kept && i<durationCount; i++){
+        PytestDuration probe={durations[i].id, 0};
+        if(bsearch(&probe, sorted, (size_t)count, sizeof(PytestDuration), compareDurationIds)) continue;
+        struct stat info;
+        snprintf(path, sizeof(path), "%.*s", (int)strcspn(durations[i].id, ":"), durations[i].id);
+        kept[i]=stat(path, &info)==0;
+        if(!kept[i]) changed=1;
+    }
+    if(changed && kept){
+        size_t len=1;
+        for(int i=0; i<count; i++) len+=strlen(ids->lines[i+1])+32;
+        for(int i=0; i<durationCount; i++) len+=kept[i] ? strlen(durations[i].id)+32 : 0;
+        char *text=malloc(len);
+        if(text){
+            char *p=text;
+            for(int i=0; i<count; i++){
+                if(seconds[i]>=0) p+=sprintf(p, "%.6f\t%s\n", seconds[i], ids->lines[i+1]);
+            }
+            for(int i=0; i<durationCount; i++){
+                if(kept[i]) p+=sprintf(p, "%.6f\t%s\n", durations[i].seconds, durations[i].id);
+            }
+            snprintf(path, sizeof(path), "%s/durations", PYTEST_SHARD_DIR);
+            writeFileAtomic(path, text, (size_t)(p-text));
+            free(text);
+        }
+    }
+    if(missing>0) LOG_ERROR("%d tests did not report; a shard may have crashed.", missing);
+    if(failed+errors+missing>0) LOG_ERROR("%d passed, %d failed, %d errors, %d skipped in %d shards (%.1f s of tests).", passed, failed, errors, skipped, shards, total);
+    else LOG("%d passed, %d skipped in %d shards (%.1f s of tests).", passed, skipped, shards, total);
+    free(kept);
+    free(seconds);
+    free(sorted);
+    return failed+errors+missing;
+}
+
+/**
+ * @brief Runs a pytest command as several concurrent pytest processes,
+ *        each running a share of the tests balanced by their past
+ *        durations.
+ *
+ * @details For a command such as `test.py` (see `parsePytest()`), the test
+ *          IDs are collected once with `pytest --collect-only` and cached
+ *          under a key of the command and the contents of every test file
+ *          (`collectionKey()`); later runs reuse them until a test file,
+ *          `conftest.py` or the pytest configuration changes. Tests that
+ *          appear or disappear without that, such as parameters read from
+ *          data files, are caught by the shards: a test the plan does not
+ *          know runs in the first shard, a planned test that is gone is not
+ *          counted as a failure, and either drops the cached collection so
+ *          the next run collects again.
+ *
+ *          The IDs are split into shards by `loadPlan()`: one per `-j` job
+ *          (one per processor outside a devcli run), or
+ *          `DEVCLI_PYTEST_SHARDS`. Inside a devcli run the first shard uses
+ *          the task's jobserver token and every other one takes a token of
+ *          its own, so a busy run gets fewer shards rather than more
+ *          processes than `-j`. The plan is kept and reused until the
+ *          collection, the recorded durations or the shard count change.
+ *          Each shard is the original command with a plugin that deselects
+ *          the tests planned for other shards and reports outcomes and
+ *          durations; its output goes to `shard-N.log`, and the logs of
+ *          shards with failures are printed after all have finished. The
+ *          reports are merged into one summary and into the recorded
+ *          durations (`mergeReports()`).
+ *
+ * @ingroup pyshard
+ *
+ * @param command Command line after placeholder substitution.
+ * @param cpus CPU list of the entry; shards pinned to the same CPUs
+ *        would only compete for them, so a list makes the command run
+ *        unchanged.
+ * @param peakMemory Receives the peaks of the shards added up, in MiB.
+ * @param status Receives `0` if every test passed or was skipped and every
+ *        shard exited with 0 or 5 (no tests), `1` otherwise.
+ *
+ * @return int `0` if the tests ran here, `-1` if the command cannot be
+ *         sharded, sharding is off (`DEVCLI_PYTEST_SHARDS=0` or `1`),
+ *         the task is pinned to CPUs, collection failed or no jobserver token is free, and the caller
+ *         must run it.
+ *
+ * Example usage:
+ * @code
+ * int status;
+ * if (pytestShardRun("pytest tests", NULL, NULL, &status) != 0)
+ *     status = spawnShell("pytest tests", NULL, NULL);
+ * @endcode
+ */
+int pytestShardRun(const char *command, const char *cpus, uint32_t *peakMemory, int *status){
+    PytestCommand parsed={0};
+    const char *setting=getenv("DEVCLI_PYTEST_SHARDS");
+    int shards=setting && *setting ? atoi(setting) : jobserverJobs();
+    if(!(setting && *setting) && shards==0) shards=tapeHardwareThreads();
+    if(shards>PYTEST_MAX_SHARDS) shards=PYTEST_MAX_SHARDS;
+    char pluginDir[4096];
+    if(cpus) return -1;
+    if(shards<2 || parsePytest(command, &parsed)!=0 || prepareDirectory(pluginDir, sizeof(pluginDir))!=0){
+        free(parsed.copy);
+        return -1;
+    }
+    PytestLines ids, durationLines, plan;
+    if(loadCollection(&parsed, pluginDir, collectionKey(&parsed), &ids)!=0 || ids.count<3){
+        linesFree(&ids);
+        free(parsed.copy);
+        return -1;
+    }
+    if(shards>ids.count-1) shards=ids.count-1;
+    Jobserver jobserver;
+    int tokens[PYTEST_MAX_SHARDS];
+    int acquired=jobserverAcquireExtra(&jobserver, tokens, shards-1);
+    if(acquired<shards-1) LOG("%d jobserver token(s) free; running %d pytest shard(s) instead of %d.", acquired, acquired+1, shards);
+    shards=acquired+1;
+    if(shards<2){
+        jobserverReleaseExtra(&jobserver, tokens, acquired);
+        linesFree(&ids);
+        free(parsed.copy);
+        return -1;
+    }
+    PytestDuration *durations;
+    int durationCount=loadDurations(&durationLines, &durations);
+    uint64_t planKey=FINGERPRINT_SEED;
+    for(int i=0; i<ids.count; i++) planKey=fingerprintText(planKey, ids.lines[i]);
+    for(int i=0; i<durationCount; i++){
+        planKey=fingerprintText(planKey, durations[i].id);
+        planKey=fingerprintBytes(planKey, &durations[i].seconds, sizeof(double));
+    }
+    planKey=fingerprintBytes(planKey, &shards, sizeof(shards));
+    if(loadPlan(&ids, durations, durationCount, planKey, shards, &plan)!=0){
+        jobserverReleaseExtra(&jobserver, tokens, acquired);
+        free(durations);
+        linesFree(&durationLines);
+        linesFree(&ids);
+        free(parsed.copy);
+        return -1;
+    }
+    PytestShard runs[PYTEST_MAX_SHARDS];
+    char extra[13000], planPath[4200], stalePath[4200], report[4200], log[4200];
+    snprintf(planPath, sizeof(planPath), "%s/plan", PYTEST_SHARD_DIR);
+    snprintf(stalePath, sizeof(stalePath), "%s/stale", PYTEST_SHARD_DIR);
+    remove(stalePath);
+    int ready=1;
+    for(int s=0; s<shards; s++){
+        snprintf(report, sizeof(report), "%s/shard-%d.report", PYTEST_SHARD_DIR, s);
+        snprintf(log, sizeof(log), "%s/shard-%d.log", PYTEST_SHARD_DIR, s);
+        int n=snprintf(extra, sizeof(extra), "\"--devcli-plan=%s\" --devcli-shard=%d \"--devcli-report=%s\"", planPath, s, report);
+        if(s==0) snprintf(extra+n, sizeof(extra)-(size_t)n, " \"--devcli-stale=%s\"", stalePath);
+        remove(report);
+        runs[s].command=pluginCommand(&parsed, pluginDir, extra, log);
+        runs[s].peakMemory=0;
+        runs[s].status=-1;
+        if(!runs[s].command) ready=0;
+    }
+    if(ready){
+        LOG("Running %d tests in %d pytest shards.", ids.count-1, shards);
+        #ifdef _WIN32
+            HANDLE handles[PYTEST_MAX_SHARDS];
+            for(int s=1; s<shards; s++) handles[s]=CreateThread(NULL, 0, shardThread, &runs[s], 0, NULL);
+            shardThread(&runs[0]);
+            for(int s=1; s<shards; s++){
+                if(handles[s]){
+                    WaitForSingleObject(handles[s], INFINITE);
+                    CloseHandle(handles[s]);
+                }
+            }
+        #else
+            pthread_t handles[PYTEST_MAX_SHARDS];
+            int started[PYTEST_MAX_SHARDS];
+            for(int s=1; s<shards; s++) started[s]=pthread_create(&handles[s], NULL, shardThread, &runs[s])==0;
+            shardThread(&runs[0]);
+            for(int s=1; s<shards; s++){
+                if(started[s]) pthread_join(handles[s], NULL);
+            }
+        #endif
+        jobserverReleaseExtra(&jobserver, tokens, acquired);
+        uint32_t peak=0;
+        int failedShards=0;
+        for(int s=0; s<shards; s++){
+            peak+=runs[s].peakMemory;
+            int code=runs[s].status;
+            #ifndef _WIN32
+                if(WIFEXITED(code)) code=WEXITSTATUS(code);
+            #endif
+            if(code==0 || code==5) continue;
+            failedShards++;
+            snprintf(log, sizeof(log), "%s/shard-%d.log", PYTEST_SHARD_DIR, s);
+            LOG_ERROR("Shard %d of %d failed with exit status %d; its output follows.", s+1, shards, code);
+            printLog(log);
+        }
+        PytestLines stale;
+        readLines(stalePath, &stale);
+        if(stale.count>0){
+            char collection[4200];
+            snprintf(collection, sizeof(collection), "%s/collection", PYTEST_SHARD_DIR);
+            remove(collection);
+            LOG("%d tests were added or removed without a test file changing; new ones ran in shard 1, and the tests are collected again next run.", stale.count);
+        }
+        *status=mergeReports(&ids, shards, durations, durationCount, &stale)>0 || failedShards>0 ? 1 : 0;
+        linesFree(&stale);
+        if(peakMemory) *peakMemory=peak;
+    }
+    else jobserverReleaseExtra(&jobserver, tokens, acquired);
+    for(int s=0; s<shards; s++) free(runs[s].command);
+    free(durations);
+    linesFree(&durationLines);
+    linesFree(&plan);
+    linesFree(&ids);
+    free(parsed.copy);
+    return ready ? 0 : -1;
+}
+
+/** @} */ // end of pyshard group
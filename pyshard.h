@@ -0,0 +1,39 @@
+/**
+ * @file pyshard.h
+ * @brief Splits a pytest run into shards balanced by past test durations and runs them at once.
+ */
+
+#ifndef DEVCLI_PYSHARD_H
+#define DEVCLI_PYSHARD_H
+
+#include <stdint.h>
+
+/** @defgroup pyshard Test Sharding
+ *  @brief Cached pytest collection, duration-balanced shard plans and one merged report.
+ *  @{
+ */
+
+/**
+ * @def PYTEST_SHARD_DIR
+ * @brief Directory, below the task's working directory, holding the cached
+ *        collection, durations, shard plan and shard logs.
+ */
+#define PYTEST_SHARD_DIR ".pytest_cache/devcli"
+
+/**
+ * @def PYTEST_MAX_SHARDS
+ * @brief Most pytest processes one run starts at once.
+ */
+#define PYTEST_MAX_SHARDS 64
+
+/**
+ * @def PYTEST_MAX_WORDS
+ * @brief Most words a pytest command may have to be sharded.
+ */
+#define PYTEST_MAX_WORDS 64
+
+int pytestShardRun(const char *command, const char *cpus, uint32_t *peakMemory, int *status);
+
+/** @} */ // end of pyshard group
+
+#endif /* DEVCLI_PYSHARD_H */
@@ -0,0 +1,505 @@
+/**
+ * @file sched.c
+ * @brief Parallel execution of plans with named, capacity-limited resources.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#include "sched.h"
+#include "devcli.h"
+#include "hostpool.h"
+#include "isolation.h"
+#include "jobserver.h"
+#include "load.h"
+#include "membudget.h"
+#include "log.h"
+
+/** @addtogroup sched
+ *  @{
+ */
+
+/**
+ * @def SCHED_MAX_WORKERS
+ * @brief Upper bound on the workers of one run, including the calling thread.
+ */
+#define SCHED_MAX_WORKERS 64
+
+/**
+ * @def SCHED_HOST_POLL_MS
+ * @brief How often a worker looks for a host slot while other devcli
+ *        processes hold them all.
+ */
+#define SCHED_HOST_POLL_MS 100
+
+/**
+ * @def SCHED_MEMORY_PATIENCE
+ * @brief Times a node that does not fit in the memory budget may be passed
+ *        over by later nodes before memory is held back for it.
+ */
+#define SCHED_MEMORY_PATIENCE 3
+
+/**
+ * @brief Progress of one plan node.
+ */
+typedef enum {
+    SCHED_WAITING = 0,
+    SCHED_RUNNING,
+    SCHED_DONE
+} SchedState;
+
+/**
+ * @brief A resource named by at least one node of the plan.
+ *
+ * @details `name` is a string offset in the image, so equal names are equal
+ *          offsets; `CONFIG_NONE` stands for the console, which nodes that
+ *          prompt for `{{path}}` or `{{name}}` hold implicitly.
+ */
+typedef struct {
+    uint32_t name;
+    uint32_t capacity;  /**< Smallest capacity any node declared for it. */
+    uint32_t held;      /**< Nodes currently holding it. */
+} SchedResource;
+
+/**
+ * @brief State shared by the workers of one run, guarded by `lock`.
+ */
+typedef struct {
+    Plan *plan;
+    SchedResource *resources;
+    size_t resourceCount;
+    uint32_t *needs;        /**< Resource indexes, `firstNeed[i]` to `firstNeed[i + 1]` for node `i`. */
+    uint32_t *firstNeed;
+    unsigned char *state;   /**< A `SchedState` per node. */
+    int *tokens;            /**< Jobserver token held by each running node. */
+    int *slots;             /**< Host slot held by each running node. */
+    uint32_t *need;         /**< Estimated peak memory of each node in MiB, `0` if unknown. */
+    unsigned *passed;       /**< Times each node was passed over for lack of memory. */
+    size_t done;
+    int running;            /**< Nodes running a command right now. */
+    uint32_t memoryBudget;  /**< MiB the running nodes may need together; `0` for no limit. */
+    uint32_t memoryUsed;    /**< Sum of `need` over the running nodes. */
+    size_t reserved;        /**< Node memory is held back for, or `plan->count`. */
+    MemoryHistory history;
+    Jobserver jobserver;
+    HostPool hostPool;
+    LoadControl load;
+    Isolation isolation;
+    int tokenWaiter;        /**< A worker is blocked in `jobserverWait()` or `jobserverSleep()`. */
+    #ifdef _WIN32
+        CRITICAL_SECTION lock;
+        CONDITION_VARIABLE changed;
+    #else
+        pthread_mutex_t lock;
+        pthread_cond_t changed;
+    #endif
+} Scheduler;
+
+static void schedLock(Scheduler *s){
+    #ifdef _WIN32
+        EnterCriticalSection(&s->lock);
+    #else
+        pthread_mutex_lock(&s->lock);
+    #endif
+}
+
+static void schedUnlock(Scheduler *s){
+    #ifdef _WIN32
+        LeaveCriticalSection(&s->lock);
+    #else
+        pthread_mutex_unlock(&s->lock);
+    #endif
+}
+
+/** @brief Sleeps until another worker finishes a node; `lock` must be held. */
+static void schedWait(Scheduler *s){
+    #ifdef _WIN32
+        SleepConditionVariableCS(&s->changed, &s->lock, INFINITE);
+    #else
+        pthread_cond_wait(&s->changed, &s->lock);
+    #endif
+}
+
+static void schedWakeAll(Scheduler *s){
+    #ifdef _WIN32
+        WakeAllConditionVariable(&s->changed);
+    #else
+        pthread_cond_broadcast(&s->changed);
+    #endif
+}
+
+/**
+ * @brief Returns the index of resource `name`, adding it if needed.
+ *
+ * @details A resource keeps the smallest capacity declared for it, so a task
+ *          that asks for exclusive use gets it even if others would share.
+ */
+static uint32_t schedResource(Scheduler *s, uint32_t name, uint32_t capacity){
+    for(size_t r=0; r<s->resourceCount; r++){
+        if(s->resources[r].name!=name) continue;
+        if(capacity<s->resources[r].capacity) s->resources[r].capacity=capacity;
+        return (uint32_t)r;
+    }
+    s->resources[s->resourceCount].name=name;
+    s->resources[s->resourceCount].capacity=capacity;
+    s->resources[s->resourceCount].held=0;
+    return (uint32_t)s->resourceCount++;
+}
+
+/**
+ * @brief Returns `1` if running `node` prompts on the console.
+ */
+static int promptsUser(const ConfigImage *config, const PlanNode *node){
+    const char *cmd=configString(config, node->entry->cmd);
+    return cmd && (strstr(cmd, "{{path}}") || strstr(cmd, "{{name}}"));
+}
+
+/**
+ * @brief Writes `category.task` of node `i` into `out`, the key of the memory history.
+ */
+static void schedTaskName(const Plan *plan, size_t i, char *out, size_t size){
+    const ConfigTask *task=&configTasks(plan->config)[plan->nodes[i].task];
+    snprintf(out, size, "%s.%s", configString(plan->config, configCategories(plan->config)[task->category].name), configString(plan->config, task->name));
+}
+
+/**
+ * @brief Collects the resources every node of the plan must hold.
+ *
+ * @details Nodes that will not run a command (no entry for the shell, or
+ *          already handled by `planInstallPackages()`) need nothing. A
+ *          resource named twice by the same node is held once.
+ *
+ *          The memory a node needs is the `memory` its entry declares or,
+ *          failing that, the peak learned from earlier runs of the task.
+ *
+ * @return int `0` on success, `-1` on allocation failure.
+ */
+static int schedCollect(Scheduler *s){
+    const Plan *plan=s->plan;
+    const ConfigImage *config=plan->config;
+    size_t total=0;
+    for(size_t i=0; i<plan->count; i++){
+        if(plan->nodes[i].entry) total+=plan->nodes[i].entry->resourceCount+1;
+    }
+    s->resources=malloc((total+1)*sizeof(SchedResource));
+    s->needs=malloc((total+1)*sizeof(uint32_t));
+    s->firstNeed=malloc((plan->count+1)*sizeof(uint32_t));
+    s->state=calloc(plan->count+1, 1);
+    s->tokens=malloc((plan->count+1)*sizeof(int));
+    s->slots=malloc((plan->count+1)*sizeof(int));
+    s->need=calloc(plan->count+1, sizeof(uint32_t));
+    s->passed=calloc(plan->count+1, sizeof(unsigned));
+    if(!s->resources || !s->needs || !s->firstNeed || !s->state || !s->tokens || !s->slots || !s->need || !s->passed) return -1;
+    size_t needCount=0;
+    for(size_t i=0; i<plan->count; i++){
+        const PlanNode *node=&plan->nodes[i];
+        s->firstNeed[i]=(uint32_t)needCount;
+        if(!node->entry || node->status!=PLAN_PENDING) continue;
+        CONFIG_FOR_EACH_RESOURCE(config, node->entry, resource){
+            uint32_t r=schedResource(s, resource->name, resource->capacity);
+            size_t k=s->firstNeed[i];
+            while(k<needCount && s->needs[k]!=r) k++;
+            if(k==needCount) s->needs[needCount++]=r;
+        }
+        if(promptsUser(config, node)) s->needs[needCount++]=schedResource(s, CONFIG_NONE, 1);
+        if(node->entry->memory!=CONFIG_NONE) s->need[i]=node->entry->memory;
+        else{
+            char name[256];
+            schedTaskName(plan, i, name, sizeof(name));
+            s->need[i]=memoryHistoryPeak(&s->history, name);
+        }
+    }
+    s->firstNeed[plan->count]=(uint32_t)needCount;
+    return 0;
+}
+
+/**
+ * @brief Returns `1` if node `i` can start now.
+ *
+ * @details Every dependency listed before it in the plan must be done. Edges
+ *          to later nodes only arise from a `dependsOn` cycle, which
+ *          `planBuild()` has already reported, so they are ignored rather
+ *          than waited on forever. Every resource must have a free slot.
+ */
+static int schedReady(const Scheduler *s, size_t i){
+    const Plan *plan=s->plan;
+    const PlanNode *node=&plan->nodes[i];
+    if(node->entry){
+        CONFIG_FOR_EACH_DEP(plan->config, node->entry, dep){
+            if(dep->task==CONFIG_NONE) continue;
+            uint32_t j=plan->nodeOf[dep->task];
+            if(j<i && s->state[j]!=SCHED_DONE) return 0;
+        }
+    }
+    for(uint32_t k=s->firstNeed[i]; k<s->firstNeed[i+1]; k++){
+        const SchedResource *resource=&s->resources[s->needs[k]];
+        if(resource->held>=resource->capacity) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Returns `1` if node `i` fits in the memory budget next to the
+ *        running nodes.
+ *
+ * @details A node of unknown size always fits, and so does any node while
+ *          nothing runs, so a node larger than the whole budget still runs,
+ *          alone. While memory is held back for a node that was passed over
+ *          too often, other nodes only fit if that node would still fit next
+ *          to them, so they can fill the gap but never delay it.
+ */
+static int schedFits(const Scheduler *s, size_t i){
+    if(s->need[i]==0 || s->memoryBudget==0 || s->running==0) return 1;
+    uint64_t total=(uint64_t)s->memoryUsed+s->need[i];
+    if(s->reserved!=s->plan->count && s->reserved!=i) total+=s->need[s->reserved];
+    return total<=s->memoryBudget;
+}
+
+/**
+ * @brief Loop run by every worker: take the first ready node, run it, repeat.
+ *
+ * @details A node's resources are taken together, under the same lock that
+ *          checked they were all free, and released together when it ends.
+ *          No worker ever holds some resources while waiting for others, so
+ *          tasks sharing resources cannot deadlock. Nodes are tried in plan
+ *          order, but a node that must wait does not hold up later ones: the
+ *          worker moves on to the next ready node, so the remaining slots are
+ *          still used.
+ *
+ *          A node that runs a command also needs a slot of the host budget,
+ *          shared with other devcli processes, and a jobserver token, shared
+ *          with the makes the tasks start. The slot is taken first and given
+ *          back if no token is free. When either is missing, one worker
+ *          waits with the lock released, on the jobserver for a token or up
+ *          to `SCHED_HOST_POLL_MS` for a slot, and the others wait for it or
+ *          for a node to finish.
+ *
+ *          Before any of that, the node must fit under the current limit of
+ *          `loadLimit()`, which follows the host load with `--adaptive` or
+ *          `--max-load`. While it does not, the waiting worker samples again
+ *          every `LOAD_SAMPLE_MS` or as soon as a node finishes.
+ *
+ *          A node whose estimated peak memory does not fit in the memory
+ *          budget next to the running ones (`schedFits()`) is passed over for
+ *          later nodes that do. Once it has been passed over
+ *          `SCHED_MEMORY_PATIENCE` times, memory is held back for it until it
+ *          starts, so a large task cannot be skipped forever. When a node
+ *          finishes, its measured peak is recorded in the memory history.
+ */
+static void schedWork(Scheduler *s){
+    const Plan *plan=s->plan;
+    schedLock(s);
+    while(s->done<plan->count){
+        size_t pick=plan->count, blocked=plan->count;
+        for(size_t i=0; i<plan->count && pick==plan->count; i++){
+            if(s->state[i]!=SCHED_WAITING || !schedReady(s, i)) continue;
+            if(schedFits(s, i)) pick=i;
+            else if(blocked==plan->count) blocked=i;
+        }
+        if(pick==plan->count){
+            schedWait(s);
+            continue;
+        }
+        int token=JOBSERVER_NONE, slot=HOST_POOL_UNMANAGED;
+        int runs=plan->nodes[pick].entry && plan->nodes[pick].status==PLAN_PENDING;
+        int throttled=runs && s->running>=loadLimit(&s->load, s->running);
+        if(runs && !throttled){
+            slot=hostPoolTryAcquire(&s->hostPool);
+            if(slot!=HOST_POOL_NONE && (token=jobserverTryAcquire(&s->jobserver))==JOBSERVER_NONE){
+                hostPoolRelease(&s->hostPool, slot);
+            }
+        }
+        if(runs && (throttled || slot==HOST_POOL_NONE || token==JOBSERVER_NONE)){
+            if(s->tokenWaiter){
+                schedWait(s);
+                continue;
+            }
+            s->tokenWaiter=1;
+            schedUnlock(s);
+            if(throttled) jobserverSleep(&s->jobserver, LOAD_SAMPLE_MS);
+            else if(slot==HOST_POOL_NONE) jobserverSleep(&s->jobserver, SCHED_HOST_POLL_MS);
+            else jobserverWait(&s->jobserver);
+            schedLock(s);
+            s->tokenWaiter=0;
+            schedWakeAll(s);
+            continue;
+        }
+        s->state[pick]=SCHED_RUNNING;
+        s->tokens[pick]=token;
+        s->slots[pick]=slot;
+        for(uint32_t k=s->firstNeed[pick]; k<s->firstNeed[pick+1]; k++) s->resources[s->needs[k]].held++;
+        s->running+=runs;
+        s->memoryUsed+=s->need[pick];
+        if(pick==s->reserved) s->reserved=plan->count;
+        else if(blocked<pick && s->reserved==plan->count && ++s->passed[blocked]>=SCHED_MEMORY_PATIENCE){
+            char name[256];
+            schedTaskName(plan, blocked, name, sizeof(name));
+            LOG("Holding memory back for %s (%u MiB), which was passed over %u times.", name, s->need[blocked], s->passed[blocked]);
+            s->reserved=blocked;
+        }
+        schedUnlock(s);
+        runTask(plan->config, &plan->nodes[pick]);
+        schedLock(s);
+        for(uint32_t k=s->firstNeed[pick]; k<s->firstNeed[pick+1]; k++) s->resources[s->needs[k]].held--;
+        jobserverRelease(&s->jobserver, s->tokens[pick]);
+        hostPoolRelease(&s->hostPool, s->slots[pick]);
+        s->running-=runs;
+        s->memoryUsed-=s->need[pick];
+        if(plan->nodes[pick].peakMemory>0){
+            char name[256];
+            schedTaskName(plan, pick, name, sizeof(name));
+            memoryHistoryRecord(&s->history, name, plan->nodes[pick].peakMemory);
+        }
+        if(s->tokenWaiter) jobserverWake(&s->jobserver);
+        s->state[pick]=SCHED_DONE;
+        s->done++;
+        schedWakeAll(s);
+    }
+    jobserverWake(&s->jobserver);
+    schedUnlock(s);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI schedWorker(LPVOID arg)
+#else
+static void *schedWorker(void *arg)
+#endif
+{
+    schedWork(arg);
+    return 0;
+}
+
+/**
+ * @brief Runs every node of `plan` with up to `jobs` tasks at a time.
+ *
+ * @details A node starts once the nodes it depends on have finished and it
+ *          can hold every resource its entry declares under `resources`
+ *          (e.g. `{"dpkg": 1, "build-dir": 1}`): at most `capacity` running
+ *          tasks hold the same resource. Tasks that prompt for `{{path}}` or
+ *          `{{name}}` also hold the console, so prompts never interleave.
+ *          The calling thread is one of the workers; with `jobs` of 1 the
+ *          nodes run one after another in plan order, exactly as before.
+ *
+ *          `jobs` is also the size of the jobserver pool (`jobserverOpen()`)
+ *          that every running task draws one token from and that a nested
+ *          `make`, `ninja` or `cmake --build` draws its extra jobs from, so
+ *          devcli and the builds it starts never run more than `jobs` jobs
+ *          between them. Each running task also holds a slot of the budget
+ *          all devcli processes of the user share (`hostPoolOpen()`).
+ *
+ *          With `adaptive` the number of tasks running at once moves between
+ *          1 and `jobs` with the CPU and memory pressure and the load average
+ *          of the host; with `maxLoad` no task starts while the load average
+ *          is that high and another task is running (`loadLimit()`).
+ *
+ *          Tasks also share a memory budget: `memoryBudget`, or the memory
+ *          available when the run starts (`memoryAvailable()`). A task is
+ *          admitted only while the estimated peaks of the running tasks plus
+ *          its own fit in it; the estimates come from the `memory` the entry
+ *          declares or from the peaks of earlier runs (the `memory` file
+ *          of the cache directory), which this run updates.
+ *
+ *          With `isolate`, devcli first moves itself into a cgroup of its own
+ *          (`isolationOpen()`) with `cpuWeight` and, when `memoryBudget` was
+ *          given, `memory.high` set to it, so every task it starts is held
+ *          to those limits.
+ *
+ * @ingroup sched
+ *
+ * @param plan Plan built by `planBuild()`, after `planInstallPackages()`.
+ * @param options `-j`, `--adaptive`, `--max-load`, `--memory-budget`,
+ *        `--cgroup` and `--cpu-weight`; a `jobs` below 1 means 1.
+ *
+ * @return int `0` on success, `-1` if the run could not be set up.
+ *
+ * Example usage:
+ * @code
+ * if (planBuild(config, task, shellKind, &plan) == 0) {
+ *     SchedOptions options = {4, 0, 0, 0, 0, ISOLATION_DEFAULT_WEIGHT};
+ *     schedRun(&plan, &options);
+ *     planFree(&plan);
+ * }
+ * @endcode
+ */
+int schedRun(Plan *plan, const SchedOptions *options){
+    int jobs=options->jobs<1 ? 1 : options->jobs;
+    Scheduler s;
+    memset(&s, 0, sizeof(s));
+    s.plan=plan;
+    s.reserved=plan->count;
+    memoryHistoryLoad(&s.history);
+    if(schedCollect(&s)!=0){
+        LOG_ERROR("Dynamic Memory not assigned to scheduler.");
+        free(s.resources);
+        free(s.needs);
+        free(s.firstNeed);
+        free(s.state);
+        free(s.tokens);
+        free(s.slots);
+        free(s.need);
+        free(s.passed);
+        memoryHistoryFree(&s.history);
+        return -1;
+    }
+    int workers=jobs;
+    if(workers>SCHED_MAX_WORKERS) workers=SCHED_MAX_WORKERS;
+    if((size_t)workers>plan->count) workers=plan->count>0 ? (int)plan->count : 1;
+    if(workers>1) LOG("Running %zu task(s) with up to %d at a time.", plan->count, workers);
+    s.memoryBudget=options->memoryBudget ? options->memoryBudget : memoryAvailable();
+    for(size_t i=0; i<plan->count && workers>1 && s.memoryBudget; i++){
+        if(s.need[i]==0) continue;
+        LOG("Admitting tasks within a memory budget of %u MiB.", s.memoryBudget);
+        break;
+    }
+    if(options->isolate) isolationOpen(&s.isolation, options->cpuWeight, options->memoryBudget);
+    hostPoolOpen(&s.hostPool);
+    jobserverOpen(&s.jobserver, jobs);
+    loadOpen(&s.load, jobs, options->adaptive, options->maxLoad);
+    #ifdef _WIN32
+        InitializeCriticalSection(&s.lock);
+        InitializeConditionVariable(&s.changed);
+        HANDLE handles[SCHED_MAX_WORKERS];
+        for(int t=1; t<workers; t++) handles[t]=CreateThread(NULL, 0, schedWorker, &s, 0, NULL);
+        schedWork(&s);
+        for(int t=1; t<workers; t++){
+            if(handles[t]){
+                WaitForSingleObject(handles[t], INFINITE);
+                CloseHandle(handles[t]);
+            }
+        }
+        DeleteCriticalSection(&s.lock);
+    #else
+        pthread_mutex_init(&s.lock, NULL);
+        pthread_cond_init(&s.changed, NULL);
+        pthread_t handles[SCHED_MAX_WORKERS];
+        int started[SCHED_MAX_WORKERS];
+        for(int t=1; t<workers; t++) started[t]=pthread_create(&handles[t], NULL, schedWorker, &s)==0;
+        schedWork(&s);
+        for(int t=1; t<workers; t++){
+            if(started[t]) pthread_join(handles[t], NULL);
+        }
+        pthread_cond_destroy(&s.changed);
+        pthread_mutex_destroy(&s.lock);
+    #endif
+    jobserverClose(&s.jobserver);
+    hostPoolClose(&s.hostPool);
+    isolationClose(&s.isolation);
+    free(s.resources);
+    free(s.needs);
+    free(s.firstNeed);
+    free(s.state);
+    free(s.tokens);
+    free(s.slots);
+    free(s.need);
+    free(s.passed);
+    memoryHistorySave(&s.history);
+    memoryHistoryFree(&s.history);
+    return 0;
+}
+
+/** @} */ // end of sched group
@@ -0,0 +1,32 @@
+/**
+ * @file sched.h
+ * @brief Runs the nodes of a plan in parallel, honouring dependencies and resources.
+ */
+
+#ifndef DEVCLI_SCHED_H
+#define DEVCLI_SCHED_H
+
+#include "plan.h"
+
+/** @defgroup sched Scheduling
+ *  @brief Hands ready plan nodes to a pool of workers.
+ *  @{
+ */
+
+/**
+ * @brief How a plan is run, from the command-line options.
+ */
+typedef struct {
+    int jobs;           /**< Most tasks running at once (`-j`). */
+    int adaptive;       /**< Scale the tasks running at once to the host load (`--adaptive`). */
+    double maxLoad;     /**< Start no task while the load average is at least this (`--max-load`); `0` for no cap. */
+    uint32_t memoryBudget; /**< MiB the running tasks may need together (`--memory-budget`); `0` for the memory available at start. */
+    int isolate;        /**< Confine the run to a cgroup of its own (`--cgroup`). */
+    int cpuWeight;      /**< `cpu.weight` of that cgroup (`--cpu-weight`). */
+} SchedOptions;
+
+int schedRun(Plan *plan, const SchedOptions *options);
+
+/** @} */ // end of sched group
+
+#endif /* DEVCLI_SCHED_H */
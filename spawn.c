@@ -0,0 +1,500 @@
+/**
+ * @file spawn.c
+ * @brief Starts task commands through the shell and measures their peak memory.
+ */
+
+#ifdef __linux__
+#define _GNU_SOURCE /* CPU_SET and pthread_setaffinity_np */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#include <sys/resource.h>
+#include <sys/wait.h>
+#endif
+#include "spawn.h"
+#include "log.h"
+
+#ifndef _WIN32
+extern char **environ;
+#endif
+
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
+#define SPAWN_HAVE_PIPE2 1
+#endif
+
+/** @addtogroup spawn
+ *  @{
+ */
+
+/**
+ * @brief A shell command whose standard input and output are pipes to
+ *        devcli; its standard error is devcli's.
+ */
+struct SpawnPipe {
+    #ifdef _WIN32
+        HANDLE process;
+        HANDLE input;           /**< Write end of the child's standard input. */
+        HANDLE output;          /**< Read end of the child's standard output. */
+        HANDLE job;             /**< Job object measuring its peak memory. */
+    #else
+        pid_t pid;
+        int input;
+        int output;
+    #endif
+    char buffer[4096];          /**< Output read but not yet returned as lines. */
+    size_t start, end;
+};
+
+#if !defined(_WIN32) && !defined(SPAWN_HAVE_PIPE2)
+/**
+ * @brief Held from creating a pipe until it is close-on-exec, and around
+ *        every spawn, where `pipe2()` cannot create it so at once.
+ */
+static pthread_mutex_t spawnLock=PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+#ifndef _WIN32
+/**
+ * @brief Creates a pipe whose ends are both close-on-exec.
+ *
+ * @details With `pipe2()` this is atomic. Without it the caller holds
+ *          `spawnLock`, so no other thread spawns between `pipe()` and
+ *          `fcntl()`.
+ *
+ * @return int `0` on success.
+ */
+static int pipeCloseOnExec(int fds[2]){
+    #ifdef SPAWN_HAVE_PIPE2
+        return pipe2(fds, O_CLOEXEC);
+    #else
+        if(pipe(fds)!=0) return -1;
+        fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+        return 0;
+    #endif
+}
+#endif
+
+/**
+ * @brief Parses a CPU list such as `0-3,6` into a bitmask of
+ *        `SPAWN_MAX_CPUS` bits.
+ *
+ * @return int Number of CPUs in the list, or `-1` after reporting a list
+ *         that is malformed or names a CPU past `SPAWN_MAX_CPUS`.
+ */
+static int parseCpuList(const char *list, uint64_t mask[SPAWN_MAX_CPUS/64]){
+    memset(mask, 0, SPAWN_MAX_CPUS/8);
+    int count=0;
+    const char *p=list;
+    while(*p){
+        char *end=NULL;
+        long first=strtol(p, &end, 10), last=first;
+        if(end==p) break;
+        p=end;
+        if(*p=='-'){
+            last=strtol(p+1, &end, 10);
+            if(end==p+1) break;
+            p=end;
+        }
+        if(first<0 || last<first || last>=SPAWN_MAX_CPUS) break;
+        for(long cpu=first; cpu<=last; cpu++){
+            if(!(mask[cpu/64]>>(cpu%64)&1)) count++;
+            mask[cpu/64]|=1ull<<(cpu%64);
+        }
+        if(*p==',') p++;
+        else if(*p) break;
+    }
+    if(*p || count==0){
+        LOG_ERROR("cpus \"%s\" is not a CPU list such as 0-3,6 below %d; running the task unpinned.", list, SPAWN_MAX_CPUS);
+        return -1;
+    }
+    return count;
+}
+
+/**
+ * @brief Runs `command` through the shell, like `system()`, and measures the
+ *        most memory it used at once.
+ *
+ * @details `system()` cannot say how much memory a command took, which the
+ *          scheduler needs to learn how heavy each task is. On POSIX the
+ *          shell is started with `posix_spawn()` and reaped with `wait4()`,
+ *          whose `ru_maxrss` is the largest resident set of the shell and of
+ *          every process it waited for. That is the peak of the biggest single
+ *          process, such as one compiler or one JVM, not of all of them added
+ *          up. On Windows the shell runs in a job object and the peak is the
+ *          job's `PeakJobMemoryUsed`, the most memory all of its processes
+ *          committed together.
+ *
+ *          With `cpus`, the command and everything it starts run only on
+ *          those CPUs, for benchmarks that must not migrate. On Linux the
+ *          calling thread pins itself just for the `posix_spawn()`, which
+ *          hands its CPU mask to the child before the shell runs anything;
+ *          on Windows the suspended process is pinned before it resumes,
+ *          to CPUs below 64 (one processor group). Other systems have no
+ *          affinity call and run the command unpinned.
+ *
+ * @ingroup spawn
+ *
+ * @param command Command line for `/bin/sh -c` (`%COMSPEC% /c` on Windows).
+ * @param cpus CPU list such as `0-3,6` to pin the command to, or `NULL`.
+ * @param peakMemory Receives the peak in MiB, rounded up, or `0` if it could
+ *        not be measured; may be `NULL`.
+ *
+ * @return int The same status `system()` would return: `0` on success, `-1`
+ *         if the shell could not be started.
+ *
+ * Example usage:
+ * @code
+ * uint32_t peak;
+ * if (spawnShell("make -j4", NULL, &peak) == 0) printf("make used %u MiB\n", peak);
+ * spawnShell("./bench", "2-3", NULL);
+ * @endcode
+ */
+int spawnShell(const char *command, const char *cpus, uint32_t *peakMemory){
+    uint64_t peakBytes=0;
+    int status=-1;
+    uint64_t mask[SPAWN_MAX_CPUS/64];
+    int pinned=cpus && parseCpuList(cpus, mask)>0;
+    #ifdef _WIN32
+        const char *comspec=getenv("COMSPEC");
+        size_t length=strlen(command)+(comspec ? strlen(comspec) : 7)+8;
+        char *line=malloc(length);
+        if(!line){
+            LOG_ERROR("Dynamic Memory allocation failed.");
+            return -1;
+        }
+        snprintf(line, length, "\"%s\" /c %s", comspec ? comspec : "cmd.exe", command);
+        STARTUPINFOA startup;
+        PROCESS_INFORMATION process;
+        memset(&startup, 0, sizeof(startup));
+        startup.cb=sizeof(startup);
+        HANDLE job=CreateJobObjectA(NULL, NULL);
+        if(!CreateProcessA(NULL, line, NULL, NULL, TRUE, CREATE_SUSPENDED, NULL, NULL, &startup, &process)){
+            LOG_ERROR("Could not start the shell for: %s", command);
+            free(line);
+            if(job) CloseHandle(job);
+            return -1;
+        }
+        free(line);
+        if(job) AssignProcessToJobObject(job, process.hProcess);
+        if(pinned && !SetProcessAffinityMask(process.hProcess, (DWORD_PTR)mask[0])) LOG_ERROR("Could not pin the task to CPUs %s.", cpus);
+        ResumeThread(process.hThread);
+        CloseHandle(process.hThread);
+        WaitForSingleObject(process.hProcess, INFINITE);
+        DWORD code=1;
+        GetExitCodeProcess(process.hProcess, &code);
+        CloseHandle(process.hProcess);
+        status=(int)code;
+        JOBOBJECT_EXTENDED_LIMIT_INFORMATION info;
+        if(job && QueryInformationJobObject(job, JobObjectExtendedLimitInformation, &info, sizeof(info), NULL)){
+            peakBytes=info.PeakJobMemoryUsed;
+        }
+        if(job) CloseHandle(job);
+    #else
+        char *argv[]={"sh", "-c", (char*)command, NULL};
+        pid_t pid;
+        #ifdef __linux__
+            cpu_set_t saved, set;
+            if(pinned){
+                CPU_ZERO(&set);
+                for(int cpu=0; cpu<SPAWN_MAX_CPUS && cpu<CPU_SETSIZE; cpu++){
+                    if(mask[cpu/64]>>(cpu%64)&1) CPU_SET(cpu, &set);
+                }
+                if(pthread_getaffinity_np(pthread_self(), sizeof(saved), &saved)!=0 || pthread_setaffinity_np(pthread_self(), sizeof(set), &set)!=0){
+                    LOG_ERROR("Could not pin the task to CPUs %s; running it unpinned.", cpus);
+                    pinned=0;
+                }
+            }
+        #else
+            if(pinned) LOG("This system cannot pin tasks to CPUs; running on any CPU.");
+        #endif
+        #ifndef SPAWN_HAVE_PIPE2
+            pthread_mutex_lock(&spawnLock);
+        #endif
+        int error=posix_spawn(&pid, "/bin/sh", NULL, NULL, argv, environ);
+        #ifndef SPAWN_HAVE_PIPE2
+            pthread_mutex_unlock(&spawnLock);
+        #endif
+        #ifdef __linux__
+            if(pinned) pthread_setaffinity_np(pthread_self(), sizeof(saved), &saved);
+        #endif
+        if(error!=0){
+            LOG_ERROR("Could not start the shell for: %s (%s)", command, strerror(error));
+            return -1;
+        }
+        struct rusage usage;
+        memset(&usage, 0, sizeof(usage));
+        while(wait4(pid, &status, 0, &usage)<0){
+            if(errno!=EINTR){
+                status=-1;
+                break;
+            }
+        }
+        #ifdef __APPLE__
+            peakBytes=(uint64_t)usage.ru_maxrss;
+        #else
+            peakBytes=(uint64_t)usage.ru_maxrss*1024;
+        #endif
+    #endif
+    if(peakMemory) *peakMemory=(uint32_t)((peakBytes+(1u<<20)-1)>>20);
+    return status;
+}
+
+/**
+ * @brief Starts `command` through the shell with pipes to its standard
+ *        input and output, for long-lived helpers such as test runners
+ *        that devcli feeds one request at a time.
+ *
+ * @details Both pipes are created close-on-exec, and only the command's
+ *          own standard input and output get its ends, so no other command
+ *          started meanwhile inherits either end: a helper sees end of
+ *          input as soon as `spawnPipeClose()` closes it, and devcli sees
+ *          end of output when the helper dies, even while other helpers
+ *          run.
+ *
+ * @ingroup spawn
+ *
+ * @param command Command line for `/bin/sh -c` (`%COMSPEC% /c` on Windows).
+ *
+ * @return SpawnPipe* The running command, or `NULL` if it could not be
+ *         started.
+ *
+ * Example usage:
+ * @code
+ * SpawnPipe *child = spawnPiped("java -cp runner Runner");
+ * char line[256];
+ * if (child && spawnPipeWrite(child, "FooTest\n") == 0 && spawnPipeReadLine(child, line, sizeof(line)) == 0)
+ *     printf("%s\n", line);
+ * if (child) spawnPipeClose(child, NULL);
+ * @endcode
+ */
+SpawnPipe *spawnPiped(const char *command){
+    SpawnPipe *child=calloc(1, sizeof(SpawnPipe));
+    if(!child){
+        LOG_ERROR("Dynamic Memory allocation failed.");
+        return NULL;
+    }
+    #ifdef _WIN32
+        SECURITY_ATTRIBUTES inherit={sizeof(SECURITY_ATTRIBUTES), NULL, TRUE};
+        HANDLE childInput, childOutput;
+        if(!CreatePipe(&childInput, &child->input, &inherit, 0)){
+            free(child);
+            return NULL;
+        }
+        if(!CreatePipe(&child->output, &childOutput, &inherit, 0)){
+            CloseHandle(childInput);
+            CloseHandle(child->input);
+            free(child);
+            return NULL;
+        }
+        SetHandleInformation(child->input, HANDLE_FLAG_INHERIT, 0);
+        SetHandleInformation(child->output, HANDLE_FLAG_INHERIT, 0);
+        const char *comspec=getenv("COMSPEC");
+        size_t length=strlen(command)+(comspec ? strlen(comspec) : 7)+8;
+        char *line=malloc(length);
+        STARTUPINFOA startup;
+        PROCESS_INFORMATION process;
+        memset(&startup, 0, sizeof(startup));
+        startup.cb=sizeof(startup);
+        startup.dwFlags=STARTF_USESTDHANDLES;
+        startup.hStdInput=childInput;
+        startup.hStdOutput=childOutput;
+        startup.hStdError=GetStdHandle(STD_ERROR_HANDLE);
+        int started=0;
+        if(line){
+            snprintf(line, length, "\"%s\" /c %s", comspec ? comspec : "cmd.exe", command);
+            started=CreateProcessA(NULL, line, NULL, NULL, TRUE, CREATE_SUSPENDED, NULL, NULL, &startup, &process);
+            free(line);
+        }
+        CloseHandle(childInput);
+        CloseHandle(childOutput);
+        if(!started){
+            LOG_ERROR("Could not start the shell for: %s", command);
+            CloseHandle(child->input);
+            CloseHandle(child->output);
+            free(child);
+            return NULL;
+        }
+        child->job=CreateJobObjectA(NULL, NULL);
+        if(child->job) AssignProcessToJobObject(child->job, process.hProcess);
+        ResumeThread(process.hThread);
+        CloseHandle(process.hThread);
+        child->process=process.hProcess;
+    #else
+        int input[2], output[2];
+        #ifndef SPAWN_HAVE_PIPE2
+            pthread_mutex_lock(&spawnLock);
+        #endif
+        if(pipeCloseOnExec(input)!=0){
+            #ifndef SPAWN_HAVE_PIPE2
+                pthread_mutex_unlock(&spawnLock);
+            #endif
+            free(child);
+            return NULL;
+        }
+        if(pipeCloseOnExec(output)!=0){
+            #ifndef SPAWN_HAVE_PIPE2
+                pthread_mutex_unlock(&spawnLock);
+            #endif
+            close(input[0]);
+            close(input[1]);
+            free(child);
+            return NULL;
+        }
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, input[0], 0);
+        posix_spawn_file_actions_adddup2(&actions, output[1], 1);
+        posix_spawn_file_actions_addclose(&actions, input[0]);
+        posix_spawn_file_actions_addclose(&actions, output[1]);
+        char *argv[]={"sh", "-c", (char*)command, NULL};
+        int error=posix_spawn(&child->pid, "/bin/sh", &actions, NULL, argv, environ);
+        #ifndef SPAWN_HAVE_PIPE2
+            pthread_mutex_unlock(&spawnLock);
+        #endif
+        posix_spawn_file_actions_destroy(&actions);
+        close(input[0]);
+        close(output[1]);
+        if(error!=0){
+            LOG_ERROR("Could not start the shell for: %s (%s)", command, strerror(error));
+            close(input[1]);
+            close(output[0]);
+            free(child);
+            return NULL;
+        }
+        child->input=input[1];
+        child->output=output[0];
+    #endif
+    return child;
+}
+
+/**
+ * @brief Writes `text` to the command's standard input.
+ *
+ * @details `SIGPIPE` is blocked while writing, so a command that exited
+ *          makes this return `-1` instead of ending devcli.
+ *
+ * @return int `0` on success, `-1` if the command no longer reads it.
+ */
+int spawnPipeWrite(SpawnPipe *child, const char *text){
+    size_t left=strlen(text);
+    #ifdef _WIN32
+        while(left>0){
+            DWORD n=0;
+            if(!WriteFile(child->input, text, (DWORD)left, &n, NULL) || n==0) return -1;
+            text+=n;
+            left-=n;
+        }
+    #else
+        sigset_t pipeSignal, saved, pending;
+        sigemptyset(&pipeSignal);
+        sigaddset(&pipeSignal, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &pipeSignal, &saved);
+        while(left>0){
+            ssize_t n=write(child->input, text, left);
+            if(n<0 && errno==EINTR) continue;
+            if(n<=0) break;
+            text+=n;
+            left-=(size_t)n;
+        }
+        if(left>0 && sigpending(&pending)==0 && sigismember(&pending, SIGPIPE)){
+            int caught;
+            sigwait(&pipeSignal, &caught);
+        }
+        pthread_sigmask(SIG_SETMASK, &saved, NULL);
+    #endif
+    return left==0 ? 0 : -1;
+}
+
+/**
+ * @brief Reads one line of the command's standard output into `line`,
+ *        without its line break; a longer line is cut to `size - 1` bytes.
+ *
+ * @return int `0` on success, `-1` once the command closed its output,
+ *         for instance because it exited.
+ */
+int spawnPipeReadLine(SpawnPipe *child, char *line, size_t size){
+    size_t length=0;
+    for(;;){
+        while(child->start<child->end){
+            char c=child->buffer[child->start++];
+            if(c=='\n'){
+                if(length>0 && line[length-1]=='\r') length--;
+                line[length]='\0';
+                return 0;
+            }
+            if(length+1<size) line[length++]=c;
+        }
+        #ifdef _WIN32
+            DWORD n=0;
+            if(!ReadFile(child->output, child->buffer, sizeof(child->buffer), &n, NULL) || n==0) return -1;
+        #else
+            ssize_t n=read(child->output, child->buffer, sizeof(child->buffer));
+            if(n<0 && errno==EINTR) continue;
+            if(n<=0) return -1;
+        #endif
+        child->start=0;
+        child->end=(size_t)n;
+    }
+}
+
+/**
+ * @brief Closes the command's standard input, waits for it to exit and
+ *        frees it.
+ *
+ * @param peakMemory Receives its peak in MiB like `spawnShell()`; may be `NULL`.
+ *
+ * @return int Its status, as `spawnShell()` returns it.
+ */
+int spawnPipeClose(SpawnPipe *child, uint32_t *peakMemory){
+    uint64_t peakBytes=0;
+    int status=-1;
+    #ifdef _WIN32
+        CloseHandle(child->input);
+        WaitForSingleObject(child->process, INFINITE);
+        CloseHandle(child->output);
+        DWORD code=1;
+        GetExitCodeProcess(child->process, &code);
+        CloseHandle(child->process);
+        status=(int)code;
+        JOBOBJECT_EXTENDED_LIMIT_INFORMATION info;
+        if(child->job && QueryInformationJobObject(child->job, JobObjectExtendedLimitInformation, &info, sizeof(info), NULL)){
+            peakBytes=info.PeakJobMemoryUsed;
+        }
+        if(child->job) CloseHandle(child->job);
+    #else
+        close(child->input);
+        close(child->output);
+        struct rusage usage;
+        memset(&usage, 0, sizeof(usage));
+        while(wait4(child->pid, &status, 0, &usage)<0){
+            if(errno!=EINTR){
+                status=-1;
+                break;
+            }
+        }
+        #ifdef __APPLE__
+            peakBytes=(uint64_t)usage.ru_maxrss;
+        #else
+            peakBytes=(uint64_t)usage.ru_maxrss*1024;
+        #endif
+    #endif
+    free(child);
+    if(peakMemory) *peakMemory=(uint32_t)((peakBytes+(1u<<20)-1)>>20);
+    return status;
+}
+
+/** @} */ // end of spawn group
@@ -0,0 +1,37 @@
+/**
+ * @file spawn.h
+ * @brief Runs a task's command line and reports how much memory it used.
+ */
+
+#ifndef DEVCLI_SPAWN_H
+#define DEVCLI_SPAWN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @defgroup spawn Process Spawning
+ *  @brief `system()` replacement that can pin the command to CPUs and measures its peak memory.
+ *  @{
+ */
+
+/**
+ * @def SPAWN_MAX_CPUS
+ * @brief Highest CPU number plus one that a task can be pinned to.
+ */
+#define SPAWN_MAX_CPUS 1024
+
+/**
+ * @brief A command started with `spawnPiped()`, talked to through its
+ *        standard input and output.
+ */
+typedef struct SpawnPipe SpawnPipe;
+
+int spawnShell(const char *command, const char *cpus, uint32_t *peakMemory);
+SpawnPipe *spawnPiped(const char *command);
+int spawnPipeWrite(SpawnPipe *child, const char *text);
+int spawnPipeReadLine(SpawnPipe *child, char *line, size_t size);
+int spawnPipeClose(SpawnPipe *child, uint32_t *peakMemory);
+
+/** @} */ // end of spawn group
+
+#endif /* DEVCLI_SPAWN_H */
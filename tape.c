@@ -0,0 +1,1110 @@
+/**
+ * @file tape.c
+ * @brief Parser and accessors for the tape DOM described in tape.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+#include "tape.h"
+#include "log.h"
+
+/** @addtogroup tape
+ *  @{
+ */
+
+/**
+ * @def TAPE_NESTING_LIMIT
+ * @brief Maximum container depth, matching cJSON's default limit.
+ */
+#define TAPE_NESTING_LIMIT 1000
+
+/**
+ * @def TAPE_MAX_THREADS
+ * @brief Upper bound on worker threads for a parallel parse.
+ */
+#define TAPE_MAX_THREADS 64
+
+/**
+ * @def TAPE_INTERN_MIN_SLOTS
+ * @brief Initial size of the string intern set; it doubles at half load.
+ */
+#define TAPE_INTERN_MIN_SLOTS 1024u
+
+/**
+ * @brief Cursor over the input text while a tape is being written.
+ *
+ * @details With `index` set, whitespace is never scanned: the cursor jumps
+ *          straight to the next position recorded by the structural index.
+ */
+typedef struct {
+    const char *p;
+    const char *end;
+    JsonTape *doc;
+    const char *base;       /**< Start of the whole input; index positions are relative to it. */
+    const uint32_t *index;  /**< Structural index from stage 1, or `NULL` for byte-at-a-time. */
+    size_t indexPos;
+    size_t indexCount;
+} TapeParser;
+
+static int tapeReserve(JsonTape *doc, size_t words){
+    if(doc->length+words<=doc->capacity) return 0;
+    size_t newCap=doc->capacity ? doc->capacity : 256;
+    while(newCap<doc->length+words) newCap*=2;
+    uint64_t *grown=realloc(doc->tape, newCap*sizeof(uint64_t));
+    if(!grown){
+        LOG_ERROR("Dynamic Memory not assigned to tape.");
+        return -1;
+    }
+    doc->tape=grown;
+    doc->capacity=newCap;
+    return 0;
+}
+
+static int arenaReserve(JsonTape *doc, size_t bytes){
+    if(doc->stringsSize+bytes<=doc->stringsCap) return 0;
+    size_t newCap=doc->stringsCap ? doc->stringsCap : 1024;
+    while(newCap<doc->stringsSize+bytes) newCap*=2;
+    char *grown=realloc(doc->strings, newCap);
+    if(!grown){
+        LOG_ERROR("Dynamic Memory not assigned to string arena.");
+        return -1;
+    }
+    doc->strings=grown;
+    doc->stringsCap=newCap;
+    return 0;
+}
+
+/**
+ * @brief Hashes a string eight bytes at a time (multiply-xorshift).
+ *
+ * @details Byte-wise FNV-1a dominated parse time on large catalogs, where
+ *          every command line is hashed once for interning.
+ */
+static uint32_t hashString(const char *str, size_t len){
+    const uint64_t multiplier=0x9E3779B97F4A7C15ull;
+    uint64_t hash=(uint64_t)len*multiplier;
+    size_t i=0;
+    for(; i+8<=len; i+=8){
+        uint64_t word;
+        memcpy(&word, str+i, sizeof(word));
+        hash=(hash^word)*multiplier;
+        hash^=hash>>29;
+    }
+    if(i<len){
+        uint64_t word=0;
+        memcpy(&word, str+i, len-i);
+        hash=(hash^word)*multiplier;
+        hash^=hash>>29;
+    }
+    hash*=multiplier;
+    return (uint32_t)(hash>>32);
+}
+
+/**
+ * @brief Probes the intern set for `str`.
+ *
+ * @param slot Receives the slot holding the match, or the free slot where
+ *             `str` belongs.
+ *
+ * @return size_t Arena offset of the interned copy, or `TAPE_NONE`.
+ */
+static size_t internProbe(const JsonTape *doc, const char *str, size_t len, uint32_t hash, size_t *slot){
+    size_t mask=doc->internSlots-1;
+    for(size_t i=hash&mask;; i=(i+1)&mask){
+        uint32_t entry=doc->intern[i];
+        if(entry==0){
+            *slot=i;
+            return TAPE_NONE;
+        }
+        uint32_t stored;
+        memcpy(&stored, doc->strings+entry-1, sizeof(stored));
+        if(stored==len && memcmp(doc->strings+entry-1+sizeof(uint32_t), str, len)==0){
+            *slot=i;
+            return entry-1;
+        }
+    }
+}
+
+/**
+ * @brief Doubles the intern set and rehashes the strings already in it.
+ */
+static int internGrow(JsonTape *doc){
+    size_t slots=doc->internSlots ? doc->internSlots*2 : TAPE_INTERN_MIN_SLOTS;
+    uint32_t *grown=calloc(slots, sizeof(uint32_t));
+    if(!grown){
+        LOG_ERROR("Dynamic Memory not assigned to string intern set.");
+        return -1;
+    }
+    for(size_t i=0; i<doc->internSlots; i++){
+        uint32_t entry=doc->intern[i];
+        if(entry==0) continue;
+        uint32_t len;
+        memcpy(&len, doc->strings+entry-1, sizeof(len));
+        size_t j=hashString(doc->strings+entry-1+sizeof(uint32_t), len)&(slots-1);
+        while(grown[j]!=0) j=(j+1)&(slots-1);
+        grown[j]=entry;
+    }
+    free(doc->intern);
+    doc->intern=grown;
+    doc->internSlots=slots;
+    return 0;
+}
+
+/**
+ * @brief Commits the string just written at the end of the arena, or drops it
+ *        in favour of an identical string already interned.
+ *
+ * @details The caller has written the length, bytes and NUL at `stringsSize`
+ *          without advancing it. Strings past the 4 GiB mark are kept as they
+ *          are, since the set stores 32-bit offsets.
+ *
+ * @return size_t Arena offset to store in the tape, or `TAPE_NONE` on
+ *         allocation failure.
+ */
+static size_t internCommit(JsonTape *doc){
+    size_t offset=doc->stringsSize;
+    uint32_t len;
+    memcpy(&len, doc->strings+offset, sizeof(len));
+    size_t entryBytes=sizeof(uint32_t)+len+1;
+    if(offset>=0xFFFFFFFFu){
+        doc->stringsSize+=entryBytes;
+        return offset;
+    }
+    if((doc->internCount+1)*2>doc->internSlots && internGrow(doc)!=0) return TAPE_NONE;
+    const char *str=doc->strings+offset+sizeof(uint32_t);
+    size_t slot;
+    size_t existing=internProbe(doc, str, len, hashString(str, len), &slot);
+    if(existing!=TAPE_NONE){
+        doc->internHits++;
+        doc->internSaved+=entryBytes;
+        return existing;
+    }
+    doc->intern[slot]=(uint32_t)offset+1;
+    doc->internCount++;
+    doc->stringsSize+=entryBytes;
+    return offset;
+}
+
+static int emit(JsonTape *doc, char type, uint64_t payload){
+    if(tapeReserve(doc, 1)!=0) return -1;
+    doc->tape[doc->length++]=((uint64_t)(unsigned char)type<<56)|(payload&0x00FFFFFFFFFFFFFFull);
+    return 0;
+}
+
+static void skipWhitespace(TapeParser *parser){
+    if(parser->index){
+        size_t offset=(size_t)(parser->p-parser->base);
+        while(parser->indexPos<parser->indexCount && parser->index[parser->indexPos]<offset) parser->indexPos++;
+        parser->p=parser->indexPos<parser->indexCount ? parser->base+parser->index[parser->indexPos] : parser->end;
+        return;
+    }
+    while(parser->p<parser->end && (*parser->p==' ' || *parser->p=='\t' || *parser->p=='\n' || *parser->p=='\r')) parser->p++;
+}
+
+static int hexValue(char c){
+    if(c>='0' && c<='9') return c-'0';
+    if(c>='a' && c<='f') return c-'a'+10;
+    if(c>='A' && c<='F') return c-'A'+10;
+    return -1;
+}
+
+static int parseHex4(const char *p, unsigned *out){
+    unsigned value=0;
+    for(int i=0; i<4; i++){
+        int digit=hexValue(p[i]);
+        if(digit<0) return -1;
+        value=(value<<4)|(unsigned)digit;
+    }
+    *out=value;
+    return 0;
+}
+
+/**
+ * @brief Returns the first quote, backslash or control character in `[p, end)`,
+ *        or `end` if there is none.
+ */
+static const char *findSpecial(const char *p, const char *end){
+    #if defined(__SSE2__) || defined(_M_X64)
+        const __m128i quote=_mm_set1_epi8('"');
+        const __m128i backslash=_mm_set1_epi8('\\');
+        const __m128i control=_mm_set1_epi8(0x1F);
+        while(end-p>=16){
+            __m128i chunk=_mm_loadu_si128((const __m128i*)p);
+            __m128i hits=_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+            hits=_mm_or_si128(hits, _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk));
+            int mask=_mm_movemask_epi8(hits);
+            if(mask) return p+__builtin_ctz((unsigned)mask);
+            p+=16;
+        }
+    #endif
+    while(p<end && *p!='"' && *p!='\\' && (unsigned char)*p>=0x20) p++;
+    return p;
+}
+
+/**
+ * @brief Decodes the string starting at the opening quote into the arena.
+ *
+ * @details Strings without escapes (almost all of `tasks.json`) are found
+ *          with `findSpecial()` and copied in one go. Otherwise the raw length
+ *          bounds the decoded length (escapes only shrink), so the arena is
+ *          reserved once before decoding.
+ *
+ * @return int `0` on success, `-1` on malformed input or allocation failure.
+ */
+static int parseString(TapeParser *parser){
+    JsonTape *doc=parser->doc;
+    const char *p=parser->p+1;
+    const char *special=findSpecial(p, parser->end);
+    if(special<parser->end && *special=='"'){
+        size_t length=(size_t)(special-p);
+        if(arenaReserve(doc, sizeof(uint32_t)+length+1)!=0) return -1;
+        size_t offset=doc->stringsSize;
+        uint32_t stored=(uint32_t)length;
+        memcpy(doc->strings+offset, &stored, sizeof(stored));
+        memcpy(doc->strings+offset+sizeof(uint32_t), p, length);
+        doc->strings[offset+sizeof(uint32_t)+length]='\0';
+        offset=internCommit(doc);
+        if(offset==TAPE_NONE) return -1;
+        parser->p=special+1;
+        return emit(doc, '"', offset);
+    }
+    const char *close=p;
+    while(close<parser->end && *close!='"'){
+        if(*close=='\\') close++;
+        close++;
+    }
+    if(close>=parser->end) return -1;
+    size_t raw=(size_t)(close-p);
+    if(arenaReserve(doc, sizeof(uint32_t)+raw+1)!=0) return -1;
+    size_t offset=doc->stringsSize;
+    char *out=doc->strings+offset+sizeof(uint32_t);
+    char *w=out;
+    while(p<close){
+        unsigned char c=(unsigned char)*p;
+        if(c<0x20) return -1;
+        if(c!='\\'){
+            *w++=(char)c;
+            p++;
+            continue;
+        }
+        p++;
+        switch(*p){
+            case '"': *w++='"'; break;
+            case '\\': *w++='\\'; break;
+            case '/': *w++='/'; break;
+            case 'b': *w++='\b'; break;
+            case 'f': *w++='\f'; break;
+            case 'n': *w++='\n'; break;
+            case 'r': *w++='\r'; break;
+            case 't': *w++='\t'; break;
+            case 'u': {
+                unsigned code;
+                if(close-p<5 || parseHex4(p+1, &code)!=0) return -1;
+                p+=4;
+                if(code>=0xDC00 && code<=0xDFFF) return -1;
+                if(code>=0xD800 && code<=0xDBFF){
+                    unsigned low;
+                    if(close-p<7 || p[1]!='\\' || p[2]!='u' || parseHex4(p+3, &low)!=0) return -1;
+                    if(low<0xDC00 || low>0xDFFF) return -1;
+                    code=0x10000+(((code&0x3FF)<<10)|(low&0x3FF));
+                    p+=6;
+                }
+                if(code<0x80){
+                    *w++=(char)code;
+                }
+                else if(code<0x800){
+                    *w++=(char)(0xC0|(code>>6));
+                    *w++=(char)(0x80|(code&0x3F));
+                }
+                else if(code<0x10000){
+                    *w++=(char)(0xE0|(code>>12));
+                    *w++=(char)(0x80|((code>>6)&0x3F));
+                    *w++=(char)(0x80|(code&0x3F));
+                }
+                else{
+                    *w++=(char)(0xF0|(code>>18));
+                    *w++=(char)(0x80|((code>>12)&0x3F));
+                    *w++=(char)(0x80|((code>>6)&0x3F));
+                    *w++=(char)(0x80|(code&0x3F));
+                }
+                break;
+            }
+            default:
+                return -1;
+        }
+        p++;
+    }
+    *w='\0';
+    uint32_t length=(uint32_t)(w-out);
+    memcpy(doc->strings+offset, &length, sizeof(length));
+    offset=internCommit(doc);
+    if(offset==TAPE_NONE) return -1;
+    parser->p=close+1;
+    return emit(doc, '"', offset);
+}
+
+/**
+ * @brief Checks that an atom ends at the cursor (whitespace, structural or end).
+ *
+ * @details The structural index only records where atoms start, so trailing
+ *          garbage such as `truex` has to be caught here.
+ */
+static int atAtomBoundary(const TapeParser *parser){
+    if(parser->p>=parser->end) return 1;
+    return strchr(" \t\r\n,:]}", *parser->p)!=NULL && *parser->p!='\0';
+}
+
+static int parseNumber(TapeParser *parser){
+    char number[64];
+    size_t n=0;
+    while(parser->p+n<parser->end && n<sizeof(number)-1){
+        char c=parser->p[n];
+        if(!((c>='0' && c<='9') || c=='-' || c=='+' || c=='.' || c=='e' || c=='E')) break;
+        number[n++]=c;
+    }
+    number[n]='\0';
+    char *after=NULL;
+    double value=strtod(number, &after);
+    if(n==0 || after!=number+n) return -1;
+    parser->p+=n;
+    if(!atAtomBoundary(parser)) return -1;
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if(emit(parser->doc, 'd', 0)!=0 || tapeReserve(parser->doc, 1)!=0) return -1;
+    parser->doc->tape[parser->doc->length++]=bits;
+    return 0;
+}
+
+static int parseLiteral(TapeParser *parser, const char *word, char type){
+    size_t n=strlen(word);
+    if((size_t)(parser->end-parser->p)<n || strncmp(parser->p, word, n)!=0) return -1;
+    parser->p+=n;
+    if(!atAtomBoundary(parser)) return -1;
+    return emit(parser->doc, type, 0);
+}
+
+/**
+ * @brief Returns the unused tail of the tape and the arena to the allocator.
+ */
+static void shrinkToFit(JsonTape *doc){
+    uint64_t *tape=realloc(doc->tape, (doc->length ? doc->length : 1)*sizeof(uint64_t));
+    if(tape){
+        doc->tape=tape;
+        doc->capacity=doc->length;
+    }
+    char *strings=realloc(doc->strings, doc->stringsSize ? doc->stringsSize : 1);
+    if(strings){
+        doc->strings=strings;
+        doc->stringsCap=doc->stringsSize;
+    }
+}
+
+/**
+ * @brief Writes the scalar at the cursor, or opens a container.
+ *
+ * @return int `1` if a container was opened, `0` for a scalar, `-1` on error.
+ */
+static int parseValue(TapeParser *parser){
+    if(parser->p>=parser->end) return -1;
+    switch(*parser->p){
+        case '{':
+        case '[':
+            if(emit(parser->doc, *parser->p, 0)!=0) return -1;
+            parser->p++;
+            return 1;
+        case '"':
+            return parseString(parser);
+        case 't':
+            return parseLiteral(parser, "true", 't');
+        case 'f':
+            return parseLiteral(parser, "false", 'f');
+        case 'n':
+            return parseLiteral(parser, "null", 'n');
+        default:
+            if(*parser->p!='-' && (*parser->p<'0' || *parser->p>'9')) return -1;
+            return parseNumber(parser);
+    }
+}
+
+/**
+ * @brief Runs the tape-writing state machine from the cursor to `parser->end`.
+ *
+ * @details Containers are tracked on an explicit stack instead of recursion,
+ *          and each closing word back-patches its opening word with the end
+ *          index and element count. Only whitespace may follow the root value.
+ *          The same code serves byte-at-a-time and indexed parsing; only
+ *          `skipWhitespace()` differs.
+ *
+ * @return int `0` on success, `-1` on error with the cursor at the failure.
+ */
+static int parseDocument(TapeParser *parser){
+    JsonTape *out=parser->doc;
+    size_t *stack=malloc(TAPE_NESTING_LIMIT*sizeof(size_t));
+    uint32_t *counts=malloc(TAPE_NESTING_LIMIT*sizeof(uint32_t));
+    int depth=0;
+    if(!stack || !counts){
+        LOG_ERROR("Dynamic Memory not assigned to parser stack.");
+        goto fail;
+    }
+    skipWhitespace(parser);
+    for(;;){
+        int opened=parseValue(parser);
+        if(opened<0) goto fail;
+        if(opened==1){
+            if(depth==TAPE_NESTING_LIMIT) goto fail;
+            stack[depth]=out->length-1;
+            counts[depth++]=0;
+            skipWhitespace(parser);
+            char close=tapeType(out, out->length-1)=='{' ? '}' : ']';
+            if(parser->p<parser->end && *parser->p==close){
+                parser->p++;
+            }
+            else{
+                counts[depth-1]++;
+                if(close=='}'){
+                    if(parser->p>=parser->end || *parser->p!='"' || parseString(parser)!=0) goto fail;
+                    skipWhitespace(parser);
+                    if(parser->p>=parser->end || *parser->p!=':') goto fail;
+                    parser->p++;
+                    skipWhitespace(parser);
+                }
+                continue;
+            }
+            depth--;
+            if(emit(out, close, stack[depth])!=0) goto fail;
+            out->tape[stack[depth]]|=(uint64_t)out->length;
+        }
+        for(;;){
+            if(depth==0) goto done;
+            skipWhitespace(parser);
+            if(parser->p>=parser->end) goto fail;
+            char close=tapeType(out, stack[depth-1])=='{' ? '}' : ']';
+            if(*parser->p==','){
+                parser->p++;
+                skipWhitespace(parser);
+                counts[depth-1]++;
+                if(close=='}'){
+                    if(parser->p>=parser->end || *parser->p!='"' || parseString(parser)!=0) goto fail;
+                    skipWhitespace(parser);
+                    if(parser->p>=parser->end || *parser->p!=':') goto fail;
+                    parser->p++;
+                    skipWhitespace(parser);
+                }
+                break;
+            }
+            if(*parser->p!=close) goto fail;
+            parser->p++;
+            depth--;
+            if(emit(out, close, stack[depth])!=0) goto fail;
+            uint64_t count=counts[depth]>0x00FFFFFFu ? 0x00FFFFFFu : counts[depth];
+            out->tape[stack[depth]]|=(count<<32)|(uint64_t)out->length;
+        }
+    }
+done:
+    skipWhitespace(parser);
+    if(parser->p!=parser->end && *parser->p!='\0') goto fail;
+    free(stack);
+    free(counts);
+    return 0;
+fail:
+    free(stack);
+    free(counts);
+    return -1;
+}
+
+
+/**
+ * @brief Turns a failed parse into an empty document carrying the error offset.
+ */
+static int parseFailed(TapeParser *parser, JsonTape *out){
+    size_t errorOffset=(size_t)(parser->p-parser->base);
+    tapeFree(out);
+    out->errorOffset=errorOffset;
+    return -1;
+}
+
+/**
+ * @brief Parses a JSON document into a tape, one byte at a time.
+ *
+ * @details See `parseDocument()` for the algorithm. For large inputs
+ *          `tapeParseIndexed()` produces the same tape faster.
+ *
+ * @ingroup tape
+ *
+ * @param json JSON text (need not be null-terminated).
+ * @param len Length of `json` in bytes.
+ * @param out Receives the document. On failure it is left empty except for
+ *            `errorOffset`.
+ *
+ * @return int `0` on success, `-1` on a syntax error or allocation failure.
+ *
+ * Example usage:
+ * @code
+ * JsonTape doc;
+ * if(tapeParse(buffer, strlen(buffer), &doc)==0){
+ *     size_t build=tapeObjectGet(&doc, 0, "build");
+ *     tapeFree(&doc);
+ * }
+ * @endcode
+ */
+int tapeParse(const char *json, size_t len, JsonTape *out){
+    memset(out, 0, sizeof(*out));
+    TapeParser parser={json, json+len, out, json, NULL, 0, 0};
+    if(len>=3 && strncmp(json, "\xEF\xBB\xBF", 3)==0) parser.p+=3;
+    if(parseDocument(&parser)!=0) return parseFailed(&parser, out);
+    shrinkToFit(out);
+    return 0;
+}
+
+/**
+ * @brief Bitmasks of one 64-byte block: bit `i` describes byte `i`.
+ */
+typedef struct {
+    uint64_t backslash;
+    uint64_t quote;
+    uint64_t structural;  /**< `{`, `}`, `[`, `]`, `:` and `,`. */
+    uint64_t whitespace;
+} BlockMasks;
+
+#if defined(__SSE2__) || defined(_M_X64)
+/**
+ * @brief Classifies 64 bytes with SSE2 compares, 16 bytes at a time.
+ *
+ * @details Compares of one class are OR-ed before a single movemask per
+ *          16-byte chunk. `[` and `]` are `{` and `}` with bit 0x20 cleared,
+ *          so brackets and braces share two compares.
+ */
+static BlockMasks classifyBlock(const char *block){
+    const __m128i caseBit=_mm_set1_epi8(0x20);
+    const __m128i openBrace=_mm_set1_epi8('{'), closeBrace=_mm_set1_epi8('}');
+    const __m128i colon=_mm_set1_epi8(':'), comma=_mm_set1_epi8(',');
+    const __m128i space=_mm_set1_epi8(' '), tab=_mm_set1_epi8('\t');
+    const __m128i newline=_mm_set1_epi8('\n'), carriage=_mm_set1_epi8('\r');
+    const __m128i quote=_mm_set1_epi8('"'), backslash=_mm_set1_epi8('\\');
+    BlockMasks masks={0, 0, 0, 0};
+    for(int i=0; i<4; i++){
+        __m128i chunk=_mm_loadu_si128((const __m128i*)(block+16*i));
+        __m128i folded=_mm_or_si128(chunk, caseBit);
+        __m128i structural=_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, openBrace), _mm_cmpeq_epi8(folded, closeBrace)),
+                                        _mm_or_si128(_mm_cmpeq_epi8(chunk, colon), _mm_cmpeq_epi8(chunk, comma)));
+        __m128i whitespace=_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+                                        _mm_or_si128(_mm_cmpeq_epi8(chunk, newline), _mm_cmpeq_epi8(chunk, carriage)));
+        int shift=16*i;
+        masks.structural|=(uint64_t)(uint32_t)_mm_movemask_epi8(structural)<<shift;
+        masks.whitespace|=(uint64_t)(uint32_t)_mm_movemask_epi8(whitespace)<<shift;
+        masks.quote|=(uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote))<<shift;
+        masks.backslash|=(uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, backslash))<<shift;
+    }
+    return masks;
+}
+#else
+/**
+ * @brief Portable fallback for targets without SSE2.
+ */
+static BlockMasks classifyBlock(const char *block){
+    BlockMasks masks={0, 0, 0, 0};
+    for(int i=0; i<64; i++){
+        uint64_t bit=1ull<<i;
+        switch(block[i]){
+            case '\\': masks.backslash|=bit; break;
+            case '"': masks.quote|=bit; break;
+            case '{': case '}': case '[': case ']': case ':': case ',': masks.structural|=bit; break;
+            case ' ': case '\t': case '\n': case '\r': masks.whitespace|=bit; break;
+            default: break;
+        }
+    }
+    return masks;
+}
+#endif
+
+/**
+ * @brief Returns the bytes escaped by an odd-length run of backslashes.
+ *
+ * @details Branch-free carry trick from simdjson: runs of backslashes that
+ *          start on an odd bit overflow into the byte after the run exactly
+ *          when the run has odd length. `carry` links runs across blocks.
+ */
+static uint64_t escapedMask(uint64_t backslash, uint64_t *carry){
+    const uint64_t evenBits=0x5555555555555555ull;
+    backslash&=~*carry;
+    uint64_t followsEscape=(backslash<<1)|*carry;
+    uint64_t oddStarts=backslash&~evenBits&~followsEscape;
+    uint64_t sequencesOnEven=oddStarts+backslash;
+    *carry=sequencesOnEven<oddStarts;
+    uint64_t invert=sequencesOnEven<<1;
+    return (evenBits^invert)&followsEscape;
+}
+
+/**
+ * @brief Prefix XOR: bit `i` of the result is the parity of bits `0..i`.
+ */
+static uint64_t prefixXor(uint64_t bits){
+    bits^=bits<<1;
+    bits^=bits<<2;
+    bits^=bits<<4;
+    bits^=bits<<8;
+    bits^=bits<<16;
+    bits^=bits<<32;
+    return bits;
+}
+
+/**
+ * @brief Stage 1: records the offset of every token start in `json`.
+ *
+ * @details Works on 64-byte blocks. Classification is vectorised; quotes
+ *          escaped by backslashes are removed, string interiors are found
+ *          with a prefix XOR over the remaining quotes, and the positions
+ *          kept are structural characters outside strings, opening quotes
+ *          and the first byte of every number or literal.
+ *
+ * @param json Input text.
+ * @param len Length of `json`; must be below 4 GiB.
+ * @param count Receives the number of positions.
+ *
+ * @return uint32_t* Heap array of positions, or `NULL` on allocation failure.
+ */
+static uint32_t *structuralIndex(const char *json, size_t len, size_t *count){
+    uint32_t *index=malloc((len+1)*sizeof(uint32_t));
+    if(!index){
+        LOG_ERROR("Dynamic Memory not assigned to structural index.");
+        return NULL;
+    }
+    uint64_t escapeCarry=0, inStringCarry=0, atomCarry=0;
+    size_t n=0;
+    char tail[64];
+    for(size_t base=0; base<len; base+=64){
+        const char *block=json+base;
+        if(len-base<64){
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, block, len-base);
+            block=tail;
+        }
+        BlockMasks masks=classifyBlock(block);
+        uint64_t quotes=masks.quote&~escapedMask(masks.backslash, &escapeCarry);
+        uint64_t inString=prefixXor(quotes)^inStringCarry;
+        inStringCarry=(uint64_t)((int64_t)inString>>63);
+        uint64_t outside=~inString;
+        uint64_t atoms=~(masks.structural|masks.whitespace|masks.quote)&outside&~(quotes&~inString);
+        uint64_t atomStarts=atoms&~((atoms<<1)|atomCarry);
+        atomCarry=atoms>>63;
+        uint64_t bits=(masks.structural&outside)|(quotes&inString)|atomStarts;
+        while(bits){
+            index[n++]=(uint32_t)(base+(size_t)__builtin_ctzll(bits));
+            bits&=bits-1;
+        }
+    }
+    *count=n;
+    return index;
+}
+
+/**
+ * @brief Parses `json` with a precomputed structural index on one thread.
+ */
+static int parseWithIndex(const char *json, size_t len, const uint32_t *index, size_t count, JsonTape *out){
+    memset(out, 0, sizeof(*out));
+    TapeParser parser={json, json+len, out, json, index, 0, count};
+    if(len>=3 && strncmp(json, "\xEF\xBB\xBF", 3)==0) parser.p+=3;
+    skipWhitespace(&parser);
+    if(parseDocument(&parser)!=0) return parseFailed(&parser, out);
+    shrinkToFit(out);
+    return 0;
+}
+
+/**
+ * @brief One top-level member found from the structural index.
+ */
+typedef struct {
+    size_t keyIndex;    /**< Index position of the key's opening quote. */
+    size_t firstIndex;  /**< Index position where the value starts. */
+    size_t lastIndex;   /**< Index position of the `,` or `}` after the value. */
+    JsonTape doc;       /**< Tape of the value, filled by a worker. */
+    int status;
+} TopLevelMember;
+
+/**
+ * @brief Work shared by the threads of a parallel parse.
+ */
+typedef struct {
+    const char *json;
+    const uint32_t *index;
+    TopLevelMember *members;
+    size_t memberCount;
+    atomic_size_t next;
+} ParallelParse;
+
+#ifdef _WIN32
+static DWORD WINAPI parseWorker(LPVOID arg)
+#else
+static void *parseWorker(void *arg)
+#endif
+{
+    ParallelParse *work=arg;
+    for(;;){
+        size_t i=atomic_fetch_add(&work->next, 1);
+        if(i>=work->memberCount) break;
+        TopLevelMember *member=&work->members[i];
+        memset(&member->doc, 0, sizeof(member->doc));
+        TapeParser parser={work->json+work->index[member->firstIndex], work->json+work->index[member->lastIndex],
+                           &member->doc, work->json, work->index, member->firstIndex, member->lastIndex};
+        member->status=parseDocument(&parser);
+        if(member->status!=0) tapeFree(&member->doc);
+    }
+    return 0;
+}
+
+/**
+ * @brief Splits the root object into members using only the index.
+ *
+ * @return size_t Number of members, or `TAPE_NONE` if the root is not a
+ *         well-formed object at the structural level.
+ */
+static size_t findTopLevelMembers(const char *json, const uint32_t *index, size_t count, TopLevelMember *members){
+    if(count<2 || json[index[0]]!='{') return TAPE_NONE;
+    size_t memberCount=0;
+    size_t depth=0;
+    size_t pos=1;
+    if(json[index[pos]]=='}') return pos==count-1 ? 0 : TAPE_NONE;
+    while(pos+2<count){
+        if(json[index[pos]]!='"' || json[index[pos+1]]!=':') return TAPE_NONE;
+        TopLevelMember *member=&members[memberCount];
+        member->keyIndex=pos;
+        member->firstIndex=pos+2;
+        for(pos=pos+2; pos<count; pos++){
+            char c=json[index[pos]];
+            if(c=='{' || c=='[') depth++;
+            else if((c=='}' || c==']') && depth>0) depth--;
+            else if(depth==0 && (c==',' || c=='}')) break;
+        }
+        if(pos>=count) return TAPE_NONE;
+        member->lastIndex=pos;
+        memberCount++;
+        if(json[index[pos]]=='}') return pos==count-1 ? memberCount : TAPE_NONE;
+        pos++;
+    }
+    return TAPE_NONE;
+}
+
+/**
+ * @brief Interns every string of `member`'s arena into `out`.
+ *
+ * @details A member arena holds each of its strings once, back to back. After
+ *          a string is interned into `out`, its length field in the member
+ *          arena is overwritten with the new offset, which is what
+ *          `appendRelocated()` reads; the member document is discarded right
+ *          after stitching, so nothing else sees the rewritten field.
+ *
+ * @return int `0` on success, `-1` on allocation failure.
+ */
+static int internMemberStrings(JsonTape *out, JsonTape *member){
+    size_t offset=0;
+    while(offset<member->stringsSize){
+        uint32_t len;
+        memcpy(&len, member->strings+offset, sizeof(len));
+        size_t entryBytes=sizeof(uint32_t)+len+1;
+        if(arenaReserve(out, entryBytes)!=0) return -1;
+        memcpy(out->strings+out->stringsSize, member->strings+offset, entryBytes);
+        size_t relocated=internCommit(out);
+        if(relocated==TAPE_NONE || relocated>0xFFFFFFFFu) return -1;
+        uint32_t stored=(uint32_t)relocated;
+        memcpy(member->strings+offset, &stored, sizeof(stored));
+        offset+=entryBytes;
+    }
+    return 0;
+}
+
+/**
+ * @brief Appends `member`'s tape to `out`, shifting its indexes and mapping
+ *        its string offsets through `internMemberStrings()`.
+ */
+static void appendRelocated(JsonTape *out, const JsonTape *member){
+    size_t base=out->length;
+    for(size_t i=0; i<member->length; i++){
+        uint64_t word=member->tape[i];
+        char type=(char)(word>>56);
+        if(type=='{' || type=='['){
+            uint64_t end=(word&0xFFFFFFFFu)+base;
+            word=(word&~(uint64_t)0xFFFFFFFFu)|end;
+        }
+        else if(type=='}' || type==']'){
+            word+=base;
+        }
+        else if(type=='"'){
+            uint32_t relocated;
+            memcpy(&relocated, member->strings+(word&0x00FFFFFFFFFFFFFFull), sizeof(relocated));
+            word=((uint64_t)(unsigned char)'"'<<56)|relocated;
+        }
+        out->tape[out->length++]=word;
+        if(type=='d'){
+            out->tape[out->length++]=member->tape[++i];
+        }
+    }
+}
+
+/**
+ * @brief Parses every top-level member on its own thread and stitches the tapes.
+ *
+ * @details The calling thread works alongside `threads - 1` helpers; members
+ *          are handed out through an atomic counter so large categories do not
+ *          hold up the rest.
+ *
+ * @return int `0` on success, `1` if the input should be parsed sequentially
+ *         instead (for example to report an accurate error), `-1` on
+ *         allocation failure.
+ */
+static int parseParallel(const char *json, const uint32_t *index, size_t count, int threads, JsonTape *out){
+    TopLevelMember *members=calloc(count/2+1, sizeof(TopLevelMember));
+    if(!members) return -1;
+    size_t memberCount=findTopLevelMembers(json, index, count, members);
+    if(memberCount==TAPE_NONE || memberCount<2){
+        free(members);
+        return 1;
+    }
+    ParallelParse work;
+    work.json=json;
+    work.index=index;
+    work.members=members;
+    work.memberCount=memberCount;
+    atomic_init(&work.next, 0);
+    if((size_t)threads>memberCount) threads=(int)memberCount;
+    threads--;
+    #ifdef _WIN32
+        HANDLE handles[TAPE_MAX_THREADS];
+        for(int t=0; t<threads; t++) handles[t]=CreateThread(NULL, 0, parseWorker, &work, 0, NULL);
+        parseWorker(&work);
+        for(int t=0; t<threads; t++){
+            if(handles[t]){
+                WaitForSingleObject(handles[t], INFINITE);
+                CloseHandle(handles[t]);
+            }
+        }
+    #else
+        pthread_t handles[TAPE_MAX_THREADS];
+        int started[TAPE_MAX_THREADS];
+        for(int t=0; t<threads; t++) started[t]=pthread_create(&handles[t], NULL, parseWorker, &work)==0;
+        parseWorker(&work);
+        for(int t=0; t<threads; t++){
+            if(started[t]) pthread_join(handles[t], NULL);
+        }
+    #endif
+    int status=0;
+    size_t words=2;
+    for(size_t i=0; i<memberCount; i++){
+        if(members[i].status!=0) status=1;
+        words+=1+members[i].doc.length;
+    }
+    memset(out, 0, sizeof(*out));
+    if(status==0 && tapeReserve(out, words)!=0) status=-1;
+    if(status==0){
+        emit(out, '{', 0);
+        for(size_t i=0; i<memberCount && status==0; i++){
+            TapeParser keyParser={json+index[members[i].keyIndex], json+index[members[i].firstIndex], out, json, NULL, 0, 0};
+            if(parseString(&keyParser)!=0){
+                status=1;
+                break;
+            }
+            if(internMemberStrings(out, &members[i].doc)!=0){
+                status=-1;
+                break;
+            }
+            out->internHits+=members[i].doc.internHits;
+            out->internSaved+=members[i].doc.internSaved;
+            appendRelocated(out, &members[i].doc);
+        }
+        if(status==0){
+            emit(out, '}', 0);
+            uint64_t countBits=memberCount>0x00FFFFFFu ? 0x00FFFFFFu : memberCount;
+            out->tape[0]|=(countBits<<32)|(uint64_t)out->length;
+            shrinkToFit(out);
+        }
+        else{
+            tapeFree(out);
+        }
+    }
+    for(size_t i=0; i<memberCount; i++) tapeFree(&members[i].doc);
+    free(members);
+    return status;
+}
+
+/**
+ * @brief Returns the number of online processors, at least 1.
+ */
+int tapeHardwareThreads(void){
+    #ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        int n=(int)info.dwNumberOfProcessors;
+    #else
+        int n=(int)sysconf(_SC_NPROCESSORS_ONLN);
+    #endif
+    return n>0 ? n : 1;
+}
+
+/**
+ * @brief Two-stage parse for large documents.
+ *
+ * @details Stage 1 (`structuralIndex()`) finds every token start with SIMD
+ *          compares and bit tricks, without branching per byte. Stage 2 runs
+ *          the ordinary tape state machine but jumps from token to token
+ *          through the index instead of scanning whitespace.
+ *
+ *          When `threads` is above 1 and the input is at least
+ *          `TAPE_PARALLEL_MIN_BYTES`, the index is also used to find the
+ *          extent of each top-level member (a category in `tasks.json`).
+ *          Members are then parsed concurrently into separate tapes and
+ *          stitched together in order. If any member fails, the whole input
+ *          is re-parsed sequentially so the reported error offset is exact.
+ *
+ *          The resulting document is equivalent to the one from `tapeParse()`.
+ *
+ * @ingroup tape
+ *
+ * @param json JSON text (need not be null-terminated, must be below 4 GiB).
+ * @param len Length of `json` in bytes.
+ * @param out Receives the document; see `tapeParse()`.
+ * @param threads Maximum number of threads; `0` uses every online processor.
+ *
+ * @return int `0` on success, `-1` on a syntax error or allocation failure.
+ */
+int tapeParseIndexed(const char *json, size_t len, JsonTape *out, int threads){
+    memset(out, 0, sizeof(*out));
+    if(len>=0xFFFFFFFFu){
+        LOG_ERROR("Indexed parsing supports inputs below 4 GiB.");
+        return -1;
+    }
+    size_t count;
+    uint32_t *index=structuralIndex(json, len, &count);
+    if(!index) return -1;
+    if(threads<=0) threads=tapeHardwareThreads();
+    if(threads>TAPE_MAX_THREADS) threads=TAPE_MAX_THREADS;
+    int status=1;
+    if(threads>1 && len>=TAPE_PARALLEL_MIN_BYTES){
+        status=parseParallel(json, index, count, threads, out);
+    }
+    if(status!=0) status=parseWithIndex(json, len, index, count, out);
+    free(index);
+    return status;
+}
+
+/**
+ * @brief Releases the tape and arena of a document.
+ */
+void tapeFree(JsonTape *doc){
+    if(!doc) return;
+    free(doc->tape);
+    free(doc->strings);
+    free(doc->intern);
+    memset(doc, 0, sizeof(*doc));
+}
+
+/**
+ * @brief Returns the heap bytes held by a document (tape, arena and intern set).
+ */
+size_t tapeMemoryUsage(const JsonTape *doc){
+    return doc->capacity*sizeof(uint64_t)+doc->stringsCap+doc->internSlots*sizeof(uint32_t);
+}
+
+/**
+ * @brief Returns the number stored at `i` (a `d` word).
+ */
+double tapeNumber(const JsonTape *doc, size_t i){
+    double value;
+    memcpy(&value, &doc->tape[i+1], sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Returns the tape index of element `n` of the array at `array`.
+ *
+ * @details Arrays whose elements are all one word wide (strings, `true`,
+ *          `false` and `null`, as in every `dependsOn` list) are detected from
+ *          the stored count and end index, and indexed in O(1).
+ *          Other arrays are walked with `tapeSkip()`, which still steps over
+ *          nested containers in O(1) each.
+ *
+ * @return size_t Tape index of the element, or `TAPE_NONE` if `array` is not
+ *         an array or `n` is out of range.
+ */
+size_t tapeArrayAt(const JsonTape *doc, size_t array, size_t n){
+    if(array==TAPE_NONE || tapeType(doc, array)!='[') return TAPE_NONE;
+    size_t count=tapeCount(doc, array);
+    size_t end=tapeEnd(doc, array);
+    if(count<0x00FFFFFFu){
+        if(n>=count) return TAPE_NONE;
+        if(end-array-1==count) return array+1+n;
+    }
+    size_t item=array+1;
+    while(n-->0 && item<end) item=tapeSkip(doc, item);
+    return item<end ? item : TAPE_NONE;
+}
+
+/**
+ * @brief Returns the arena offset of the interned string `str`, or `TAPE_NONE`
+ *        if no key or value in the document spells it.
+ *
+ * @details Resolve a key once with this function, then match members with
+ *          `tapeObjectGetInterned()`, which compares offsets instead of bytes.
+ */
+size_t tapeFindString(const JsonTape *doc, const char *str, size_t len){
+    if(doc->internSlots==0) return TAPE_NONE;
+    size_t slot;
+    return internProbe(doc, str, len, hashString(str, len), &slot);
+}
+
+/**
+ * @brief Finds the value of the member whose key is the interned string at
+ *        `keyOffset` (from `tapeFindString()`).
+ *
+ * @return size_t Tape index of the value, or `TAPE_NONE`.
+ */
+size_t tapeObjectGetInterned(const JsonTape *doc, size_t object, size_t keyOffset){
+    if(object==TAPE_NONE || keyOffset==TAPE_NONE || tapeType(doc, object)!='{') return TAPE_NONE;
+    TAPE_FOR_EACH_MEMBER(doc, object, member){
+        if(tapePayload(doc, member)==keyOffset) return member+1;
+    }
+    return TAPE_NONE;
+}
+
+/**
+ * @brief Finds the value of member `key` in the object at `object`.
+ *
+ * @details Keys are compared case-sensitively. The key is looked up in the
+ *          intern set first, so members are matched by offset and a key that
+ *          appears nowhere in the document is rejected without a scan. Arenas
+ *          of 4 GiB or more, which are only partly interned, fall back to
+ *          comparing bytes.
+ *
+ * @return size_t Tape index of the value, or `TAPE_NONE`.
+ */
+size_t tapeObjectGet(const JsonTape *doc, size_t object, const char *key){
+    size_t keyLen=strlen(key);
+    if(doc->stringsSize<0xFFFFFFFFu) return tapeObjectGetInterned(doc, object, tapeFindString(doc, key, keyLen));
+    if(object==TAPE_NONE || tapeType(doc, object)!='{') return TAPE_NONE;
+    TAPE_FOR_EACH_MEMBER(doc, object, member){
+        size_t len;
+        const char *name=tapeString(doc, member, &len);
+        if(len==keyLen && memcmp(name, key, len)==0) return member+1;
+    }
+    return TAPE_NONE;
+}
+
+/**
+ * @brief Returns the string value of member `key`, or `NULL` if it is absent
+ *        or not a string.
+ */
+const char *tapeObjectString(const JsonTape *doc, size_t object, const char *key){
+    size_t value=tapeObjectGet(doc, object, key);
+    if(value==TAPE_NONE || tapeType(doc, value)!='"') return NULL;
+    return tapeString(doc, value, NULL);
+}
+
+/** @} */ // end of tape group
@@ -0,0 +1,153 @@
+/**
+ * @file tape.h
+ * @brief Compact, read-only JSON document stored as a tape of 64-bit words.
+ *
+ * @details The tape follows simdjson's layout. Every JSON value occupies one
+ *          64-bit word (two for numbers): the top 8 bits hold a type character
+ *          and the low 56 bits a payload. Strings live in a separate arena as
+ *          a 32-bit length, the bytes and a terminating NUL, and the tape word
+ *          stores the arena offset. Object members are a key string word
+ *          followed by the value.
+ *
+ *          Strings are interned while parsing: every distinct key or value is
+ *          stored in the arena once, and repeated occurrences (the `use`/`cmd`
+ *          keys of every shell entry, `cmake ..` under three shells) point at
+ *          the same offset. Below 4 GiB of arena, two string words are
+ *          therefore equal exactly when their payloads are, and `tapeObjectGetInterned()` compares keys
+ *          without touching their bytes.
+ *
+ *          Containers know where they end: the payload of `{` and `[` holds the
+ *          tape index one past the matching `}` or `]`, plus the element count,
+ *          so skipping a whole subtree is a single read.
+ *
+ *          | Word | Payload |
+ *          |------|---------|
+ *          | `{` / `[` | bits 0-31: index after the closing word, bits 32-55: element count |
+ *          | `}` / `]` | index of the opening word |
+ *          | `"` | offset of the string in the arena |
+ *          | `d` | none; the next word holds the IEEE-754 bits of the number |
+ *          | `t` / `f` / `n` | none |
+ */
+
+#ifndef DEVCLI_TAPE_H
+#define DEVCLI_TAPE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/** @defgroup tape Tape DOM
+ *  @brief Index-based, read-only JSON representation used to load `tasks.json`.
+ *  @{
+ */
+
+/**
+ * @def TAPE_NONE
+ * @brief Returned by lookups that find nothing.
+ */
+#define TAPE_NONE ((size_t)-1)
+
+/**
+ * @def TAPE_PARALLEL_MIN_BYTES
+ * @brief Inputs smaller than this are not worth splitting across threads.
+ *
+ * @details `tapeParseIndexed()` only parses in parallel from this size up;
+ *          below it, its single-threaded path is slower than `tapeParse()`,
+ *          so callers use the indexed parser only for inputs at least this
+ *          large on a machine with more than one hardware thread.
+ */
+#define TAPE_PARALLEL_MIN_BYTES (1u<<20)
+
+/**
+ * @brief A parsed document: the tape and its string arena.
+ */
+typedef struct JsonTape {
+    uint64_t *tape;      /**< Tape words; `tape[0]` is the root value. */
+    size_t length;       /**< Number of words in use. */
+    size_t capacity;     /**< Number of words allocated. */
+    char *strings;       /**< String arena. */
+    size_t stringsSize;  /**< Bytes of the arena in use. */
+    size_t stringsCap;   /**< Bytes of the arena allocated. */
+    size_t errorOffset;  /**< Byte offset of the first error when parsing fails. */
+    uint32_t *intern;    /**< Open-addressing set of arena offsets plus one; `0` marks a free slot. */
+    size_t internSlots;  /**< Slots in `intern` (power of two). */
+    size_t internCount;  /**< Distinct strings in the arena. */
+    size_t internHits;   /**< String occurrences that reused an interned copy. */
+    size_t internSaved;  /**< Arena bytes those occurrences would otherwise have taken. */
+} JsonTape;
+
+int tapeParse(const char *json, size_t len, JsonTape *out);
+int tapeParseIndexed(const char *json, size_t len, JsonTape *out, int threads);
+int tapeHardwareThreads(void);
+void tapeFree(JsonTape *doc);
+size_t tapeMemoryUsage(const JsonTape *doc);
+
+/** @brief Returns the type character of the word at `i`. */
+static inline char tapeType(const JsonTape *doc, size_t i){
+    return (char)(doc->tape[i]>>56);
+}
+
+/** @brief Returns the 56-bit payload of the word at `i`. */
+static inline uint64_t tapePayload(const JsonTape *doc, size_t i){
+    return doc->tape[i]&0x00FFFFFFFFFFFFFFull;
+}
+
+/**
+ * @brief Returns the index of the value following the one at `i`, skipping
+ *        containers in O(1).
+ */
+static inline size_t tapeSkip(const JsonTape *doc, size_t i){
+    char type=tapeType(doc, i);
+    if(type=='{' || type=='[') return (size_t)(tapePayload(doc, i)&0xFFFFFFFFu);
+    if(type=='d') return i+2;
+    return i+1;
+}
+
+/** @brief Returns the number of members or elements of the container at `i`. */
+static inline size_t tapeCount(const JsonTape *doc, size_t i){
+    return (size_t)(tapePayload(doc, i)>>32);
+}
+
+/** @brief Returns the index of the closing word of the container at `i`. */
+static inline size_t tapeEnd(const JsonTape *doc, size_t i){
+    return tapeSkip(doc, i)-1;
+}
+
+/**
+ * @brief Returns the string at `i` (a `"` word), optionally storing its length.
+ */
+static inline const char *tapeString(const JsonTape *doc, size_t i, size_t *len){
+    const char *base=doc->strings+tapePayload(doc, i);
+    if(len){
+        uint32_t n;
+        memcpy(&n, base, sizeof(n));
+        *len=n;
+    }
+    return base+sizeof(uint32_t);
+}
+
+double tapeNumber(const JsonTape *doc, size_t i);
+size_t tapeArrayAt(const JsonTape *doc, size_t array, size_t n);
+size_t tapeFindString(const JsonTape *doc, const char *str, size_t len);
+size_t tapeObjectGetInterned(const JsonTape *doc, size_t object, size_t keyOffset);
+size_t tapeObjectGet(const JsonTape *doc, size_t object, const char *key);
+const char *tapeObjectString(const JsonTape *doc, size_t object, const char *key);
+
+/**
+ * @def TAPE_FOR_EACH_MEMBER(doc, object, key)
+ * @brief Iterates the members of the object at `object`; the value of each
+ *        member is at `key + 1`.
+ */
+#define TAPE_FOR_EACH_MEMBER(doc, object, key) \
+    for(size_t key=(object)+1; key<tapeEnd((doc), (object)); key=tapeSkip((doc), key+1))
+
+/**
+ * @def TAPE_FOR_EACH_ELEMENT(doc, array, item)
+ * @brief Iterates the elements of the array at `array`.
+ */
+#define TAPE_FOR_EACH_ELEMENT(doc, array, item) \
+    for(size_t item=(array)+1; item<tapeEnd((doc), (array)); item=tapeSkip((doc), item))
+
+/** @} */ // end of tape group
+
+#endif /* DEVCLI_TAPE_H */
@@ -0,0 +1,936 @@
+/**
+ * @file testselect.c
+ * @brief Chooses the tests a change affects from Python import graphs and C include graphs.
+ */
+
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#define MKDIR(path) _mkdir(path)
+#else
+#include <sys/wait.h>
+#define MKDIR(path) mkdir(path, 0755)
+#endif
+#include "testselect.h"
+#include "devcli.h"
+#include "log.h"
+
+/** @addtogroup testselect
+ *  @{
+ */
+
+/**
+ * @def TEST_SELECT_VERSION
+ * @brief First line of every state file; a state file with another first
+ *        line is ignored and every test runs.
+ */
+#define TEST_SELECT_VERSION "devcli-tests-1"
+
+/**
+ * @brief Kind of test command a selection was made for.
+ */
+typedef enum {
+    TEST_KIND_PYTEST,   /**< pytest run; selected test files are appended. */
+    TEST_KIND_C         /**< Single-source C or C++ compile-and-run. */
+} TestKind;
+
+/**
+ * @brief One Python source of the project tree.
+ */
+typedef struct {
+    char *path;             /**< Relative path with `/` separators. */
+    uint64_t fingerprint;   /**< `fingerprintFile()` of the file now. */
+    char *imports;          /**< Imported module names, space separated. */
+    int *deps;              /**< Indexes of the files this one imports. */
+    int depCount;
+    int depCapacity;
+    int test;               /**< `1` for `test_*.py` and `*_test.py`. */
+    int changed;            /**< New or changed since the last run. */
+    int affected;           /**< Changed, or imports a changed file. */
+    int failed;             /**< A test that did not pass last time. */
+    int selected;           /**< A test that runs this time. */
+} PyFile;
+
+/**
+ * @brief The Python sources of the project tree, sorted by path.
+ */
+typedef struct {
+    PyFile *files;
+    int count;
+    int capacity;
+} PyTree;
+
+/**
+ * @brief Tests chosen for one run of a test command.
+ */
+struct TestSelection {
+    TestKind kind;
+    char *command;          /**< Command to run, or `NULL` to skip it. */
+    int all;                /**< Every test runs. */
+    char statePath[64];
+    char depPath[64];
+    PyTree tree;
+    uint64_t config;        /**< Fingerprint of the pytest configuration files. */
+};
+
+/**
+ * @var runEveryTest
+ * @brief Set by `--all`: run every test, but still record the state.
+ */
+static int runEveryTest=0;
+
+/**
+ * @brief Makes every later selection run all tests (`--all`).
+ *
+ * @details The state is still recorded, so the run after one with `--all`
+ *          selects from a fresh baseline.
+ *
+ * @ingroup testselect
+ */
+void testSelectAll(void){
+    runEveryTest=1;
+}
+
+/**
+ * @brief Reads a whole file into a NUL-terminated buffer.
+ *
+ * @return char* The contents, to be freed, or `NULL`.
+ */
+static char *readWhole(const char *path){
+    FILE *file=fopen(path, "rb");
+    if(!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long len=ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *text=len>=0 ? malloc((size_t)len+1) : NULL;
+    if(text && fread(text, 1, (size_t)len, file)!=(size_t)len){
+        free(text);
+        text=NULL;
+    }
+    fclose(file);
+    if(text) text[len]='\0';
+    return text;
+}
+
+/**
+ * @brief Creates `TEST_SELECT_DIR` with a `.gitignore`, and names the
+ *        state file of a command in it.
+ *
+ * @return int `0` if the directory exists.
+ */
+static int prepareState(const char *command, const char *suffix, TestSelection *selection){
+    MKDIR(TEST_SELECT_DIR);
+    struct stat info;
+    if(stat(TEST_SELECT_DIR, &info)!=0) return -1;
+    if(stat(TEST_SELECT_DIR "/.gitignore", &info)!=0){
+        FILE *file=fopen(TEST_SELECT_DIR "/.gitignore", "w");
+        if(file){
+            fputs("*\n", file);
+            fclose(file);
+        }
+    }
+    uint64_t key=fingerprintBytes(FINGERPRINT_SEED, TEST_SELECT_VERSION, sizeof(TEST_SELECT_VERSION));
+    key=fingerprintBytes(key, command, strlen(command));
+    snprintf(selection->statePath, sizeof(selection->statePath), TEST_SELECT_DIR "/%016llx.%s", (unsigned long long)key, suffix);
+    snprintf(selection->depPath, sizeof(selection->depPath), TEST_SELECT_DIR "/%016llx.d", (unsigned long long)key);
+    return 0;
+}
+
+/**
+ * @brief Returns the file name part of `path`.
+ */
+static const char *baseName(const char *path){
+    const char *base=path;
+    for(const char *p=path; *p; p++){
+        if(*p=='/' || *p=='\\') base=p+1;
+    }
+    return base;
+}
+
+/**
+ * @brief Checks that `command` is a plain pytest run whose tests devcli
+ *        may choose: `pytest`, `py.test` or `python -m pytest` with only
+ *        options, since paths already on the command line would be run in
+ *        full next to the selected files.
+ */
+static int isPlainPytest(const char *command){
+    #ifdef _WIN32
+        const char *special=";&|<>$`%^";
+    #else
+        const char *special=";&|<>$`'\\";
+    #endif
+    if(command[strcspn(command, special)] || strchr(command, '\n')) return 0;
+    char *copy=strdup(command), *words[64];
+    if(!copy) return 0;
+    int count=splitCommandWords(copy, words, 64), first=-1;
+    if(count>0){
+        const char *base=baseName(words[0]);
+        if(strcmp(base, "pytest")==0 || strcmp(base, "pytest.exe")==0 || strcmp(base, "py.test")==0) first=1;
+        else if(count>2 && strcmp(words[1], "-m")==0 && strcmp(words[2], "pytest")==0
+            && (strncmp(base, "python", 6)==0 || strcmp(base, "py")==0 || strcmp(base, "py.exe")==0)) first=3;
+    }
+    for(int i=first>0 ? first : count; i<count; i++){
+        if(words[i][0]!='-') first=-1;
+    }
+    free(copy);
+    return first>0;
+}
+
+/**
+ * @brief Returns `1` if the path is a test module in pytest's default
+ *        naming, `test_*.py` or `*_test.py`.
+ */
+static int isTestModule(const char *path){
+    const char *base=baseName(path);
+    size_t len=strlen(base);
+    return strncmp(base, "test_", 5)==0 || (len>8 && strcmp(base+len-8, "_test.py")==0);
+}
+
+/**
+ * @brief Adds a Python source to the tree.
+ *
+ * @return int `0` on success.
+ */
+static int addFile(PyTree *tree, const char *path, const struct stat *info){
+    if(tree->count==tree->capacity){
+        int capacity=tree->capacity ? tree->capacity*2 : 256;
+        PyFile *grown=realloc(tree->files, (size_t)capacity*sizeof(PyFile));
+        if(!grown) return -1;
+        tree->files=grown;
+        tree->capacity=capacity;
+    }
+    PyFile *file=&tree->files[tree->count];
+    memset(file, 0, sizeof(*file));
+    file->path=strdup(path);
+    if(!file->path) return -1;
+    file->fingerprint=fingerprintFile(FINGERPRINT_SEED, path, info);
+    file->test=isTestModule(path);
+    tree->count++;
+    return 0;
+}
+
+/**
+ * @brief State `visitPython()` fills while the working directory is walked.
+ */
+typedef struct {
+    PyTree *tree;
+    uint64_t *config;
+    int *custom;
+} PyWalk;
+
+/**
+ * @brief Adds a Python source found by `walkPythonTree()` to the tree, and
+ *        at the top fingerprints the pytest configuration.
+ *
+ * @details `*custom` is set when a configuration file changes
+ *          `python_files`, since test modules can then not be told apart.
+ */
+static void visitPython(const char *path, const char *name, const struct stat *info, int depth, void *context){
+    PyWalk *walk=context;
+    size_t len=strlen(name);
+    if(len>3 && strcmp(name+len-3, ".py")==0) addFile(walk->tree, path, info);
+    else if(depth==0 && (strcmp(name, "pytest.ini")==0 || strcmp(name, "pyproject.toml")==0
+        || strcmp(name, "setup.cfg")==0 || strcmp(name, "tox.ini")==0)){
+        *walk->config+=fingerprintFile(FINGERPRINT_SEED, path, info);
+        char *text=readWhole(path);
+        if(text && strstr(text, "python_files")) *walk->custom=1;
+        free(text);
+    }
+}
+
+static int compareFiles(const void *a, const void *b){
+    return strcmp(((const PyFile*)a)->path, ((const PyFile*)b)->path);
+}
+
+/**
+ * @brief Finds a source of the tree by path.
+ *
+ * @return int Its index, or `-1`.
+ */
+static int findFile(const PyTree *tree, const char *path){
+    int low=0, high=tree->count-1;
+    while(low<=high){
+        int mid=(low+high)/2, order=strcmp(tree->files[mid].path, path);
+        if(order==0) return mid;
+        if(order<0) low=mid+1;
+        else high=mid-1;
+    }
+    return -1;
+}
+
+static void addDep(PyFile *file, int dep){
+    if(dep<0) return;
+    if(file->depCount==file->depCapacity){
+        int capacity=file->depCapacity ? file->depCapacity*2 : 8;
+        int *grown=realloc(file->deps, (size_t)capacity*sizeof(int));
+        if(!grown) return;
+        file->deps=grown;
+        file->depCapacity=capacity;
+    }
+    file->deps[file->depCount++]=dep;
+}
+
+/**
+ * @brief Appends an import token to a growing buffer, followed by a space.
+ */
+static void appendToken(char **out, size_t *len, size_t *capacity, const char *module, const char *name){
+    size_t need=strlen(module)+(name ? strlen(name)+1 : 0)+2;
+    if(*len+need>*capacity){
+        size_t capacity2=(*capacity+need)*2;
+        char *grown=realloc(*out, capacity2);
+        if(!grown) return;
+        *out=grown;
+        *capacity=capacity2;
+    }
+    size_t dots=strspn(module, ".");
+    *len+=sprintf(*out+*len, name ? (module[dots] ? "%s.%s " : "%s%s ") : "%s ", module, name ? name : "");
+}
+
+/**
+ * @brief Returns `1` if `word` is a dotted Python name, possibly relative.
+ */
+static int isModuleName(const char *word){
+    if(!*word) return 0;
+    for(const char *p=word; *p; p++){
+        if(!(*p=='.' || *p=='_' || (*p>='a' && *p<='z') || (*p>='A' && *p<='Z') || (*p>='0' && *p<='9'))) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Records the modules one `import` or `from` statement names.
+ *
+ * @details `import a.b as c, d` names `a.b` and `d`; `from a import b, c`
+ *          names `a`, `a.b` and `a.c`, since `b` and `c` may be submodules.
+ *          Relative names keep their leading dots.
+ */
+static void scanStatement(char *statement, char **out, size_t *len, size_t *capacity){
+    for(char *p=statement; *p; p++){
+        if(*p==',' || *p=='(' || *p==')' || *p=='\t' || *p=='\r' || *p=='\n') *p=' ';
+    }
+    char *words[256];
+    int count=0;
+    for(char *word=strtok(statement, " "); word && count<256; word=strtok(NULL, " ")) words[count++]=word;
+    if(count<2) return;
+    if(strcmp(words[0], "import")==0){
+        for(int i=1; i<count; i++){
+            if(strcmp(words[i], "as")==0) i++;
+            else if(isModuleName(words[i])) appendToken(out, len, capacity, words[i], NULL);
+        }
+    }
+    else if(count>=4 && strcmp(words[0], "from")==0 && strcmp(words[2], "import")==0 && isModuleName(words[1])){
+        appendToken(out, len, capacity, words[1], NULL);
+        for(int i=3; i<count; i++){
+            if(strcmp(words[i], "as")==0) i++;
+            else if(strcmp(words[i], "*")!=0 && isModuleName(words[i]) && !strchr(words[i], '.')) appendToken(out, len, capacity, words[1], words[i]);
+        }
+    }
+}
+
+/**
+ * @brief Statically scans a Python source for the modules it imports.
+ *
+ * @details Only `import` and `from ... import` statements are read,
+ *          including parenthesised and backslash-continued ones and those
+ *          inside functions; `importlib` and `__import__()` calls are not
+ *          seen.
+ *
+ * @return char* The module names, space separated, to be freed.
+ */
+static char *scanImports(const char *path){
+    size_t len=0, capacity=256;
+    char *out=malloc(capacity), *text=readWhole(path);
+    if(!out){
+        free(text);
+        return NULL;
+    }
+    out[0]='\0';
+    for(char *p=text; p && *p; ){
+        while(*p==' ' || *p=='\t') p++;
+        if(strncmp(p, "import ", 7)!=0 && strncmp(p, "from ", 5)!=0){
+            while(*p && *p!='\n' && *p!=';') p++;
+            if(*p) p++;
+            continue;
+        }
+        char *end=p;
+        int depth=0;
+        while(*end && !(depth==0 && (*end=='\n' || *end==';'))){
+            if(*end=='(') depth++;
+            else if(*end==')' && depth>0) depth--;
+            else if(*end=='\\' && end[1]=='\n') *end=' ';
+            else if(*end=='\\' && end[1]=='\r' && end[2]=='\n'){
+                *end=' ';
+                end[1]=' ';
+            }
+            else if(*end=='#'){
+                while(*end && *end!='\n') *end++=' ';
+                continue;
+            }
+            end++;
+        }
+        char last=*end;
+        *end='\0';
+        scanStatement(p, &out, &len, &capacity);
+        p=last ? end+1 : end;
+    }
+    free(text);
+    return out;
+}
+
+/**
+ * @brief Copies the directory part of `path` (`""` at the top) to `out`.
+ */
+static void directoryOf(const char *path, char *out, size_t size){
+    const char *slash=strrchr(path, '/');
+    size_t len=slash ? (size_t)(slash-path) : 0;
+    if(len>=size) len=size-1;
+    memcpy(out, path, len);
+    out[len]='\0';
+}
+
+/**
+ * @brief Adds the files that importing `module` (no leading dots) from the
+ *        directory `root` would run: every package `__init__.py` on the way
+ *        and the module itself.
+ */
+static void resolveModule(const PyTree *tree, PyFile *file, const char *root, const char *module){
+    char prefix[4096], path[4200];
+    snprintf(prefix, sizeof(prefix), "%s", root);
+    if(!*module){
+        snprintf(path, sizeof(path), prefix[0] ? "%s/__init__.py" : "%s__init__.py", prefix);
+        addDep(file, findFile(tree, path));
+        return;
+    }
+    const char *part=module;
+    while(*part){
+        size_t n=strcspn(part, ".");
+        size_t used=strlen(prefix);
+        if(used+n+2>=sizeof(prefix)) return;
+        if(used) prefix[used++]='/';
+        memcpy(prefix+used, part, n);
+        prefix[used+n]='\0';
+        snprintf(path, sizeof(path), "%s.py", prefix);
+        int found=findFile(tree, path);
+        if(found>=0){
+            addDep(file, found);
+            return;
+        }
+        snprintf(path, sizeof(path), "%s/__init__.py", prefix);
+        addDep(file, findFile(tree, path));
+        part+=n;
+        if(*part=='.') part++;
+    }
+}
+
+/**
+ * @brief Resolves the imports of one file to files of the tree.
+ *
+ * @details An absolute name is looked up from the file's own directory,
+ *          from the first directory above it that is not a package (where
+ *          pytest puts test modules on `sys.path`), from the working
+ *          directory and from `src`; every match counts, so a name that
+ *          Python would find in only one of them still makes the file
+ *          depend on all. Relative names are looked up from the file's
+ *          package. A test module also depends on every `conftest.py` from
+ *          its directory up to the working directory.
+ */
+static void resolveFile(const PyTree *tree, int index){
+    PyFile *file=&tree->files[index];
+    char dir[4096], basedir[4096], path[4200];
+    directoryOf(file->path, dir, sizeof(dir));
+    snprintf(basedir, sizeof(basedir), "%s", dir);
+    while(basedir[0]){
+        snprintf(path, sizeof(path), "%s/__init__.py", basedir);
+        if(findFile(tree, path)<0) break;
+        directoryOf(basedir, basedir, sizeof(basedir));
+    }
+    char *tokens=file->imports ? strdup(file->imports) : NULL;
+    for(char *token=tokens ? strtok(tokens, " ") : NULL; token; token=strtok(NULL, " ")){
+        size_t dots=strspn(token, ".");
+        if(dots>0){
+            char base[4096];
+            snprintf(base, sizeof(base), "%s", dir);
+            for(size_t i=1; i<dots; i++) directoryOf(base, base, sizeof(base));
+            resolveModule(tree, file, base, "");
+            resolveModule(tree, file, base, token+dots);
+            continue;
+        }
+        const char *roots[4]={dir, basedir, "", "src"};
+        for(int r=0; r<4; r++){
+            if(r>0 && strcmp(roots[r], roots[r-1])==0) continue;
+            resolveModule(tree, file, roots[r], token);
+        }
+    }
+    free(tokens);
+    if(!file->test) return;
+    snprintf(path, sizeof(path), "conftest.py");
+    addDep(file, findFile(tree, path));
+    for(const char *slash=strchr(file->path, '/'); slash; slash=strchr(slash+1, '/')){
+        snprintf(path, sizeof(path), "%.*s/conftest.py", (int)(slash-file->path), file->path);
+        addDep(file, findFile(tree, path));
+    }
+}
+
+/**
+ * @brief Marks every file that imports an affected file, directly or not,
+ *        as affected too.
+ */
+static void propagate(PyTree *tree){
+    int count=tree->count, total=0;
+    for(int i=0; i<count; i++) total+=tree->files[i].depCount;
+    int *start=calloc((size_t)count+1, sizeof(int)), *users=malloc((size_t)(total>0 ? total : 1)*sizeof(int));
+    int *fill=malloc((size_t)(count>0 ? count : 1)*sizeof(int)), *queue=malloc((size_t)(count>0 ? count : 1)*sizeof(int));
+    if(!start || !users || !fill || !queue){
+        for(int i=0; i<count; i++) tree->files[i].affected=1;
+        free(start);
+        free(users);
+        free(fill);
+        free(queue);
+        return;
+    }
+    for(int i=0; i<count; i++){
+        for(int d=0; d<tree->files[i].depCount; d++) start[tree->files[i].deps[d]+1]++;
+    }
+    for(int i=0; i<count; i++) start[i+1]+=start[i];
+    memcpy(fill, start, (size_t)count*sizeof(int));
+    for(int i=0; i<count; i++){
+        for(int d=0; d<tree->files[i].depCount; d++) users[fill[tree->files[i].deps[d]]++]=i;
+    }
+    int head=0, tail=0;
+    for(int i=0; i<count; i++){
+        tree->files[i].affected=tree->files[i].changed;
+        if(tree->files[i].affected) queue[tail++]=i;
+    }
+    while(head<tail){
+        int at=queue[head++];
+        for(int u=start[at]; u<start[at+1]; u++){
+            PyFile *user=&tree->files[users[u]];
+            if(user->affected) continue;
+            user->affected=1;
+            queue[tail++]=users[u];
+        }
+    }
+    free(start);
+    free(users);
+    free(fill);
+    free(queue);
+}
+
+/**
+ * @brief Reads the state of the last run of a pytest command: the
+ *        fingerprint and imports of every source, and the tests that did
+ *        not pass.
+ *
+ * @details Files whose fingerprint is unchanged take their imports from
+ *          the state; the others are marked changed.
+ *
+ * @return int `0` if the state is usable, `-1` if there is none, `-2` if
+ *         the configuration changed or a source was deleted.
+ */
+static int loadPythonState(TestSelection *selection){
+    PyTree *tree=&selection->tree;
+    char *text=readWhole(selection->statePath);
+    if(!text) return -1;
+    char *line=text, *next;
+    int usable=strncmp(text, TEST_SELECT_VERSION "\n", sizeof(TEST_SELECT_VERSION))==0, deleted=0, configured=1;
+    for(int i=0; i<tree->count; i++) tree->files[i].changed=1;
+    for(; usable && line && *line; line=next){
+        next=strchr(line, '\n');
+        if(next) *next++='\0';
+        char *field=strchr(line, '\t');
+        if(!field) continue;
+        *field++='\0';
+        if(strcmp(line, "config")==0){
+            if(strtoull(field, NULL, 16)!=selection->config) configured=0;
+        }
+        else if(strcmp(line, "failed")==0){
+            int found=findFile(tree, field);
+            if(found>=0) tree->files[found].failed=1;
+        }
+        else if(strcmp(line, "file")==0){
+            char *path=strchr(field, '\t'), *imports=path ? strchr(path+1, '\t') : NULL;
+            if(!imports) continue;
+            *path++='\0';
+            *imports++='\0';
+            int found=findFile(tree, path);
+            if(found<0) deleted=1;
+            else if(strtoull(field, NULL, 16)==tree->files[found].fingerprint){
+                tree->files[found].changed=0;
+                tree->files[found].imports=strdup(imports);
+            }
+        }
+    }
+    free(text);
+    if(!usable) return -1;
+    return deleted || !configured ? -2 : 0;
+}
+
+/**
+ * @brief Records the state of this run of a pytest command.
+ *
+ * @details A test is recorded as failed if it ran in a run that did not
+ *          pass; such tests run again next time whatever changed.
+ */
+static void savePythonState(const TestSelection *selection, int failed){
+    char temp[80];
+    snprintf(temp, sizeof(temp), "%s.tmp", selection->statePath);
+    FILE *file=fopen(temp, "w");
+    if(!file) return;
+    fprintf(file, "%s\nconfig\t%016llx\n", TEST_SELECT_VERSION, (unsigned long long)selection->config);
+    const PyTree *tree=&selection->tree;
+    for(int i=0; i<tree->count; i++){
+        const PyFile *source=&tree->files[i];
+        if(source->test && (failed ? source->selected : 0)) fprintf(file, "failed\t%s\n", source->path);
+    }
+    for(int i=0; i<tree->count; i++){
+        const PyFile *source=&tree->files[i];
+        fprintf(file, "file\t%016llx\t%s\t%s\n", (unsigned long long)source->fingerprint, source->path, source->imports ? source->imports : "");
+    }
+    if(fclose(file)!=0){
+        remove(temp);
+        return;
+    }
+    remove(selection->statePath);
+    rename(temp, selection->statePath);
+}
+
+/**
+ * @brief Chooses the test modules of a pytest command that a change affects.
+ *
+ * @return int `0` with `selection->command` set, or `NULL` if no test is
+ *         affected; `-1` if the command cannot be narrowed.
+ */
+static int selectPython(const char *command, TestSelection *selection){
+    PyTree *tree=&selection->tree;
+    int custom=0;
+    PyWalk walk={tree, &selection->config, &custom};
+    walkPythonTree("", visitPython, &walk);
+    if(custom || tree->count==0) return -1;
+    qsort(tree->files, (size_t)tree->count, sizeof(PyFile), compareFiles);
+    int tests=0, state=loadPythonState(selection);
+    for(int i=0; i<tree->count; i++){
+        tests+=tree->files[i].test;
+        if(!tree->files[i].imports) tree->files[i].imports=scanImports(tree->files[i].path);
+    }
+    if(tests==0) return -1;
+    selection->all=runEveryTest || state!=0;
+    int chosen=0;
+    size_t len=strlen(command)+1;
+    if(!selection->all){
+        for(int i=0; i<tree->count; i++) resolveFile(tree, i);
+        propagate(tree);
+        for(int i=0; i<tree->count; i++){
+            PyFile *file=&tree->files[i];
+            file->selected=file->test && (file->affected || file->failed);
+            if(!file->selected) continue;
+            chosen++;
+            len+=strlen(file->path)+3;
+        }
+        selection->all=chosen==tests || len>TEST_SELECT_MAX_COMMAND;
+    }
+    if(selection->all){
+        for(int i=0; i<tree->count; i++) tree->files[i].selected=tree->files[i].test;
+        if(runEveryTest) LOG("--all given; running all %d test modules.", tests);
+        else if(state==-1) LOG("No record of the last run; running all %d test modules.", tests);
+        else if(state==-2) LOG("A source was deleted or the pytest configuration changed; running all %d test modules.", tests);
+        else LOG("All %d test modules are affected by the changes since the last run.", tests);
+        selection->command=strdup(command);
+        return selection->command ? 0 : -1;
+    }
+    if(chosen==0){
+        LOG("None of the %d test modules is affected by the changes since the last run; skipping.", tests);
+        return 0;
+    }
+    selection->command=malloc(len);
+    if(!selection->command) return -1;
+    char *p=selection->command+sprintf(selection->command, "%s", command);
+    for(int i=0; i<tree->count; i++){
+        if(tree->files[i].selected) p+=sprintf(p, strchr(tree->files[i].path, ' ') ? " \"%s\"" : " %s", tree->files[i].path);
+    }
+    LOG("%d of %d test modules are affected by the changes since the last run; running those.", chosen, tests);
+    return 0;
+}
+
+/**
+ * @brief Returns `1` if `word` names gcc, g++, cc, c++, clang or clang++,
+ *        possibly with a path, a version suffix such as `-13`, or `.exe`.
+ */
+static int isCompiler(const char *word){
+    static const char *const names[]={"gcc", "g++", "cc", "c++", "clang", "clang++"};
+    const char *base=baseName(word);
+    for(size_t i=0; i<sizeof(names)/sizeof(names[0]); i++){
+        size_t len=strlen(names[i]);
+        if(strncmp(base, names[i], len)!=0) continue;
+        const char *rest=base+len;
+        if(*rest=='-' && rest[1]>='0' && rest[1]<='9') rest+=strspn(rest+1, "0123456789.")+1;
+        if(*rest=='\0' || strcmp(rest, ".exe")==0) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Checks that `command` starts with a compile of exactly one C or
+ *        C++ source, such as `gcc {{name}}.c -o {{name}} && ./{{name}}`.
+ *
+ * @return int Length of the compiler word in `command`, or `0`.
+ */
+static size_t singleSourceCompile(const char *command){
+    size_t head=strcspn(command, ";&|");
+    char *copy=malloc(head+1), *words[256];
+    if(!copy) return 0;
+    memcpy(copy, command, head);
+    copy[head]='\0';
+    int count=splitCommandWords(copy, words, 256), sources=0;
+    for(int i=1; i<count; i++){
+        const char *dot=strrchr(words[i], '.');
+        if(words[i][0]!='-' && dot && (strcmp(dot, ".c")==0 || strcmp(dot, ".cc")==0 || strcmp(dot, ".cpp")==0
+            || strcmp(dot, ".cxx")==0 || strcmp(dot, ".C")==0)) sources++;
+        if(strncmp(words[i], "-M", 2)==0 || strcmp(words[i], "-E")==0) sources=2;
+    }
+    int compile=count>0 && isCompiler(words[0]) && sources==1;
+    free(copy);
+    if(!compile) return 0;
+    const char *start=command+strspn(command, " \t");
+    if(*start=='"'){
+        const char *close=strchr(start+1, '"');
+        return close ? (size_t)(close+1-command) : 0;
+    }
+    return (size_t)(start-command)+strcspn(start, " \t");
+}
+
+/**
+ * @brief Checks whether the source and headers a C test was built from
+ *        last time are all unchanged.
+ *
+ * @return int Number of inputs if all are unchanged, `-1` otherwise.
+ */
+static int inputsUnchanged(const char *statePath){
+    char *text=readWhole(statePath);
+    if(!text) return -1;
+    int count=0, same=strncmp(text, TEST_SELECT_VERSION "\n", sizeof(TEST_SELECT_VERSION))==0;
+    char *next;
+    for(char *line=text+sizeof(TEST_SELECT_VERSION); same && *line; line=next){
+        next=strchr(line, '\n');
+        if(next) *next++='\0';
+        else next=line+strlen(line);
+        char *path=strchr(line, '\t');
+        if(!path) continue;
+        *path++='\0';
+        struct stat info;
+        same=stat(path, &info)==0 && fingerprintFile(FINGERPRINT_SEED, path, &info)==strtoull(line, NULL, 16);
+        count++;
+    }
+    free(text);
+    return same && count>0 ? count : -1;
+}
+
+/**
+ * @brief Records the inputs listed in the dependency file the compiler
+ *        wrote with `-MMD -MF`, with their fingerprints.
+ *
+ * @details Only the first rule is read. Escaped spaces (`\ `), `$$` and
+ *          continuation lines are understood, and a colon followed by `\`
+ *          or `/` is taken as part of a Windows drive path.
+ */
+static void saveIncludeState(const TestSelection *selection){
+    char *text=readWhole(selection->depPath);
+    if(!text) return;
+    char *p=text;
+    while(*p && !(*p==':' && (p[1]==' ' || p[1]=='\t' || p[1]=='\r' || p[1]=='\n' || p[1]=='\0'))) p++;
+    char temp[80];
+    snprintf(temp, sizeof(temp), "%s.tmp", selection->statePath);
+    FILE *file=*p ? fopen(temp, "w") : NULL;
+    if(!file){
+        free(text);
+        return;
+    }
+    fprintf(file, "%s\n", TEST_SELECT_VERSION);
+    char path[4096];
+    size_t len=0;
+    for(p++; ; p++){
+        int endRule=*p=='\0' || *p=='\n';
+        if(*p=='\\' && (p[1]=='\n' || (p[1]=='\r' && p[2]=='\n'))){
+            p+=p[1]=='\r' ? 2 : 1;
+            endRule=0;
+        }
+        else if(*p=='\\' && p[1]==' '){
+            if(len<sizeof(path)-1) path[len++]=' ';
+            p++;
+            continue;
+        }
+        else if(*p=='$' && p[1]=='$'){
+            if(len<sizeof(path)-1) path[len++]='$';
+            p++;
+            continue;
+        }
+        else if(!endRule && *p!=' ' && *p!='\t' && *p!='\r'){
+            if(len<sizeof(path)-1) path[len++]=*p;
+            continue;
+        }
+        if(len>0){
+            path[len]='\0';
+            struct stat info;
+            if(stat(path, &info)==0) fprintf(file, "%016llx\t%s\n", (unsigned long long)fingerprintFile(FINGERPRINT_SEED, path, &info), path);
+            len=0;
+        }
+        if(endRule) break;
+    }
+    free(text);
+    if(fclose(file)!=0){
+        remove(temp);
+        return;
+    }
+    remove(selection->statePath);
+    rename(temp, selection->statePath);
+}
+
+/**
+ * @brief Skips a single-source C or C++ test whose source and headers are
+ *        unchanged since its last passing run, or adds `-MMD -MF` to its
+ *        compile so that the headers it includes are known afterwards.
+ *
+ * @return int `0` with `selection->command` set, or `NULL` to skip it;
+ *         `-1` if the command is not such a test.
+ */
+static int selectC(const char *command, TestSelection *selection){
+    size_t compiler=singleSourceCompile(command);
+    if(compiler==0) return -1;
+    selection->all=1;
+    if(!runEveryTest){
+        int inputs=inputsUnchanged(selection->statePath);
+        if(inputs>0){
+            LOG("The source and headers of this test (%d files) are unchanged since it last passed; skipping.", inputs);
+            return 0;
+        }
+        LOG("This test has not passed with its current source and headers; running it.");
+    }
+    else LOG("--all given; running the test.");
+    size_t len=strlen(command)+strlen(selection->depPath)+16;
+    selection->command=malloc(len);
+    if(!selection->command) return -1;
+    snprintf(selection->command, len, "%.*s -MMD -MF %s%s", (int)compiler, command, selection->depPath, command+compiler);
+    return 0;
+}
+
+/**
+ * @brief Chooses what a test command runs, from the files changed since
+ *        its last run.
+ *
+ * @details Two kinds of test commands are understood; anything else
+ *          returns `NULL` and runs unchanged.
+ *
+ *          A plain pytest command such as `test.py` (no paths of its own)
+ *          is given the test modules a change affects. Every Python source
+ *          below the working directory is fingerprinted (`fingerprintFile()`)
+ *          and statically scanned for its imports; a test module is affected
+ *          if it, a `conftest.py` above it, or any module it imports
+ *          directly or through others changed, was added, or failed last
+ *          time. A deleted source, a changed pytest configuration file, no
+ *          record of a previous run, or `--all` (`testSelectAll()`) runs
+ *          every test. The imports of unchanged files are kept in the state
+ *          and not scanned again.
+ *
+ *          A compile-and-run of one C or C++ source, such as `test.gcc`, is
+ *          skipped when the source and every header listed in the
+ *          dependency file of its last passing run are unchanged, and
+ *          otherwise runs with `-MMD -MF` added so that its include graph
+ *          is recorded for next time. System headers and the compiler
+ *          itself are not tracked.
+ *
+ *          The change set is the files whose path, size or modification
+ *          time differ from the last run, so uncommitted edits count and
+ *          the selection works outside git. Files a test reads at run time
+ *          rather than imports or includes, such as data files, are not
+ *          tracked; use `--all` after changing them. The state of each
+ *          command is kept in `TEST_SELECT_DIR`.
+ *
+ * @ingroup testselect
+ *
+ * @param command Test command after placeholder substitution.
+ *
+ * @return TestSelection* The selection, to pass to `testSelectCommand()`
+ *         and `testSelectEnd()`, or `NULL` if the command is run as is.
+ *
+ * Example usage:
+ * @code
+ * TestSelection *selection = testSelectBegin("pytest");
+ * int status = 0;
+ * if (!selection) status = spawnShell("pytest", NULL, NULL);
+ * else {
+ *     if (testSelectCommand(selection))
+ *         status = spawnShell(testSelectCommand(selection), NULL, NULL);
+ *     testSelectEnd(selection, status);
+ * }
+ * @endcode
+ */
+TestSelection *testSelectBegin(const char *command){
+    int python=isPlainPytest(command);
+    if(!python && singleSourceCompile(command)==0) return NULL;
+    TestSelection *selection=calloc(1, sizeof(TestSelection));
+    if(!selection) return NULL;
+    selection->kind=python ? TEST_KIND_PYTEST : TEST_KIND_C;
+    int result=prepareState(command, python ? "py" : "c", selection);
+    if(result==0) result=python ? selectPython(command, selection) : selectC(command, selection);
+    if(result!=0){
+        testSelectEnd(selection, -1);
+        return NULL;
+    }
+    return selection;
+}
+
+/**
+ * @brief Returns the command a selection runs.
+ *
+ * @ingroup testselect
+ *
+ * @return const char* The command, or `NULL` if no test is affected and
+ *         nothing needs to run.
+ */
+const char *testSelectCommand(const TestSelection *selection){
+    return selection->command;
+}
+
+/**
+ * @brief Records the outcome of a selection and frees it.
+ *
+ * @details For pytest, the fingerprints and imports of every source are
+ *          saved, and the tests that ran are recorded as failed when
+ *          `status` is neither `0` nor `5` (no tests collected). For a C
+ *          test, its inputs are saved after a passing run and forgotten
+ *          after a failing one.
+ *
+ * @ingroup testselect
+ *
+ * @param selection Selection from `testSelectBegin()`.
+ * @param status Exit status of the command, `0` if it was skipped, or
+ *        `-1` to discard the selection without recording anything.
+ */
+void testSelectEnd(TestSelection *selection, int status){
+    if(!selection) return;
+    if(status!=-1){
+        int code=status;
+        #ifndef _WIN32
+            if(WIFEXITED(status)) code=WEXITSTATUS(status);
+        #endif
+        if(selection->kind==TEST_KIND_PYTEST) savePythonState(selection, code!=0 && code!=5);
+        else if(selection->command && status==0) saveIncludeState(selection);
+        else if(selection->command) remove(selection->statePath);
+        if(selection->kind==TEST_KIND_C) remove(selection->depPath);
+    }
+    for(int i=0; i<selection->tree.count; i++){
+        free(selection->tree.files[i].path);
+        free(selection->tree.files[i].imports);
+        free(selection->tree.files[i].deps);
+    }
+    free(selection->tree.files);
+    free(selection->command);
+    free(selection);
+}
+
+/** @} */ // end of testselect group
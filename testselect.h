@@ -0,0 +1,40 @@
+/**
+ * @file testselect.h
+ * @brief Runs only the tests affected by the files changed since the last test run.
+ */
+
+#ifndef DEVCLI_TESTSELECT_H
+#define DEVCLI_TESTSELECT_H
+
+/** @defgroup testselect Test Selection
+ *  @brief Dependency maps from sources to tests, and the tests a change set affects.
+ *  @{
+ */
+
+/**
+ * @def TEST_SELECT_DIR
+ * @brief Directory, below the task's working directory, holding one state
+ *        file per test command.
+ */
+#define TEST_SELECT_DIR ".devcli_tests"
+
+/**
+ * @def TEST_SELECT_MAX_COMMAND
+ * @brief Longest command a selection may grow to; longer selections run
+ *        every test instead.
+ */
+#define TEST_SELECT_MAX_COMMAND 8000
+
+/**
+ * @brief Tests chosen for one run of a test command (see `testSelectBegin()`).
+ */
+typedef struct TestSelection TestSelection;
+
+void testSelectAll(void);
+TestSelection *testSelectBegin(const char *command);
+const char *testSelectCommand(const TestSelection *selection);
+void testSelectEnd(TestSelection *selection, int status);
+
+/** @} */ // end of testselect group
+
+#endif /* DEVCLI_TESTSELECT_H */